@@ -0,0 +1,21 @@
+#pragma once
+
+/* Parameters of the bounding hierarchy, from the bvh line of the scene description */
+struct bvh_parameters {
+
+    enum class builder {
+        Disabled, KMeans, SAH
+    };
+
+    builder builder_ = builder::Disabled;
+
+    /* KMeans: average number of polygons in the terminal nodes */
+    unsigned int polygons_per_bounding = 0;
+
+    /* SAH: number of children of the internal nodes (2 or 4) */
+    unsigned int arity = 2;
+
+    inline bool enabled() const {
+        return builder_ != builder::Disabled;
+    }
+};
@@ -3,6 +3,8 @@
 #include "scene/objects/object.hpp"
 #include "scene/bounding/bounding.hpp"
 
+#include <cstdint>
+#include <optional>
 #include <variant>
 
 /* K-means clustering algorithm */
@@ -90,5 +92,6 @@ const bounding* create_bounding_hierarchy(std::vector<const object*>&& content,
 
 /** Tests **/
 
-/* Displays the depth of the hierarchy, as well as the minimum, maximum and average arity of each depth */
-void display_hierarchy_properties(const bounding* bd0);
\ No newline at end of file
+/* Displays the depth of the hierarchy, as well as the minimum, maximum and average arity of each depth,
+   the SAH cost of the hierarchy and its build time (in ms) if provided */
+void display_hierarchy_properties(const bounding* bd0, std::optional<uint64_t> build_time = std::nullopt);
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "scene/objects/object.hpp"
+#include "scene/bounding/bounding.hpp"
+
+#include <vector>
+
+/* Binned Surface Area Heuristic builder
+
+   The objects are split recursively along the plane (among SAH_NUMBER_OF_BINS candidates per axis)
+   that minimizes the expected cost of a ray traversal, and a node becomes terminal when intersecting
+   all its objects is cheaper than splitting it.
+   The top levels are split sequentially, then the subtrees are built in parallel.
+   The binary tree is then collapsed into a tree of the given arity (2 or 4). */
+const bounding* create_sah_hierarchy(std::vector<const object*>&& content, unsigned int arity);
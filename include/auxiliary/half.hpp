@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+/* Conversions between single- and half-precision floats (IEEE 754 binary16),
+   used by the half-precision textures and the compact raw data files
+   The F16C instructions are used when they are available, otherwise the bits are computed */
+
+/* Rounds x to the nearest half-precision float (saturated at the largest finite one) */
+inline uint16_t float_to_half(const float x) {
+#if defined(__F16C__)
+    return _cvtss_sh(std::clamp(x, -65504.0f, 65504.0f), _MM_FROUND_TO_NEAREST_INT);
+#else
+    constexpr float MAX_HALF = 65504.0f;
+    constexpr float MIN_NORMAL_HALF = 0x1p-14f;
+
+    const uint16_t sign = std::signbit(x) ? 0x8000 : 0;
+    const float a = std::abs(x);
+
+    if (not (a > 0.0f))
+        return sign;
+    if (a >= MAX_HALF)
+        return sign | 0x7BFF;
+    /* The roundings are to the nearest, ties to even (in the default rounding mode), as with the F16C instructions */
+    if (a < MIN_NORMAL_HALF)
+        // Subnormal numbers (a rounding up to 1024 gives the smallest normal number)
+        return sign | static_cast<uint16_t>(std::nearbyint(std::ldexp(a, 24)));
+
+    int exponent;
+    const float fraction = std::frexp(a, &exponent); // a = fraction * 2^exponent, fraction in [0.5, 1)
+    uint32_t biased_exponent = exponent - 1 + 15;
+    uint32_t mantissa = static_cast<uint32_t>(std::nearbyint((2.0f * fraction - 1.0f) * 1024.0f));
+    if (mantissa == 1024) {
+        mantissa = 0;
+        biased_exponent++;
+    }
+    return sign | ((biased_exponent >= 0x1F) ? 0x7BFF : static_cast<uint16_t>((biased_exponent << 10) | mantissa));
+#endif
+}
+
+inline float half_to_float(const uint16_t h) {
+#if defined(__F16C__)
+    return _cvtsh_ss(h);
+#else
+    const uint32_t sign     = static_cast<uint32_t>(h & 0x8000) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1F;
+    const uint32_t mantissa = h & 0x3FF;
+
+    if (exponent == 0) {
+        // Subnormal numbers
+        const float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign != 0 ? -value : value;
+    }
+    if (exponent == 0x1F)
+        return std::bit_cast<float>(sign | 0x7F800000 | (mantissa << 13));
+    return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+#endif
+}
@@ -2,24 +2,183 @@
 
 #include "parameters.hpp"
 #include "auxiliary/timer.hpp"
+#include "auxiliary/sampler.hpp"
 
-#include <random>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+/* splitmix64: used to expand a 64-bit seed into the state of the generator, and to mix seeds */
+constexpr uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/* Combines a seed and two counters (e.g. the pixel index and the sample index) into a new seed */
+constexpr uint64_t mix_seed(const uint64_t seed, const uint64_t a, const uint64_t b) {
+    uint64_t state = seed;
+    state ^= splitmix64(state) + a;
+    state ^= splitmix64(state) + b;
+    return splitmix64(state);
+}
+
+/* xoshiro256+ generator (Blackman, Vigna): 256 bits of state, suited for floating-point generation */
+class xoshiro256plus {
+
+    private:
+        std::array<uint64_t, 4> s;
+
+        static constexpr uint64_t rotl(const uint64_t x, const int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+
+    public:
+        using result_type = uint64_t;
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        explicit constexpr xoshiro256plus(const uint64_t seed) {
+            reseed(seed);
+        }
+
+        constexpr void reseed(uint64_t seed) {
+            for (uint64_t& x : s)
+                x = splitmix64(seed);
+        }
+
+        constexpr result_type operator()() {
+            const uint64_t result = s[0] + s[3];
+            const uint64_t t = s[1] << 17;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = rotl(s[3], 45);
+            return result;
+        }
+};
+
+/* Converts 64 random bits into a floating-point number uniformly distributed in [0, 1),
+   using the high bits (the low bits of xoshiro256+ are weaker) */
+template<typename Float>
+requires std::is_floating_point_v<Float>
+constexpr Float to_ratio(const uint64_t x) {
+    if constexpr (std::is_same_v<Float, float>)
+        return static_cast<float>(x >> 40) * 0x1.0p-24f;
+    else
+        return static_cast<Float>(x >> 11) * static_cast<Float>(0x1.0p-53);
+}
+
+/* Seed used when none is given: the clock, plus a counter so that generators created
+   in the same millisecond still get different sequences */
+inline uint64_t default_seed() {
+    static std::atomic<uint64_t> counter = 0;
+    return mix_seed(timer_ms::get_time(), counter++, 0);
+}
 
 class randomgen {
 
     private:
-        mutable std::mt19937                         engine;
-        mutable std::uniform_real_distribution<real> unif_ratio;
-        mutable std::uniform_real_distribution<real> unif_angle;
-        mutable std::normal_distribution<real>       normal_dist;
+        mutable xoshiro256plus engine;
+        uint64_t seed;
+        real std_dev_normal;
+
+        /* Sample sequences: current pixel, sample index and dimension */
+        sampler_type sampler;
+        mutable uint64_t pixel_key = 0;
+        mutable uint32_t sample = 0;
+        mutable uint32_t dimension = 0;
+        mutable sampling::point_2d pixel_offset = { 0, 0 };
+
+        /* Next point of the sequence of the selected sampler, in the next dimension */
+        inline sampling::point_2d next_point() const {
+
+            const uint32_t d = dimension++;
+
+            using enum sampler_type;
+            switch (sampler) {
+                case Stratified: {
+                    const uint64_t key = mix_seed(pixel_key, d, sample >> 4);
+                    return sampling::stratified(sample, static_cast<uint32_t>(key), engine());
+                }
+                case Sobol: {
+                    const uint64_t key = mix_seed(pixel_key, d, 0);
+                    return sampling::owen_scrambled_sobol(sample, static_cast<uint32_t>(mix_seed(key, 0, 1)),
+                        static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32));
+                }
+                default: {
+                    /* The shuffling and the shift of each dimension do not depend on the pixel,
+                       so that the pattern of the pixel offsets is kept */
+                    const uint64_t key = mix_seed(seed, d, 0);
+                    return sampling::blue_noise_sobol(sample, static_cast<uint32_t>(mix_seed(key, 0, 1)), pixel_offset,
+                        static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32));
+                }
+            }
+        }
+
+        static inline real to_real(const uint32_t x) {
+            return to_ratio<real>(static_cast<uint64_t>(x) << 32);
+        }
 
     public:
         // Factor 4.0_r to improve camera ray generation computation speed
         randomgen(const real std_dev_anti_aliasing = ANTI_ALIASING)
-            :   engine(timer_ms::get_time()),
-                unif_ratio(0, 1),
-                unif_angle(0, 2 * PI),
-                normal_dist(0, (STRATIFIED_ENABLED ? 4.0_r * std_dev_anti_aliasing : std_dev_anti_aliasing)) {}
+            : randomgen(default_seed(), std_dev_anti_aliasing) {}
+
+        /* Explicit seed, for reproducible renders and generators created at the same time (e.g. one per thread) */
+        randomgen(const uint64_t seed, const real std_dev_anti_aliasing,
+            const sampler_type sampler = sampler_type::Independent)
+            :   engine(seed),
+                seed(seed),
+                std_dev_normal(STRATIFIED_ENABLED ? 4.0_r * std_dev_anti_aliasing : std_dev_anti_aliasing),
+                sampler(sampler) {}
+
+        /* True if the numbers are drawn from sample sequences (the pixel and sample are set by reseed) */
+        inline bool uses_sequences() const {
+            return sampler != sampler_type::Independent;
+        }
+
+        /* Restarts the sequence from a state that only depends on the seed, the pixel (i, j) and the sample index,
+           so that a given pixel and sample always draw the same numbers, whichever thread computes them */
+        inline void reseed(const int i, const int j, const uint32_t sample_index) const {
+            pixel_key = mix_seed(seed, (static_cast<uint64_t>(j) << 32) | static_cast<uint32_t>(i), 0);
+            engine.reseed(mix_seed(pixel_key, sample_index, 0));
+            sample = sample_index;
+            dimension = 0;
+            if (sampler == sampler_type::BlueNoise)
+                pixel_offset = sampling::blue_noise_offset(i, j);
+        }
+
+        /* Position of the generator in the sequence of a path, so that several paths can be traced alternately
+           with the same numbers as if they were traced one after the other (wavefront mode) */
+        struct state {
+            xoshiro256plus engine;
+            uint64_t pixel_key;
+            uint32_t sample;
+            uint32_t dimension;
+            sampling::point_2d pixel_offset;
+        };
+
+        inline state save_state() const {
+            return { engine, pixel_key, sample, dimension, pixel_offset };
+        }
+
+        inline void restore_state(const state& st) const {
+            engine       = st.engine;
+            pixel_key    = st.pixel_key;
+            sample       = st.sample;
+            dimension    = st.dimension;
+            pixel_offset = st.pixel_offset;
+        }
 
         /* Returns a random real between 0 and m */
         inline real random_real(real m) const {
@@ -28,22 +187,67 @@ class randomgen {
 
         /* Returns a random real between 0 and 1 */
         inline real random_ratio() const {
-            return unif_ratio(engine);
+            if (sampler == sampler_type::Independent)
+                return to_ratio<real>(engine());
+            return to_real(next_point().x);
+        }
+
+        /* Returns n random reals between 0 and 1
+           (with a sampler, they are taken two by two from 2D points) */
+        template<unsigned int n>
+        inline std::array<real, n> random_ratios() const {
+            std::array<real, n> t;
+            if (sampler == sampler_type::Independent) {
+                std::array<uint64_t, n> bits;
+                for (uint64_t& x : bits)
+                    x = engine();
+                for (unsigned int i = 0; i < n; i++)
+                    t[i] = to_ratio<real>(bits[i]);
+                return t;
+            }
+            for (unsigned int i = 0; i + 1 < n; i += 2) {
+                const sampling::point_2d p = next_point();
+                t[i]     = to_real(p.x);
+                t[i + 1] = to_real(p.y);
+            }
+            if constexpr (n % 2 == 1)
+                t[n - 1] = random_ratio();
+            return t;
+        }
+
+        /* Fills output with random reals between 0 and 1
+           (the bits are drawn first, so that the conversion loop is vectorized) */
+        inline void fill_ratios(const std::span<real> output) const {
+            if (sampler != sampler_type::Independent) {
+                for (real& x : output)
+                    x = random_ratio();
+                return;
+            }
+            constexpr std::size_t CHUNK = 64;
+            std::array<uint64_t, CHUNK> bits;
+            for (std::size_t start = 0; start < output.size(); start += CHUNK) {
+                const std::size_t size = std::min(CHUNK, output.size() - start);
+                for (std::size_t i = 0; i < size; i++)
+                    bits[i] = engine();
+                for (std::size_t i = 0; i < size; i++)
+                    output[start + i] = to_ratio<real>(bits[i]);
+            }
         }
 
         /* Returns a random real between 0 and 2 * PI */
         inline real random_angle() const {
-            return unif_angle(engine);
+            return (2.0_r * PI) * random_ratio();
         }
 
         /* Returns one random real chosen according to a normal distribution
-           of mean m and standard deviation std_dev */
+           of mean 0 and standard deviation std_dev (Box-Muller transform) */
         inline real random_normal() const {
-            return normal_dist(engine);
+            const auto [ u, v ] = random_ratios<2>();
+            return std_dev_normal * std::sqrt(-2.0_r * std::log(1.0_r - u)) * std::cos((2.0_r * PI) * v);
         }
 
-        /* Returns two random reals chosen according to a normal distribution
-           of mean m and standard deviation std_dev */
+        /* Returns n random reals chosen according to a normal distribution
+           of mean 0 and standard deviation std_dev */
         template<unsigned int n>
         requires (n >= 2)
         inline std::array<real, n> random_normal() const {
@@ -62,30 +266,29 @@ requires std::is_floating_point_v<Float>
 class random_ratio_gen {
 
     private:
-        mutable std::mt19937                          engine;
-        mutable std::uniform_real_distribution<Float> unif_ratio;
-        mutable std::uniform_int_distribution<>       unif_int;
+        mutable xoshiro256plus engine;
+        uint64_t number_of_indices;
 
     public:
-        
+
         random_ratio_gen(uint64_t seed, int max_index)
             :   engine(seed),
-                unif_ratio(0, 1),
-                unif_int(0, max_index) {}
+                number_of_indices(static_cast<uint64_t>(max_index) + 1) {}
 
         random_ratio_gen(int max_index)
-            : random_ratio_gen(timer_ms::get_time(), max_index) {}
-        
+            : random_ratio_gen(default_seed(), max_index) {}
+
         template<typename T>
         requires std::is_same_v<T, Float> || std::is_same_v<T, int>
         T random() const {
             if constexpr (std::is_same_v<T, Float>)
-                return unif_ratio(engine);
+                return to_ratio<Float>(engine());
             else
-                return unif_int(engine);
+                /* Integer between 0 and max_index, by multiplication of the high 32 bits */
+                return static_cast<int>(((engine() >> 32) * number_of_indices) >> 32);
         }
 
         Float random(Float m) const {
             return m * random<Float>();
         }
-};
\ No newline at end of file
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+
+/* Sample sequences used by randomgen when a sampler other than sampler_type::Independent is selected
+
+   Each draw of a path (pixel jitter, lens, bounce directions, Russian roulette...) uses its own dimension,
+   and the sample index of the pixel is the index in the sequence of that dimension.
+   The points are 2D, in 32-bit fixed point (the value x stands for x / 2^32),
+   so that the directions (which use two numbers) are stratified in two dimensions.
+
+   - Stratified: within each group of 16 samples, one sample in each cell of a 4x4 grid, jittered.
+   - Sobol: first two dimensions of the Sobol sequence, with an Owen scrambling and a shuffling of the index
+     that depend on the pixel and the dimension (Burley, Practical Hash-based Owen Scrambling, 2020).
+   - BlueNoise: the same Sobol points, with a shuffling of the index that depends on the dimension only
+     (so that the dimensions are not correlated), shifted (modulo 1) by an offset that depends on the pixel,
+     taken from the R2 sequence on the pixel coordinates, so that the error is distributed as a blue noise. */
+
+/* Source of the numbers drawn by the paths */
+enum class sampler_type {
+    Independent, Stratified, Sobol, BlueNoise
+};
+
+namespace sampling {
+
+    struct point_2d {
+        uint32_t x, y;
+    };
+
+    constexpr uint32_t reverse_bits(uint32_t x) {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+        x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    /* Hash in which each bit only depends on the bits of lower weight (Laine, Karras) */
+    constexpr uint32_t laine_karras_permutation(uint32_t x, const uint32_t seed) {
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+        return x;
+    }
+
+    /* Owen scrambling in base 2: each bit is flipped depending on the bits of higher weight */
+    constexpr uint32_t nested_uniform_scramble(uint32_t x, const uint32_t seed) {
+        x = reverse_bits(x);
+        x = laine_karras_permutation(x, seed);
+        return reverse_bits(x);
+    }
+
+    /* First two dimensions of the Sobol sequence: van der Corput, and the dimension generated by the Pascal matrix */
+    constexpr point_2d sobol(uint32_t index) {
+        const uint32_t x = reverse_bits(index);
+        uint32_t y = 0;
+        for (uint32_t v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1) {
+            if (index & 1u)
+                y ^= v;
+        }
+        return { x, y };
+    }
+
+    constexpr point_2d owen_scrambled_sobol(const uint32_t index, const uint32_t seed_index,
+        const uint32_t seed_x, const uint32_t seed_y) {
+
+        const point_2d p = sobol(nested_uniform_scramble(index, seed_index));
+        return { nested_uniform_scramble(p.x, seed_x), nested_uniform_scramble(p.y, seed_y) };
+    }
+
+    /* jitter: random bits, seed: random permutation of the 16 cells of each group of samples */
+    constexpr point_2d stratified(const uint32_t index, const uint32_t seed, const uint64_t jitter) {
+        /* Odd multiplier and offset: a permutation of the 16 cells */
+        const uint32_t cell = ((index & 15u) * (seed | 1u) + (seed >> 8)) & 15u;
+        return {
+            ((cell & 3u) << 30) | static_cast<uint32_t>(jitter >> 34),
+            ((cell >> 2) << 30) | (static_cast<uint32_t>(jitter) >> 2)
+        };
+    }
+
+    /* Offset of the pixel (i, j), such that neighbouring pixels have very different offsets */
+    inline point_2d blue_noise_offset(const int i, const int j) {
+        constexpr double A1 = 0.7548776662466927;
+        constexpr double A2 = 0.5698402909980532;
+        const double x = A1 * i + A2 * j;
+        const double y = A2 * i + A1 * j;
+        return {
+            static_cast<uint32_t>((x - static_cast<int64_t>(x)) * 0x1.0p32),
+            static_cast<uint32_t>((y - static_cast<int64_t>(y)) * 0x1.0p32)
+        };
+    }
+
+    /* Cranley-Patterson rotation of the Sobol points: the additions modulo 2^32 are shifts modulo 1
+       The index is shuffled first (as for owen_scrambled_sobol), otherwise the points of all the dimensions
+       of a sample would be the same point, shifted by a constant */
+    inline point_2d blue_noise_sobol(const uint32_t index, const uint32_t seed_index, const point_2d& pixel_offset,
+        const uint32_t seed_x, const uint32_t seed_y) {
+
+        const point_2d p = sobol(nested_uniform_scramble(index, seed_index));
+        return { p.x + pixel_offset.x + seed_x, p.y + pixel_offset.y + seed_y };
+    }
+}
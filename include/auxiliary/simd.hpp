@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+/* Packs of width single-precision lanes, used by the wide bounding hierarchy
+
+   The operations are performed on the whole pack; comparisons return a bit mask (bit i for lane i).
+   The pack of 4 lanes uses SSE registers and the pack of 8 lanes AVX registers when they are available,
+   otherwise a portable array-based version is used. */
+
+template<unsigned int width>
+struct float_lanes {
+
+    std::array<float, width> v;
+
+    static inline float_lanes load(const float* p) {
+        float_lanes r;
+        for (unsigned int i = 0; i < width; i++) r.v[i] = p[i];
+        return r;
+    }
+
+    static inline float_lanes broadcast(const float x) {
+        float_lanes r;
+        r.v.fill(x);
+        return r;
+    }
+
+    inline void store(float* p) const {
+        for (unsigned int i = 0; i < width; i++) p[i] = v[i];
+    }
+
+    #define LANEWISE(expr) float_lanes r; for (unsigned int i = 0; i < width; i++) r.v[i] = (expr); return r;
+    friend inline float_lanes operator+(const float_lanes& a, const float_lanes& b) { LANEWISE(a.v[i] + b.v[i]) }
+    friend inline float_lanes operator-(const float_lanes& a, const float_lanes& b) { LANEWISE(a.v[i] - b.v[i]) }
+    friend inline float_lanes operator*(const float_lanes& a, const float_lanes& b) { LANEWISE(a.v[i] * b.v[i]) }
+    friend inline float_lanes operator/(const float_lanes& a, const float_lanes& b) { LANEWISE(a.v[i] / b.v[i]) }
+    friend inline float_lanes min(const float_lanes& a, const float_lanes& b) { LANEWISE(a.v[i] < b.v[i] ? a.v[i] : b.v[i]) }
+    friend inline float_lanes max(const float_lanes& a, const float_lanes& b) { LANEWISE(a.v[i] > b.v[i] ? a.v[i] : b.v[i]) }
+    friend inline float_lanes abs(const float_lanes& a) { LANEWISE(a.v[i] < 0.0f ? -a.v[i] : a.v[i]) }
+    #undef LANEWISE
+
+    friend inline unsigned int le_mask(const float_lanes& a, const float_lanes& b) {
+        unsigned int mask = 0;
+        for (unsigned int i = 0; i < width; i++) mask |= static_cast<unsigned int>(a.v[i] <= b.v[i]) << i;
+        return mask;
+    }
+};
+
+#if defined(__SSE2__)
+template<>
+struct float_lanes<4> {
+
+    __m128 v;
+
+    static inline float_lanes load(const float* p) { return { _mm_load_ps(p) }; }
+    static inline float_lanes broadcast(const float x) { return { _mm_set1_ps(x) }; }
+    inline void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend inline float_lanes operator+(const float_lanes& a, const float_lanes& b) { return { _mm_add_ps(a.v, b.v) }; }
+    friend inline float_lanes operator-(const float_lanes& a, const float_lanes& b) { return { _mm_sub_ps(a.v, b.v) }; }
+    friend inline float_lanes operator*(const float_lanes& a, const float_lanes& b) { return { _mm_mul_ps(a.v, b.v) }; }
+    friend inline float_lanes operator/(const float_lanes& a, const float_lanes& b) { return { _mm_div_ps(a.v, b.v) }; }
+    friend inline float_lanes min(const float_lanes& a, const float_lanes& b) { return { _mm_min_ps(a.v, b.v) }; }
+    friend inline float_lanes max(const float_lanes& a, const float_lanes& b) { return { _mm_max_ps(a.v, b.v) }; }
+    friend inline float_lanes abs(const float_lanes& a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+
+    friend inline unsigned int le_mask(const float_lanes& a, const float_lanes& b) {
+        return _mm_movemask_ps(_mm_cmple_ps(a.v, b.v));
+    }
+};
+#endif
+
+#if defined(__AVX__)
+template<>
+struct float_lanes<8> {
+
+    __m256 v;
+
+    static inline float_lanes load(const float* p) { return { _mm256_load_ps(p) }; }
+    static inline float_lanes broadcast(const float x) { return { _mm256_set1_ps(x) }; }
+    inline void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend inline float_lanes operator+(const float_lanes& a, const float_lanes& b) { return { _mm256_add_ps(a.v, b.v) }; }
+    friend inline float_lanes operator-(const float_lanes& a, const float_lanes& b) { return { _mm256_sub_ps(a.v, b.v) }; }
+    friend inline float_lanes operator*(const float_lanes& a, const float_lanes& b) { return { _mm256_mul_ps(a.v, b.v) }; }
+    friend inline float_lanes operator/(const float_lanes& a, const float_lanes& b) { return { _mm256_div_ps(a.v, b.v) }; }
+    friend inline float_lanes min(const float_lanes& a, const float_lanes& b) { return { _mm256_min_ps(a.v, b.v) }; }
+    friend inline float_lanes max(const float_lanes& a, const float_lanes& b) { return { _mm256_max_ps(a.v, b.v) }; }
+    friend inline float_lanes abs(const float_lanes& a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; }
+
+    friend inline unsigned int le_mask(const float_lanes& a, const float_lanes& b) {
+        return _mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ));
+    }
+};
+#endif
@@ -4,7 +4,9 @@
 #include "image/image.hpp"
 #include "file_readers/error.hpp"
 
+#include <array>
 #include <expected>
+#include <optional>
 
 class bmp {
 
@@ -46,6 +48,15 @@ class bmp {
 			}
 		};
 
+		/* 8-bit components of the pixels of a .bmp file, in RGB order, the first row being the top one */
+		struct pixels {
+			std::size_t width, height;
+			std::vector<uint8_t> data;
+		};
+
+		/* Extracts the pixels of the given .bmp file, without converting them to colors */
+		static std::expected<pixels, file_reader::error> read_pixels(const std::string& file_name);
+
 		/* Extracts the data from the given .bmp file: stores the width and height in the provided
 			references, and returns a matrix of width rows and height columns containing colors */
 		static std::expected<matrix, file_reader::error> read_file(const std::string& file_name);
@@ -56,4 +67,26 @@ class bmp {
 		/* Writes the data into a .bmp file with the given name
 			The value (real) of each component of each color of data is divided by number_of_rays before being written in the file */
 		static exit_status export_data(const std::string& file_name, const image& image);
+
+		/* Size of the headers of the exported files (the pixel data starts right after them) */
+		static constexpr unsigned int HEADER_SIZE = 54;
+
+		/* Size in bytes of a row of pixels of an exported file of the given width, padding included */
+		static unsigned int row_size(unsigned int width);
+
+		/* Headers of an exported file of the given resolution */
+		static std::array<uint8_t, HEADER_SIZE> make_header(unsigned int width, unsigned int height);
+
+		/* Writes the 3 bytes (BGR) of the pixel of average color average in dest
+			(so that the files can be written without building an image, see raw_data::combine_files) */
+		static inline void encode_pixel(rt::color average, const std::optional<real> gamma, uint8_t* const dest) {
+			average.cap();
+			if (gamma.has_value())
+				average.apply_gamma(gamma.value());
+
+			const auto [ b, g, r ] = average.to_uint8_bgr();
+			dest[0] = b;
+			dest[1] = g;
+			dest[2] = r;
+		}
 };
\ No newline at end of file
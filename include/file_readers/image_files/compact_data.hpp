@@ -0,0 +1,92 @@
+#pragma once
+
+#include "image/image.hpp"
+
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+/* Parameters of the compact format of the raw data files (format:2) */
+struct compact_parameters {
+    enum class precision : unsigned int {
+        Half   = 16,
+        Single = 32
+    };
+
+    static constexpr unsigned int DEFAULT_TILE_SIZE = 32;
+
+    precision bits         = precision::Half;
+    unsigned int tile_size = DEFAULT_TILE_SIZE;
+    bool compression       = true;  // The tiles are delta-encoded, shuffled by byte planes and run-length encoded
+};
+
+/* Compact encoding of the data of a raw data file
+
+   The data stores the average color of each pixel (the sum of its samples divided by the number of samples,
+   which is written in the header), in half- or single-precision floats. The image is split into square tiles
+   of tile_size pixels (smaller on the right and bottom edges), and the values of a tile are divided
+   by a power of two (its exponent), such that the largest one is in [0.5, 1), so that the half-precision floats
+   keep 11 significant bits relative to the brightest pixel of the tile, whatever the scale of the image.
+   The averages are clamped to [-2^1000, 2^1000].
+
+   Layout (in the byte order of the machine, as the binary format):
+       (number of tiles + 1) offsets (uint64), the positions of the tiles relative to the end of the offsets,
+       the last one being the size of the tiles, so that a tile can be decoded without the others
+       the tiles, in row-major order of tiles
+   Tile:
+       exponent of the colors (int16)
+       3 planes (red, green and blue) of the values of the pixels of the tile in row-major order
+   With compression (lossless), each plane is replaced by the differences of consecutive values (as integers),
+   the bytes of the planes are grouped by significance (all the low bytes first), and the result is run-length encoded
+   (PackBits: a control byte c < 128 followed by c + 1 bytes copied, or c > 128 followed by a byte repeated 257 - c times). */
+
+class compact_data {
+
+    public:
+
+        /* Parallel: the tiles are encoded on the threads of the global pool
+           Sequential: they are encoded on the calling thread, e.g. an I/O thread that runs during a render,
+           which would otherwise compete with the render for the threads of the pool */
+        enum class execution {
+            Parallel, Sequential
+        };
+
+        /* Encodes the averages of the pixels (width * height, row by row) of sums (divided by number_of_samples) */
+        static std::vector<std::byte> encode(std::span<const rt::color> sums, unsigned int number_of_samples,
+            unsigned int width, unsigned int height, const compact_parameters& parameters,
+            execution execution = execution::Parallel);
+
+        /* Decoder of the tiles of encoded data, which is not copied
+           The constructor throws file_reader::error::DataError if the offsets of the tiles do not fit in the data */
+        class decoder {
+
+            public:
+                const unsigned int width, height;
+                const compact_parameters parameters;
+                const unsigned int tiles_x, tiles_y;
+
+            private:
+                const std::span<const std::byte> offsets; // Not aligned in mapped files
+                const std::span<const std::byte> tiles;
+
+                uint64_t offset(std::size_t index) const;
+
+            public:
+                decoder(std::span<const std::byte> data, unsigned int width, unsigned int height, const compact_parameters& parameters);
+
+                /* Position and size of the pixels of the tile (tx, ty) in the image: x, y, width, height */
+                struct rectangle {
+                    unsigned int x, y, width, height;
+                };
+                rectangle tile_rectangle(unsigned int tx, unsigned int ty) const;
+
+                /* Writes the average colors of the pixels of the tile (tx, ty) in colors, as 3 components per pixel,
+                   the pixel (x + i, y + j) of the tile rectangle being at colors[3 * (j * stride + i)] (stride in pixels)
+                   Throws file_reader::error::DataError if the tile is corrupted */
+                void decode_tile(unsigned int tx, unsigned int ty, color_real* colors, std::size_t stride) const;
+
+                /* Range of bytes (offset and length, in the data) of the tile rows [first_row, end_row) */
+                std::pair<std::size_t, std::size_t> tile_rows_range(unsigned int first_row, unsigned int end_row) const;
+        };
+};
@@ -3,10 +3,22 @@
 #include "image/matrix.hpp"
 #include "file_readers/error.hpp"
 
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <expected>
 
 class hdr {
     public:
+        /* Pixels of a .hdr file in the RGBE format (8-bit mantissas and a shared exponent),
+           the first row being the top one */
+        struct pixels {
+            std::size_t width, height;
+            std::vector<uint8_t> data;
+        };
+
+        /* Extracts the pixels of the given .hdr file, without converting them to colors */
+        static std::expected<pixels, file_reader::error> read_pixels(const std::string& file_name);
+
         static std::expected<matrix, file_reader::error> read_file(const std::string& file_name);
 };
\ No newline at end of file
@@ -5,4 +5,4 @@
 #include <string>
 #include <optional>
 
-std::optional<normal_map::vector_matrix> read_normal_map(const std::string& file_name);
\ No newline at end of file
+std::optional<normal_map::normals> read_normal_map(const std::string& file_name);
\ No newline at end of file
@@ -3,18 +3,22 @@
 #include "auxiliary/exit_status.hpp"
 #include "image/image.hpp"
 #include "file_readers/error.hpp"
+#include "file_readers/image_files/compact_data.hpp"
 
 #include <expected>
+#include <optional>
 #include <string>
 #include <span>
+#include <vector>
 
 class raw_data {
 
     public:
 
         enum class format : unsigned int {
-            Text   = 0,
-            Binary = 1
+            Text    = 0,
+            Binary  = 1,
+            Compact = 2
         };
 
         /* Creates a file file_name, and writes in it the resolution of the image, the number of rays used to generate it,
@@ -32,18 +36,82 @@ class raw_data {
             line k representing pixel (k % width, k / width)
 
             Binary
-            width:1920 height:1080 number_of_rays:500 format:1 pixel_size:24
+            width:1920 height:1080 number_of_rays:500 format:1 pixel_size:24 gamma:2.200000 seed:12345 scene:0123456789abcdef
             Binary representation of the rows of the input image, stored consecutively, with no separator
+
+            Compact
+            width:7680 height:4320 number_of_rays:500 format:2 precision:16 tile_size:32 compression:1 gamma:2.200000
+            Average colors of the pixels in half- (precision:16) or single-precision (precision:32) floats, by tiles,
+            optionally compressed (see compact_data.hpp)
+            The averages are multiplied by number_of_rays when the file is read, so that the files of all formats
+            are read and merged the same way (the half-precision floats are rounded to 11 significant bits).
+
+            Adaptive sampling: the pixels do not all have number_of_rays samples, and their numbers of samples are not written.
+            Each pixel is written as its own average (the sum of its samples divided by its own number of samples)
+            multiplied by number_of_rays, so that the file is read, resumed and merged as if every pixel
+            had number_of_rays samples (each one then counts in a merge in proportion to number_of_rays).
+
+            The fields gamma, seed and scene (hash of the scene description, in hexadecimal) are optional:
+            seed and scene identify the render, so that it can be resumed (see the -resume option).
         */
-        static exit_status export_data(const std::string& file_name, const image& image, format format = format::Binary);
+        static exit_status export_data(const std::string& file_name, const image& image, format format = format::Binary,
+            const compact_parameters& compact = {});
+
+        /* Fields of the first line of a raw data file */
+        struct header {
+            unsigned int width = 0, height = 0;
+            unsigned int number_of_samples = 0;
+            format data_format = format::Text;
+            std::size_t pixel_size = sizeof(rt::color);
+            std::optional<real> gamma; // Gamma of the image (inverse of the value written)
+            std::optional<render_identity> identity;
+            compact_parameters compact; // Compact format only
+        };
+
+        /* Copy of the content of a binary raw data file, taken from an image,
+           so that it can be written while the image keeps being rendered */
+        struct capture {
+            unsigned int width = 0, height = 0;
+            unsigned int number_of_samples = 0;
+            std::optional<real> gamma;
+            std::optional<render_identity> identity;
+            std::vector<rt::color> pixels; // The buffer is reused by the next captures
+        };
+
+        /* Copies the values of image exported in the binary format in c (in parallel) */
+        static void capture_data(const image& image, capture& c);
+
+        /* Writes c in the binary or compact format:
+           the data is written in file_name.tmp, which then replaces file_name, so that file_name always contains a complete file
+           The compact tiles are encoded according to execution (see compact_data::encode) */
+        static exit_status export_capture(const std::string& file_name, const capture& c, format format = format::Binary,
+            const compact_parameters& compact = {},
+            compact_data::execution execution = compact_data::execution::Parallel);
 
         /* Reads a file file_name generated by export_raw, and returns a matrix with its content
             Writes the number of rays in the associated variable */
         static std::expected<image, file_reader::error> read_file(const std::string& file_name);
 
+        /* Reads the first line of the raw data file file_name */
+        static std::expected<header, file_reader::error> read_file_header(const std::string& file_name);
+
+        /* Memory used by default by combine_files for the parts of the files being merged */
+        static constexpr std::size_t DEFAULT_MERGE_MEMORY = std::size_t(512) << 20;
+
         /* Combines the n files whose names are in the array source_file_names into one bmp file dest_bmp_name (extension .bmp)
-            and one raw data file dest_raw_name (extension .rtdata) */
+            and one raw data file dest_raw_name (extension .rtdata)
+            The result has the sum of the numbers of samples of the files. If weights is not empty, it has one weight per file,
+            and the average color of the result is the weighted average of the average colors of the files
+            (otherwise, each file counts in proportion to its number of samples).
+            The result records the seed and the scene of the files if they all record the same ones (e.g. the shards of a render).
+
+            The files in the binary and compact formats are mapped in memory: their headers are all checked first,
+            then they are summed in bands of rows (in parallel within a band, the compact files being decoded by rows of tiles)
+            into the mapped output files, so that at most about memory_budget bytes of the files are loaded at the same time,
+            whatever their number. If a file is in the text format, the files are summed one by one in an image.
+            The result is in the binary format. */
         static exit_status combine_files(const std::string& dest_bmp_name, const std::string& dest_raw_name,
             std::span<const std::string> source_file_names, std::optional<std::string> input_dir,
-            std::optional<float> gamma_opt);
+            std::optional<float> gamma_opt, std::span<const real> weights = {},
+            std::size_t memory_budget = DEFAULT_MERGE_MEMORY);
 };
\ No newline at end of file
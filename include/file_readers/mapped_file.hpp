@@ -0,0 +1,69 @@
+#pragma once
+
+#include "auxiliary/exit_status.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+#include <span>
+#include <string>
+
+/* Memory mapping of a whole file (mmap on POSIX systems, MapViewOfFile on Windows)
+
+   The pages are loaded by the operating system on demand, and shared with the page cache,
+   so that large binary files are read without intermediate copies.
+   A file is either mapped read-only, or created with a given size and mapped read-write (output files).
+   The constructors throw a std::runtime_error if the file cannot be opened, created or mapped. */
+
+class mapped_file {
+
+    private:
+        const std::byte* data_ = nullptr;
+        std::size_t size_      = 0;
+        bool writable          = false;
+
+#ifdef _WIN32
+        void* file_handle    = nullptr;
+        void* mapping_handle = nullptr;
+#endif
+
+        void unmap() noexcept;
+
+    public:
+
+        /* Read-only mapping of the existing file file_name */
+        explicit mapped_file(const std::string& file_name);
+
+        /* Read-write mapping of the file file_name, created (or truncated) with size bytes */
+        mapped_file(const std::string& file_name, std::size_t size);
+
+        mapped_file(const mapped_file&)            = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        mapped_file(mapped_file&&)                 = delete;
+        mapped_file& operator=(mapped_file&&)      = delete;
+
+        ~mapped_file() noexcept {
+            unmap();
+        }
+
+        inline std::span<const std::byte> content() const {
+            return { data_, size_ };
+        }
+
+        /* Content of a read-write mapping */
+        inline std::span<std::byte> mutable_content() const {
+            if (not writable)
+                throw std::runtime_error("mapped file is read-only");
+            return { const_cast<std::byte*>(data_), size_ };
+        }
+
+        inline std::size_t size() const {
+            return size_;
+        }
+
+        /* Hints that the bytes [offset, offset + length) will not be accessed again, so that their pages
+           can be removed from the memory of the process (after being scheduled for writing, for a read-write mapping) */
+        void release(std::size_t offset, std::size_t length) const noexcept;
+
+        /* Writes the modified pages of a read-write mapping to the file */
+        exit_status flush() const;
+};
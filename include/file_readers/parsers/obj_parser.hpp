@@ -17,7 +17,9 @@ pre_parsing_info_obj pre_parse_obj(const std::string& filename);
 
 /* Wavefront .obj file parser */
 /* Only handles .obj files made up of triangles and quads, for now.
-   The polygons with >= 5 sides are split into triangles */
+   The polygons with >= 5 sides are split into triangles
+   The files are memory-mapped and split into chunks at line boundaries, whose v/vt/vn/f records are parsed in parallel,
+   then the polygons are built in the order of the file, so the result does not depend on the number of threads */
 
 /* Positioning information for 3D models */
 class model_positioning {
@@ -61,12 +63,14 @@ class model_positioning {
     - Only one texture is handled.
     - Object names (o), polygon groups (g), smooth shading (s), lines (l) are ignored.
     - The object is scaled with the factor scale, and shifted by the vector shift.
-    - If bounding_enabled, a bounding containing the whole object is placed in output_bd.
-        It contains a hierarchy of bounding boxes, such that the terminal ones contain at most
-        polygons_per_bounding polygons.
+    - If the bvh is enabled, a bounding containing the whole object is placed in output_bd.
+        It contains a hierarchy of bounding boxes, built according to bvh_params.
+    - The file is split into number_of_chunks chunks parsed in parallel (by default, depending on its size
+        and the number of threads), which does not change the result.
 */
 exit_status parse_obj_file(const std::string& file_name, std::optional<unsigned int> default_texture_index,
     containers& containers,
     const model_positioning& positioning,
-    bool bounding_enabled, unsigned int polygons_per_bounding,
-    const bounding*& output_bd, std::optional<real> gamma = std::nullopt);
\ No newline at end of file
+    const bvh_parameters& bvh_params,
+    const bounding*& output_bd, std::optional<real> gamma = std::nullopt,
+    std::optional<std::size_t> number_of_chunks = std::nullopt);
\ No newline at end of file
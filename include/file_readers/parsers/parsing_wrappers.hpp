@@ -13,6 +13,12 @@ enum class silent_option {
     Default, Silent
 };
 
+/* Binary snapshot of the parsed scene and its bounding hierarchy (see scene_snapshot.hpp),
+   loaded instead of parsing the scene when it is up to date */
+enum class snapshot_mode {
+    Disabled, Enabled
+};
+
 // Wrappable types: material, texture, normal_map, mapping::compostion
 template<typename T> inline constexpr std::string type_str() = delete;
 
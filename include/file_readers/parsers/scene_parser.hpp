@@ -17,6 +17,9 @@ struct containers {
     std::vector<texture>&              texture_set;
     std::vector<normal_map>&           normal_map_set;
     scene::containers::orientation&    orientation_containers;
+    /* Files loaded during the parsing (obj, mtl, textures, normal maps), which invalidate the snapshot when modified */
+    std::vector<std::string>&          dependencies;
 };
 
-std::optional<scene> parse_scene_descriptor(const std::string& file_name);
\ No newline at end of file
+/* Parses the scene description file_name, or loads its snapshot (see scene_snapshot.hpp) if it is up to date */
+std::optional<scene> parse_scene_descriptor(const std::string& file_name, snapshot_mode snapshot = snapshot_mode::Enabled);
\ No newline at end of file
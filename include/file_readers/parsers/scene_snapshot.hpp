@@ -0,0 +1,96 @@
+#pragma once
+
+#include "scene/scene.hpp"
+#include "auxiliary/exit_status.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+class file;
+class snapshot_reader;
+
+/* Binary snapshot of a parsed scene
+
+   After a scene description is parsed, the result of the parsing of its content (objects, orientations,
+   materials, mappings) and the bounding hierarchy built by the clustering or the SAH are written
+   in a binary file next to it (scene.txt -> scene.rtscene).
+   On the next launches, this file is memory-mapped and the containers are rebuilt from it,
+   instead of re-parsing the obj files and rebuilding the hierarchy.
+
+   The resolution and the camera are not stored: they are always parsed from the scene description,
+   so that moving the camera does not invalidate the snapshot. The background is also re-parsed.
+   The snapshot is only used if:
+    - it was written by a build with the same format version and the same real type,
+    - the content of the scene description after the camera has the same hash,
+    - each file loaded during the parsing (obj, mtl, textures, normal maps) has the same size
+      and either the same modification time, or the same hash (e.g. after a copy).
+   Otherwise, the scene is parsed again and the snapshot is replaced.
+
+   Format (all values in the native byte order):
+    - header: magic "RTSCENE", version, sizeof(real), total size of the file, hash of the scene description,
+      list of the files loaded (path, size, modification time, hash)
+    - materials, compositions, textures and normal maps (in their compact format, with their mip pyramid, see texture.hpp and normal_map.hpp)
+    - orientations of the triangles, quads, spheres, planes
+    - triangles, quads, spheres, planes, boxes, cylinders
+    - object_set, as indices in the concatenation of the object containers
+    - bounding hierarchy, in depth-first order */
+
+class scene_snapshot {
+
+    public:
+
+        /* Bumped at each change of the format, or of the data members of the serialized classes */
+        static constexpr uint32_t VERSION = 4;
+
+        struct dependency {
+            std::string path;
+            uint64_t size;
+            int64_t modification_time;
+            uint64_t hash;
+        };
+
+        /* Content of the scene description, as stored in the snapshot */
+        struct content {
+            std::vector<const object*>        object_set;
+            std::vector<const bounding*>      bounding_set;
+            scene::containers::object         object_containers;
+            std::vector<material>             material_set;
+            std::vector<mapping::composition> composition_set;
+            std::vector<texture>              texture_set;
+            std::vector<normal_map>           normal_map_set;
+            scene::containers::orientation    orientation_containers;
+
+            content(const scene::pre_parsing_info& pre_parsing_info)
+                : object_containers(pre_parsing_info), orientation_containers(pre_parsing_info) {}
+        };
+
+        /* Name of the snapshot of the scene description file_name */
+        static std::string file_name_of(const std::string& file_name);
+
+        /* Hash of the content of the scene description from position offset (the part stored in the snapshot) */
+        static uint64_t hash_description(const std::string& file_name, std::size_t offset);
+
+        /* Returns the content stored in the snapshot snapshot_name, if it is valid for a scene description
+           whose hash is description_hash */
+        static std::optional<content> load(const std::string& snapshot_name, uint64_t description_hash);
+
+        /* Writes the snapshot of scene scn, parsed from a scene description whose hash is description_hash,
+           and which loaded the files in dependency_names */
+        static exit_status save(const std::string& snapshot_name, uint64_t description_hash,
+            std::span<const std::string> dependency_names, const scene& scn);
+
+    private:
+
+        /* References to the data members of the objects (see the friend declarations in the object classes) */
+        template<typename T>
+        static auto fields(T& obj);
+
+        template<typename Obj>
+        static void write_objects(const file& f, const std::vector<Obj>& set);
+
+        template<typename Obj>
+        static void read_objects(snapshot_reader& reader, std::vector<Obj>& set, std::size_t count);
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "image/matrix.hpp"
+#include "math/geometry/vector.hpp"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+/* Material index of the pixels whose first sample reached the background */
+constexpr uint32_t NO_MATERIAL = std::numeric_limits<uint32_t>::max();
+
+/* Values at the first hit of a camera ray (or of the background, if no object is hit) */
+struct aov_sample {
+    /* Texture color (or color of the material) */
+    rt::color albedo;
+    /* World-space shading normal, zero for the background */
+    rt::vector normal;
+    /* Distance from the origin of the ray, 0 for the background */
+    real depth = 0.0_r;
+    uint32_t material_index = NO_MATERIAL;
+};
+
+/* Auxiliary buffers (arbitrary output variables) filled from the first hits, alongside the image:
+   the albedo, normal and depth are summed over the samples like the colors of the image,
+   the material index is the one of the first sample of the pixel */
+
+class aov_buffers {
+
+    public:
+        matrix albedo;
+        /* The components x, y, z of the normals are stored as the red, green, blue of a color */
+        matrix normal;
+        std::vector<real> depth;
+        std::vector<uint32_t> material_index;
+
+        enum class layer {
+            Albedo, Normal, Depth, MaterialIndex
+        };
+
+        static constexpr std::array<layer, 4> layers = {
+            layer::Albedo, layer::Normal, layer::Depth, layer::MaterialIndex
+        };
+
+        static inline std::string layer_name(const layer l) {
+            using enum layer;
+            switch (l) {
+                case Albedo:        return "albedo";
+                case Normal:        return "normal";
+                case Depth:         return "depth";
+                case MaterialIndex: return "material";
+                default: throw;
+            }
+        }
+
+        /* The values of the pixels are exported either as they are (raw data files),
+           or mapped to colors between 0 and 255 to be displayed (bmp files) */
+        enum class output {
+            Values, Display
+        };
+
+        aov_buffers() = default;
+
+        void enable(int width, int height) {
+            albedo = matrix(width, height);
+            normal = matrix(width, height);
+            depth.assign(width * height, 0.0_r);
+            material_index.assign(width * height, NO_MATERIAL);
+        }
+
+        inline bool is_enabled() const {
+            return not depth.empty();
+        }
+
+        /* Adds the sample of the pixel of index index (row * width + col) */
+        inline void add(const std::size_t index, const aov_sample& s, const bool first_sample) {
+            albedo.data[index] += s.albedo;
+            normal.data[index] += rt::color(s.normal.x, s.normal.y, s.normal.z);
+            depth[index] += s.depth;
+            if (first_sample)
+                material_index[index] = s.material_index;
+        }
+};
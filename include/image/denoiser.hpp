@@ -0,0 +1,47 @@
+#pragma once
+
+#include "image/image.hpp"
+
+#include <vector>
+
+/* Edge-avoiding A-Trous wavelet denoiser
+   (Dammertz et al., Edge-Avoiding A-Trous Wavelet Transform for fast Global Illumination Filtering, 2010)
+
+   Each iteration is a 5x5 B3-spline filter whose taps are spaced by 2^iteration pixels,
+   so that large radii are reached in a few iterations. The weight of each tap is reduced
+   by the difference of luminance, of normal and of depth with the center pixel, which preserves the edges.
+   As in SVGF (Schied et al., 2017), the luminance difference is relative to the standard deviation of the noise,
+   estimated from the samples of each pixel when they are known (adaptive sampling), otherwise from the variance
+   of the luminance around each pixel, and filtered along with the colors.
+   When the albedo is known, the color is divided by it before the filtering and multiplied back after,
+   so that only the lighting is smoothed and the textures stay sharp.
+   The iterations are parallelized over the tiles of the image. */
+
+struct denoiser_parameters {
+    int iterations = 5;
+    /* Luminance difference (in standard deviations of the noise) from which the taps are ignored */
+    real sigma_luminance = 4.0_r;
+    /* Exponent of the cosine between the normals */
+    real sigma_normal = 64.0_r;
+    /* Depth difference (relative to the depth) from which the taps are ignored, per pixel of distance */
+    real sigma_depth = 0.05_r;
+};
+
+/* Colors and guides, averaged over the samples (the guides may be absent) */
+struct denoiser_input {
+    const matrix& color;
+    const matrix* albedo = nullptr;
+    /* Components x, y, z of the normals stored as the red, green, blue of a color */
+    const matrix* normal = nullptr;
+    /* Depth stored in the red component (0 for the background) */
+    const matrix* depth  = nullptr;
+    /* Variance of the luminance of the average color of each pixel, estimated from its samples
+       (negative when unknown, e.g. with fewer than two samples, the variance is then estimated around the pixel) */
+    const std::vector<color_real>* variance = nullptr;
+};
+
+matrix denoise(const denoiser_input& input, const denoiser_parameters& param = {});
+
+/* Denoised version of img (with 1 sample), guided by its auxiliary buffers when they are enabled,
+   and by the variances of its pixels when the sampling is adaptive */
+image denoise_image(const image& img, const denoiser_parameters& param = {});
@@ -1,15 +1,50 @@
 #pragma once
 
 #include "image/matrix.hpp"
+#include "image/aov.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <optional>
+#include <vector>
+
+/* Minimum average luminance used as the reference of the relative error of the pixels
+   (the colors are between 0 and 255), so that the noise of dark pixels is not overestimated */
+constexpr real ADAPTIVE_LUMINANCE_FLOOR = 0.05_r * 255.0_r;
+
+/* Relative error of the pixels with fewer than two samples, whose variance cannot be estimated
+   (finite, so that it is still compared correctly with -ffast-math) */
+constexpr color_real UNKNOWN_RELATIVE_ERROR = std::numeric_limits<color_real>::max();
+
+/* Seed of the generators of a render and hash of its scene description,
+   written in the raw data files so that the render can be resumed */
+struct render_identity {
+    uint64_t seed;
+    uint64_t scene_hash;
+
+    bool operator==(const render_identity&) const = default;
+};
 
 class image {
     public:
         matrix data;
         std::optional<real> gamma;
+        /* Number of sample passes (the number of samples of each pixel, unless the sampling is adaptive) */
         int number_of_samples = 0;
 
+        /* Adaptive sampling: number of samples of each pixel and sum of the squared luminances of its samples,
+           in double precision as the sums of the colors (empty when the sampling is uniform) */
+        std::vector<uint32_t> pixel_samples;
+        std::vector<color_real> luminance_sq;
+
+        /* Identity of the render the samples come from (unknown for the merges of files of different renders) */
+        std::optional<render_identity> identity;
+
+        /* First-hit auxiliary buffers (empty unless enabled) */
+        aov_buffers aovs;
+
         image(int width, int height, std::optional<real> gamma = std::nullopt)
             : data(width, height), gamma(gamma) {}
 
@@ -41,9 +76,85 @@ class image {
             number_of_samples += nb_samples;
         }
 
+        /* Starts keeping the statistics of each pixel (before the first sample pass) */
+        void enable_adaptive_sampling() {
+            pixel_samples.assign(data.data.size(), number_of_samples);
+            luminance_sq.assign(data.data.size(), 0.0);
+        }
+
+        /* Starts filling the auxiliary buffers (before the first sample pass) */
+        void enable_aovs() {
+            aovs.enable(width(), height());
+        }
+
+        bool is_adaptive() const {
+            return not pixel_samples.empty();
+        }
+
+        int get_sample_count(int row, int col) const {
+            return is_adaptive() ? static_cast<int>(pixel_samples[row * width() + col]) : number_of_samples;
+        }
+
+        /* Factor by which the sum of the samples of the pixel (row, col) is multiplied to get their average,
+           invN being 1 / number_of_samples */
+        real average_factor(int row, int col, real invN) const {
+            if (not is_adaptive())
+                return invN;
+            const uint32_t n = pixel_samples[row * width() + col];
+            return (n == 0) ? 0.0_r : 1.0_r / static_cast<real>(n);
+        }
+
+        /* Adds a sample to the pixel (row, col) */
+        void add_sample(int row, int col, const rt::color& color) {
+            data[row, col] += color;
+            if (is_adaptive()) {
+                const std::size_t index = row * width() + col;
+                const color_real luminance = color.get_luminance();
+                pixel_samples[index]++;
+                luminance_sq[index] += luminance * luminance;
+            }
+        }
+
+        /* Same, with the values of the first hit of the sample */
+        void add_sample(int row, int col, const rt::color& color, const aov_sample& aov) {
+            if (aovs.is_enabled())
+                aovs.add(row * width() + col, aov, get_sample_count(row, col) == 0);
+            add_sample(row, col, color);
+        }
+
+        /* Unbiased estimate of the variance of the luminance of the samples of the pixel (row, col)
+           (adaptive sampling only, 0 with fewer than two samples)
+           The difference of the two moments cancels most of their digits, hence the double precision */
+        color_real luminance_variance(int row, int col) const {
+            const std::size_t index = row * width() + col;
+            const uint32_t n = pixel_samples[index];
+            if (n < 2)
+                return 0.0;
+
+            const color_real inv_n = 1.0 / static_cast<color_real>(n);
+            const color_real mean = data[row, col].get_luminance() * inv_n;
+            return std::max(0.0, luminance_sq[index] * inv_n - mean * mean) * static_cast<color_real>(n) / static_cast<color_real>(n - 1);
+        }
+
+        /* Estimated standard error of the average luminance of the pixel (row, col), relative to that luminance
+           (UNKNOWN_RELATIVE_ERROR with fewer than two samples) */
+        color_real relative_error(int row, int col) const {
+            const uint32_t n = pixel_samples[row * width() + col];
+            if (n < 2)
+                return UNKNOWN_RELATIVE_ERROR;
+
+            const color_real inv_n = 1.0 / static_cast<color_real>(n);
+            const color_real mean = data[row, col].get_luminance() * inv_n;
+            return std::sqrt(luminance_variance(row, col) * inv_n) / std::max(mean, static_cast<color_real>(ADAPTIVE_LUMINANCE_FLOOR));
+        }
+
         /* Applies gamma correction to the color data */
         void apply_gamma() {
             if (gamma.has_value())
                 data.apply_gamma(gamma.value());
         }
-};
\ No newline at end of file
+};
+
+/* Image of a layer of the auxiliary buffers of img, averaged over the samples of each pixel
+   (with 1 sample, and the gamma of img for the albedo) */
+image aov_image(const image& img, aov_buffers::layer layer, aov_buffers::output output);
@@ -2,6 +2,10 @@
 
 #include "light/ray.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 /** The hit class contains the information
  * of a ray hitting a surface: the ray in question,
  * the point of contact, the normal of the surface at
@@ -10,6 +14,11 @@
 
 static constexpr real BIAS_NORM = 1.0E-3_r;
 
+/* The rounding error on the contact point grows with its distance to the origin:
+   far from the origin, the bias is scaled with the magnitude of the point instead
+   (this only matters in single precision, where BIAS_NORM is exceeded from |p| ~ 130) */
+static constexpr real BIAS_RELATIVE = 64 * std::numeric_limits<real>::epsilon();
+
 /* Forward-declaring the object class, to solve mutual recursivity between the hit and object classes */
 class object;
 
@@ -60,19 +69,25 @@ class hit {
             return type;
         }
 
-        /* Auxiliary function that applies a bias of 1.0E-3 times the normal to the ray position,
+        /* Norm of the bias: BIAS_NORM, or more for points far from the origin */
+        [[nodiscard]] inline real bias_norm() const {
+            const real magnitude = std::max({ std::abs(point.x), std::abs(point.y), std::abs(point.z) });
+            return std::max(BIAS_NORM, magnitude * BIAS_RELATIVE);
+        }
+
+        /* Auxiliary function that applies a bias of 1.0E-3 (see bias_norm) times the normal to the ray position,
         outward the surface contact point if outward_bias is true (so in the direction of the normal),
         inward otherwise (in the opposite direction to the normal) */
         [[nodiscard]] inline rt::vector biased_point(const ray_orientation_type bias_orientation) const {
 
-            const real bias_norm = (ray_orientation != bias_orientation) ? BIAS_NORM : (-BIAS_NORM);
-            return fma(normal, bias_norm, point);
+            const real bias = (ray_orientation != bias_orientation) ? bias_norm() : (-bias_norm());
+            return fma(normal, bias, point);
         }
 
         template <ray_orientation_type ray_orientation, ray_orientation_type bias_orientation>
         [[nodiscard]] inline rt::vector biased_point() const {
 
-            constexpr real bias_norm = (ray_orientation != bias_orientation ? 1.0_r : -1.0_r) * BIAS_NORM;
-            return fma(normal, bias_norm, point);
+            constexpr real sign = (ray_orientation != bias_orientation ? 1.0_r : -1.0_r);
+            return fma(normal, sign * bias_norm(), point);
         }
 };
\ No newline at end of file
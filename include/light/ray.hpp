@@ -2,6 +2,20 @@
 
 #include "math/geometry/vector.hpp"
 
+#include <cmath>
+
+/* Footprint of a ray (ray cone): isotropic approximation of the ray differentials of the pixel it comes from,
+   used to select the level of detail of the textures.
+   The width of the footprint grows linearly with the distance travelled: width + spread * distance */
+struct ray_footprint {
+    real width  = 0.0_r;
+    real spread = 0.0_r;
+
+    [[nodiscard]] inline real width_at(const real distance) const {
+        return std::fma(spread, distance, width);
+    }
+};
+
 class ray {
     
     public:
@@ -10,14 +24,18 @@ class ray {
 
         /* Precomputed: inverse of the direction's components */
         rt::vector inv_dir;
+
+        /* Null for the rays that do not come from the camera (shadow rays) */
+        ray_footprint footprint;
         
-        ray(const rt::vector& origin, const rt::vector& dir) :
+        ray(const rt::vector& origin, const rt::vector& dir, const ray_footprint& footprint = {}) :
             origin(origin), direction(dir),
             inv_dir(
                 1.0_r / direction.x,
                 1.0_r / direction.y,
                 1.0_r / direction.z
-            ) {}
+            ),
+            footprint(footprint) {}
         
         ray(ray&&)                 noexcept = default;
         ray(const ray&)            noexcept = default;
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "file_readers/image_files/raw_data.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+/* Background writer of the checkpoints of an offline render
+
+   The image is captured (copied in parallel, which takes a fraction of a pass) and the capture
+   is encoded (in the compact format) and written in a raw data file by an I/O thread, while the next passes are rendered.
+   The captures are double-buffered: a new capture can be taken while the previous one is still being written,
+   the submission only waits if that write is not complete when the capture is handed to the thread.
+   Each file is written next to its destination and renamed, so that the destination is always complete. */
+
+class checkpoint_writer {
+
+    private:
+        const std::string file_path;
+        const std::optional<compact_parameters> compact; // Compact format if set, binary format otherwise
+
+        std::array<raw_data::capture, 2> captures;
+        unsigned int next_capture = 0;
+
+        /* State shared with the I/O thread, protected by mut */
+        std::mutex mut;
+        std::condition_variable cond;
+        std::optional<unsigned int> pending_capture; // Capture submitted and not written yet
+        exit_status last_status = exit_status::Success;
+        bool stopping = false;
+
+        std::thread thread;
+
+        void thread_loop();
+
+    public:
+
+        checkpoint_writer(const std::string& file_path, const std::optional<compact_parameters>& compact);
+
+        checkpoint_writer(const checkpoint_writer&)            = delete;
+        checkpoint_writer(checkpoint_writer&&)                 = delete;
+        checkpoint_writer& operator=(const checkpoint_writer&) = delete;
+        checkpoint_writer& operator=(checkpoint_writer&&)      = delete;
+
+        /* Waits for the last write and stops the thread */
+        ~checkpoint_writer() noexcept;
+
+        /* Captures image, and hands the capture to the I/O thread
+           Returns Failure if the previous write failed */
+        exit_status submit(const image& image);
+
+        /* Waits until the last capture submitted is written, and returns the status of the writes since the last call */
+        exit_status wait();
+};
@@ -2,13 +2,18 @@
 
 #include "image/image.hpp"
 #include "auxiliary/exit_status.hpp"
+#include "file_readers/image_files/compact_data.hpp"
 
+#include <optional>
 #include <vector>
 
 class file_handler {
     private:
         mutable bool output_dir_exists = false;
 
+        /* Parameters of the raw data files, exported in the compact format if set (binary format otherwise) */
+        const std::optional<compact_parameters> compact;
+
         void create_dir() const;
 
         enum class type {
@@ -31,7 +36,17 @@ class file_handler {
         using bmp_filename = type_filename<Bmp>;
         using raw_filename = type_filename<Raw>;
 
-        file_handler();
+        explicit file_handler(std::optional<compact_parameters> compact = std::nullopt);
+
+        inline const std::optional<compact_parameters>& raw_compact() const {
+            return compact;
+        }
+
+        /* Path of the file filename in the output directory (which is created if needed) */
+        std::string output_path(const std::string& filename) const;
+
+        /* Displayed name of the file filename in the output directory */
+        std::string display_name(const std::string& filename) const;
 
         inline exit_status export_as(const raw_filename& raw, const image& image) const {
             
@@ -52,6 +67,10 @@ class file_handler {
             printf("\n");
             return status_raw && status_bmp;
         }
+
+        /* Exports each layer of the auxiliary buffers of image as name_<layer>.bmp (to be displayed)
+           and name_<layer>.rtdata (values averaged over the samples) */
+        exit_status export_aovs(const std::string& name, const image& image) const;
 };
 
 constexpr file_handler::bmp_filename bmp(const std::string& filename) {
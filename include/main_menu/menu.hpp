@@ -7,6 +7,7 @@
 #include <string>
 #include <span>
 #include <optional>
+#include <vector>
 
 static constexpr std::string DEFAULT_DESCRIPTOR_FILE_NAME = "../scene.txt";
 
@@ -16,10 +17,14 @@ class menu {
         runtime_parameters_container runtime_parameters;
         std::string scene_descriptor_name = DEFAULT_DESCRIPTOR_FILE_NAME;
 
+        /* Name of the executable and arguments it was launched with, passed on to the worker processes */
+        std::string executable_name;
+        std::vector<std::string> arguments;
+
         exit_status parse_arguments(std::span<const std::string> args);
 
         inline std::optional<scene> parse_scene_descriptor_file() const {
-            return parse_scene_descriptor(scene_descriptor_name);
+            return parse_scene_descriptor(scene_descriptor_name, runtime_parameters.snapshot);
         }
 
         void update_gamma(std::optional<real> new_gamma);
@@ -1,5 +1,12 @@
 #pragma once
 
+#include "auxiliary/sampler.hpp"
+#include "file_readers/parsers/parsing_wrappers.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
 struct program_parameters {
     enum class mode {
         Interactive, Offline
@@ -24,6 +31,16 @@ struct tone_mapping_parameters {
     float gamma_value;
 };
 
+/* Adaptive sampling: once a tile has ADAPTIVE_MIN_SAMPLES samples per pixel,
+   it is no longer rendered when the relative error of all its pixels is below threshold */
+struct adaptive_parameters {
+    enum class mode {
+        Disabled, Enabled
+    };
+    mode a_mode;
+    float threshold;
+};
+
 enum class time_mode {
     Disabled, Simple, Full
 };
@@ -32,6 +49,38 @@ enum class russian_roulette_mode {
     Disabled, Enabled
 };
 
+/* Next-event estimation: explicit sampling of the light sources at the diffuse bounces */
+enum class nee_mode {
+    Disabled, Enabled
+};
+
+enum class tracing_mode {
+    PathByPath, Wavefront
+};
+
+/* First-hit auxiliary buffers (albedo, normal, depth, material index), exported with the final image */
+enum class aov_mode {
+    Disabled, Enabled
+};
+
+/* Edge-avoiding denoising of the displayed image (interactive mode) or of an additional exported image (offline mode) */
+enum class denoise_mode {
+    Disabled, Enabled
+};
+
+/* Format of the exported raw data files: sums of the samples in double precision (binary),
+   or averages in half or single precision, by compressed tiles (see file_readers/image_files/compact_data.hpp) */
+enum class raw_format {
+    Binary, Half, Single
+};
+
+/* Part of the samples of a render computed by one process (see main_menu/shard_coordinator.hpp):
+   shard index (from 0) of count shards */
+struct shard_parameters {
+    unsigned int index;
+    unsigned int count;
+};
+
 struct runtime_debugger {
     enum class option {
         Disabled, Enabled
@@ -46,7 +95,19 @@ struct runtime_parameters_container {
     program_parameters       program                = { program_parameters::mode::Interactive,   0    };
     sampling_parameters      sampling               = { sampling_parameters::mode::UniSample,    1    };
     tone_mapping_parameters  tone_mapping           = { tone_mapping_parameters::mode::Disabled, 1.0f };
+    adaptive_parameters      adaptive               = { adaptive_parameters::mode::Disabled,     0.02f };
     time_mode                time                   = time_mode::Disabled;
     russian_roulette_mode    russian_roulette       = russian_roulette_mode::Disabled;
+    nee_mode                 nee                    = nee_mode::Disabled;
+    tracing_mode             tracing                = tracing_mode::PathByPath;
+    std::optional<uint64_t>  seed                   = std::nullopt;
+    sampler_type             sampler                = sampler_type::Independent;
+    aov_mode                 aov                    = aov_mode::Disabled;
+    denoise_mode             denoise                = denoise_mode::Disabled;
+    snapshot_mode            snapshot               = snapshot_mode::Enabled;
+    raw_format               raw                    = raw_format::Binary;
     runtime_debugger::option debug                  = runtime_debugger::option::Disabled;
+    std::optional<std::string> resume_file          = std::nullopt; // Raw data file of the render to continue
+    std::optional<shard_parameters> shard           = std::nullopt; // Shard rendered by this process (worker)
+    unsigned int             number_of_workers      = 0;            // Worker processes launched by this process (coordinator)
 };
\ No newline at end of file
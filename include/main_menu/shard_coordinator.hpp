@@ -0,0 +1,49 @@
+#pragma once
+
+#include "main_menu/runtime_parameters.hpp"
+#include "main_menu/file_handler.hpp"
+#include "auxiliary/exit_status.hpp"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+
+/* Render split across several processes (sharding)
+
+   The samples of an offline render are split into count contiguous ranges of sample indices (shards).
+   The random numbers only depend on the seed, the pixel and the sample index (see render/render_loops.cpp),
+   so the shards rendered with the same seed draw disjoint sequences, and their sum is the image
+   of the render in a single process.
+
+   A worker process renders one shard (option -shard index/count) and saves it as <name>_shard<index>.rtdata
+   in the output directory. It reports its progress on its standard output, one line per pass:
+       Shard <index>/<count>: <samples> / <samples of the shard>
+   and one line after each checkpoint:
+       Shard <index>/<count>: saved
+   The shards can be rendered on several machines sharing a file system, and combined with the merger.
+
+   The coordinator (option -workers count) launches the workers as copies of the executable with the same arguments,
+   the same seed and one shard each, reads their reports through pipes, and merges the saved shards into
+   image.rtdata and image.bmp after each checkpoint and at the end.
+   On Linux, the CPUs available to the coordinator are split into disjoint sets, one per worker,
+   so that the workers (whose thread pool has one thread per available CPU) do not compete for the same cores.
+ */
+
+class shard_coordinator {
+
+    public:
+
+        /* Range [first, last) of the sample indices of shard among total samples */
+        static std::pair<unsigned int, unsigned int> sample_range(const shard_parameters& shard, unsigned int total);
+
+        /* Name of the raw data file of the shard index of the image output_name, in the output directory */
+        static std::string file_name(const std::string& output_name, unsigned int index);
+
+        /* Renders total samples with number_of_workers copies of the executable executable_name,
+           launched with the arguments of the coordinator (with seed instead of their seed, and one shard each),
+           and merges their shards as output_name.rtdata and output_name.bmp in the output directory */
+        static exit_status run(const std::string& executable_name, std::span<const std::string> arguments,
+            unsigned int number_of_workers, unsigned int total, uint64_t seed,
+            const file_handler& file_handler, const std::string& output_name);
+};
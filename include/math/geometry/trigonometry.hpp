@@ -29,11 +29,13 @@ namespace trig {
     /* Uniform sampling of a point on the surface of a unit sphere */
     inline rt::vector random_direction_sphere(const randomgen& rg) {
 
+        const auto [ u, v ] = rg.random_ratios<2>();
+
         /* cos(phi) is sampled uniformly on [-1, 1] */
-        const real cos_phi = 2.0_r * rg.random_ratio() - 1.0_r;
+        const real cos_phi = 2.0_r * u - 1.0_r;
 
         /* theta is sampled uniformly on [0, 2pi] */
-        const real theta = rg.random_angle();
+        const real theta = (2.0_r * PI) * v;
 
         return trig::direction(cos_phi, theta);
     }
@@ -44,13 +46,13 @@ namespace trig {
 
         return {
             .theta = (is_not_zero(x)) ?
-                  atan(z / x) + (is_positive(x) ? (3.0_r * PI / 2.0_r) : (PI / 2.0_r))
+                  std::atan(z / x) + (is_positive(x) ? (3.0_r * PI / 2.0_r) : (PI / 2.0_r))
                 : 0.0_r,
 
             // dir is a unit vector, but due to floating-point imprecision, dir.y can be greater than 1
             .phi = (not abs_less_than_one(y)) ?
                   (is_positive(y) ? 0.0_r : PI)
-                : acos(y)
+                : std::acos(y)
         };
     }
 };
\ No newline at end of file
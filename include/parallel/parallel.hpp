@@ -1,7 +1,14 @@
 #pragma once
 
+#include "parallel/tiles.hpp"
+
 #include <functional>
+#include <span>
 
 void parallel_for(int nb_elements, const std::function<void (int i)>& functor);
 
-void parallel_for(int nb_elements, const std::function<void (int start, int end)>& functor, int nb_threads = 0);
\ No newline at end of file
+void parallel_for(int nb_elements, const std::function<void (int start, int end)>& functor, int nb_threads = 0);
+
+/* Processes the tiles on the threads of the global pool, with work-stealing
+   The functor receives the index of the thread processing the tile, in [0, thread_pool::global().size()) */
+void parallel_for_tiles(std::span<const tile> tiles, const std::function<void (const tile& t, unsigned int thread_index)>& functor);
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/* Persistent work-stealing thread pool
+
+   The threads are created once and wait for batches of tasks submitted with run().
+   The tasks of a batch are dealt to the threads in contiguous blocks (so that neighbouring tasks,
+   e.g. neighbouring tiles along a space-filling curve, are processed by the same thread),
+   each thread consumes its own queue from the front, and when it is empty, steals tasks
+   from the back of the queues of the other threads. */
+
+class thread_pool {
+
+    public:
+
+        /* Functor called on each task, with the index of the thread executing it (in [0, size())) */
+        using task_function = std::function<void (int task, unsigned int thread_index)>;
+
+    private:
+
+        struct task_queue {
+            std::mutex mut;
+            std::deque<int> tasks;
+        };
+
+        std::vector<std::thread> threads;
+        std::vector<std::unique_ptr<task_queue>> queues;
+
+        /* Batch state, protected by mut */
+        std::mutex mut;
+        std::condition_variable batch_start;
+        std::condition_variable batch_end;
+        const task_function* current_function = nullptr;
+        unsigned long int batch_number = 0;
+        unsigned int number_of_idle_threads = 0;
+        bool stopping = false;
+
+        /* Only one batch can be submitted at a time */
+        std::mutex submission_mut;
+
+        void thread_loop(unsigned int thread_index);
+
+        std::optional<int> pop_task(unsigned int thread_index);
+
+    public:
+
+        /* Creates nb_threads threads (if nb_threads == 0, hardware_concurrency(),
+           or on Linux the number of CPUs the process can run on, if it is smaller) */
+        explicit thread_pool(unsigned int nb_threads = 0);
+
+        thread_pool(const thread_pool&)            = delete;
+        thread_pool(thread_pool&&)                 = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+        thread_pool& operator=(thread_pool&&)      = delete;
+
+        ~thread_pool() noexcept;
+
+        inline unsigned int size() const {
+            return threads.size();
+        }
+
+        /* Runs the functor on every task index in [0, nb_tasks) and returns once they are all completed
+           If called from a thread of a pool, the tasks are run sequentially on the calling thread */
+        void run(int nb_tasks, const task_function& functor);
+
+        /* Index of the calling thread in its pool, if it belongs to one */
+        static std::optional<unsigned int> current_thread_index();
+
+        /* Process-wide pool, created on first use */
+        static thread_pool& global();
+};
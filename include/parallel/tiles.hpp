@@ -0,0 +1,15 @@
+#pragma once
+
+#include "parameters.hpp"
+
+#include <vector>
+
+/* Rectangular region [x_start, x_end) x [y_start, y_end) of an image */
+struct tile {
+    int x_start, y_start;
+    int x_end, y_end;
+};
+
+/* Cuts a width x height image into tiles of size tile_size x tile_size (smaller on the right and bottom borders),
+   listed in the given order (row by row, or along a Morton or Hilbert curve, which keeps consecutive tiles close) */
+std::vector<tile> generate_tiles(int width, int height, int tile_size = TILE_SIZE, tile_order order = TILE_ORDER);
@@ -7,8 +7,17 @@
 
 /*** real ***/
 
-// Type alias for floating-point numerical values
+// Type alias for floating-point numerical values (geometry, intersections, shading)
+// Single precision is selected at compile time with the SINGLE_PRECISION option (see CMakeLists.txt)
+#ifdef RT_SINGLE_PRECISION
+using real = float;
+#else
 using real = double;
+#endif
+
+// Type of the color components: the colors are accumulated in the pixels over many samples,
+// so they stay in double precision whatever the precision of real
+using color_real = double;
 
 constexpr real operator ""_r(unsigned long long int x) { return static_cast<real>(x); }
 constexpr real operator ""_r(long double x)            { return static_cast<real>(x); }
@@ -50,6 +59,13 @@ enum class parallelism {
 };
 constexpr parallelism PARALLELISM = parallelism::Enabled;
 
+// Image tiles handed out to the render threads (side length in pixels, and order of traversal)
+enum class tile_order {
+    Rows, Morton, Hilbert
+};
+constexpr int        TILE_SIZE  = 16;
+constexpr tile_order TILE_ORDER = tile_order::Hilbert;
+
 /***********************************************************************/
 
 /*** Macro ***/
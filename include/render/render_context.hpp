@@ -0,0 +1,79 @@
+#pragma once
+
+#include "scene/scene.hpp"
+#include "tracing/tracing.hpp"
+#include "parallel/tiles.hpp"
+#include "main_menu/runtime_parameters.hpp"
+
+#include <memory>
+#include <vector>
+
+/* Rendering state kept alive for the whole render, shared by all the sample passes:
+   the tiles of the image, and for each thread of the global pool, its random generator and its worker
+   (the threads of the pool are persistent, so their thread_local BVH stacks are kept as well) */
+
+class render_context {
+
+    private:
+
+        struct thread_state {
+            const randomgen rg;
+            const worker worker_;
+
+            thread_state(const scene& scene, uint64_t seed, sampler_type sampler,
+                unsigned int number_of_bounces, russian_roulette_mode russian_roulette, nee_mode nee)
+
+                : rg(seed, ANTI_ALIASING, sampler),
+                  worker_(scene, rg, number_of_bounces, russian_roulette, nee) {}
+
+            thread_state(const thread_state&)            = delete;
+            thread_state(thread_state&&)                 = delete;
+            thread_state& operator=(const thread_state&) = delete;
+            thread_state& operator=(thread_state&&)      = delete;
+        };
+
+        std::vector<std::unique_ptr<const thread_state>> states;
+
+    public:
+
+        const scene& scene_;
+        const std::vector<tile> tiles;
+
+        /* Generator of the anti-aliasing shift of each pass */
+        const randomgen rg0;
+
+        /* Seed of all the generators: the render only depends on it (and on the scene and parameters) */
+        const uint64_t seed;
+
+        /* Path by path, or by batches of paths (one per tile) traced bounce by bounce */
+        const tracing_mode tracing;
+
+        /* Skipping of the converged tiles (the image must keep the statistics of its pixels) */
+        const adaptive_parameters adaptive;
+
+        /* Index of the first sample of the image, when it only holds a range of the samples of the render
+           (shard of a render split across several processes) */
+        const unsigned int first_sample;
+
+        render_context(const scene& scene, unsigned int number_of_bounces, russian_roulette_mode russian_roulette,
+            nee_mode nee, uint64_t seed, sampler_type sampler = sampler_type::Independent,
+            tracing_mode tracing = tracing_mode::PathByPath,
+            adaptive_parameters adaptive = { adaptive_parameters::mode::Disabled, 0.0f }, unsigned int first_sample = 0);
+
+        /* Draws the anti-aliasing shifts of the first number_of_passes passes, when the image continues
+           a previous render or starts at first_sample (the other numbers only depend on the seed, the pixel and the sample index) */
+        void skip_passes(unsigned int number_of_passes) const;
+
+        render_context(const render_context&)            = delete;
+        render_context(render_context&&)                 = delete;
+        render_context& operator=(const render_context&) = delete;
+        render_context& operator=(render_context&&)      = delete;
+
+        inline const randomgen& get_randomgen(unsigned int thread_index) const {
+            return states[thread_index]->rg;
+        }
+
+        inline const worker& get_worker(unsigned int thread_index) const {
+            return states[thread_index]->worker_;
+        }
+};
@@ -4,19 +4,19 @@
 #include "scene/scene.hpp"
 #include "main_menu/runtime_parameters.hpp"
 
+class render_context;
+
 /* Sequential loop */
 void render_loop_seq(image& image, const scene& scene, unsigned int number_of_bounces, russian_roulette_mode russian_roulette);
 
-/* Main render loop */
-void render_loop(image& image, const scene& scene, unsigned int number_of_bounces, russian_roulette_mode russian_roulette);
+/* Main render loop (one sample pass, on the threads of the pool) */
+void render_loop(image& image, const render_context& context);
 
 /* Main render loop with time measurement */
-void render_loop_time(image& image, const scene& scene, unsigned int number_of_bounces,
-    russian_roulette_mode russian_roulette, time_mode time_mode);
+void render_loop_time(image& image, const render_context& context, time_mode time_mode);
 
 // Temporarily disabled
 void render_loop_parallel_multisample(image& image, const scene& scene, unsigned int number_of_bounces, unsigned int number_of_samples);
 
 // Experiment
-void render_loop_parallel_all_at_once(image& image, const scene& scene, unsigned int number_of_bounces,
-    russian_roulette_mode russian_roulette, int target);
\ No newline at end of file
+void render_loop_parallel_all_at_once(image& image, const render_context& context, int target);
\ No newline at end of file
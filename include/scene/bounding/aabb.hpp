@@ -54,7 +54,13 @@ class aabb {
         }
 
         /* Only measures the distance from the outside of the aabb, otherwise returns 0.0_r */
-        real measure_distance(const ray& r) const;
+        inline real measure_distance(const ray& r) const {
+            return measure_distance(position, dims, r);
+        }
+
+        /* Same, for an aabb stored elsewhere (e.g. inline in a node of a flattened hierarchy)
+           as its position and dims, following the convention of type_ */
+        static real measure_distance(const rt::vector& position, const rt::vector& dims, const ray& r);
 
         inline bool is_hit_by(const ray& r) const {
             return measure_distance(r) < infinity;
@@ -68,6 +74,15 @@ class aabb {
                 return build_min_max_coord(position - dims, position + dims);
         }
 
+        /* Stored position (center or corner, depending on type_) and dimensions */
+        inline const rt::vector& get_stored_position() const {
+            return position;
+        }
+
+        inline const rt::vector& get_dims() const {
+            return dims;
+        }
+
         /* Returns the corner */
         inline rt::vector get_position() const {
             if constexpr (type_ == Corner)
@@ -13,6 +13,11 @@ class bounding {
 
         using box_type = aabb;
 
+        /* Number of children per node of the hierarchy used by the tree-search (see scene::hierarchy_type):
+           1 keeps the flattened hierarchy of aabbs in real precision (flat_bvh),
+           4 or 8 collapses it into wide nodes whose float boxes are tested with SSE or AVX (wide_bvh) */
+        static constexpr unsigned int node_width = 4;
+
         enum class node_type {
             InternalNode, TerminalNode
         };
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "scene/bounding/bounding.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/* Flattened bounding hierarchy
+
+   The pointer-linked boundings built by the clustering are converted after the build
+   into one contiguous array of nodes, in depth-first order, where the children of a node are stored
+   next to each other, and into one array of primitives, reordered so that the content of each
+   terminal node is a contiguous range.
+   The traversal then only follows indices into these two arrays. */
+
+class flat_bvh {
+
+    public:
+
+        /* One node per cache line: the aabb is stored inline, following the convention of aabb::type_ */
+        struct alignas(64) node {
+            rt::vector position;
+            rt::vector dims;
+            /* Index of the first child if the node is internal, or of the first primitive if it is terminal */
+            uint32_t first;
+            /* Number of children or primitives */
+            uint32_t count;
+            bounding::node_type type;
+            /* Container nodes (first-level non-polygon objects) have no box */
+            bool has_box;
+        };
+
+    private:
+
+        std::vector<node> nodes;
+        std::vector<const object*> primitives;
+
+        /* The first-level boundings are the first nodes of the array */
+        uint32_t number_of_roots = 0;
+
+        void add_subtree(uint32_t node_index, const bounding* bd);
+
+        static node make_node(const bounding* bd);
+
+    public:
+
+        flat_bvh() = default;
+
+        /* Flattens the hierarchies of the first-level boundings */
+        explicit flat_bvh(std::span<const bounding * const> bounding_set);
+
+        flat_bvh(flat_bvh&&) noexcept        = default;
+        flat_bvh& operator=(flat_bvh&&)      = default;
+        flat_bvh(const flat_bvh&)            = delete;
+        flat_bvh& operator=(const flat_bvh&) = delete;
+
+        inline std::size_t number_of_nodes() const {
+            return nodes.size();
+        }
+
+        /* Tree-search: updates distance_to_closest and closest_object if an object closer than
+           distance_to_closest is hit by the ray */
+        void find_closest(const ray& r, real& distance_to_closest, const object*& closest_object) const;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "scene/bounding/bounding.hpp"
+#include "scene/objects/triangle.hpp"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+/* Wide (multi-branching) bounding hierarchy
+
+   Same idea as flat_bvh, but each node stores the boxes of up to width children,
+   in single-precision structure-of-arrays lanes, so that all the child boxes are tested at once
+   with SIMD instructions (SSE for width 4, AVX for width 8).
+   The n-ary hierarchy built by the clustering or the SAH is collapsed to the node width:
+   the largest internal children are replaced by their own children until the node is full,
+   and nodes with too many children are split into intermediate nodes.
+
+   The triangles of the terminal nodes are packed in blocks of width triangles, also stored in float lanes,
+   which are tested at once; the other objects are tested one by one.
+
+   The float boxes are rounded outwards, and the float triangle tests only select candidates,
+   so that the closest object is always determined by the exact (real) intersection tests. */
+
+template<unsigned int width>
+class wide_bvh {
+
+    static_assert(width == 4 || width == 8, "The node width should be 4 or 8");
+
+    public:
+
+        struct alignas(32) node {
+            /* Boxes of the children, one lane per child */
+            std::array<float, width> min_x, min_y, min_z;
+            std::array<float, width> max_x, max_y, max_z;
+            /* Index of the child node if the child is internal, or of its leaf if it is terminal */
+            std::array<uint32_t, width> child;
+            /* Number of objects of a terminal child, 0 for an internal child */
+            std::array<uint32_t, width> count;
+        };
+
+        /* Triangles of a terminal node: first vertex and edges (p1 - p0, p2 - p0) */
+        struct alignas(32) triangle_block {
+            std::array<float, width> p0x, p0y, p0z;
+            std::array<float, width> e1x, e1y, e1z;
+            std::array<float, width> e2x, e2y, e2z;
+            /* Magnitudes of the first vertex (largest coordinate) and of the edges (sums of the coordinates),
+               which bound the rounding errors of the float test */
+            std::array<float, width> p0_norm, e1_norm, e2_norm;
+            /* Triangles used for the exact test and the shading (nullptr in unused lanes) */
+            std::array<const triangle*, width> triangles;
+            unsigned int valid_mask;
+        };
+
+        /* Content of a terminal node: blocks of triangles, then the other objects */
+        struct leaf {
+            uint32_t first_block;
+            uint32_t number_of_blocks;
+            uint32_t first_primitive;
+            uint32_t number_of_primitives;
+        };
+
+        /* Unused lanes have an empty box and this child index */
+        static constexpr uint32_t EMPTY_LANE = std::numeric_limits<uint32_t>::max();
+
+    private:
+
+        std::vector<node> nodes;
+        std::vector<leaf> leaves;
+        std::vector<triangle_block> blocks;
+        std::vector<const object*> primitives;
+
+        uint32_t add_node(std::span<const bounding * const> items);
+
+        uint32_t add_leaf(const std::vector<const object*>& content);
+
+    public:
+
+        wide_bvh() = default;
+
+        /* Collapses the hierarchies of the first-level boundings */
+        explicit wide_bvh(std::span<const bounding * const> bounding_set);
+
+        wide_bvh(wide_bvh&&) noexcept        = default;
+        wide_bvh& operator=(wide_bvh&&)      = default;
+        wide_bvh(const wide_bvh&)            = delete;
+        wide_bvh& operator=(const wide_bvh&) = delete;
+
+        inline std::size_t number_of_nodes() const {
+            return nodes.size();
+        }
+
+        /* Tree-search: updates distance_to_closest and closest_object if an object closer than
+           distance_to_closest is hit by the ray */
+        void find_closest(const ray& r, real& distance_to_closest, const object*& closest_object) const;
+};
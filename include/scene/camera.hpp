@@ -74,6 +74,9 @@ class camera {
         real mhalf_fovw;
         real mhalf_fovh;
 
+        /* Footprint of the camera rays: angle under which a pixel is seen (ray differentials of the pixel grid) */
+        ray_footprint pixel_footprint;
+
         /* Depth of field */
         real focal_length;
         real aperture;
@@ -108,6 +111,14 @@ class camera {
                      std::fma(dj, static_cast<real>(sj) + shift.vert,  mhalf_fovh) };
         }
 
+        /* Position drawn uniformly in the pixel, from the sample sequences of the generator */
+        inline std::pair<real, real> shift_sampled(const int i, const int j, const randomgen& rg) const {
+            constexpr real scale = STRATIFIED_ENABLED ? 4.0_r : 1.0_r;
+            const auto [ u, v ] = rg.random_ratios<2>();
+            return { std::fma(di, scale * (static_cast<real>(i) + u) - 0.5_r, mhalf_fovw),
+                     std::fma(dj, scale * (static_cast<real>(j) + v) - 0.5_r, mhalf_fovh) };
+        }
+
         inline rt::vector direction(real ishift, real jshift) const {
             return fma(to_the_right, ishift, fma(to_the_bottom, jshift, direction_scaled)).unit();
         }
@@ -129,15 +140,15 @@ class camera {
         /* Returns the ray that goes toward the pixel i,j of the screen */
         ray gen_ray_classic(int i, int j, int iteration) const {
             const auto [ ishift, jshift ] = shift_classic(i, j, iteration);
-            return ray(origin, direction(ishift, jshift));
+            return ray(origin, direction(ishift, jshift), pixel_footprint);
         }
 
         static inline aa_shift generate_shift(const randomgen& rg) {
             const real radius = rg.random_normal();
             const real angle  = rg.random_angle();
             return {
-                .horiz = radius * cos(angle),
-                .vert  = radius * sin(angle)
+                .horiz = radius * std::cos(angle),
+                .vert  = radius * std::sin(angle)
             };
         }
 
@@ -145,17 +156,26 @@ class camera {
            following a normal distribution around to center of the pixel, with given stardard deviation */
         ray gen_ray_normal(int i, int j, int iteration, const aa_shift& shift) const {
             const auto [ ishift, jshift ] = shift_normal(i, j, iteration, shift);
-            return ray(origin, direction(ishift, jshift));
+            return ray(origin, direction(ishift, jshift), pixel_footprint);
         }
 
         /* Returns the ray that goes toward the pixel i,j of the screen, with depth of field */
         ray gen_ray_dof(int i, int j, const randomgen& rg, int iteration) const;
 
+        /* Returns the ray that goes toward a position in the pixel i,j of the screen, drawn from the sample sequences */
+        ray gen_ray_sampled(int i, int j, const randomgen& rg) const {
+            const auto [ ishift, jshift ] = shift_sampled(i, j, rg);
+            return ray(origin, direction(ishift, jshift), pixel_footprint);
+        }
+
+        /* With a sampler, the position in the pixel is drawn from the sample sequences,
+           otherwise it is the stratified position of the iteration, with the shift shared by the whole pass */
         ray gen_ray(int i, int j, const randomgen& rg, int iteration, const aa_shift& shift) const {
-            return
-                mode.uses_dof() ?
-                      gen_ray_dof(i, j, rg, iteration)
-                    : gen_ray_normal(i, j, iteration, shift);
+            if (mode.uses_dof())
+                return gen_ray_dof(i, j, rg, iteration);
+            return rg.uses_sequences() ?
+                  gen_ray_sampled(i, j, rg)
+                : gen_ray_normal(i, j, iteration, shift);
         }
 
         rt::point project(const rt::vector& v, int width, int height) const;
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "scene/objects/object.hpp"
+#include "scene/material/material.hpp"
+
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+/* Light sources of the scene, sampled for the next-event estimation
+
+   The light sources are the objects with a full-intensity emissive material (which end the paths that hit them).
+   Only the triangles, quads and spheres can be sampled; the other light sources are only reached by the bounces.
+   A light source is chosen with a probability proportional to its power (area * intensity * average color),
+   then a point is chosen uniformly on its surface. */
+
+class emissive_lights {
+
+    private:
+        std::vector<const object*> lights;
+
+        /* Cumulative powers of the light sources */
+        std::vector<real> cumulative_power;
+        real total_power = 0.0_r;
+
+        /* Probability densities (with respect to the area) of the points of the light sources,
+           looked up when a light source is hit by a bounce */
+        std::unordered_map<const object*, real> pdf_areas;
+
+    public:
+
+        struct light_sample {
+            const object* light;
+            rt::vector point;
+            /* Probability density of the point, with respect to the area */
+            real pdf_area;
+        };
+
+        emissive_lights() = default;
+
+        emissive_lights(std::span<const object* const> object_set, std::span<const material> material_set);
+
+        static inline bool is_light_source(const material& m) {
+            return m.is_emissive() && m.get_emission_intensity() >= 1.0_r;
+        }
+
+        static bool is_samplable(const object* obj);
+
+        static inline real power(const object* obj, const material& m) {
+            return obj->area() * m.get_emission_intensity() * static_cast<real>(m.get_color().get_average());
+        }
+
+        inline bool empty() const {
+            return lights.empty();
+        }
+
+        inline std::size_t size() const {
+            return lights.size();
+        }
+
+        /* Chooses a light source and a point on it */
+        light_sample sample(const randomgen& rg) const;
+
+        /* Probability density (with respect to the area) of the points of obj,
+           0 if obj cannot be sampled */
+        inline real pdf_area(const object* obj) const {
+            const auto it = pdf_areas.find(obj);
+            return (it != pdf_areas.end()) ? it->second : 0.0_r;
+        }
+};
@@ -2,6 +2,10 @@
 
 #include "auxiliary/randomgen.hpp"
 #include "image/matrix.hpp"
+#include "scene/material/texture.hpp"
+
+#include <algorithm>
+#include <vector>
 
 constexpr unsigned int LOWRES_DEFAULT_WIDTH  = 854;
 constexpr unsigned int LOWRES_DEFAULT_HEIGHT = 480;
@@ -22,9 +26,12 @@ class alias_table {
         };
 
         std::vector<alias_bin> bins;
+        /* Probability of each bin, kept to evaluate the density of the samples */
+        std::vector<Float> probabilities;
         unsigned int map_width;
         unsigned int map_height;
         unsigned int pt_width;
+        unsigned int pt_height;
         Float ratio_x;
         Float ratio_y;
 
@@ -41,7 +48,13 @@ class alias_table {
             unsigned int pt_width,
             unsigned int pt_height)
 
-        : alias_table(compute_low_res_table(matrix), matrix.width, matrix.height, pt_width, pt_height) {}
+        : alias_table(compute_low_res_table(matrix, pt_width, pt_height), matrix.width, matrix.height, pt_width, pt_height) {}
+
+        alias_table(const texture& texture,
+            unsigned int pt_width,
+            unsigned int pt_height)
+
+        : alias_table(compute_low_res_table(texture, pt_width, pt_height), texture.get_width(), texture.get_height(), pt_width, pt_height) {}
 
         // Should be called in each thread at initialization
         inline random_ratio_gen<Float> get_random_generator() const {
@@ -55,10 +68,53 @@ class alias_table {
             return (rg.random<Float>() < p) ? i : alias;
         }
 
+        /* Same, with a single random number x in [0, 1): its integer part (times the number of bins)
+           selects the bin and its fractional part the alias, so that a stratified x gives stratified bins */
+        inline unsigned int sample_table(const Float x) const {
+
+            const Float scaled = x * static_cast<Float>(bins.size());
+            const unsigned int i = std::min(static_cast<unsigned int>(scaled), static_cast<unsigned int>(bins.size() - 1));
+            const auto [ p, alias ] = bins[i];
+            return (scaled - static_cast<Float>(i) < p) ? i : alias;
+        }
+
         light_map_sample sample_light_map(const random_ratio_gen<Float>& rg) const;
 
     private:
-        static std::vector<Float> compute_low_res_table(const matrix& matrix);
+        /* Probability table of the low-res image (of dimensions width * height) of the light map:
+           average luminance of the pixels of each low-res pixel, times the sine of the polar angle at its center */
+        static std::vector<Float> compute_low_res_table(const matrix& matrix, unsigned int width, unsigned int height);
+        static std::vector<Float> compute_low_res_table(const texture& texture, unsigned int width, unsigned int height);
+};
+
+/* Background texture used as a light source (environment map in equirectangular projection)
+
+   A low-res pixel is chosen with the alias table, then a point (u, v) uniformly in that pixel.
+   The texture coordinates are converted to a direction by the background, which knows its orientation. */
+
+class infinite_area_light {
+
+    private:
+        alias_table table;
+
+    public:
+
+        struct uv_sample {
+            real u, v;
+            /* Probability density of the direction, with respect to the solid angle
+               (0 at the poles, where the density is not defined) */
+            real pdf;
+        };
+
+        explicit infinite_area_light(const texture& map)
+            : table(map,
+                std::min(LOWRES_DEFAULT_WIDTH,  map.get_width()),
+                std::min(LOWRES_DEFAULT_HEIGHT, map.get_height())) {}
+
+        uv_sample sample(const randomgen& rg) const;
+
+        /* Probability density (with respect to the solid angle) of the direction of texture coordinates (u, v) */
+        real pdf(real u, real v) const;
 };
 
 
@@ -2,8 +2,10 @@
 
 #include "scene/material/texture.hpp"
 #include "math/geometry/mat3.hpp"
+#include "scene/light_sources/infinite_area.hpp"
 
 #include <cmath>
+#include <optional>
 
 constexpr linalg::mat_type mat_type = linalg::mat_type::Col;
 
@@ -19,9 +21,16 @@ class background_container {
         rt::color bg_color;
         texture bg_texture;
         linalg::mat3<mat_type> rotation_matrix;
+        linalg::mat3<mat_type> inverse_rotation_matrix;
+
+        /* Importance sampling of the directions according to the texture, when a texture is set */
+        std::optional<infinite_area_light> light;
 
         /* Returns the color of the pixel dir is pointing at, when a texture is set */
-        const rt::color& get_texture_color(const rt::vector& dir) const;
+        rt::color get_texture_color(const rt::vector& dir) const;
+
+        /* Direction (in the scene) pointing at the texture coordinates (u, v) */
+        rt::vector get_direction(real u, real v) const;
 
     public:
         /* Struct containing the background color, the background texture and its orientation */
@@ -30,10 +39,29 @@ class background_container {
 
         background_container(texture&& txt, const real theta_x, const real theta_y, const real theta_z)
             : type_(type::Textured), bg_texture(std::move(txt)),
-                rotation_matrix(linalg::mat3<mat_type>::rotation(theta_x, theta_y, theta_z)) {}
+                rotation_matrix(linalg::mat3<mat_type>::rotation(theta_x, theta_y, theta_z)),
+                inverse_rotation_matrix(linalg::mat3<mat_type>::inverse_rotation(theta_x, theta_y, theta_z)),
+                light(std::in_place, bg_texture) {}
+
+        struct direction_sample {
+            rt::vector direction;
+            /* Probability density of the direction, with respect to the solid angle (0 if the sample is invalid) */
+            real pdf;
+        };
+
+        /* Whether the directions of the background can be sampled according to its brightness */
+        inline bool is_importance_sampled() const {
+            return light.has_value();
+        }
+
+        /* Samples a direction with a probability proportional to the brightness of the background texture */
+        direction_sample sample_direction(const randomgen& rg) const;
+
+        /* Probability density of dir (with respect to the solid angle) for sample_direction */
+        real pdf(const rt::vector& dir) const;
 
         /* Returns the background color when it is a color */
-        inline const rt::color& get_color(const rt::vector& dir) const {
+        inline rt::color get_color(const rt::vector& dir) const {
             using enum type;
 
             switch (type_) {
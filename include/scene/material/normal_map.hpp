@@ -3,24 +3,96 @@
 #include "math/geometry/vector.hpp"
 #include "file_readers/parsers/parsing_wrappers.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <string>
 #include <vector>
-#include <algorithm>
+
+/* Class representing a normal map
+
+   The normals are stored in one contiguous buffer, in the octahedral encoding:
+   the unit vector is projected on the octahedron |x| + |y| + |z| = 1, whose lower half is folded onto the upper one,
+   and the two coordinates on the unfolded square are stored as 16-bit integers (4 bytes per texel
+   instead of 24 for an rt::vector, for an angular error below 0.01 degree).
+
+   A mip pyramid is built when the map is loaded (each level halves the dimensions of the previous one,
+   its normals being the normalized average of four normals of the previous level),
+   and the level is selected from the footprint of the ray, as for the textures */
 
 class normal_map {
 
     public:
-        using vector_matrix = std::vector<std::vector<rt::vector>>;
+        using encoded_normal = uint32_t;
+
+        /* Normals of the full resolution, encoded, row by row */
+        struct normals {
+            unsigned int width, height;
+            std::vector<encoded_normal> data;
+        };
 
     private:
-        vector_matrix data;
-        int width, height;
-        real width_real, height_real;
+
+        /* Level of the mip pyramid: position of its normals in data, and dimensions */
+        struct level {
+            std::size_t offset;
+            unsigned int width, height;
+            real max_x, max_y; // Coordinates of the last column and row
+        };
+
+        std::vector<encoded_normal> data; // Normals of all the levels, from the full resolution to 1x1
+        unsigned int width = 0, height = 0;
+        std::vector<level> levels;
+
+        /* Serialization of the data members (see file_readers/parsers/scene_snapshot.hpp) */
+        friend class scene_snapshot;
+
+        /* Fills levels from the dimensions of the map, and returns the total number of normals */
+        std::size_t compute_levels();
+
+        /* Computes the normals of the levels after the first one */
+        void build_mipmaps();
+
+        static inline real decode_coordinate(const uint32_t c) {
+            return static_cast<real>(c) * (2.0_r / 65535.0_r) - 1.0_r;
+        }
+
+        static inline uint32_t encode_coordinate(const real x) {
+            return static_cast<uint32_t>(std::lround((std::clamp(x, -1.0_r, 1.0_r) + 1.0_r) * (65535.0_r / 2.0_r)));
+        }
+
+        /* Normal of column x and row y of level l (not normalized) */
+        inline rt::vector get_normal(const level& l, const unsigned int x, const unsigned int y) const {
+            return decode(data[l.offset + static_cast<std::size_t>(y) * l.width + x]);
+        }
+
+        /* Bilinear interpolation of the four normals of level l around the UV-coordinates u, v (not normalized) */
+        inline rt::vector bilinear(const level& l, const real u, const real v) const {
+
+            // Due to floating-point imprecision, some "unit" vector have a norm slightly larger than 1,
+            // producing out of range coordinates
+            const real x = std::clamp(u * l.max_x, 0.0_r, l.max_x);
+            const real y = std::clamp(v * l.max_y, 0.0_r, l.max_y);
+
+            const unsigned int x0 = static_cast<unsigned int>(x);
+            const unsigned int y0 = static_cast<unsigned int>(y);
+            const unsigned int x1 = std::min(x0 + 1, l.width  - 1);
+            const unsigned int y1 = std::min(y0 + 1, l.height - 1);
+            const real tx = x - static_cast<real>(x0);
+            const real ty = y - static_cast<real>(y0);
+
+            const rt::vector n00 = get_normal(l, x0, y0), n10 = get_normal(l, x1, y0);
+            const rt::vector n01 = get_normal(l, x0, y1), n11 = get_normal(l, x1, y1);
+            const rt::vector top    = fma(n10 - n00, tx, n00);
+            const rt::vector bottom = fma(n11 - n01, tx, n01);
+            return fma(bottom - top, ty, top);
+        }
     
     public:
         normal_map() {}
 
-        normal_map(unsigned int w, unsigned int h, vector_matrix&& data);
+        /* Constructor from the normals of the full resolution */
+        normal_map(normals&& n);
 
         /* Constructor from a .bmp file */
         normal_map(const std::string& file_name);
@@ -31,16 +103,75 @@ class normal_map {
         normal_map(const normal_map&)            = delete;
         normal_map& operator=(const normal_map&) = delete;
 
-        /* Returns the normal in tangent space at the given UV-coordinates u, v (between 0 and 1) */
-        /* Returns the local normal at the given UV-coordinates u, v (between 0 and 1) */
-        inline const rt::vector& get_tangent_space_normal(const real u, const real v) const {
-            const int x = u * width_real;
-            const int y = v * height_real;
-            // Due to floating-point imprecision, some "unit" vector have a norm slightly larger than 1,
-            // producing out of range coordinates
-            return data[ std::clamp(y, 0, height) ][ std::clamp(x, 0, width) ]; 
+        /* Octahedral encoding of the unit vector n */
+        static inline encoded_normal encode(const rt::vector& n) {
+
+            const real inv_l1 = 1.0_r / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+            real x = n.x * inv_l1;
+            real y = n.y * inv_l1;
+            if (n.z < 0.0_r) {
+                // Folding of the lower half
+                const real fx = (1.0_r - std::abs(y)) * (x >= 0.0_r ? 1.0_r : -1.0_r);
+                const real fy = (1.0_r - std::abs(x)) * (y >= 0.0_r ? 1.0_r : -1.0_r);
+                x = fx;
+                y = fy;
+            }
+            return (encode_coordinate(y) << 16) | encode_coordinate(x);
+        }
+
+        /* Unit vector of the octahedral encoding e */
+        static inline rt::vector decode(const encoded_normal e) {
+
+            real x = decode_coordinate(e & 0xFFFF);
+            real y = decode_coordinate(e >> 16);
+            const real z = 1.0_r - std::abs(x) - std::abs(y);
+            if (z < 0.0_r) {
+                // Unfolding of the lower half
+                const real t = -z;
+                x += (x >= 0.0_r) ? -t : t;
+                y += (y >= 0.0_r) ? -t : t;
+            }
+            return rt::vector(x, y, z).unit();
+        }
+
+        /* Returns the normal in tangent space at the given UV-coordinates u, v (between 0 and 1),
+           at the level of detail lod: bilinearly interpolated between the normals,
+           and linearly between the two closest levels */
+        inline rt::vector get_tangent_space_normal(const real u, const real v, const real lod = 0.0_r) const {
+
+            if (not (lod > 0.0_r) || levels.size() == 1)
+                return bilinear(levels.front(), u, v).unit();
+
+            const real clamped_lod = std::min(lod, static_cast<real>(levels.size() - 1));
+            const std::size_t l0 = static_cast<std::size_t>(clamped_lod);
+            const real t = clamped_lod - static_cast<real>(l0);
+            if (l0 + 1 == levels.size() || t == 0.0_r)
+                return bilinear(levels[l0], u, v).unit();
+
+            const rt::vector fine = bilinear(levels[l0], u, v);
+            return fma(bilinear(levels[l0 + 1], u, v) - fine, t, fine).unit();
+        }
+
+        inline unsigned int get_width() const {
+            return width;
+        }
+
+        inline unsigned int get_height() const {
+            return height;
         }
+
+        inline std::size_t get_number_of_levels() const {
+            return levels.size();
+        }
+
+        /* Memory used by the normals (of all the levels), in bytes */
+        inline std::size_t memory_size() const {
+            return data.size() * sizeof(encoded_normal);
+        }
+
+        /* Dimensions and memory used by the map, compared to a storage as vectors */
+        std::string memory_report() const;
 };
 
 template<>
-inline constexpr std::string type_str<normal_map>() { return "normal map"; }
\ No newline at end of file
+inline constexpr std::string type_str<normal_map>() { return "normal map"; }
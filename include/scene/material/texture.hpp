@@ -2,46 +2,214 @@
 
 #include "image/matrix.hpp"
 #include "file_readers/parsers/parsing_wrappers.hpp"
+#include "auxiliary/simd.hpp"
+#include "auxiliary/half.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <optional>
+#include <vector>
 
 /* Class representing texture data
 
    All textures from a scene are stored in the static vector texture::set,
    and materials can store a texture_info object, pointing to a texture object
    and coordinates from this texture
+
+   The texels are stored in a compact format chosen according to the source of the texture,
+   and decoded on the fly when the texture is sampled:
+    - RGB8: 3 bytes per texel, for the .bmp files. The components are decoded with a table,
+      which also applies the gamma correction,
+    - RGBE: 4 bytes per texel (8-bit mantissas and a shared exponent, as in the file), for the .hdr files,
+    - Half: 6 bytes per texel (half-precision floats), for the textures built from a matrix of colors.
+
+   A mip pyramid is built when the texture is loaded (each level halves the dimensions of the previous one),
+   so that the samples of distant or grazing surfaces read a few texels of a small level,
+   selected from the footprint of the ray, instead of texels scattered across the full resolution.
  */
 
 class texture {
 
+    public:
+
+        enum class texel_format : uint8_t {
+            RGB8, RGBE, Half
+        };
+
     private:
-        matrix data;
-        int width, height;
-        real width_real, height_real;
 
-    public:      
+        using lanes = float_lanes<4>;
+
+        /* Level of the mip pyramid: position of its texels in texels, and dimensions */
+        struct level {
+            std::size_t offset;
+            unsigned int width, height;
+            real max_x, max_y; // Coordinates of the last column and row
+        };
+
+        texel_format format = texel_format::RGB8;
+        std::vector<uint8_t> texels; // Texels of all the levels, from the full resolution to 1x1
+        unsigned int width = 0, height = 0;
+        std::vector<level> levels;
+
+        /* Value of each 8-bit component (RGB8 format), or scale factor of each exponent (RGBE format) */
+        std::array<float, 256> component_table = {};
+
+        /* Serialization of the data members (see file_readers/parsers/scene_snapshot.hpp) */
+        friend class scene_snapshot;
+
+        static constexpr std::size_t bytes_per_texel(const texel_format format) {
+            switch (format) {
+                case texel_format::RGB8: return 3;
+                case texel_format::RGBE: return 4;
+                case texel_format::Half: return 6;
+                default: throw;
+            }
+        }
+
+        static inline lanes make_lanes(const float r, const float g, const float b) {
+            alignas(16) const std::array<float, 4> values = { r, g, b, 0.0f };
+            return lanes::load(values.data());
+        }
+
+        static inline rt::color to_color(const lanes& l) {
+            alignas(16) std::array<float, 4> c;
+            l.store(c.data());
+            return rt::color(c[0], c[1], c[2]);
+        }
+
+        /* Fills levels from the dimensions of the texture, and returns the total number of texels */
+        std::size_t compute_levels();
+
+        /* Computes the texels of the levels after the first one, each texel being the average of four texels
+           of the previous level (box filter) */
+        void build_mipmaps();
+
+        /* Writes the color c in the format of the texture at position t */
+        void encode(const rt::color& c, uint8_t* t) const;
+
+        /* Decoded texel of column x and row y of level l */
+        template<texel_format F>
+        inline lanes decode(const level& l, const unsigned int x, const unsigned int y) const {
+
+            const uint8_t* const t = texels.data()
+                + bytes_per_texel(F) * (l.offset + static_cast<std::size_t>(y) * l.width + x);
+
+            if constexpr (F == texel_format::RGB8)
+                return make_lanes(component_table[t[0]], component_table[t[1]], component_table[t[2]]);
+
+            else if constexpr (F == texel_format::RGBE)
+                return make_lanes(t[0], t[1], t[2]) * lanes::broadcast(component_table[t[3]]);
+
+            else {
+                std::array<uint16_t, 3> h;
+                std::memcpy(h.data(), t, sizeof(h));
+                return make_lanes(half_to_float(h[0]), half_to_float(h[1]), half_to_float(h[2]));
+            }
+        }
+
+        /* Bilinear interpolation of the four texels of level l around the UV-coordinates u, v */
+        template<texel_format F>
+        inline lanes bilinear(const level& l, const real u, const real v) const {
+
+            // Due to floating-point imprecision, some "unit" vector have a norm slightly larger than 1,
+            // producing out of range coordinates
+            const real x = std::clamp(u * l.max_x, 0.0_r, l.max_x);
+            const real y = std::clamp(v * l.max_y, 0.0_r, l.max_y);
+
+            const unsigned int x0 = static_cast<unsigned int>(x);
+            const unsigned int y0 = static_cast<unsigned int>(y);
+            const unsigned int x1 = std::min(x0 + 1, l.width  - 1);
+            const unsigned int y1 = std::min(y0 + 1, l.height - 1);
+
+            const lanes tx = lanes::broadcast(static_cast<float>(x - x0));
+            const lanes ty = lanes::broadcast(static_cast<float>(y - y0));
+
+            const lanes c00 = decode<F>(l, x0, y0), c10 = decode<F>(l, x1, y0);
+            const lanes c01 = decode<F>(l, x0, y1), c11 = decode<F>(l, x1, y1);
+            const lanes top    = c00 + (c10 - c00) * tx;
+            const lanes bottom = c01 + (c11 - c01) * tx;
+
+            return top + (bottom - top) * ty;
+        }
+
+        /* Trilinear filtering: interpolation between the bilinear samples of the two levels around lod */
+        template<texel_format F>
+        inline rt::color trilinear(const real u, const real v, const real lod) const {
+
+            if (not (lod > 0.0_r) || levels.size() == 1)
+                return to_color(bilinear<F>(levels.front(), u, v));
+
+            const real clamped_lod = std::min(lod, static_cast<real>(levels.size() - 1));
+            const std::size_t l0 = static_cast<std::size_t>(clamped_lod);
+            const real t = clamped_lod - static_cast<real>(l0);
+            if (l0 + 1 == levels.size() || t == 0.0_r)
+                return to_color(bilinear<F>(levels[l0], u, v));
+
+            const lanes fine   = bilinear<F>(levels[l0],     u, v);
+            const lanes coarse = bilinear<F>(levels[l0 + 1], u, v);
+            return to_color(fine + (coarse - fine) * lanes::broadcast(static_cast<float>(t)));
+        }
+
+    public:
         texture() {}
 
-        texture(matrix&& matrix) :
-            data(std::move(matrix)),
-            width(data.width - 1), height(data.height - 1),
-            width_real(width),
-            height_real(height) {}
+        /* Constructor from a matrix of colors (stored in the Half format) */
+        texture(const matrix& matrix);
 
         /* Constructor from a .bmp or .hdr file */
         texture(const std::string& file_name, std::optional<real> gamma = std::nullopt);
 
-        /* Returns the color stored in data at UV-coordinates u, v (between 0 and 1) times width, height */
-        inline const rt::color& get_color(const real u, const real v) const {
-            const int x = u * width_real;
-            const int y = v * height_real;
-            // Due to floating-point imprecision, some "unit" vector have a norm slightly larger than 1,
-            // producing out of range coordinates
-            return data[ std::clamp(y, 0, height), std::clamp(x, 0, width) ];
+        /* Returns the color at UV-coordinates u, v (between 0 and 1), at the level of detail lod
+           (log2 of the size of the footprint of the sample, in texels of the full resolution):
+           bilinearly interpolated between the texels, and linearly between the two closest levels */
+        inline rt::color get_color(const real u, const real v, const real lod = 0.0_r) const {
+            using enum texel_format;
+
+            switch (format) {
+                case RGB8: return trilinear<RGB8>(u, v, lod);
+                case RGBE: return trilinear<RGBE>(u, v, lod);
+                case Half: return trilinear<Half>(u, v, lod);
+                default: throw;
+            }
+        }
+
+        /* Color of the texel of column x and row y (of the full resolution, or of level l of the mip pyramid) */
+        inline rt::color get_texel(const unsigned int x, const unsigned int y, const std::size_t l = 0) const {
+            using enum texel_format;
+
+            switch (format) {
+                case RGB8: return to_color(decode<RGB8>(levels[l], x, y));
+                case RGBE: return to_color(decode<RGBE>(levels[l], x, y));
+                case Half: return to_color(decode<Half>(levels[l], x, y));
+                default: throw;
+            }
         }
 
+        inline unsigned int get_width() const {
+            return width;
+        }
+
+        inline unsigned int get_height() const {
+            return height;
+        }
+
+        inline std::size_t get_number_of_levels() const {
+            return levels.size();
+        }
+
+        /* Memory used by the texels (of all the levels), in bytes */
+        inline std::size_t memory_size() const {
+            return texels.size();
+        }
+
+        /* Dimensions, format and memory used by the texture, compared to a storage as colors */
+        std::string memory_report() const;
+
         ~texture()                    noexcept = default;
 
         texture(texture&&)            noexcept = default;
@@ -52,4 +220,4 @@ class texture {
 };
 
 template<>
-inline constexpr std::string type_str<texture>() { return "texture"; }
\ No newline at end of file
+inline constexpr std::string type_str<texture>() { return "texture"; }
@@ -5,6 +5,9 @@
 
 class box final : public object {
     
+    /* Serialization of the data members (see file_readers/parsers/scene_snapshot.hpp) */
+    friend class scene_snapshot;
+
     private:
     
         /* A box is defined by a vector position, which represents the center of the box,
@@ -85,5 +88,7 @@ class box final : public object {
         
         rt::vector sample_visible(const randomgen& rg, const rt::vector& pt) const override;
 
+        real area() const override;
+
         void print() const override;
 };
@@ -5,6 +5,9 @@
 
 class cylinder final : public object {
     
+    /* Serialization of the data members (see file_readers/parsers/scene_snapshot.hpp) */
+    friend class scene_snapshot;
+
     private:
 
         rt::vector direction;
@@ -59,5 +62,7 @@ class cylinder final : public object {
         
         rt::vector sample_visible(const randomgen& rg, const rt::vector& pt) const override;
 
+        real area() const override;
+
         void print() const override;
 };
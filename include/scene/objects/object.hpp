@@ -90,5 +90,8 @@ class object {
         virtual rt::vector sample_visible(const randomgen& rg,
             const rt::vector& pt) const                              = 0;
 
+        /* Returns the surface area of the object */
+        virtual real area() const                                    = 0;
+
         virtual void print() const                                   = 0;
 };
\ No newline at end of file
@@ -5,6 +5,9 @@
 
 class plane final : public object {
     
+    /* Serialization of the data members (see file_readers/parsers/scene_snapshot.hpp) */
+    friend class scene_snapshot;
+
     private:
 
         rt::vector normal;
@@ -74,5 +77,7 @@ class plane final : public object {
         
         rt::vector sample_visible(const randomgen& rg, const rt::vector& pt) const override;
 
+        real area() const override;
+
         void print() const override;
 };
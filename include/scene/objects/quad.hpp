@@ -7,6 +7,9 @@
 
 class quad final : public object {
     
+    /* Serialization of the data members (see file_readers/parsers/scene_snapshot.hpp) */
+    friend class scene_snapshot;
+
     private:
     
         /* A quad is defined by a normal (unit) vector (a,b,c), and three (non-unit) vectors position, v1, v2, v3
@@ -87,6 +90,8 @@ class quad final : public object {
         
         rt::vector sample_visible(const randomgen& rg, const rt::vector& pt) const override;
 
+        real area() const override;
+
         void print() const override;
 
     private:
@@ -6,6 +6,9 @@
 
 class sphere final : public object {
     
+    /* Serialization of the data members (see file_readers/parsers/scene_snapshot.hpp) */
+    friend class scene_snapshot;
+
     private:
 
         real radius;
@@ -61,5 +64,8 @@ class sphere final : public object {
         /* Uniformly samples a point on the sphere that is visible from pt */
         rt::vector sample_visible(const randomgen& rg, const rt::vector& pt) const override;
 
+        /* Surface area (used for the sampling of light sources) */
+        real area() const override;
+
         void print() const override;
 };
@@ -35,6 +35,9 @@ inline std::string det_case_to_string(det_case case_det) {
 
 class triangle final : public object {
     
+    /* Serialization of the data members (see file_readers/parsers/scene_snapshot.hpp) */
+    friend class scene_snapshot;
+
     private:
         /* A triangle is defined by a normal (unit) vector (a,b,c), and three (non-unit) vectors position, v1, v2
            (when the triangle is three points P0, P1, P2, position = P0, v1 = P1-P0 and v2 = P2-P0).
@@ -106,8 +109,7 @@ class triangle final : public object {
         /* General function, used in triangle and quad classes */
         static inline rt::vector sample_triangle(const randomgen& rg, const rt::vector& v0, const rt::vector& v1, const rt::vector& v2) {
             
-            const real x = rg.random_ratio();
-            const real y = rg.random_ratio();
+            const auto [ x, y ] = rg.random_ratios<2>();
             
             real u, v;
             if (x < y) {
@@ -126,6 +128,8 @@ class triangle final : public object {
         
         rt::vector sample_visible(const randomgen& rg, const rt::vector& pt) const override;
 
+        real area() const override;
+
         void print() const override;
 
     private:
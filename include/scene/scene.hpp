@@ -8,6 +8,9 @@
 #include "scene/objects/cylinder.hpp"
 
 #include "scene/bounding/bounding.hpp"
+#include "scene/bounding/flat_bvh.hpp"
+#include "scene/bounding/wide_bvh.hpp"
+#include "accelerating_structures/bvh_parameters.hpp"
 #include "scene/material/texture.hpp"
 #include "auxiliary/randomgen.hpp"
 #include "scene/camera.hpp"
@@ -16,6 +19,7 @@
 #include "scene/material/material.hpp"
 
 #include "scene/material/mapping.hpp"
+#include "scene/light_sources/emissive_lights.hpp"
 
 /* Struct containing all info from a map sample */
 struct map_sample {
@@ -187,11 +191,18 @@ class scene {
         /* Set of the first-level bounding boxes */
         std::vector<const bounding*> bounding_set;
 
+        /* Flattened copy of the bounding hierarchy, used for the tree-search */
+        using hierarchy_type = std::conditional_t<bounding::node_width == 1, flat_bvh, wide_bvh<bounding::node_width>>;
+        hierarchy_type flat_hierarchy;
+
         /* Objects, materials, textures, normal_maps */
         containers::object      object_containers;
         containers::mapping     mapping_containers;
         containers::orientation orientation_containers;
 
+        /* Light sources sampled by the next-event estimation */
+        emissive_lights lights;
+
         /* Camera */
         camera cam;
 
@@ -199,8 +210,8 @@ class scene {
         int width;
         int height;
 
-        // Triangles are grouped by the given number in the bounding box tree-search method
-        unsigned int polygons_per_bounding;
+        // Parameters of the bounding hierarchy built around the triangles of the .obj files
+        bvh_parameters bvh_params;
 
         std::optional<real> gamma;
         
@@ -214,7 +225,7 @@ class scene {
             scene::containers::orientation&& orientation_containers,
             camera&& cam,
             int width, int height,
-            unsigned int polygons_per_bounding,
+            const bvh_parameters& bvh_params,
             std::optional<real> gamma
         );
 
@@ -249,6 +260,8 @@ class scene {
         /* Returns the color of the pixel associated with UV-coordinates u, v */
         
         /* Sampling maps */
-        const rt::color& sample_color(const hit& h, const material& m) const;
-        map_sample sample_maps(const hit& h, const material& m) const;
+        rt::color sample_color(const hit& h, const material& m) const;
+
+        /* The level of detail of the maps is selected from the footprint of the ray r on the surface */
+        map_sample sample_maps(const hit& h, const material& m, const ray& r) const;
 };
\ No newline at end of file
@@ -11,12 +11,12 @@ namespace rt  {
 
 	struct color {
 
-		real red, green, blue;
+		color_real red, green, blue;
 
 		constexpr color()
-			: red(0.0_r), green(0.0_r), blue(0.0_r) {}
+			: red(0.0), green(0.0), blue(0.0) {}
 
-		constexpr color(const real r, const real g, const real b)
+		constexpr color(const color_real r, const color_real g, const color_real b)
 			: red(r), green(g), blue(b) {}
 
 		constexpr color(const color&) 	 noexcept = default;
@@ -25,13 +25,18 @@ namespace rt  {
 		color& operator=(color&&)		 noexcept = default;
 
 
-		inline real get_average() const {
-			return (red + green + blue) * (1.0_r / 3.0_r);
+		inline color_real get_average() const {
+			return (red + green + blue) * (1.0 / 3.0);
 		}
 
 		// Same between 0 and 1
-		inline real get_average_ratio() const {
-			return (red + green + blue) * (1.0_r / (3.0_r * 255.0_r));
+		inline color_real get_average_ratio() const {
+			return (red + green + blue) * (1.0 / (3.0 * 255.0));
+		}
+
+		// Relative luminance (Rec. 709)
+		inline color_real get_luminance() const {
+			return 0.2126 * red + 0.7152 * green + 0.0722 * blue;
 		}
 
 		inline bool operator==(const color& c) const {
@@ -40,7 +45,7 @@ namespace rt  {
 				&& (c.blue  == blue);
 		}
 
-		inline color operator*(const real x) const {
+		inline color operator*(const color_real x) const {
 			return color(
 				x * red,
 				x * green,
@@ -57,7 +62,7 @@ namespace rt  {
 		}
 
 		inline color operator*(const color& c) const {
-			constexpr real inv255 = 1.0_r / 255.0_r;
+			constexpr color_real inv255 = 1.0 / 255.0;
 			return color(
 				red   * c.red   * inv255,
 				green * c.green * inv255,
@@ -65,8 +70,8 @@ namespace rt  {
 			);
 		}
 		
-		inline color operator/(const real x) const {
-			const real invx = 1.0_r / x;
+		inline color operator/(const color_real x) const {
+			const color_real invx = 1.0 / x;
 			return color(
 				red   * invx,
 				green * invx,
@@ -88,40 +93,40 @@ namespace rt  {
 		}
 
 		inline void operator *=(const color& other) {
-			constexpr real inv255 = 1.0_r / 255.0_r;
+			constexpr color_real inv255 = 1.0 / 255.0;
 			red   *= other.red   * inv255;
 			green *= other.green * inv255;
 			blue  *= other.blue  * inv255;
 		}
 
-		inline void operator *=(const real a) {
+		inline void operator *=(const color_real a) {
 			red   *= a;
 			green *= a;
 			blue  *= a;
 		}
 
-		inline void operator /=(const real a) {
+		inline void operator /=(const color_real a) {
 			red   /= a;
 			green /= a;
 			blue  /= a;
 		}
 
 		// exponentiation operator
-		inline void operator^=(const real a) {
+		inline void operator^=(const color_real a) {
 			red   = pow(red,   a);
 			green = pow(green, a);
 			blue  = pow(blue,  a);
 		}
 
-		inline void apply_gamma(const real gamma) {
-			(*this) /= 255.0_r;
+		inline void apply_gamma(const color_real gamma) {
+			(*this) /= 255.0;
 			(*this) ^= gamma;
-			(*this) *= 255.0_r;
+			(*this) *= 255.0;
 		}
 
 		/* Maxing out color components at 255. */
 		[[nodiscard]] color get_capped() const {
-			constexpr real max = 255.0_r;
+			constexpr color_real max = 255.0;
 			return color(
 				std::min(red,   max),
 				std::min(green, max),
@@ -130,7 +135,7 @@ namespace rt  {
 		}
 
 		inline void cap() {
-			constexpr real max = 255.0_r;
+			constexpr color_real max = 255.0;
 			red   = std::min(red,   max);
 			green = std::min(green, max);
 			blue  = std::min(blue,  max);
@@ -171,7 +176,7 @@ namespace rt  {
 	color average_col_vect(std::span<const color> color_set);
 
 	// Returns c1 * a + c2
-	inline color fma(const color& c1, const real a, const color& c2) {
+	inline color fma(const color& c1, const color_real a, const color& c2) {
 		return
 			color(
 				std::fma(c1.red,   a, c2.red),
@@ -185,9 +190,9 @@ namespace rt  {
 
 		return
 			color(
-				std::fma(c1.red,   c2.red   / 255.0_r, c3.red),
-				std::fma(c1.green, c2.green / 255.0_r, c3.green),
-				std::fma(c1.blue,  c2.blue  / 255.0_r, c3.blue)
+				std::fma(c1.red,   c2.red   / 255.0, c3.red),
+				std::fma(c1.green, c2.green / 255.0, c3.green),
+				std::fma(c1.blue,  c2.blue  / 255.0, c3.blue)
 			);
 	}
 }
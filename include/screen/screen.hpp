@@ -80,7 +80,8 @@ namespace rt {
 
 			/****************************************************************************************************/
 
-			/* Copies the rt::color matrix onto the screen, by averaging the number_of_rays colors per pixel */
+			/* Copies the rt::color matrix onto the screen, by averaging the number_of_rays colors per pixel
+			   (with adaptive sampling, each pixel is averaged over its own number of samples) */
 			void fast_copy(unsigned int number_of_rays) const;
 
 			void fast_copy_gamma(unsigned int number_of_rays) const;
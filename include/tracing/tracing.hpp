@@ -4,10 +4,18 @@
 #include "screen/color.hpp"
 #include "scene/scene.hpp"
 #include "main_menu/runtime_parameters.hpp"
+#include "image/aov.hpp"
 
 #include "tracing/direction.hpp"
 #include "auxiliary/stack_based_custom_stack.hpp"
 
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
 
 class worker {
     public:
@@ -16,21 +24,34 @@ class worker {
         
         unsigned int bounce;
         russian_roulette_mode russian_roulette;
+        nee_mode nee;
         real init_refr_index;
         bvh_option bvh;
 
-        mutable stack_based_custom_stack<real, 20> refr_stack;
+        using refraction_stack = stack_based_custom_stack<real, 20>;
+
+        mutable refraction_stack refr_stack;
 
         worker(const scene& scene, const randomgen& rg,
-            unsigned int bounce, russian_roulette_mode russian_roulette, real init_refr_index = 1.0_r)
+            unsigned int bounce, russian_roulette_mode russian_roulette,
+            nee_mode nee = nee_mode::Disabled, real init_refr_index = 1.0_r)
 
             : scene_(scene), rg(rg), bounce(bounce), russian_roulette(russian_roulette),
+              nee((scene.lights.empty() && not scene.mapping_containers.background.is_importance_sampled()) ?
+                  nee_mode::Disabled : nee),
               init_refr_index(init_refr_index),
-              bvh(scene.polygons_per_bounding != 0 ? bvh_option::Enabled : bvh_option::Disabled) {}
-
-        rt::color pathtrace(const ray& init_ray) const;
+              bvh(scene.bvh_params.enabled() ? bvh_option::Enabled : bvh_option::Disabled) {}
 
+        /* If first_hit is not null, the values of the first hit of the path are written into it */
+        rt::color pathtrace(const ray& init_ray, aov_sample* first_hit = nullptr) const;
 
+        /* Wavefront version: the paths of the batch of rays init_rays are traced together, one bounce at a time,
+           and their colors are placed in output (of the same size)
+           init_states (of the same size) are the states of the generator after the generation of each ray,
+           from which the random numbers of each path are drawn
+           If first_hits is not empty (of the same size), the values of the first hits are written into it */
+        void pathtrace_wavefront(std::span<const ray> init_rays, std::span<const randomgen::state> init_states,
+            std::span<rt::color> output, std::span<aov_sample> first_hits = {}) const;
 
     private:
         using enum ray_orientation_type;
@@ -84,11 +105,6 @@ class worker {
             const rt::vector& local_normal, const direction::sin_refracted_output& sin_refr,
             real& refr_index, real next_refr_i) const;
 
-        [[nodiscard]] rt::color background_case(const rt::vector& direction, const accumulators& acc) const;
-
-        [[nodiscard]] rt::color full_intensity_case(const accumulators& acc,
-            const hit& h, const material& m) const;
-
         struct bounce_parameters {
             const hit& h;
             const material& m;
@@ -101,7 +117,61 @@ class worker {
             ray r;
             accumulators acc;
             real refr_index;
+            refraction_stack& refr_stack;
+            /* Probability density of the direction of r if it comes from a diffuse bounce
+               where the light sources were sampled, 0 otherwise (used to weight the light reached by r) */
+            real diffuse_pdf = 0.0_r;
         };
 
+        [[nodiscard]] rt::color background_case(const path_parameters& path) const;
+
+        /* Values of the first hit h of the camera ray r, for the auxiliary buffers,
+           maps being the sample of the maps of the material at h (already computed for the bounce) */
+        [[nodiscard]] aov_sample first_hit_values(const ray& r, const hit& h, const map_sample& maps) const;
+
+        /* Same, when the camera ray r hits no object */
+        [[nodiscard]] aov_sample first_hit_values(const ray& r) const;
+
+        [[nodiscard]] rt::color full_intensity_case(const path_parameters& path,
+            const hit& h, const material& m) const;
+
+        /* Next-event estimation: radiance received from a point sampled on a light source,
+           divided by the probability density of the sample and weighted against the diffuse bounce
+           (the color of the surface is applied by the accumulator) */
+        [[nodiscard]] rt::color direct_lighting(const hit& h, const rt::vector& oriented_normal) const;
+
+        /* Same, with a direction sampled on the background texture */
+        [[nodiscard]] rt::color environment_lighting(const hit& h, const rt::vector& oriented_normal) const;
+
         void process_bounce(const bounce_parameters& param, path_parameters& out, bool) const;
+
+        /* Wavefront mode */
+
+        /* Kinds of hits, shaded group by group */
+        enum class wavefront_group : uint8_t {
+            Miss, Emitter, Diffuse, Specular, Refractive
+        };
+        static constexpr std::size_t NUMBER_OF_WAVEFRONT_GROUPS = 5;
+
+        wavefront_group classify(const std::optional<hit>& opt_h) const;
+
+        /* Buffers of the paths of a batch, kept between the batches */
+        struct wavefront_buffers {
+            std::vector<path_parameters> paths;
+            /* States of the generator of the paths, restored before each of their bounces */
+            std::vector<randomgen::state> states;
+            std::vector<std::optional<hit>> hits;
+            std::vector<wavefront_group> groups;
+            /* Indices (in paths) of the active paths, sorted by group, and of the surviving ones */
+            std::vector<uint32_t> active;
+            std::vector<uint32_t> sorted;
+            std::vector<uint32_t> survivors;
+            /* Refraction stacks of the paths (not movable, so allocated once for the largest batch) */
+            std::unique_ptr<refraction_stack[]> stacks;
+            std::size_t capacity = 0;
+
+            void reserve(std::size_t size);
+        };
+
+        mutable wavefront_buffers wavefront;
 };
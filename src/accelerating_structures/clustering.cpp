@@ -343,8 +343,46 @@ const bounding* create_bounding_hierarchy(std::vector<const object*>&& content,
 
 /** Display function **/
 
-/* Displays the depth of the hierarchy, as well as the minimum, maximum and average arity of each depth */
-void display_hierarchy_properties(const bounding* bd0) {
+static real surface_area(const min_max_coord& mmc) {
+    const auto [ min_x, max_x, min_y, max_y, min_z, max_z ] = mmc;
+    const real dx = max_x - min_x;
+    const real dy = max_y - min_y;
+    const real dz = max_z - min_z;
+    if (dx < 0.0_r || dy < 0.0_r || dz < 0.0_r)
+        return 0.0_r;
+    return 2.0_r * (dx * dy + dy * dz + dz * dx);
+}
+
+/* Expected cost of a ray traversal, relative to the cost of one object intersection
+   (each node visited costs one box test, each object one intersection test,
+   and the probability of visiting a node is the ratio of its surface area to the root's) */
+static real compute_sah_cost(const bounding* bd0) {
+
+    const real root_area = surface_area(bd0->get_min_max_coord());
+    if (root_area <= 0.0_r)
+        return 0.0_r;
+
+    real cost = 0.0_r;
+    custom_stack<const bounding*> bds;
+    bds.push(bd0);
+
+    while (not bds.empty()) {
+        const bounding* bd = bds.pop();
+        const real ratio = (bd->b != nullptr) ? surface_area(bd->get_min_max_coord()) / root_area : 1.0_r;
+
+        if (bd->type == bounding::InternalNode) {
+            cost += ratio;
+            bds.push(bd->get_children());
+        }
+        else
+            cost += ratio * (1.0_r + bd->get_content().size());
+    }
+    return cost;
+}
+
+/* Displays the depth of the hierarchy, as well as the minimum, maximum and average arity of each depth,
+   the SAH cost of the hierarchy and its build time */
+void display_hierarchy_properties(const bounding* bd0, const std::optional<uint64_t> build_time) {
 
     printf("\r============================= HIERARCHY STATISTICS =============================\n");
 
@@ -418,5 +456,8 @@ void display_hierarchy_properties(const bounding* bd0) {
         
         level++;
     }
+    printf("|| SAH cost: %lf\n", compute_sah_cost(bd0));
+    if (build_time.has_value())
+        printf("|| Build time: %lums\n", static_cast<unsigned long int>(build_time.value()));
     printf("===============================================================================\n");
 }
\ No newline at end of file
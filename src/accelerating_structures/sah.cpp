@@ -0,0 +1,299 @@
+#include "accelerating_structures/sah.hpp"
+
+#include "parallel/parallel.hpp"
+#include "parallel/thread_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <span>
+
+static constexpr unsigned int SAH_NUMBER_OF_BINS = 16;
+
+/* Relative costs of a box traversal and of an object intersection */
+static constexpr real TRAVERSAL_COST    = 1.0_r;
+static constexpr real INTERSECTION_COST = 1.0_r;
+
+/* Terminal nodes never hold more objects than this, whatever the cost */
+static constexpr unsigned int MAX_LEAF_SIZE = 16;
+
+/* Subtrees are built in parallel once they hold fewer objects than this (or than n / (4 * number of threads)) */
+static constexpr std::size_t MIN_TASK_SIZE = 4096;
+
+
+static inline real coord(const rt::vector& v, const int axis) {
+    return (axis == 0) ? v.x : (axis == 1) ? v.y : v.z;
+}
+
+struct bounds {
+    rt::vector min = min_max_coord::min_empty;
+    rt::vector max = min_max_coord::max_empty;
+
+    inline void extend(const rt::vector& pmin, const rt::vector& pmax) {
+        min = { std::min(min.x, pmin.x), std::min(min.y, pmin.y), std::min(min.z, pmin.z) };
+        max = { std::max(max.x, pmax.x), std::max(max.y, pmax.y), std::max(max.z, pmax.z) };
+    }
+
+    inline void extend(const bounds& b) {
+        extend(b.min, b.max);
+    }
+
+    inline real surface_area() const {
+        const rt::vector d = max - min;
+        if (d.x < 0.0_r || d.y < 0.0_r || d.z < 0.0_r)
+            return 0.0_r;
+        return 2.0_r * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
+
+struct primitive_info {
+    bounds box;
+    rt::vector centroid;
+    const object* obj;
+};
+
+/* Node of the temporary binary tree */
+struct build_node {
+    bounds box;
+    std::unique_ptr<build_node> left  = nullptr;
+    std::unique_ptr<build_node> right = nullptr;
+    std::vector<const object*> content;
+
+    inline bool is_terminal() const {
+        return left == nullptr;
+    }
+};
+
+struct split {
+    int axis;
+    unsigned int bin;
+    real cost;
+};
+
+static inline unsigned int bin_of(const primitive_info& p, const bounds& centroid_box, const int axis) {
+    const real min    = coord(centroid_box.min, axis);
+    const real extent = coord(centroid_box.max, axis) - min;
+    const unsigned int b = static_cast<unsigned int>(SAH_NUMBER_OF_BINS * (coord(p.centroid, axis) - min) / extent);
+    return std::min(b, SAH_NUMBER_OF_BINS - 1);
+}
+
+/* Returns the split plane of minimum cost, among the bin boundaries of the three axes */
+static std::optional<split> find_best_split(const std::span<const primitive_info> prims,
+    const bounds& box, const bounds& centroid_box) {
+
+    const real parent_area = box.surface_area();
+    if (parent_area <= 0.0_r)
+        return std::nullopt;
+
+    std::optional<split> best = std::nullopt;
+
+    for (int axis = 0; axis < 3; axis++) {
+
+        if (coord(centroid_box.max, axis) - coord(centroid_box.min, axis) <= 0.0_r)
+            continue;
+
+        std::array<bounds, SAH_NUMBER_OF_BINS> bin_boxes;
+        std::array<unsigned int, SAH_NUMBER_OF_BINS> bin_counts {};
+
+        for (const primitive_info& p : prims) {
+            const unsigned int b = bin_of(p, centroid_box, axis);
+            bin_boxes[b].extend(p.box);
+            bin_counts[b]++;
+        }
+
+        /* Sweep from the right, then from the left */
+        std::array<real, SAH_NUMBER_OF_BINS> right_costs {};
+        bounds right_box;
+        unsigned int right_count = 0;
+        for (unsigned int b = SAH_NUMBER_OF_BINS - 1; b > 0; b--) {
+            right_box.extend(bin_boxes[b]);
+            right_count += bin_counts[b];
+            right_costs[b] = right_box.surface_area() * right_count;
+        }
+
+        bounds left_box;
+        unsigned int left_count = 0;
+        for (unsigned int b = 1; b < SAH_NUMBER_OF_BINS; b++) {
+            left_box.extend(bin_boxes[b - 1]);
+            left_count += bin_counts[b - 1];
+
+            if (left_count == 0 || left_count == prims.size())
+                continue;
+
+            const real cost = TRAVERSAL_COST
+                + INTERSECTION_COST * (left_box.surface_area() * left_count + right_costs[b]) / parent_area;
+
+            if (not best.has_value() || cost < best->cost)
+                best = split { .axis = axis, .bin = b, .cost = cost };
+        }
+    }
+
+    return best;
+}
+
+static bounds compute_bounds(const std::span<const primitive_info> prims, bounds& centroid_box) {
+    bounds box;
+    centroid_box = bounds();
+    for (const primitive_info& p : prims) {
+        box.extend(p.box);
+        centroid_box.extend(p.centroid, p.centroid);
+    }
+    return box;
+}
+
+/* Splits prims in two non-empty halves and returns the size of the first one,
+   or returns nothing if a terminal node is cheaper */
+static std::optional<std::size_t> partition(const std::span<primitive_info> prims, const bounds& box) {
+
+    const std::size_t n = prims.size();
+    if (n <= 1)
+        return std::nullopt;
+
+    bounds centroid_box;
+    compute_bounds(prims, centroid_box);
+
+    const std::optional<split> best = find_best_split(prims, box, centroid_box);
+    const real leaf_cost = INTERSECTION_COST * n;
+
+    if (n <= MAX_LEAF_SIZE && ((not best.has_value()) || leaf_cost <= best->cost))
+        return std::nullopt;
+
+    if (best.has_value()) {
+        const auto middle = std::partition(prims.begin(), prims.end(),
+            [&] (const primitive_info& p) { return bin_of(p, centroid_box, best->axis) < best->bin; });
+        return middle - prims.begin();
+    }
+
+    /* All the centroids are at the same place (or the box is flat): median split */
+    const std::size_t half = n / 2;
+    std::nth_element(prims.begin(), prims.begin() + half, prims.end(),
+        [] (const primitive_info& p, const primitive_info& q) { return p.obj < q.obj; });
+    return half;
+}
+
+static std::unique_ptr<build_node> make_terminal_node(const std::span<const primitive_info> prims, const bounds& box) {
+    std::unique_ptr<build_node> node = std::make_unique<build_node>();
+    node->box = box;
+    node->content.reserve(prims.size());
+    for (const primitive_info& p : prims)
+        node->content.push_back(p.obj);
+    return node;
+}
+
+/* Sequential build of a subtree */
+static std::unique_ptr<build_node> build_subtree(const std::span<primitive_info> prims) {
+
+    bounds centroid_box;
+    const bounds box = compute_bounds(prims, centroid_box);
+
+    const std::optional<std::size_t> middle = partition(prims, box);
+    if (not middle.has_value())
+        return make_terminal_node(prims, box);
+
+    std::unique_ptr<build_node> node = std::make_unique<build_node>();
+    node->box   = box;
+    node->left  = build_subtree(prims.first(middle.value()));
+    node->right = build_subtree(prims.subspan(middle.value()));
+    return node;
+}
+
+struct build_task {
+    std::span<primitive_info> prims;
+    std::unique_ptr<build_node>* slot;
+};
+
+/* Builds the top levels of the tree, and leaves the subtrees smaller than task_size to the tasks */
+static void build_top_levels(const std::span<primitive_info> prims, std::unique_ptr<build_node>& slot,
+    const std::size_t task_size, std::vector<build_task>& tasks) {
+
+    if (prims.size() <= task_size) {
+        tasks.push_back({ prims, &slot });
+        return;
+    }
+
+    bounds centroid_box;
+    const bounds box = compute_bounds(prims, centroid_box);
+
+    const std::optional<std::size_t> middle = partition(prims, box);
+    if (not middle.has_value()) {
+        slot = make_terminal_node(prims, box);
+        return;
+    }
+
+    slot = std::make_unique<build_node>();
+    slot->box = box;
+    build_top_levels(prims.first(middle.value()), slot->left,  task_size, tasks);
+    build_top_levels(prims.subspan(middle.value()), slot->right, task_size, tasks);
+}
+
+static std::unique_ptr<bounding::box_type> make_box(const bounds& b) {
+    return std::make_unique<bounding::box_type>(build_min_max_coord(b.min, b.max));
+}
+
+/* Converts the binary tree into boundings, pulling up grandchildren until the nodes have arity children */
+static const bounding* convert(build_node& node, const unsigned int arity) {
+
+    if (node.is_terminal())
+        return new bounding(std::move(node.content), make_box(node.box));
+
+    std::vector<build_node*> kids = { node.left.get(), node.right.get() };
+
+    while (kids.size() < arity) {
+        // The internal child of largest surface is replaced with its two children
+        auto largest = kids.end();
+        real largest_area = -1.0_r;
+        for (auto it = kids.begin(); it != kids.end(); it++) {
+            if (not (*it)->is_terminal() && (*it)->box.surface_area() > largest_area) {
+                largest = it;
+                largest_area = (*it)->box.surface_area();
+            }
+        }
+        if (largest == kids.end())
+            break;
+
+        build_node* const expanded = *largest;
+        *largest = expanded->left.get();
+        kids.push_back(expanded->right.get());
+    }
+
+    std::vector<const bounding*> children;
+    children.reserve(kids.size());
+    for (build_node* const kid : kids)
+        children.push_back(convert(*kid, arity));
+
+    return new bounding(std::move(children), make_box(node.box));
+}
+
+const bounding* create_sah_hierarchy(std::vector<const object*>&& content, const unsigned int arity) {
+
+    if (content.empty())
+        return new bounding(std::move(content));
+
+    printf("\rOptimizing the data structure (SAH)...");
+    fflush(stdout);
+
+    std::vector<primitive_info> prims(content.size());
+    parallel_for(content.size(), [&] (int i) {
+        const object* const obj = content[i];
+        const auto [ min_x, max_x, min_y, max_y, min_z, max_z ] = obj->get_min_max_coord();
+        const rt::vector min(min_x, min_y, min_z);
+        const rt::vector max(max_x, max_y, max_z);
+        prims[i] = {
+            .box      = { .min = min, .max = max },
+            .centroid = (min + max) * 0.5_r,
+            .obj      = obj
+        };
+    });
+
+    /* Top levels first, then one task per subtree */
+    const std::size_t task_size = std::max(MIN_TASK_SIZE, prims.size() / (4 * thread_pool::global().size()));
+    std::unique_ptr<build_node> root;
+    std::vector<build_task> tasks;
+    build_top_levels(prims, root, task_size, tasks);
+
+    parallel_for(tasks.size(), [&] (int i) {
+        *tasks[i].slot = build_subtree(tasks[i].prims);
+    });
+
+    return convert(*root, std::max(arity, 2u));
+}
@@ -0,0 +1,108 @@
+#include "file_readers/image_files/raw_data.hpp"
+#include "file_readers/image_files/bmp_reader.hpp"
+#include "image/denoiser.hpp"
+
+#include <filesystem>
+#include <optional>
+
+using namespace std::filesystem;
+
+/* Reads the raw data file of an auxiliary buffer exported with the image (image_<layer>.rtdata),
+   if it exists next to it */
+static std::optional<image> read_layer(const path& source, const std::string& layer_name) {
+
+    const path layer_path = path(source).replace_filename(source.stem().generic_string() + "_" + layer_name + ".rtdata");
+    if (not (exists(layer_path) && is_regular_file(layer_path)))
+        return std::nullopt;
+
+    std::expected<image, file_reader::error> layer = raw_data::read_file(layer_path.generic_string());
+    if (not layer.has_value()) {
+        printf("Error: could not read file %s, ignored\n", layer_path.generic_string().c_str());
+        return std::nullopt;
+    }
+    printf("Guide: %s\n", layer_path.filename().generic_string().c_str());
+    return std::move(layer.value());
+}
+
+/* Colors averaged over the samples */
+static matrix average(const image& img) {
+
+    const real invN = 1.0_r / std::max(1, img.number_of_samples);
+    matrix m(img.width(), img.height());
+    for (std::size_t k = 0; k < m.data.size(); k++)
+        m.data[k] = img.data.data[k] * invN;
+    return m;
+}
+
+/* Program that denoises a raw data file, guided by the auxiliary buffers exported with it (option -aov of main) */
+/* Arguments syntax:
+   ./denoise source.rtdata [-iterations n] [-gamma g]
+   The output files are source_denoised.bmp and source_denoised.rtdata */
+int main(int argc, char* argv[]) {
+
+    const std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.empty() || not args[0].ends_with(".rtdata")) {
+        printf("Error: no source file provided\n");
+        return EXIT_FAILURE;
+    }
+
+    const path source(args[0]);
+    denoiser_parameters param;
+    std::optional<real> gamma_opt;
+
+    try {
+        for (std::size_t i = 1; i < args.size(); i++) {
+            const std::string& arg = args[i];
+            if (arg == "-iterations" && i + 1 < args.size())
+                param.iterations = std::stoi(args[++i]);
+            else if (arg == "-gamma" && i + 1 < args.size())
+                gamma_opt = 1.0_r / std::stof(args[++i]);
+            else
+                throw std::runtime_error("Unexpected argument " + arg);
+        }
+    }
+    catch (const std::exception& e) {
+        printf("%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    std::expected<image, file_reader::error> source_image = raw_data::read_file(source.generic_string());
+    if (not source_image.has_value()) {
+        printf("Error: could not read file %s\n", source.generic_string().c_str());
+        return EXIT_FAILURE;
+    }
+    const image& img = source_image.value();
+    const matrix color = average(img);
+
+    const std::optional<image> albedo = read_layer(source, aov_buffers::layer_name(aov_buffers::layer::Albedo));
+    const std::optional<image> normal = read_layer(source, aov_buffers::layer_name(aov_buffers::layer::Normal));
+    const std::optional<image> depth  = read_layer(source, aov_buffers::layer_name(aov_buffers::layer::Depth));
+
+    const auto guide = [&] (const std::optional<image>& layer) -> const matrix* {
+        if (not layer.has_value())
+            return nullptr;
+        if (layer->width() != img.width() || layer->height() != img.height()) {
+            printf("Error: incorrect width or height of a guide, ignored\n");
+            return nullptr;
+        }
+        return &layer->data;
+    };
+
+    const image denoised(
+        denoise({ .color = color, .albedo = guide(albedo), .normal = guide(normal), .depth = guide(depth) }, param),
+        gamma_opt.has_value() ? gamma_opt : img.gamma
+    );
+
+    const path dest = path(source).replace_filename(source.stem().generic_string() + "_denoised");
+    const std::string dest_bmp = dest.generic_string() + ".bmp";
+    const std::string dest_raw = dest.generic_string() + ".rtdata";
+
+    const exit_status status = bmp::export_data(dest_bmp, denoised) && raw_data::export_data(dest_raw, denoised);
+    if (status == exit_status::Failure) {
+        printf("Error: denoiser failed\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("Files %s and %s created\n", dest_bmp.c_str(), dest_raw.c_str());
+    return EXIT_SUCCESS;
+}
@@ -11,8 +11,8 @@ static constexpr int DEFAULT_BYTES_PER_COLOR = 3;
 
 using enum file_reader::error;
 
-/* Extracts the data from the given .bmp file into the matrix data, which must have the right size */
-std::expected<matrix, file_reader::error> bmp::read_file(const std::string& file_name) {
+/* Extracts the pixels of the given .bmp file, without converting them to colors */
+std::expected<bmp::pixels, file_reader::error> bmp::read_pixels(const std::string& file_name) {
 
     try {
         
@@ -64,22 +64,23 @@ std::expected<matrix, file_reader::error> bmp::read_file(const std::string& file
         throw_if_failure(status, ReadingErrorData);
         f.close();
 
-        matrix matrix(width, height);
+        pixels out = { .width = width, .height = height, .data = std::vector<uint8_t>(3 * width * height) };
 
+        /* The rows are stored from the bottom one to the top one, and the components in BGR order */
         parallel_for(height, [&] (int j) {
 
-            const matrix::row row = matrix[height - 1 - j];
+            uint8_t* pixel = out.data.data() + 3 * width * (height - 1 - j);
             unsigned int index = pitch * j;
-            for (rt::color& color : row) {
-                const real b = buffer[index];
-                const real g = buffer[index + 1];
-                const real r = buffer[index + 2];
-                color = rt::color(r, g, b);
+            for (unsigned int i = 0; i < width; i++) {
+                pixel[0] = buffer[index + 2];
+                pixel[1] = buffer[index + 1];
+                pixel[2] = buffer[index];
+                pixel += 3;
                 index += bytes_per_pixels;
             }
         });
 
-        return matrix;
+        return out;
     }
     catch (file::error) {
         return std::unexpected(FileError);
@@ -93,6 +94,29 @@ std::expected<matrix, file_reader::error> bmp::read_file(const std::string& file
     }
 }
 
+/* Extracts the data from the given .bmp file into the matrix data, which must have the right size */
+std::expected<matrix, file_reader::error> bmp::read_file(const std::string& file_name) {
+
+    const std::expected<pixels, file_reader::error> pixels_opt = read_pixels(file_name);
+    if (not pixels_opt.has_value())
+        return std::unexpected(pixels_opt.error());
+
+    const auto& [ width, height, data ] = pixels_opt.value();
+    matrix matrix(width, height);
+
+    parallel_for(height, [&] (int j) {
+
+        const matrix::row row = matrix[j];
+        const uint8_t* pixel = data.data() + 3 * width * j;
+        for (rt::color& color : row) {
+            color = rt::color(pixel[0], pixel[1], pixel[2]);
+            pixel += 3;
+        }
+    });
+
+    return matrix;
+}
+
 /* Prints the info contained in the header of the given .bmp file */
 exit_status bmp::print_info(const std::string& file_name) {
 
@@ -126,22 +150,22 @@ struct byte_representation {
         b3((n >> 24) & 0xFF) {}
 };
 
-/* Writes the data into a .bmp file with the given name
-   The value (double) of each component of each color of data is divided by number_of_rays before being written in the file */
-exit_status bmp::export_data(const std::string& file_name, const image& image) {
-
-    const auto [ width, height ] = image.data.get_dimensions();
-
+unsigned int bmp::row_size(const unsigned int width) {
     const unsigned int row_length_bytes = DEFAULT_BYTES_PER_COLOR * width;
     const unsigned int padding_bytes = (4 - (row_length_bytes % 4)) % 4;
+    return row_length_bytes + padding_bytes;
+}
+
+std::array<uint8_t, bmp::HEADER_SIZE> bmp::make_header(const unsigned int width, const unsigned int height) {
 
     /* All sizes are stored in little-endian */
 
     constexpr unsigned int BMP_HEADER_SIZE  = 14;
     constexpr unsigned int INFO_HEADER_SIZE = 40;
+    static_assert(BMP_HEADER_SIZE + INFO_HEADER_SIZE == HEADER_SIZE);
 
-    const unsigned int data_size = (row_length_bytes + padding_bytes) * height;
-    const unsigned int file_size = BMP_HEADER_SIZE + INFO_HEADER_SIZE + data_size;
+    const unsigned int data_size = row_size(width) * height;
+    const unsigned int file_size = HEADER_SIZE + data_size;
 
     /** Header **/
 
@@ -150,7 +174,7 @@ exit_status bmp::export_data(const std::string& file_name, const image& image) {
     const auto [ h0, h1, h2, h3 ] = byte_representation(height);
     const auto [ d0, d1, d2, d3 ] = byte_representation(data_size);
 
-    uint8_t header[] = {
+    return {
 
         /* 2 bytes: BM */
         'B', 'M',
@@ -199,30 +223,31 @@ exit_status bmp::export_data(const std::string& file_name, const image& image) {
         0, 0, 0, 0,
         0, 0, 0, 0
     };
+}
+
+/* Writes the data into a .bmp file with the given name
+   The value (double) of each component of each color of data is divided by the number of samples of the pixel
+   before being written in the file */
+exit_status bmp::export_data(const std::string& file_name, const image& image) {
+
+    const auto [ width, height ] = image.data.get_dimensions();
+
+    const std::array<uint8_t, HEADER_SIZE> header = make_header(width, height);
 
     /** Color data **/
 
-    std::vector<uint8_t> buffer(data_size, 0);
+    const unsigned int row_size = bmp::row_size(width);
+    std::vector<uint8_t> buffer(row_size * height, 0);
 
     /* Each pixel is represented as 3 bytes BGR, each line (sequence of 3*width bytes) is followed by p bytes '0' of padding */
-    const bool gamma_enabled = image.gamma.has_value();
     const real invN = 1.0_r / image.number_of_samples;
-    const unsigned int row_size = DEFAULT_BYTES_PER_COLOR * width + padding_bytes;
 
     for (int j = height - 1; const matrix::const_row row : image.data) {
 
-        for (unsigned int index = j * row_size; const rt::color& c : row) {
+        const int image_row = static_cast<int>(height) - 1 - j;
+        for (unsigned int index = j * row_size, i = 0; const rt::color& c : row) {
             
-            rt::color col = c * invN;
-            col.cap();
-
-            if (gamma_enabled)
-                col.apply_gamma(image.gamma.value());
-
-            const auto [ b, g, r ] = col.to_uint8_bgr();
-            buffer[index]     = b;
-            buffer[index + 1] = g;
-            buffer[index + 2] = r;
+            encode_pixel(c * image.average_factor(image_row, i++, invN), image.gamma, buffer.data() + index);
             if constexpr (DEFAULT_BYTES_PER_COLOR == 4) {
                 buffer[index + 3] = 255;
             }
@@ -237,7 +262,7 @@ exit_status bmp::export_data(const std::string& file_name, const image& image) {
         file f(file_name, "wb");
 
         using enum file_reader::error;
-        throw_if_failure(f.write<uint8_t>(header), WritingErrorHeader);
+        throw_if_failure(f.write(std::span<const uint8_t>(header)), WritingErrorHeader);
         throw_if_failure(f.write(buffer),          WritingErrorData);
         
         return exit_status::Success;
@@ -0,0 +1,289 @@
+#include "file_readers/image_files/compact_data.hpp"
+
+#include "file_readers/error.hpp"
+#include "parallel/parallel.hpp"
+#include "auxiliary/half.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+using enum file_reader::error;
+using precision = compact_parameters::precision;
+
+/* Largest absolute value of the averages encoded: the larger ones are clamped to it (with their sign),
+   so that the exponents of the tiles, and the values decoded, stay far from the largest double */
+constexpr double MAX_ENCODED_VALUE = 0x1p1000;
+
+/* Exponent e such that the largest absolute value of values is in [0.5, 1) * 2^e (0 if they are all zero) */
+static int16_t tile_exponent(const std::span<const double> values) {
+    double max = 0.0;
+    for (const double v : values)
+        max = std::max(max, std::abs(v));
+
+    if (not (max > 0.0))
+        return 0;
+    int exponent;
+    std::frexp(max, &exponent);
+    return static_cast<int16_t>(exponent);
+}
+
+/* Run-length encoding (PackBits) of in, appended to out */
+static void rle_encode(const std::span<const std::byte> in, std::vector<std::byte>& out) {
+
+    constexpr std::size_t MAX_LENGTH = 128;
+    const std::size_t n = in.size();
+    std::size_t i = 0;
+
+    while (i < n) {
+        std::size_t run = 1;
+        while (i + run < n && run < MAX_LENGTH && in[i + run] == in[i])
+            run++;
+
+        if (run >= 3) {
+            out.push_back(static_cast<std::byte>(257 - run));
+            out.push_back(in[i]);
+            i += run;
+            continue;
+        }
+
+        // Literal bytes, up to the next run of 3 equal bytes
+        const std::size_t start = i;
+        while (i < n && i - start < MAX_LENGTH
+            && not (i + 2 < n && in[i] == in[i + 1] && in[i] == in[i + 2]))
+            i++;
+
+        out.push_back(static_cast<std::byte>(i - start - 1));
+        out.insert(out.end(), in.begin() + start, in.begin() + i);
+    }
+}
+
+/* Decodes in (run-length encoded) into out, which must be filled exactly */
+static void rle_decode(const std::span<const std::byte> in, const std::span<std::byte> out) {
+
+    std::size_t i = 0, o = 0;
+    while (i < in.size()) {
+        const unsigned int control = std::to_integer<unsigned int>(in[i++]);
+
+        if (control < 128) {
+            const std::size_t length = control + 1;
+            if (i + length > in.size() || o + length > out.size())
+                throw DataError;
+            std::memcpy(out.data() + o, in.data() + i, length);
+            i += length;
+            o += length;
+        }
+        else if (control > 128) {
+            const std::size_t length = 257 - control;
+            if (i >= in.size() || o + length > out.size())
+                throw DataError;
+            std::fill_n(out.begin() + o, length, in[i++]);
+            o += length;
+        }
+        else
+            throw DataError;
+    }
+
+    if (o != out.size())
+        throw DataError;
+}
+
+/* Rectangle of the tile (tx, ty) of an image of the given size */
+static compact_data::decoder::rectangle tile_rectangle(const unsigned int tx, const unsigned int ty,
+    const unsigned int width, const unsigned int height, const unsigned int tile_size) {
+    return {
+        .x = tx * tile_size,
+        .y = ty * tile_size,
+        .width  = std::min(tile_size, width  - tx * tile_size),
+        .height = std::min(tile_size, height - ty * tile_size)
+    };
+}
+
+/* Encodes the tile of rectangle r: the averages are gathered by plane, scaled by the exponent of the tile
+   and converted to words of bytes_per_value bytes, which are then compressed */
+static std::vector<std::byte> encode_tile(const std::span<const rt::color> sums, const double invN,
+    const unsigned int width, const compact_data::decoder::rectangle& r, const compact_parameters& parameters) {
+
+    const std::size_t n = static_cast<std::size_t>(r.width) * r.height;
+    constexpr std::size_t nb_planes = 3;
+    const std::size_t bytes_per_value = static_cast<unsigned int>(parameters.bits) / 8;
+
+    thread_local std::vector<double> values;
+    values.resize(nb_planes * n);
+    for (unsigned int j = 0; j < r.height; j++) {
+        for (unsigned int i = 0; i < r.width; i++) {
+            const std::size_t pixel = static_cast<std::size_t>(r.y + j) * width + r.x + i;
+            const std::size_t k = static_cast<std::size_t>(j) * r.width + i;
+            const rt::color& c = sums[pixel];
+            values[k]         = std::clamp(c.red   * invN, -MAX_ENCODED_VALUE, MAX_ENCODED_VALUE);
+            values[n + k]     = std::clamp(c.green * invN, -MAX_ENCODED_VALUE, MAX_ENCODED_VALUE);
+            values[2 * n + k] = std::clamp(c.blue  * invN, -MAX_ENCODED_VALUE, MAX_ENCODED_VALUE);
+        }
+    }
+
+    const int16_t exponent = tile_exponent(values);
+
+    /* Words of the values, stored with their bytes grouped by significance if compressed */
+    thread_local std::vector<std::byte> words;
+    words.resize(nb_planes * n * bytes_per_value);
+    for (std::size_t plane = 0; plane < nb_planes; plane++) {
+
+        std::byte* const plane_words = words.data() + plane * n * bytes_per_value;
+        uint32_t previous = 0;
+
+        for (std::size_t k = 0; k < n; k++) {
+            const float v = static_cast<float>(std::ldexp(values[plane * n + k], -exponent));
+            const uint32_t word = (parameters.bits == precision::Half) ? float_to_half(v) : std::bit_cast<uint32_t>(v);
+
+            if (not parameters.compression) {
+                if (bytes_per_value == 2) {
+                    const uint16_t half = static_cast<uint16_t>(word);
+                    std::memcpy(plane_words + 2 * k, &half, sizeof(uint16_t));
+                }
+                else
+                    std::memcpy(plane_words + 4 * k, &word, sizeof(uint32_t));
+                continue;
+            }
+
+            const uint32_t delta = word - previous;
+            previous = word;
+            for (std::size_t b = 0; b < bytes_per_value; b++)
+                plane_words[b * n + k] = static_cast<std::byte>((delta >> (8 * b)) & 0xFF);
+        }
+    }
+
+    std::vector<std::byte> tile(sizeof(int16_t));
+    std::memcpy(tile.data(), &exponent, sizeof(int16_t));
+
+    if (parameters.compression)
+        rle_encode(words, tile);
+    else
+        tile.insert(tile.end(), words.begin(), words.end());
+    return tile;
+}
+
+std::vector<std::byte> compact_data::encode(const std::span<const rt::color> sums, const unsigned int number_of_samples,
+    const unsigned int width, const unsigned int height,
+    const compact_parameters& parameters, const execution execution) {
+
+    const unsigned int tile_size = parameters.tile_size;
+    const unsigned int tiles_x = (width  + tile_size - 1) / tile_size;
+    const unsigned int tiles_y = (height + tile_size - 1) / tile_size;
+    const std::size_t nb_tiles = static_cast<std::size_t>(tiles_x) * tiles_y;
+    const double invN = (number_of_samples == 0) ? 0.0 : 1.0 / number_of_samples;
+
+    std::vector<std::vector<std::byte>> tiles(nb_tiles);
+    const auto encode_tile_at = [&] (const int t) {
+        const decoder::rectangle r = tile_rectangle(t % tiles_x, t / tiles_x, width, height, tile_size);
+        tiles[t] = encode_tile(sums, invN, width, r, parameters);
+    };
+
+    if (execution == execution::Parallel)
+        parallel_for(static_cast<int>(nb_tiles), encode_tile_at);
+    else {
+        for (int t = 0; t < static_cast<int>(nb_tiles); t++)
+            encode_tile_at(t);
+    }
+
+    std::vector<uint64_t> offsets(nb_tiles + 1, 0);
+    for (std::size_t t = 0; t < nb_tiles; t++)
+        offsets[t + 1] = offsets[t] + tiles[t].size();
+
+    std::vector<std::byte> data(offsets.size() * sizeof(uint64_t) + offsets.back());
+    std::memcpy(data.data(), offsets.data(), offsets.size() * sizeof(uint64_t));
+    std::byte* position = data.data() + offsets.size() * sizeof(uint64_t);
+    for (const std::vector<std::byte>& tile : tiles) {
+        std::memcpy(position, tile.data(), tile.size());
+        position += tile.size();
+    }
+    return data;
+}
+
+compact_data::decoder::decoder(const std::span<const std::byte> data, const unsigned int width, const unsigned int height,
+    const compact_parameters& parameters)
+    : width(width), height(height), parameters(parameters),
+      tiles_x((width  + parameters.tile_size - 1) / parameters.tile_size),
+      tiles_y((height + parameters.tile_size - 1) / parameters.tile_size),
+      offsets(data.first(std::min(data.size(), (static_cast<std::size_t>(tiles_x) * tiles_y + 1) * sizeof(uint64_t)))),
+      tiles(data.subspan(offsets.size())) {
+
+    const std::size_t nb_tiles = static_cast<std::size_t>(tiles_x) * tiles_y;
+    if (offsets.size() != (nb_tiles + 1) * sizeof(uint64_t) || offset(0) != 0 || offset(nb_tiles) > tiles.size())
+        throw DataError;
+    for (std::size_t t = 0; t < nb_tiles; t++) {
+        if (offset(t + 1) < offset(t))
+            throw DataError;
+    }
+}
+
+uint64_t compact_data::decoder::offset(const std::size_t index) const {
+    uint64_t value;
+    std::memcpy(&value, offsets.data() + index * sizeof(uint64_t), sizeof(uint64_t));
+    return value;
+}
+
+compact_data::decoder::rectangle compact_data::decoder::tile_rectangle(const unsigned int tx, const unsigned int ty) const {
+    return ::tile_rectangle(tx, ty, width, height, parameters.tile_size);
+}
+
+void compact_data::decoder::decode_tile(const unsigned int tx, const unsigned int ty,
+    color_real* const colors, const std::size_t stride) const {
+
+    const std::size_t index = static_cast<std::size_t>(ty) * tiles_x + tx;
+    const std::span<const std::byte> tile = tiles.subspan(offset(index), offset(index + 1) - offset(index));
+
+    const rectangle r = tile_rectangle(tx, ty);
+    const std::size_t n = static_cast<std::size_t>(r.width) * r.height;
+    const std::size_t bytes_per_value = static_cast<unsigned int>(parameters.bits) / 8;
+    const std::size_t words_size = 3 * n * bytes_per_value;
+
+    if (tile.size() < sizeof(int16_t))
+        throw DataError;
+    int16_t exponent;
+    std::memcpy(&exponent, tile.data(), sizeof(int16_t));
+    const std::span<const std::byte> payload = tile.subspan(sizeof(int16_t));
+
+    thread_local std::vector<std::byte> words;
+    if (parameters.compression) {
+        words.resize(words_size);
+        rle_decode(payload, words);
+    }
+    else if (payload.size() < words_size)
+        throw DataError;
+    const std::byte* const source = parameters.compression ? words.data() : payload.data();
+
+    for (std::size_t plane = 0; plane < 3; plane++) {
+
+        const std::byte* const plane_words = source + plane * n * bytes_per_value;
+        uint32_t previous = 0;
+
+        for (std::size_t k = 0; k < n; k++) {
+            uint32_t word = 0;
+            if (parameters.compression) {
+                for (std::size_t b = 0; b < bytes_per_value; b++)
+                    word |= std::to_integer<uint32_t>(plane_words[b * n + k]) << (8 * b);
+                word = (word + previous) & ((bytes_per_value == 2) ? 0xFFFF : 0xFFFFFFFF);
+                previous = word;
+            }
+            else if (bytes_per_value == 2) {
+                uint16_t half;
+                std::memcpy(&half, plane_words + 2 * k, sizeof(uint16_t));
+                word = half;
+            }
+            else
+                std::memcpy(&word, plane_words + 4 * k, sizeof(uint32_t));
+
+            const float v = (parameters.bits == precision::Half) ? half_to_float(static_cast<uint16_t>(word)) : std::bit_cast<float>(word);
+            const std::size_t i = k % r.width;
+            const std::size_t j = k / r.width;
+            colors[3 * (j * stride + i) + plane] = static_cast<color_real>(std::ldexp(static_cast<double>(v), exponent));
+        }
+    }
+}
+
+std::pair<std::size_t, std::size_t> compact_data::decoder::tile_rows_range(const unsigned int first_row, const unsigned int end_row) const {
+    const uint64_t begin = offset(static_cast<std::size_t>(first_row) * tiles_x);
+    const uint64_t end   = offset(static_cast<std::size_t>(end_row)   * tiles_x);
+    return { offsets.size() + begin, end - begin };
+}
@@ -8,7 +8,8 @@
 
 using enum file_reader::error;
 
-std::expected<matrix, file_reader::error> hdr::read_file(const std::string& file_name) {
+/* Extracts the pixels of the given .hdr file, without converting them to colors */
+std::expected<hdr::pixels, file_reader::error> hdr::read_pixels(const std::string& file_name) {
 
     try {
 
@@ -94,31 +95,20 @@ std::expected<matrix, file_reader::error> hdr::read_file(const std::string& file
             }
         }
 
-        matrix data(width, height);
+        /* Interleaving of the components */
+        pixels out = { .width = width, .height = height, .data = std::vector<uint8_t>(4 * width * height) };
 
         parallel_for(height, [&] (int j) {
 
-            int index = j * width;
-            const matrix::row row = data[j];
-
-            for (rt::color& color : row) {
-
-                const rt::color col(
-                    data_buffer[0][index],
-                    data_buffer[1][index],
-                    data_buffer[2][index]
-                );
-
-                const int e = data_buffer[3][index];
-                const real radiance_val = std::exp2(static_cast<real>(e - 128));
-
-                color = col * radiance_val;
-
-                index++;
+            uint8_t* pixel = out.data.data() + 4 * width * j;
+            for (unsigned int index = j * width; index < (j + 1) * width; index++) {
+                for (int component = 0; component < 4; component++)
+                    pixel[component] = data_buffer[component][index];
+                pixel += 4;
             }
         });
 
-        return data;
+        return out;
     }
     catch (file::error) {
         return std::unexpected(file_reader::error::FileError);
@@ -130,4 +120,34 @@ std::expected<matrix, file_reader::error> hdr::read_file(const std::string& file
         printf("%s\n", e.what());
         return std::unexpected(file_reader::error::Other);
     }
-}
\ No newline at end of file
+}
+
+std::expected<matrix, file_reader::error> hdr::read_file(const std::string& file_name) {
+
+    const std::expected<pixels, file_reader::error> pixels_opt = read_pixels(file_name);
+    if (not pixels_opt.has_value())
+        return std::unexpected(pixels_opt.error());
+
+    const auto& [ width, height, rgbe ] = pixels_opt.value();
+    matrix data(width, height);
+
+    parallel_for(height, [&] (int j) {
+
+        const uint8_t* pixel = rgbe.data() + 4 * width * j;
+        const matrix::row row = data[j];
+
+        for (rt::color& color : row) {
+
+            const rt::color col(pixel[0], pixel[1], pixel[2]);
+
+            const int e = pixel[3];
+            const real radiance_val = std::exp2(static_cast<real>(e - 128));
+
+            color = col * radiance_val;
+
+            pixel += 4;
+        }
+    });
+
+    return data;
+}
@@ -1,37 +1,35 @@
 #include "file_readers/image_files/normal_map_reader.hpp"
 
 #include "file_readers/image_files/bmp_reader.hpp"
+#include "parallel/parallel.hpp"
 
-static normal_map::vector_matrix convert_bmp_to_normal_field(const matrix& col_data) {
+/* The pixels are read directly in the buffer of encoded normals, without an intermediate matrix of colors */
+std::optional<normal_map::normals> read_normal_map(const std::string& file_name) {
 
-    constexpr real s = 2.0_r / 255.0_r;
-    normal_map::vector_matrix norm_data(col_data.height, std::vector<rt::vector>(col_data.width));
+    const std::expected<bmp::pixels, file_reader::error> pixels_opt = bmp::read_pixels(file_name);
+    if (not pixels_opt.has_value())
+        return std::nullopt;
 
-    for (int j = 0; const matrix::const_row row : col_data) {
-        std::vector<rt::vector>& norm_data_line = norm_data[j];
+    const bmp::pixels& pixels = pixels_opt.value();
+    normal_map::normals normals = {
+        .width  = static_cast<unsigned int>(pixels.width),
+        .height = static_cast<unsigned int>(pixels.height),
+        .data   = std::vector<normal_map::encoded_normal>(pixels.width * pixels.height)
+    };
 
-        for (int i = 0; const rt::color& color : row) {
+    constexpr real s = 2.0_r / 255.0_r;
+    parallel_for(pixels.height, [&] (int j) {
+        const std::size_t row = pixels.width * j;
+        for (std::size_t i = row; i < row + pixels.width; i++) {
+            const uint8_t* const rgb = pixels.data.data() + 3 * i;
             // Conversion from [0..255] to [-1;1]
-            norm_data_line[i] = rt::vector (
-                color.red   * s - 1.0_r,
-                color.green * s - 1.0_r,
-                color.blue  * s - 1.0_r
-            ).unit();
-            i++;
+            normals.data[i] = normal_map::encode(rt::vector(
+                rgb[0] * s - 1.0_r,
+                rgb[1] * s - 1.0_r,
+                rgb[2] * s - 1.0_r
+            ).unit());
         }
-        j++;
-    }
+    });
     
-    return norm_data;
+    return normals;
 }
-
-std::optional<normal_map::vector_matrix> read_normal_map(const std::string& file_name) {
-
-    const std::expected<matrix, file_reader::error> mat_opt = bmp::read_file(file_name);
-    if (not mat_opt.has_value())
-        return std::nullopt;
-
-    const matrix& col_data = mat_opt.value();
-    return convert_bmp_to_normal_field(col_data);
-}
-
@@ -1,19 +1,154 @@
 #include "file_readers/image_files/raw_data.hpp"
 #include "file_readers/image_files/bmp_reader.hpp"
 #include "file_readers/file.hpp"
+#include "file_readers/mapped_file.hpp"
+#include "parallel/parallel.hpp"
 
 #include <stdexcept>
 #include <cstdlib>
 #include <memory>
 #include <cstring>
 #include <filesystem>
+#include <numeric>
+#include <string_view>
+#include <sstream>
 
 using enum raw_data::format;
 using enum file_reader::error;
 
+/* With adaptive sampling, the pixels do not all have number_of_rays samples:
+   their averages are multiplied by number_of_rays, so that the files are read and merged the same way (see raw_data.hpp) */
+static inline rt::color exported_color(const image& image, const int row, const int col, const real invN) {
+    const rt::color& c = image[row, col];
+    return image.is_adaptive() ?
+          c * (image.average_factor(row, col, invN) * image.number_of_samples)
+        : c;
+}
+
+/* First line of a raw data file (without the line break) */
+static std::string header_line(const raw_data::header& header) {
+
+    const auto& [ width, height, number_of_samples, format, pixel_size, gamma, identity, compact ] = header;
+
+    std::array<char, 256> buffer;
+    int length = std::snprintf(buffer.data(), buffer.size(), "width:%u height:%u number_of_rays:%u format:%u",
+        width, height, number_of_samples, static_cast<unsigned int>(format));
+
+    if (format == Compact)
+        length += std::snprintf(buffer.data() + length, buffer.size() - length,
+            " precision:%u tile_size:%u compression:%u", static_cast<unsigned int>(compact.bits),
+            compact.tile_size, static_cast<unsigned int>(compact.compression));
+    else
+        length += std::snprintf(buffer.data() + length, buffer.size() - length, " pixel_size:%zu", pixel_size);
+
+    if (gamma.has_value())
+        length += std::snprintf(buffer.data() + length, buffer.size() - length,
+            " gamma:%lf", 1.0 / static_cast<double>(gamma.value()));
+
+    if (identity.has_value())
+        length += std::snprintf(buffer.data() + length, buffer.size() - length,
+            " seed:%llu scene:%016llx", static_cast<unsigned long long int>(identity.value().seed),
+            static_cast<unsigned long long int>(identity.value().scene_hash));
+
+    return std::string(buffer.data(), length);
+}
+
+static exit_status write_header(const file& f, const raw_data::header& header) {
+    return f.printf("%s\n", header_line(header).c_str());
+}
+
+/* Parses the first line of a raw data file, made of fields key:value separated by spaces
+   (width, height and number_of_rays are required, the other fields are optional and the unknown ones are ignored) */
+static raw_data::header parse_header(const std::string& line) {
+
+    raw_data::header header;
+    bool width_read = false, height_read = false, number_of_rays_read = false;
+    unsigned int format_code = 0;
+    unsigned int precision_bits = static_cast<unsigned int>(compact_parameters::precision::Half);
+    std::optional<uint64_t> seed, scene_hash;
+
+    std::istringstream fields(line);
+    std::string field;
+    while (fields >> field) {
+
+        const std::size_t colon = field.find(':');
+        if (colon == std::string::npos)
+            throw ReadingErrorHeader;
+        const std::string key   = field.substr(0, colon);
+        const std::string value = field.substr(colon + 1);
+
+        try {
+            if (key == "width") {
+                header.width = std::stoul(value);
+                width_read = true;
+            }
+            else if (key == "height") {
+                header.height = std::stoul(value);
+                height_read = true;
+            }
+            else if (key == "number_of_rays") {
+                header.number_of_samples = std::stoul(value);
+                number_of_rays_read = true;
+            }
+            else if (key == "format")
+                format_code = std::stoul(value);
+            else if (key == "pixel_size")
+                header.pixel_size = std::stoul(value);
+            else if (key == "precision")
+                precision_bits = std::stoul(value);
+            else if (key == "tile_size")
+                header.compact.tile_size = std::stoul(value);
+            else if (key == "variance" && std::stoul(value) != 0)
+                // Tiles with a plane of variances, which is no longer written
+                throw DataError;
+            else if (key == "compression")
+                header.compact.compression = std::stoul(value) != 0;
+            else if (key == "gamma")
+                header.gamma = 1.0_r / static_cast<real>(std::stod(value));
+            else if (key == "seed")
+                seed = std::stoull(value);
+            else if (key == "scene")
+                scene_hash = std::stoull(value, nullptr, 16);
+        }
+        catch (const std::exception&) {
+            throw ReadingErrorHeader;
+        }
+    }
+
+    if (not (width_read && height_read && number_of_rays_read))
+        throw ReadingErrorHeader;
+    // The binary data is only readable by a build with the same real type
+    if (format_code > 2 || (format_code == 1 && header.pixel_size != sizeof(rt::color)))
+        throw DataError;
+    if (format_code == 2) {
+        if ((precision_bits != 16 && precision_bits != 32) || header.compact.tile_size == 0)
+            throw DataError;
+        header.compact.bits = static_cast<compact_parameters::precision>(precision_bits);
+    }
+
+    header.data_format = static_cast<raw_data::format>(format_code);
+    if (seed.has_value() && scene_hash.has_value())
+        header.identity = render_identity{ .seed = seed.value(), .scene_hash = scene_hash.value() };
+
+    return header;
+}
+
+/* Reads the first line of a raw data file: the position is then at the start of the data */
+static raw_data::header read_header(const file& f) {
+    return parse_header(f.read_line());
+}
+
 // format = 0: decimal representations written in sequence, one by line
 // format = 1: binary values written in sequence
-exit_status raw_data::export_data(const std::string& file_name, const image& image, const raw_data::format format) {
+// format = 2: averages encoded by tiles (see compact_data.hpp)
+exit_status raw_data::export_data(const std::string& file_name, const image& image, const raw_data::format format,
+    const compact_parameters& compact) {
+
+    if (format != Text) {
+        capture c;
+        capture_data(image, c);
+        return export_capture(file_name, c, format, compact);
+    }
 
     try {
 
@@ -21,51 +156,98 @@ exit_status raw_data::export_data(const std::string& file_name, const image& ima
 
         const auto [ width, height ] = image.data.get_dimensions();
         
-        const exit_status status = f.printf("width:%u height:%u number_of_rays:%u format:%u pixel_size:%zu",
-            width, height, image.number_of_samples, format, sizeof(rt::color));
+        header h;
+        h.width  = width;
+        h.height = height;
+        h.number_of_samples = image.number_of_samples;
+        h.data_format = Text;
+        h.gamma = image.gamma;
+        h.identity = image.identity;
+        const exit_status status = write_header(f, h);
+        throw_if_failure(status, "Writing error at first line of " + file_name + "\n");
+
+        const real invN = 1.0_r / image.number_of_samples;
+        for (int j = height - 1; j >= 0; j--) {
+            for (int i = 0; i < static_cast<int>(width); i++) {
+                const auto [ r, g, b ] = exported_color(image, j, i, invN);
+                f.printf("%lf %lf %lf\n", r, g, b);
+            }
+        }
+
+        return exit_status::Success;
+    }
+    catch (const std::exception& e) {
+        printf("%s", e.what());
+        return exit_status::Failure;
+    }
+}
 
-        const exit_status status_gamma =
-            (image.gamma.has_value()) ?
-              f.printf(" gamma:%lf\n", 1.0 / static_cast<double>(image.gamma.value()))
-            : f.printf("\n");
+void raw_data::capture_data(const image& image, capture& c) {
+
+    const auto [ width, height ] = image.data.get_dimensions();
+    c.width  = width;
+    c.height = height;
+    c.number_of_samples = image.number_of_samples;
+    c.gamma = image.gamma;
+    c.identity = image.identity;
+    c.pixels.resize(static_cast<std::size_t>(width) * height);
+
+    const real invN = 1.0_r / image.number_of_samples;
+    parallel_for(height, [&] (const int j) {
+        rt::color* const row = c.pixels.data() + static_cast<std::size_t>(j) * width;
+        if (image.is_adaptive()) {
+            for (int i = 0; i < static_cast<int>(width); i++)
+                row[i] = exported_color(image, j, i, invN);
+        }
+        else
+            std::memcpy(row, image.data[j].data(), width * sizeof(rt::color));
+    });
+}
 
-        throw_if_failure(status && status_gamma, "Writing error at first line of " + file_name + "\n");
+exit_status raw_data::export_capture(const std::string& file_name, const capture& c, const raw_data::format format,
+    const compact_parameters& compact, const compact_data::execution execution) {
 
-        switch (format) {
-            case Text:
-                for (int j = height - 1; j >= 0; j--) {
-                    const matrix::const_row row = image.data[j];
-                    for (const rt::color& c : row) {
-                        const auto [ r, g, b ] = c;
-                        f.printf("%lf %lf %lf\n", r, g, b);
-                    }
-                }
-                break;
-            case Binary: {
-                const std::size_t buffer_size = image.width() * image.height();
-                const std::unique_ptr<rt::color[]> buffer_container(new rt::color[buffer_size]);
-                rt::color* buffer_start = buffer_container.get();
+    const std::string temporary_name = file_name + ".tmp";
 
-                std::size_t index = 0;
-                const std::size_t row_length_bin = width * sizeof(rt::color);
-                for (const matrix::const_row row : image.data) {
-                    std::memcpy(buffer_start + index, row.data(), row_length_bin);
-                    index += width;
-                }
-                
-                const std::span buffer = { reinterpret_cast<const rt::color*>(buffer_start), buffer_size };
-                const exit_status status = f.write(buffer);
-                throw_if_failure(status, "Could not write in file");
-                break;
-            }
+    try {
+        header h = {
+            .width = c.width, .height = c.height,
+            .number_of_samples = c.number_of_samples,
+            .data_format = (format == Compact) ? Compact : Binary,
+            .gamma = c.gamma,
+            .identity = c.identity,
+            .compact = compact
+        };
+
+        /* The tiles are encoded before the file is opened */
+        const std::vector<std::byte> encoded = (h.data_format == Compact) ?
+              compact_data::encode(c.pixels, c.number_of_samples, c.width, c.height, h.compact, execution)
+            : std::vector<std::byte>();
+
+        {
+            file f(temporary_name, "wb");
+
+            const exit_status status = write_header(f, h);
+            throw_if_failure(status, "Writing error at first line of " + temporary_name + "\n");
+
+            const exit_status status_data = (h.data_format == Compact) ?
+                  f.write(std::span<const std::byte>(encoded))
+                : f.write(std::span<const rt::color>(c.pixels));
+            throw_if_failure(status_data && exit_status_of(std::fflush(f.f) == 0),
+                "Could not write in file " + temporary_name + "\n");
         }
 
+        std::filesystem::rename(temporary_name, file_name);
         return exit_status::Success;
     }
     catch (const std::exception& e) {
         printf("%s", e.what());
-        return exit_status::Failure;
     }
+    catch (file::error) {}
+
+    std::error_code ignored;
+    std::filesystem::remove(temporary_name, ignored);
+    return exit_status::Failure;
 }
 
 static std::unique_ptr<rt::color[]> read_raw_file_content(const file& f, const raw_data::format format,
@@ -89,32 +271,41 @@ static std::unique_ptr<rt::color[]> read_raw_file_content(const file& f, const r
     return buffer;
 }
 
+/* Adds the averages decoded by decoder, multiplied by factor, to the pixels of image (in parallel, by tiles) */
+static void add_compact_data(image& image, const compact_data::decoder& decoder, const real factor) {
+
+    parallel_for(static_cast<int>(decoder.tiles_x * decoder.tiles_y), [&] (const int t) {
+
+        const unsigned int tx = t % decoder.tiles_x;
+        const unsigned int ty = t / decoder.tiles_x;
+        const auto [ x, y, tile_width, tile_height ] = decoder.tile_rectangle(tx, ty);
+
+        thread_local std::vector<color_real> colors;
+        colors.resize(3 * static_cast<std::size_t>(tile_width) * tile_height);
+        decoder.decode_tile(tx, ty, colors.data(), tile_width);
+
+        for (unsigned int j = 0; j < tile_height; j++) {
+            for (unsigned int i = 0; i < tile_width; i++) {
+                const color_real* const c = colors.data() + 3 * (static_cast<std::size_t>(j) * tile_width + i);
+                image[y + j, x + i] += rt::color(c[0], c[1], c[2]) * factor;
+            }
+        }
+    });
+}
+
 /* Reads a file file_name generated by export_raw, and returns a matrix with its content
    Writes the number of rays in the associated variable */
 std::expected<image, file_reader::error> raw_data::read_file(const std::string& file_name) {
 
     try {
 
-        file f(file_name);
-
-        unsigned int width, height, number_of_rays;
-        unsigned int format_code = 0;
-        std::size_t pixel_size = sizeof(rt::color);
-        const int ret = f.scanf_count("width:%u height:%u number_of_rays:%u format:%u pixel_size:%zu",
-            width, height, number_of_rays, format_code, pixel_size);
+        file f(file_name, "rb");
 
-        if (ret < 3)
-            throw ReadingErrorHeader;
-        if (format_code != 0 && format_code != 1)
-            throw DataError;
-            
-        const raw_data::format format = static_cast<raw_data::format>(format_code);
-
-        float gamma;
-        const exit_status status_gamma = f.scanf(" gamma:%f", gamma);
-        const std::optional gamma_opt = optional_of(status_gamma, 1.0_r / static_cast<real>(gamma));
+        const auto [ width, height, number_of_rays, format, pixel_size, gamma, identity, compact ] = read_header(f);
 
-        image image(width, height, gamma_opt);
+        image image(width, height, gamma);
+        image.number_of_samples = number_of_rays;
+        image.identity = identity;
         
         switch (format) {
             case Text: {
@@ -142,6 +333,15 @@ std::expected<image, file_reader::error> raw_data::read_file(const std::string&
                 }
                 break;
             }
+            case Compact: {
+                std::vector<std::byte> data(f.length() - f.position());
+                throw_if_failure(f.read(std::span<std::byte>(data)), ReadingErrorData);
+                f.close();
+
+                const compact_data::decoder decoder(data, width, height, compact);
+                add_compact_data(image, decoder, static_cast<real>(number_of_rays));
+                break;
+            }
         }
 
         return image;
@@ -155,129 +355,374 @@ std::expected<image, file_reader::error> raw_data::read_file(const std::string&
     }
 }
 
-/* Combines the n files whose names are in the array source_file_names into one bmp file dest_bmp_name (extension .bmp)
-   and one raw data file dest_raw_name (extension .rtdata) */
-exit_status raw_data::combine_files(const std::string& dest_bmp_name, const std::string& dest_raw_name,
-    const std::span<const std::string> source_file_names, std::optional<std::string> input_dir,
-    std::optional<float> gamma_opt) {
-
-    const std::size_t nb_files = source_file_names.size();
-    printf("Merging %zu file%s...\n", nb_files, (nb_files > 1) ? "s" : "");
+std::expected<raw_data::header, file_reader::error> raw_data::read_file_header(const std::string& file_name) {
 
     try {
+        const file f(file_name, "rb");
+        return read_header(f);
+    }
+    catch (file_reader::error e) {
+        return std::unexpected(e);
+    }
+    catch (const std::exception&) {
+        return std::unexpected(Other);
+    }
+}
 
-        /* Determination of the size of the matrix */
-        unsigned int width, height;
-        {
-            const std::string& name = source_file_names[0];
-            const std::string full_filename = input_dir.has_value() ?
-                  std::filesystem::path(input_dir.value()).append(name).generic_string()
-                : name;
-            file f0(full_filename);
-            
-            [[maybe_unused]] unsigned int number_of_rays_0, format_code_0, pixel_size_0;
-            const exit_status status = f0.scanf("width:%u height:%u number_of_rays:%u format:%u pixel_size:%u",
-                    width, height, number_of_rays_0, format_code_0, pixel_size_0);
-            float gamma_0;
-            const exit_status status_gamma = f0.scanf(" gamma:%f\n", gamma_0);
-            f0.close();
-
-            if (status == exit_status::Failure) {
-                printf("Reading error at first line of file %s\n", name.c_str());
-                throw ReadingErrorHeader;
-            }
-
-            if (status_gamma == exit_status::Success) {
-                if (gamma_opt.has_value() && (std::abs(1.0f / gamma_opt.value() - gamma_0)) > 1.0e-5f)
-                    printf("gamma argument %f was overridden by raw data file (gamma = %f)\n", 1.0f / gamma_opt.value(), gamma_0);
-                gamma_opt = 1.0 / static_cast<double>(gamma_0);
-            }
-        }
+/* Source file of a merge */
+struct merge_source {
+    std::string name;
+    std::string path;
+    std::unique_ptr<mapped_file> mapping;
+    raw_data::header header;
+    std::size_t data_offset = 0;                  // Position of the data in the file
+    std::optional<compact_data::decoder> decoder; // Compact format only
+    real scale = 1.0_r;                           // Factor of the values of the file in the sum
+
+    /* Factor of the decoded values in the sum (the compact files store averages) */
+    double factor() const {
+        return decoder.has_value() ? static_cast<double>(scale) * header.number_of_samples : static_cast<double>(scale);
+    }
+};
 
-        image image(width, height, gamma_opt);
+/* Maps the source file name and reads its header */
+static merge_source map_source(const std::string& name, const std::optional<std::string>& input_dir) {
 
-        /* Adding the value of each file to matrix */
-        for (const std::string& name : source_file_names) {
+    merge_source source;
+    source.name = name;
+    source.path = input_dir.has_value() ?
+          std::filesystem::path(input_dir.value()).append(name).generic_string()
+        : name;
 
-            const std::string full_filename = input_dir.has_value() ?
-                  std::filesystem::path(input_dir.value()).append(name).generic_string()
-                : name;
-            file f(full_filename);
+    try {
+        source.mapping = std::make_unique<mapped_file>(source.path);
+    }
+    catch (const std::exception& e) {
+        printf("Error, %s\n", e.what());
+        throw FileError;
+    }
 
-            unsigned int width_k, height_k, number_of_rays_k;
-            unsigned int format_code = 0;
-            std::size_t pixel_size = sizeof(rt::color); // default value
-            const int ret = f.scanf_count("width:%u height:%u number_of_rays:%u format:%u pixel_size:%zu",
-                width_k, height_k, number_of_rays_k, format_code, pixel_size);
+    const std::span<const std::byte> content = source.mapping->content();
+    const std::string_view text(reinterpret_cast<const char*>(content.data()), content.size());
+    const std::size_t end_of_line = text.find('\n');
 
-            {
-                [[maybe_unused]] float gamma_k;
-                f.scanf(" gamma:%f\n", gamma_k);
-            }
+    try {
+        if (end_of_line == std::string_view::npos)
+            throw ReadingErrorHeader;
+        source.header = parse_header(std::string(text.substr(0, end_of_line)));
+    }
+    catch (file_reader::error) {
+        printf("Reading error at first line of file %s\n", name.c_str());
+        throw;
+    }
+    source.data_offset = end_of_line + 1;
 
-            const bool correct_format = format_code == 0 || format_code == 1;
-            if (ret < 3 || not correct_format) {
-                printf("Reading error at first line of file %s\n", name.c_str());
-                throw (correct_format) ? ReadingErrorHeader : DataError;
-            }
+    const auto& [ width, height, _, format, pixel_size, _, _, compact ] = source.header;
 
-            if (width_k != width || height_k != height) {
-                printf("Error, incorrect width or height in file %s\n", name.c_str());
-                throw DataError;
-            }
+    if (format == Binary) {
+        const std::size_t data_size = static_cast<std::size_t>(width) * height * pixel_size;
+        if (content.size() < source.data_offset + data_size) {
+            printf("Error, incorrect size of file %s\n", name.c_str());
+            throw DataError;
+        }
+    }
+    else if (format == Compact) {
+        try {
+            source.decoder.emplace(content.subspan(source.data_offset), width, height, compact);
+        }
+        catch (file_reader::error) {
+            printf("Error, incorrect tiles in file %s\n", name.c_str());
+            throw;
+        }
+    }
 
-            const raw_data::format format = static_cast<raw_data::format>(format_code);
+    return source;
+}
 
-            switch (format) {
-                case Text: {
-                    for (int j = height - 1; j >= 0; j--) {
-                        const matrix::row row = image.data[j];
-                        for (rt::color& color : row) {
-                            const auto [ r, g, b ] = f.scan<real, 3>();
-                            color += rt::color(r, g, b);
+/* Sums the sources (all in the binary or compact format) into the raw data file dest_raw_name and the bmp file dest_bmp_name,
+   band by band, both files being written through mappings */
+static void merge_mapped(const std::string& dest_bmp_name, const std::string& dest_raw_name,
+    const std::span<const merge_source> sources, const unsigned int width, const unsigned int height,
+    const unsigned int number_of_samples, const std::optional<real> gamma, const std::optional<render_identity>& identity,
+    const std::size_t memory_budget) {
+
+    static_assert(sizeof(rt::color) == 3 * sizeof(color_real));
+
+    const std::size_t nb_pixels = static_cast<std::size_t>(width) * height;
+    raw_data::header output_header;
+    output_header.width  = width;
+    output_header.height = height;
+    output_header.number_of_samples = number_of_samples;
+    output_header.data_format = Binary;
+    output_header.gamma = gamma;
+    output_header.identity = identity;
+    const std::string header = header_line(output_header) + "\n";
+    const std::size_t raw_offset = header.size();
+    const std::size_t row_bytes = static_cast<std::size_t>(width) * sizeof(rt::color);
+    const unsigned int bmp_row_size = bmp::row_size(width);
+
+    /* The rows are processed in blocks (one task of the thread pool each) of about MIN_BLOCK_SIZE pixels at least,
+       made of whole rows of tiles of the compact sources, and the blocks are grouped in bands
+       whose parts of the sources and of the output fit in the memory budget */
+    constexpr std::size_t MIN_BLOCK_SIZE = 4096;
+    unsigned int tile_rows = 1;
+    std::size_t band_row_bytes = row_bytes;
+    for (const merge_source& source : sources) {
+        if (source.decoder.has_value()) {
+            tile_rows = std::lcm(tile_rows, source.header.compact.tile_size);
+            band_row_bytes += (source.mapping->size() - source.data_offset) / height + 1;
+        }
+        else
+            band_row_bytes += row_bytes;
+    }
+    const unsigned int min_rows = static_cast<unsigned int>((MIN_BLOCK_SIZE + width - 1) / width);
+    const unsigned int block_rows = (min_rows + tile_rows - 1) / tile_rows * tile_rows;
+    const unsigned int band_rows = static_cast<unsigned int>(std::max<std::size_t>(1, memory_budget / band_row_bytes / block_rows)) * block_rows;
+
+    const std::string raw_temporary_name = dest_raw_name + ".tmp";
+    const std::string bmp_temporary_name = dest_bmp_name + ".tmp";
+
+    {
+        const mapped_file raw_output(raw_temporary_name, raw_offset + nb_pixels * sizeof(rt::color));
+        const mapped_file bmp_output(bmp_temporary_name, bmp::HEADER_SIZE + static_cast<std::size_t>(bmp_row_size) * height);
+        std::byte* const raw_data = raw_output.mutable_content().data();
+        uint8_t* const bmp_data = reinterpret_cast<uint8_t*>(bmp_output.mutable_content().data());
+
+        std::memcpy(raw_data, header.data(), header.size());
+        const std::array<uint8_t, bmp::HEADER_SIZE> bmp_header = bmp::make_header(width, height);
+        std::memcpy(bmp_data, bmp_header.data(), bmp_header.size());
+
+        const real invN = 1.0_r / number_of_samples;
+
+        for (unsigned int band_start = 0; band_start < height; band_start += band_rows) {
+
+            const unsigned int band_end = std::min(band_start + band_rows, height);
+            const int nb_blocks = static_cast<int>((band_end - band_start + block_rows - 1) / block_rows);
+
+            parallel_for(nb_blocks, [&] (const int block) {
+
+                const unsigned int first_row = band_start + block * block_rows;
+                const unsigned int end_row   = std::min(first_row + block_rows, band_end);
+                const std::size_t start = static_cast<std::size_t>(first_row) * width;
+                const std::size_t count = static_cast<std::size_t>(end_row - first_row) * width;
+
+                /* The sums are accumulated in double precision, the values being copied (or decoded) first
+                   since the data of the files is not aligned */
+                thread_local std::vector<double> sums;
+                thread_local std::vector<color_real> values;
+                sums.assign(3 * count, 0.0);
+                values.resize(3 * count);
+
+                for (const merge_source& source : sources) {
+
+                    if (source.decoder.has_value()) {
+                        const compact_data::decoder& decoder = source.decoder.value();
+                        const unsigned int tile_size = decoder.parameters.tile_size;
+                        for (unsigned int ty = first_row / tile_size; ty < (end_row + tile_size - 1) / tile_size; ty++) {
+                            for (unsigned int tx = 0; tx < decoder.tiles_x; tx++) {
+                                const auto [ x, y, _, _ ] = decoder.tile_rectangle(tx, ty);
+                                decoder.decode_tile(tx, ty, values.data() + 3 * ((static_cast<std::size_t>(y) - first_row) * width + x), width);
+                            }
                         }
                     }
-                    break;
+                    else
+                        std::memcpy(values.data(), source.mapping->content().data() + source.data_offset + start * sizeof(rt::color),
+                            count * sizeof(rt::color));
+
+                    const double factor = source.factor();
+                    for (std::size_t k = 0; k < 3 * count; k++)
+                        sums[k] += factor * values[k];
                 }
-                case Binary: {
-                    const unsigned int buffer_size = width * height;
-                    const std::unique_ptr<rt::color[]> buffer_container = read_raw_file_content(f, format, pixel_size, buffer_size);
-                    f.close();
-
-                    const rt::color* buffer = buffer_container.get();
-                    
-                    for (int index = 0; const matrix::row row : image.data) {
-                        for (rt::color& color : row) {
-                            color += buffer[index];
-                            index++;
-                        }
+
+                for (std::size_t k = 0; k < 3 * count; k++)
+                    values[k] = static_cast<color_real>(sums[k]);
+                std::memcpy(raw_data + raw_offset + start * sizeof(rt::color), values.data(), count * sizeof(rt::color));
+
+                /* The rows of the bmp file are stored from the bottom one to the top one */
+                for (unsigned int j = first_row; j < end_row; j++) {
+                    const color_real* v = values.data() + 3 * static_cast<std::size_t>(j - first_row) * width;
+                    uint8_t* pixel = bmp_data + bmp::HEADER_SIZE + static_cast<std::size_t>(height - 1 - j) * bmp_row_size;
+                    for (unsigned int i = 0; i < width; i++) {
+                        bmp::encode_pixel(rt::color(v[0], v[1], v[2]) * invN, gamma, pixel);
+                        v += 3;
+                        pixel += 3;
                     }
-                    break;
                 }
+            });
+
+            /* The band is not accessed again */
+            for (const merge_source& source : sources) {
+                if (source.decoder.has_value()) {
+                    const unsigned int tile_size = source.header.compact.tile_size;
+                    const auto [ offset, length ] = source.decoder.value().tile_rows_range(
+                        band_start / tile_size, (band_end + tile_size - 1) / tile_size);
+                    source.mapping->release(source.data_offset + offset, length);
+                }
+                else
+                    source.mapping->release(source.data_offset + band_start * row_bytes, (band_end - band_start) * row_bytes);
             }
+            raw_output.release(raw_offset + band_start * row_bytes, (band_end - band_start) * row_bytes);
+            bmp_output.release(bmp::HEADER_SIZE + static_cast<std::size_t>(height - band_end) * bmp_row_size,
+                static_cast<std::size_t>(band_end - band_start) * bmp_row_size);
 
-            image.increase_sample_count(number_of_rays_k);
+            printf("\r%u / %u rows", band_end, height);
+            fflush(stdout);
+        }
+        printf("\n");
+
+        throw_if_failure(raw_output.flush(), "Could not write in file " + raw_temporary_name + "\n");
+        throw_if_failure(bmp_output.flush(), "Could not write in file " + bmp_temporary_name + "\n");
+    }
+
+    std::filesystem::rename(raw_temporary_name, dest_raw_name);
+    std::filesystem::rename(bmp_temporary_name, dest_bmp_name);
+}
+
+/* Sums the sources (one of them at least in the text format) in an image, exported in dest_bmp_name and dest_raw_name */
+static void merge_in_memory(const std::string& dest_bmp_name, const std::string& dest_raw_name,
+    const std::span<const merge_source> sources, const unsigned int width, const unsigned int height,
+    const unsigned int number_of_samples, const std::optional<real> gamma, const std::optional<render_identity>& identity) {
+
+    image image(width, height, gamma);
+    image.identity = identity;
+
+    for (const merge_source& source : sources) {
+        switch (source.header.data_format) {
+            case Text: {
+                file f(source.path);
+                (void) read_header(f);
+
+                for (int j = height - 1; j >= 0; j--) {
+                    const matrix::row row = image.data[j];
+                    for (rt::color& color : row) {
+                        const auto [ r, g, b ] = f.scan<real, 3>();
+                        color += rt::color(r, g, b) * source.scale;
+                    }
+                }
+                break;
+            }
+            case Compact: {
+                add_compact_data(image, source.decoder.value(), static_cast<real>(source.factor()));
+                break;
+            }
+            case Binary: {
+                const std::byte* const data = source.mapping->content().data() + source.data_offset;
+                parallel_for(height, [&] (const int j) {
+                    const matrix::row row = image.data[j];
+                    for (std::size_t index = static_cast<std::size_t>(j) * width; rt::color& color : row) {
+                        rt::color c;
+                        std::memcpy(&c, data + index * sizeof(rt::color), sizeof(rt::color));
+                        color += c * source.scale;
+                        index++;
+                    }
+                });
+                break;
+            }
         }
+    }
+    image.increase_sample_count(number_of_samples);
+
+    /* Exporting the matrix as a bmp file */
+    const exit_status status_bmp = bmp::export_data(dest_bmp_name, image);
+
+    constexpr raw_data::format DEFAULT_FORMAT = Binary;
+    const exit_status status_raw = raw_data::export_data(dest_raw_name, image, DEFAULT_FORMAT);
+
+    if ((status_bmp && status_raw) == exit_status::Failure) {
+
+        if (status_bmp == exit_status::Failure)
+            printf("Error in generating the bmp file %s\n", dest_bmp_name.c_str());
+        if (status_raw == exit_status::Failure)
+            printf("Error in generating the raw data file %s\n", dest_raw_name.c_str());
+
+        throw FileError;
+    }
+}
+
+/* Combines the n files whose names are in the array source_file_names into one bmp file dest_bmp_name (extension .bmp)
+   and one raw data file dest_raw_name (extension .rtdata) */
+exit_status raw_data::combine_files(const std::string& dest_bmp_name, const std::string& dest_raw_name,
+    const std::span<const std::string> source_file_names, const std::optional<std::string> input_dir,
+    std::optional<float> gamma_opt, const std::span<const real> weights, const std::size_t memory_budget) {
 
-        /* Exporting the matrix as a bmp file */
-        const exit_status status_bmp = bmp::export_data(dest_bmp_name, image);
+    const std::size_t nb_files = source_file_names.size();
+    printf("Merging %zu file%s...\n", nb_files, (nb_files > 1) ? "s" : "");
 
-        constexpr format DEFAULT_FORMAT = Binary;
-        const exit_status status_raw = export_data(dest_raw_name, image, DEFAULT_FORMAT);
+    try {
 
-        if ((status_bmp && status_raw) == exit_status::Failure) {
-                
-            if (status_bmp == exit_status::Failure)
-                printf("Error in generating the bmp file %s\n", dest_bmp_name.c_str());
-            if (status_raw == exit_status::Failure) 
-                printf("Error in generating the raw data file %s\n", dest_raw_name.c_str());
+        if (not weights.empty() && weights.size() != nb_files) {
+            printf("Error, %zu weights provided for %zu files\n", weights.size(), nb_files);
+            throw DataError;
+        }
 
-            throw FileError;
+        /* All the headers are checked before the data is read */
+        std::vector<merge_source> sources;
+        sources.reserve(nb_files);
+        for (const std::string& name : source_file_names)
+            sources.push_back(map_source(name, input_dir));
+
+        const unsigned int width  = sources[0].header.width;
+        const unsigned int height = sources[0].header.height;
+        for (const merge_source& source : sources) {
+            if (source.header.width != width || source.header.height != height) {
+                printf("Error, incorrect width or height in file %s\n", source.name.c_str());
+                throw DataError;
+            }
         }
 
+        if (sources[0].header.gamma.has_value()) {
+            const float gamma_0 = 1.0f / static_cast<float>(sources[0].header.gamma.value());
+            if (gamma_opt.has_value() && (std::abs(1.0f / gamma_opt.value() - gamma_0)) > 1.0e-5f)
+                printf("gamma argument %f was overridden by raw data file (gamma = %f)\n", 1.0f / gamma_opt.value(), gamma_0);
+            gamma_opt = sources[0].header.gamma.value();
+        }
+        const std::optional<real> gamma = gamma_opt;
+
+        /* The result keeps the seed and the scene of the files if they all record the same ones
+           (e.g. the shards of a render, which can then be resumed) */
+        const std::optional<render_identity> identity = sources[0].header.identity;
+        const bool same_identity = std::ranges::all_of(sources,
+            [&identity] (const merge_source& source) { return source.header.identity == identity; });
+        if (not same_identity)
+            printf("The files come from different renders: the merged file does not record a seed and a scene\n");
+
+        const unsigned int number_of_samples = std::accumulate(sources.begin(), sources.end(), 0u,
+            [] (const unsigned int n, const merge_source& source) { return n + source.header.number_of_samples; });
+
+        /* A file of weight w and n samples contributes number_of_samples * w / (n * total weight) times its sum,
+           so that the average colors are weighted */
+        if (not weights.empty()) {
+            const real total_weight = std::accumulate(weights.begin(), weights.end(), 0.0_r);
+            if (std::ranges::any_of(weights, [] (const real w) { return w < 0.0_r; }) || total_weight <= 0.0_r) {
+                printf("Error, the weights should be non-negative, and not all zero\n");
+                throw DataError;
+            }
+
+            for (std::size_t k = 0; k < nb_files; k++) {
+                const unsigned int n = sources[k].header.number_of_samples;
+                sources[k].scale = (n == 0) ? 0.0_r : number_of_samples * weights[k] / (n * total_weight);
+            }
+        }
+
+        const bool no_text = std::ranges::none_of(sources,
+            [] (const merge_source& source) { return source.header.data_format == Text; });
+
+        if (no_text)
+            merge_mapped(dest_bmp_name, dest_raw_name, sources, width, height, number_of_samples, gamma,
+                same_identity ? identity : std::nullopt, memory_budget);
+        else
+            merge_in_memory(dest_bmp_name, dest_raw_name, sources, width, height, number_of_samples, gamma,
+                same_identity ? identity : std::nullopt);
+
         return exit_status::Success;
     }
-    catch (...) {
-        return exit_status::Failure;
+    catch (const std::exception& e) {
+        printf("%s", e.what());
     }
-}
\ No newline at end of file
+    catch (...) {}
+
+    std::error_code ignored;
+    std::filesystem::remove(dest_raw_name + ".tmp", ignored);
+    std::filesystem::remove(dest_bmp_name + ".tmp", ignored);
+    return exit_status::Failure;
+}
@@ -0,0 +1,195 @@
+#include "file_readers/mapped_file.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::string& file_name) {
+
+    file_handle = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        file_handle = nullptr;
+        throw std::runtime_error("could not open file " + file_name);
+    }
+
+    LARGE_INTEGER file_size;
+    if (not GetFileSizeEx(file_handle, &file_size)) {
+        unmap();
+        throw std::runtime_error("could not read the size of file " + file_name);
+    }
+    size_ = static_cast<std::size_t>(file_size.QuadPart);
+
+    // Empty files cannot be mapped
+    if (size_ == 0)
+        return;
+
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle == nullptr) {
+        unmap();
+        throw std::runtime_error("could not map file " + file_name);
+    }
+
+    data_ = static_cast<const std::byte*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr) {
+        unmap();
+        throw std::runtime_error("could not map file " + file_name);
+    }
+}
+
+mapped_file::mapped_file(const std::string& file_name, const std::size_t size)
+    : size_(size), writable(true) {
+
+    file_handle = CreateFileA(file_name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        file_handle = nullptr;
+        throw std::runtime_error("could not create file " + file_name);
+    }
+
+    // Empty files cannot be mapped
+    if (size_ == 0)
+        return;
+
+    // The file is extended to the size of the mapping
+    const unsigned long long int size_64 = size_;
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(size_64 >> 32), static_cast<DWORD>(size_64 & 0xFFFFFFFF), nullptr);
+    if (mapping_handle == nullptr) {
+        unmap();
+        throw std::runtime_error("could not map file " + file_name);
+    }
+
+    data_ = static_cast<const std::byte*>(MapViewOfFile(mapping_handle, FILE_MAP_WRITE, 0, 0, 0));
+    if (data_ == nullptr) {
+        unmap();
+        throw std::runtime_error("could not map file " + file_name);
+    }
+}
+
+void mapped_file::release(const std::size_t offset, const std::size_t length) const noexcept {
+    if (writable && data_ != nullptr && length != 0)
+        FlushViewOfFile(data_ + offset, length);
+}
+
+exit_status mapped_file::flush() const {
+    if (data_ == nullptr)
+        return exit_status::Success;
+    return exit_status_of(FlushViewOfFile(data_, 0) && FlushFileBuffers(file_handle));
+}
+
+void mapped_file::unmap() noexcept {
+    if (data_ != nullptr)
+        UnmapViewOfFile(data_);
+    if (mapping_handle != nullptr)
+        CloseHandle(mapping_handle);
+    if (file_handle != nullptr)
+        CloseHandle(file_handle);
+    data_ = nullptr;
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+}
+
+#else
+
+mapped_file::mapped_file(const std::string& file_name) {
+
+    const int descriptor = open(file_name.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        throw std::runtime_error("could not open file " + file_name);
+
+    struct stat file_status;
+    if (fstat(descriptor, &file_status) != 0) {
+        close(descriptor);
+        throw std::runtime_error("could not read the size of file " + file_name);
+    }
+    size_ = static_cast<std::size_t>(file_status.st_size);
+
+    // Empty files cannot be mapped
+    if (size_ == 0) {
+        close(descriptor);
+        return;
+    }
+
+    // The mapping keeps the file open: the descriptor is closed, so that many files can be mapped at the same time
+    void* const address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (address == MAP_FAILED)
+        throw std::runtime_error("could not map file " + file_name);
+    data_ = static_cast<const std::byte*>(address);
+
+    // The files are mostly read from the beginning to the end
+    madvise(address, size_, MADV_SEQUENTIAL);
+}
+
+mapped_file::mapped_file(const std::string& file_name, const std::size_t size)
+    : size_(size), writable(true) {
+
+    const int descriptor = open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (descriptor < 0)
+        throw std::runtime_error("could not create file " + file_name);
+
+    if (ftruncate(descriptor, static_cast<off_t>(size_)) != 0) {
+        close(descriptor);
+        throw std::runtime_error("could not set the size of file " + file_name);
+    }
+
+    // Empty files cannot be mapped
+    if (size_ == 0) {
+        close(descriptor);
+        return;
+    }
+
+    void* const address = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    if (address == MAP_FAILED)
+        throw std::runtime_error("could not map file " + file_name);
+    data_ = static_cast<const std::byte*>(address);
+}
+
+void mapped_file::release(const std::size_t offset, const std::size_t length) const noexcept {
+
+    if (data_ == nullptr || length == 0)
+        return;
+
+    // The range is extended to whole pages
+    const std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t start = offset - offset % page_size;
+    const std::size_t end   = std::min(offset + length, size_);
+    void* const address = const_cast<std::byte*>(data_ + start);
+
+    if (writable) {
+        msync(address, end - start, MS_ASYNC);
+#ifdef __linux__
+        // The modified pages of a shared mapping are kept in the page cache until they are written
+        madvise(address, end - start, MADV_DONTNEED);
+#endif
+    }
+    else
+        madvise(address, end - start, MADV_DONTNEED);
+}
+
+exit_status mapped_file::flush() const {
+    if (data_ == nullptr)
+        return exit_status::Success;
+    return exit_status_of(msync(const_cast<std::byte*>(data_), size_, MS_SYNC) == 0);
+}
+
+void mapped_file::unmap() noexcept {
+    if (data_ != nullptr)
+        munmap(const_cast<std::byte*>(data_), size_);
+    data_ = nullptr;
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "file_readers/image_files/raw_data.hpp"
 
 #include <filesystem>
+#include <sstream>
 
 using namespace std::filesystem;
 
@@ -17,12 +18,36 @@ struct parameters {
     std::string dest_bmp = "merged.bmp";
     std::string dest_raw = "merged.rtdata";
     std::optional<float> gamma_opt;
+    std::vector<real> weights;
+    std::size_t memory_budget = raw_data::DEFAULT_MERGE_MEMORY;
     bool input_dir_set  = false;
     bool output_dir_set = false;
     bool dest_set       = false;
     bool gamma_set      = false;
+    bool weights_set    = false;
+    bool memory_set     = false;
 };
 
+/* Parses a list of weights separated by commas */
+static std::vector<real> parse_weights(const std::string& list) {
+
+    std::vector<real> weights;
+    std::istringstream values(list);
+    std::string value;
+    while (std::getline(values, value, ',')) {
+        try {
+            weights.push_back(static_cast<real>(std::stod(value)));
+        }
+        catch (const std::exception&) {
+            throw std::runtime_error("Error: incorrect weight " + value + "\n");
+        }
+    }
+
+    if (weights.empty())
+        throw std::runtime_error("Error: no weight provided\n");
+    return weights;
+}
+
 /* Returns the index in the argument list after the parsing, at the beginning of the source filenames */
 static unsigned int parse_parameters(parameters& param, const std::span<const std::string> args) {
 
@@ -89,6 +114,29 @@ static unsigned int parse_parameters(parameters& param, const std::span<const st
             param.gamma_set = true;
             current_index += nb_args + 1;
         }
+        else if (int nb_args = 1;
+            arg == "-weights"
+                && args_size > current_index + nb_args
+                && not param.weights_set) {
+
+            param.weights = parse_weights(args[current_index + 1]);
+
+            param.weights_set = true;
+            current_index += nb_args + 1;
+        }
+        else if (int nb_args = 1;
+            arg == "-memory"
+                && args_size > current_index + nb_args
+                && not param.memory_set) {
+
+            const unsigned long int megabytes = std::stoul(args[current_index + 1]);
+            if (megabytes == 0)
+                throw std::runtime_error("Error: the memory budget should be positive\n");
+            param.memory_budget = static_cast<std::size_t>(megabytes) << 20;
+
+            param.memory_set = true;
+            current_index += nb_args + 1;
+        }
         else
             throw std::runtime_error("Unexpected argument " + arg + "\n");
     }
@@ -96,14 +144,18 @@ static unsigned int parse_parameters(parameters& param, const std::span<const st
     if (args_size <= current_index)
         throw std::runtime_error("Error: no source file provided\n");
 
+    if (param.weights_set && param.weights.size() != args_size - current_index)
+        throw std::runtime_error("Error: " + std::to_string(param.weights.size()) + " weights provided for "
+            + std::to_string(args_size - current_index) + " source files\n");
+
     return current_index;
 }
 
 
 /* Program that combines raw data files into a bmp file */
 /* Arguments syntax:
-   ./merge dest.bmp dest.rtdata [-gamma g] source1 source2 ... sourcen
-   with g the gamma value */
+   ./merge dest.bmp dest.rtdata [-gamma g] [-weights w1,w2,...,wn] [-memory m] source1 source2 ... sourcen
+   with g the gamma value, wk the weight of sourcek and m the memory budget in MB */
 int main(int argc, char* argv[]) {
     
     const std::vector<std::string> args(argv + 1, argv + argc);
@@ -144,7 +196,8 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    const exit_status status = raw_data::combine_files(dest_bmp, dest_raw, source_file_names, input_dir, param.gamma_opt);
+    const exit_status status = raw_data::combine_files(dest_bmp, dest_raw, source_file_names, input_dir, param.gamma_opt,
+        param.weights, param.memory_budget);
 
     switch (status) {
         case exit_status::Success:
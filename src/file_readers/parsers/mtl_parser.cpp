@@ -132,10 +132,13 @@ exit_status parse_mtl_file(const std::filesystem::path& path, const std::string&
                     // Texture loading
                     const std::string full_name = (path / tfile_name).generic_string();
 
-                    auto& [ _, _, _, _, composition_wrapper_set, texture_set, normal_map_set, _ ] = containers;
+                    auto& [ _, _, _, _, composition_wrapper_set, texture_set, normal_map_set, _, dependencies ] = containers;
+
+                    std::string report;
 
                     try {
-                        texture_set.emplace_back(full_name, gamma);
+                        report = texture_set.emplace_back(full_name, gamma).memory_report();
+                        dependencies.push_back(full_name);
                     }
                     catch (const std::exception& e) {
                         printf("%s\n", e.what());
@@ -153,7 +156,7 @@ exit_status parse_mtl_file(const std::filesystem::path& path, const std::string&
                     static_assert(TODO_ROUGHNESS_MAP_IN_MTL);
                     static_assert(TODO_DISPLACEMENT_MAP_IN_MTL);
 
-                    printf("\rmtl_parser: %s texture loaded\n", tfile_name.c_str());
+                    printf("\rmtl_parser: %s texture loaded (%s)\n", tfile_name.c_str(), report.c_str());
                 }
                 // else: texture omitted
 
@@ -1,18 +1,25 @@
 #include "file_readers/parsers/obj_parser.hpp"
 
 #include "accelerating_structures/clustering.hpp"
+#include "accelerating_structures/sah.hpp"
 #include "file_readers/parsers/mtl_parser.hpp"
 #include "file_readers/file.hpp"
+#include "file_readers/mapped_file.hpp"
+#include "parallel/parallel.hpp"
 #include "auxiliary/utils.hpp"
+#include "auxiliary/timer.hpp"
 
 #include <array>
+#include <span>
 #include <stack>
 #include <stdexcept>
 #include <filesystem>
 
-#include <sstream>
-#include <limits>
+#include <string_view>
+#include <thread>
 #include <charconv>
+#include <cstring>
+#include <optional>
 
 #include <algorithm>
 
@@ -27,51 +34,99 @@ split the quad into two triangles, to solve some visual glitches */
 static constexpr bool SPLIT_ALL_QUADS = false;
 static constexpr real QUAD_SPLIT_THRESHOLD = 1.0e-7_r;
 
-constexpr std::streamsize MAX_LINE_SIZE = std::numeric_limits<std::streamsize>::max();
+/* The .obj files are memory-mapped and split into chunks ending at line boundaries, that are parsed in parallel.
+   The chunks contain at least MIN_CHUNK_SIZE bytes, and there are at most CHUNKS_PER_THREAD chunks per thread
+   (more chunks than threads balance the load between the threads). */
+static constexpr std::size_t MIN_CHUNK_SIZE    = 1 << 20;
+static constexpr std::size_t CHUNKS_PER_THREAD = 4;
 
 /**************************************************************************************/
 
-pre_parsing_info_obj pre_parse_obj(const std::string& filename) {
+static inline std::string_view text_of(const mapped_file& f) {
+    return { reinterpret_cast<const char*>(f.content().data()), f.size() };
+}
 
-    file f(filename, "rb");
-    const std::vector<unsigned char> content = f.extract();
-    f.close();
+/* Splits text into chunks of similar sizes, each one ending with a line break (except the last one)
+   If number_of_chunks is not specified, it is determined from the size of the text and the number of threads */
+static std::vector<std::string_view> split_in_chunks(const std::string_view text,
+    const std::optional<std::size_t> number_of_chunks = std::nullopt) {
 
-    pre_parsing_info_obj out;
-    auto& [ faces, triangles, quads ] = out;
+    const std::size_t nb_threads = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t nb_chunks  = std::max(std::size_t(1), number_of_chunks.value_or(
+        std::clamp(text.size() / MIN_CHUNK_SIZE, std::size_t(1), nb_threads * CHUNKS_PER_THREAD)));
+    const std::size_t chunk_size = text.size() / nb_chunks;
 
-    unsigned int i = 0;
-    const unsigned int length = content.size();
-    
-    auto skip_line = [&] {
-        while (i < length && content[i] != '\n')
-            i++;
-        i++;
-    };
+    std::vector<std::string_view> chunks;
+    chunks.reserve(nb_chunks);
 
-    auto count_spaces_in_line = [&] {
-        int cpt = 0;
-        unsigned char ch;
-        while (i < length && ((ch = content[i]) != '\n')) {
-            cpt += (ch == ' ');
-            i++;
+    std::size_t start = 0;
+    for (std::size_t c = 0; c < nb_chunks && start < text.size(); c++) {
+
+        std::size_t end = text.size();
+        if (c != nb_chunks - 1) {
+            const std::size_t line_break = text.find('\n', std::max(start, chunk_size * (c + 1)));
+            end = (line_break == std::string_view::npos) ? text.size() : line_break + 1;
         }
-        i++;
-        return cpt;
-    };
 
-    while (i < length) {
-        if (content[i] == 'f') {
-            const int nb = count_spaces_in_line();
-            switch (nb) {
-                case 3:  triangles++;     break;
-                case 4:  quads++;         break;
-                default: triangles += nb; break;
+        chunks.push_back(text.substr(start, end - start));
+        start = end;
+    }
+    return chunks;
+}
+
+pre_parsing_info_obj pre_parse_obj(const std::string& filename) {
+
+    const mapped_file f(filename);
+    const std::vector<std::string_view> chunks = split_in_chunks(text_of(f));
+
+    /* Each chunk is counted separately, and the counts are summed */
+    std::vector<pre_parsing_info_obj> chunk_counts(chunks.size());
+
+    parallel_for(chunks.size(), [&] (int c) {
+
+        const std::string_view content = chunks[c];
+        auto& [ faces, triangles, quads ] = chunk_counts[c];
+
+        std::size_t i = 0;
+        const std::size_t length = content.size();
+
+        auto skip_line = [&] {
+            while (i < length && content[i] != '\n')
+                i++;
+            i++;
+        };
+
+        auto count_spaces_in_line = [&] {
+            int cpt = 0;
+            char ch;
+            while (i < length && ((ch = content[i]) != '\n')) {
+                cpt += (ch == ' ');
+                i++;
+            }
+            i++;
+            return cpt;
+        };
+
+        while (i < length) {
+            if (content[i] == 'f') {
+                const int nb = count_spaces_in_line();
+                switch (nb) {
+                    case 3:  triangles++;     break;
+                    case 4:  quads++;         break;
+                    default: triangles += nb; break;
+                }
+                faces++;
             }
-            faces++;
+            else
+                skip_line();
         }
-        else
-            skip_line();
+    });
+
+    pre_parsing_info_obj out;
+    for (const auto& [ faces, triangles, quads ] : chunk_counts) {
+        out.faces     += faces;
+        out.triangles += triangles;
+        out.quads     += quads;
     }
 
     /*
@@ -127,20 +182,6 @@ static inline std::pair<rt::vector, rt::vector> compute_normals(
     };
 }
 
-/* Parses and returns size values of type T, and modifies the buffer variable to the next position */
-template<typename T, int size>
-requires std::is_arithmetic_v<T>
-static std::array<T, size> parse(const char *& buffer, unsigned int max_length) {
-    std::array<T, size> v;
-    const char * pt = buffer;
-    for (int i = 0; i < size; i++) {
-        const auto [ p, _ ] = std::from_chars(pt, pt + max_length, v[i]);
-        pt = p + 1;
-    }
-    buffer = pt;
-    return v;
-}
-
 /* Wavefront .obj file parser */
 
 template<typename type>
@@ -213,20 +254,21 @@ struct polygon_manager {
     const bool               bounding_enabled;
 
     public:
-        // nb should be 3 (for triangle), 4 (for quad) or 5 (for polygon with 5 vertices or more)
-        void add_geometry(std::istringstream& stream, const int nb,
-            index_description<5>& id) {
+        /* corners contains the (v, vt, vn) index triplets of the vertices of a face, with positive indices
+           3 vertices make a triangle, 4 a quad, and polygons with more vertices are subdivided into triangles */
+        void add_geometry(std::span<const int> corners) {
 
-            if (nb < 3 || nb > 5)
-                throw std::runtime_error("add_geometry: Incorrect parameter nb = " + std::to_string(nb));
+            const std::size_t nb = corners.size() / 3;
+            if (nb < 3)
+                throw std::runtime_error("add_geometry: Incorrect number of vertices nb = " + std::to_string(nb));
 
+            index_description<5> id;
             auto& [ v, vt, vn ] = id;
-            const auto& [ number_of_vertices, number_of_texture_coords, number_of_normals, _, _, _ ] = counters;
 
-            for (int i = 0; i < nb; i++) {
-                correct(v[i],  number_of_vertices);
-                correct(vt[i], number_of_texture_coords);
-                correct(vn[i], number_of_normals);
+            for (std::size_t i = 0; i < std::min(nb, std::size_t(5)); i++) {
+                v[i]  = corners[3 * i];
+                vt[i] = corners[3 * i + 1];
+                vn[i] = corners[3 * i + 2];
             }
 
             auto& [ v1,  v2,  v3,  v4,  v5  ] = v;
@@ -244,7 +286,7 @@ struct polygon_manager {
                     break;
                 default:
                     /* Polygons with more than 4 sides */
-                    add_subdivided_polygon(stream,
+                    add_subdivided_polygon(corners.subspan(15),
                         { .v = { v1, v2, v3, v4, v5 }, .vt = { vt1, vt2, vt3, vt4, vt5 }, .vn = { vn1, vn2, vn3, vn4, vn5 } }
                     );
                     break;
@@ -386,17 +428,15 @@ struct polygon_manager {
             counters.increase<polygon>();
         }
 
-        /* Auxiliary function that subdivides a polygon with more than 5 sides into triangles, and adds all of them */
-        void add_subdivided_polygon(std::istringstream& stream, index_description<5>&& id) {
+        /* Auxiliary function that subdivides a polygon with at least 5 sides into triangles, and adds all of them
+           id contains the first 5 vertices, and other_corners the index triplets of the next ones */
+        void add_subdivided_polygon(std::span<const int> other_corners, index_description<5>&& id) {
 
             const auto& [ _, _, texturing_option, normal_option ] = mapping_params;
 
             const bool normal_enabled = normal_option    == normal::Enabled;
             const bool apply_texture  = texturing_option == texturing::Enabled;
 
-            // const std::string error_message = "Error in parsing of polygons of at least 5 sides ("
-            //     + std::string(normal_enabled ? "with" : "without") + "normal)\n";
-
             auto& [ vertex_set, uv_coord_set, normal_set, _, _, _ ] = sets;
 
             auto& [ v, vt, vn ] = id;
@@ -417,35 +457,21 @@ struct polygon_manager {
 
             unsigned int cpt = 5;
 
-            // Reading triplets until the end of the line
-            
-            unsigned char ch;
-            while ((not stream.eof()) && ((ch = stream.peek()) != '\n' && ch != '\r')) {
-                
-                int vi = 0, vti = 0, vni = 0;
-                stream >> vi;
-                if (stream.peek() == '/') {
-                    stream.get(); // '/'
-                    if (apply_texture)
-                        stream >> vti;
-                    char d; // receives '/'
-                    if (normal_enabled)
-                        stream >> d >> vni;
-                }
+            for (std::size_t i = 0; i + 2 < other_corners.size(); i += 3) {
+
+                const int vi  = other_corners[i];
+                const int vti = other_corners[i + 1];
+                const int vni = other_corners[i + 2];
 
-                correct(vi, vertex_set.size() - 1);
                 v_stack.push(vi);
+                final.v += vertex_set[vi];
+
                 if (apply_texture) {
-                    correct(vti, uv_coord_set.size() - 1);
                     vt_stack.push(vti);
-                }
-
-                final.v += vertex_set[vi];
-                if (apply_texture)
                     final.vt += uv_coord_set[vti];
+                }
                 
                 if (normal_enabled) {
-                    correct(vni, normal_set.size() - 1);
                     vn_stack.push(vni);
                     final.vn += normal_set[vni];
                 }
@@ -523,130 +549,272 @@ struct polygon_manager {
         }
 };
 
-static void parse_face_declaration(std::istringstream& stream, polygon_manager& poly_manager) {
+/* Records of a chunk of an .obj file, parsed independently of the other chunks */
 
-    static std::string line;
-    static std::istringstream line_stream;
+struct face_record {
+    unsigned int first; // Position of the first (v, vt, vn) triplet in obj_chunk::indices
+    unsigned int nb;    // Number of vertices
+    texturing    texturing_option;
+    normal       normal_option;
 
-    std::getline(stream, line, '\n');
-    line_stream = std::istringstream(std::move(line));
+    /* Numbers of v, vt, vn declared before the face in the chunk, to convert negative indices */
+    unsigned int vertices_before, texture_coords_before, normals_before;
+};
 
-    index_description<5> id;
-    auto& [ v, vt, vn ] = id;
+/* Commands that have to be executed in order with the faces (material and mtl file changes) */
+struct obj_command {
+    enum class type {
+        Usemtl, Mtllib
+    };
 
-    line_stream >> v[0];
+    type             command_type;
+    unsigned int     position; // Number of faces of the chunk declared before the command
+    std::string_view argument; // Points to the mapped file
+};
 
-    enum class face_type {
-        Full, NoTexture, NoNormal, NoTextureNoNormal
-    };
-    using enum face_type;
+struct obj_chunk {
+    std::vector<rt::vector>  vertex_set, uv_coord_set, normal_set;
+    std::vector<face_record> faces;
+    std::vector<int>         indices;
+    std::vector<obj_command> commands;
+    polygon_manager::min_max_dims min_max;
 
-    face_type type = Full;
+    /* Parsing error, rethrown after all the chunks are parsed */
+    std::optional<std::string> error;
+};
 
-    int nb = 1;
-    if (line_stream.peek() == ' ') {
-        type = NoTextureNoNormal;
-        while (nb < 5 && line_stream >> v[nb])
-            nb++;
-    }
-    else {
-        char d1, d2; // receive '/'
-        line_stream.get(); // '/'
-        if (line_stream.peek() == '/') {
-            type = NoTexture;
-            line_stream >> d1 >> vn[0];
-            while (nb < 5 && line_stream >> v[nb] >> d1 >> d2 >> vn[nb])
-                nb++;
+static inline bool is_blank(const char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+/* Advances pt to the next non-blank character of the line */
+static inline void skip_blanks(const char*& pt, const char* end) {
+    while (pt < end && is_blank(*pt))
+        pt++;
+}
+
+/* Parses a value of type T at position pt (after the blanks) and advances pt after it
+   Returns false if there is no value to parse */
+template<typename T>
+requires std::is_arithmetic_v<T>
+static inline bool parse_value(const char*& pt, const char* end, T& value) {
+    skip_blanks(pt, end);
+    const auto [ p, ec ] = std::from_chars(pt, end, value);
+    if (ec != std::errc())
+        return false;
+    pt = p;
+    return true;
+}
+
+/* Parses the next word of the line */
+static inline std::string_view parse_word(const char*& pt, const char* end) {
+    skip_blanks(pt, end);
+    const char* start = pt;
+    while (pt < end && not is_blank(*pt))
+        pt++;
+    return { start, static_cast<std::size_t>(pt - start) };
+}
+
+static void parse_vertex_declaration(const std::string_view keyword, const char* pt, const char* end, obj_chunk& chunk) {
+
+    const std::string error_message = "invalid " + std::string(keyword) + " declaration";
+
+    if (keyword == "vt") {
+        /* Texture UV-coordinates definition (v is optional) */
+
+        double u, v = 0;
+        if (not parse_value(pt, end, u))
+            throw std::runtime_error(error_message);
+        parse_value(pt, end, v);
+
+        if (is_between_zero_and_one(u) && is_between_zero_and_one(v)) [[likely]] {
+            
+            chunk.uv_coord_set.emplace_back(u, v, 0);
         }
         else {
-            line_stream >> vt[0];
-            if (line_stream.peek() == '/') {
-                type = Full;
-                line_stream >> d1 >> vn[0];
-                while (nb < 5 && line_stream >> v[nb] >> d1 >> vt[nb] >> d2 >> vn[nb])
-                    nb++;
-            }
-            else {
-                type = NoNormal;
-                while (nb < 5 && line_stream >> v[nb] >> d1 >> vt[nb])
-                    nb++;
-            }
+            const real nu = (u >= 0) ? 1.0_r : ((u <= (-1.0_r)) ? 0.0_r : 1.0_r + u);
+            const real nv = (v >= 0) ? 1.0_r : ((v <= (-1.0_r)) ? 0.0_r : 1.0_r + v);
+            chunk.uv_coord_set.emplace_back(nu, nv, 0);
         }
+        return;
     }
-    
-    auto& [ _, _, texturing_option, normal_option ] = poly_manager.mapping_params;
-    texturing_option = type == NoTexture || type == NoTextureNoNormal ?
-          texturing::Disabled
-        : texturing::Enabled;
 
-    normal_option = type == NoNormal || type == NoTextureNoNormal ?
-          normal::Disabled
-        : normal::Enabled;
-
-    poly_manager.add_geometry(line_stream, nb, id);
-}
+    /* Vertex or normal definition */
 
-static void parse_vertex_declaration(const std::string& arg, std::istringstream& stream, polygon_manager& poly_manager) {
+    double x, y, z;
+    if (not (parse_value(pt, end, x) && parse_value(pt, end, y) && parse_value(pt, end, z)))
+        throw std::runtime_error(error_message);
 
-    static std::string line;
+    if (keyword == "v") {
+        chunk.vertex_set.emplace_back(x, y, z);
 
-    std::getline(stream, line);
-    const char * buffer = line.data() + 1;
+        /* Updating max dimensions */
+        auto& [ min, max ] = chunk.min_max;
+        min = rt::min(min, chunk.vertex_set.back());
+        max = rt::max(max, chunk.vertex_set.back());
+    }
+    else
+        chunk.normal_set.emplace_back(x, y, z);
+}
 
-    enum class vtype {
-        V, VT, VN
+/* Parses the vertices of a face: v, v/vt, v//vn or v/vt/vn
+   Whether the face is textured and has normals is determined by its first vertex,
+   missing indices are set to 0 (the unused first vector of the sets) */
+static void parse_face_declaration(const char* pt, const char* end, obj_chunk& chunk) {
+
+    auto& [ vertex_set, uv_coord_set, normal_set, faces, indices, _, _, _ ] = chunk;
+
+    face_record face = {
+        .first = static_cast<unsigned int>(indices.size()),
+        .nb    = 0,
+        .texturing_option = texturing::Disabled,
+        .normal_option    = normal::Disabled,
+        .vertices_before       = static_cast<unsigned int>(vertex_set.size()),
+        .texture_coords_before = static_cast<unsigned int>(uv_coord_set.size()),
+        .normals_before        = static_cast<unsigned int>(normal_set.size())
     };
-    using enum vtype;
-    const vtype type = (arg == "v") ? V : (arg == "vt") ? VT : VN;
 
-    auto& [ vertex_set, uv_coord_set, normal_set, _, _, _ ] = poly_manager.sets;
-    auto& [ number_of_vertices, number_of_texture_coords, number_of_normals, _, _, _ ] = poly_manager.counters;
-
-    switch (type) {
-        case V:
-        case VN: {
-            /* Vertex definition */
+    const auto parse_index = [&pt, end] (int& index) {
+        const auto [ p, ec ] = std::from_chars(pt, end, index);
+        if (ec != std::errc())
+            throw std::runtime_error("invalid face declaration");
+        pt = p;
+    };
 
-            const auto [ x, y, z ] = parse<double, 3>(buffer, line.size());
+    int v;
+    while (parse_value(pt, end, v)) {
 
-            if (type == V) {
-                vertex_set.emplace_back(x, y, z);
-                number_of_vertices++;
+        int vt = 0, vn = 0;
+        bool has_vt = false, has_vn = false;
 
-                /* Updating max dimensions */
-                auto& [ min, max ] = poly_manager.min_max;
-                min = rt::min(min, vertex_set.back());
-                max = rt::max(max, vertex_set.back());
+        if (pt < end && *pt == '/') {
+            pt++;
+            if (pt < end && *pt != '/') {
+                parse_index(vt);
+                has_vt = true;
             }
-            else {
-                normal_set.emplace_back(x, y, z);
-                number_of_normals++;
+            if (pt < end && *pt == '/') {
+                pt++;
+                parse_index(vn);
+                has_vn = true;
             }
         }
-        break;
-        
-        case VT: {
-            /* Texture UV-coordinates definition */
 
-            const auto [ u, v ] = parse<double, 2>(buffer, line.size());
+        if (face.nb == 0) {
+            face.texturing_option = has_vt ? texturing::Enabled : texturing::Disabled;
+            face.normal_option    = has_vn ? normal::Enabled    : normal::Disabled;
+        }
 
-            if (is_between_zero_and_one(u) && is_between_zero_and_one(v)) [[likely]] {
-                
-                uv_coord_set.emplace_back(u, v, 0);
-            }
-            else {
-                const real nu = (u >= 0) ? 1.0_r : ((u <= (-1.0_r)) ? 0.0_r : 1.0_r + u);
-                const real nv = (v >= 0) ? 1.0_r : ((v <= (-1.0_r)) ? 0.0_r : 1.0_r + v);
-                uv_coord_set.emplace_back(nu, nv, 0);
-            }
-            number_of_texture_coords++;
-            break;
+        indices.insert(indices.end(), { v, vt, vn });
+        face.nb++;
+    }
+
+    skip_blanks(pt, end);
+    if (pt != end)
+        throw std::runtime_error("invalid face declaration");
+
+    faces.push_back(face);
+}
+
+/* Parses the records of a chunk, line by line
+   Object names (o), polygon groups (g), smooth shading (s), lines (l), parameter space vertices (vp)
+   and comments are ignored */
+static void parse_chunk(const std::string_view text, obj_chunk& chunk) {
+
+    const char* pt        = text.data();
+    const char* const end = text.data() + text.size();
+
+    while (pt < end) {
+
+        const char* line_end = static_cast<const char*>(std::memchr(pt, '\n', end - pt));
+        if (line_end == nullptr)
+            line_end = end;
+
+        const std::string_view keyword = parse_word(pt, line_end);
+
+        if (keyword == "f")
+            parse_face_declaration(pt, line_end, chunk);
+
+        else if (keyword == "v" || keyword == "vt" || keyword == "vn")
+            parse_vertex_declaration(keyword, pt, line_end, chunk);
+
+        else if (keyword == "usemtl" || keyword == "mtllib") {
+            chunk.commands.push_back({
+                .command_type = (keyword == "usemtl") ? obj_command::type::Usemtl : obj_command::type::Mtllib,
+                .position     = static_cast<unsigned int>(chunk.faces.size()),
+                .argument     = parse_word(pt, line_end)
+            });
         }
 
-        default: throw;
+        pt = line_end + 1;
     }
 }
 
+/* Converts the indices of a face (in corners) to positive indices in the merged sets,
+   declared_before containing the numbers of v, vt, vn declared in the chunks before the one of the face
+   The unused indices (vt without texture, vn without normals) are set to 0 */
+static void convert_indices(std::span<int> corners, const face_record& face,
+    const std::array<unsigned int, 3>& declared_before, const sets_container& sets) {
+
+    const bool apply_texture  = face.texturing_option == texturing::Enabled;
+    const bool normal_enabled = face.normal_option    == normal::Enabled;
+
+    const auto& [ vertex_set, uv_coord_set, normal_set, _, _, _ ] = sets;
+
+    const auto convert = [] (int& index, const unsigned int declared, const std::size_t set_size) {
+        correct(index, declared);
+        if (index < 0 || static_cast<std::size_t>(index) >= set_size)
+            throw std::runtime_error("index out of range in face declaration");
+    };
+
+    for (std::size_t i = 0; i < corners.size(); i += 3) {
+
+        auto& v  = corners[i];
+        auto& vt = corners[i + 1];
+        auto& vn = corners[i + 2];
+
+        convert(v, declared_before[0] + face.vertices_before, vertex_set.size());
+
+        if (apply_texture)
+            convert(vt, declared_before[1] + face.texture_coords_before, uv_coord_set.size());
+        else
+            vt = 0;
+
+        if (normal_enabled)
+            convert(vn, declared_before[2] + face.normals_before, normal_set.size());
+        else
+            vn = 0;
+    }
+}
+
+/* Concatenates the v, vt, vn vectors of the chunks, in the order of the file */
+static std::array<std::vector<rt::vector>, 3> merge_sets(std::span<const obj_chunk> chunks) {
+
+    /* Position of the first vectors of each chunk in the merged sets
+       All indices start at 1, so for simplicity we add an unused first vector */
+    std::vector<std::array<std::size_t, 3>> offsets(chunks.size());
+    std::array<std::size_t, 3> offset = { 1, 1, 1 };
+    for (std::size_t c = 0; c < chunks.size(); c++) {
+        offsets[c] = offset;
+        offset[0] += chunks[c].vertex_set.size();
+        offset[1] += chunks[c].uv_coord_set.size();
+        offset[2] += chunks[c].normal_set.size();
+    }
+
+    std::array<std::vector<rt::vector>, 3> out;
+    for (std::size_t s = 0; s < out.size(); s++)
+        out[s].resize(offset[s]);
+
+    parallel_for(chunks.size(), [&] (int c) {
+        const auto& [ vertex_set, uv_coord_set, normal_set, _, _, _, _, _ ] = chunks[c];
+        std::ranges::copy(vertex_set,   out[0].begin() + offsets[c][0]);
+        std::ranges::copy(uv_coord_set, out[1].begin() + offsets[c][1]);
+        std::ranges::copy(normal_set,   out[2].begin() + offsets[c][2]);
+    });
+
+    return out;
+}
+
 static void print_result(const polygon_manager& poly_manager) {
 
     const auto& [ _, _, positioning, sets, counters, _, min_max, _ ] = poly_manager;
@@ -685,33 +853,40 @@ static void print_result(const polygon_manager& poly_manager) {
     }
 }
 
-static std::array<std::vector<rt::vector>, 3> build_sets(const unsigned int expected_size) {
-    
-    /* All indices start at 1, so for simplicity we add an unused first vector */
-
-    std::array<std::vector<rt::vector>, 3> out;
-    for (auto& v : out) {
-        v.reserve(expected_size);
-        v.emplace_back();
-    }
-    return out;
-}
-
 /* Parses .obj file file_name. Triangles and quads are added to obj_set,
 with material indices (defined with the keyword usemtl) found in material_names
 
     - Object names (o), polygon groups (g), smooth shading (s), lines (l) are ignored.
     - The object is scaled with the factor scale, and shifted by the vector shift (members of positioning)
-    - If bounding_enabled, a bounding containing the whole object is placed in output_bd.
-        It contains a hierarchy of bounding boxes, such that the terminal ones contain at most
-        polygons_per_bounding polygons.
+    - If the bvh is enabled, a bounding containing the whole object is placed in output_bd.
+        It contains a hierarchy of bounding boxes, built either by k-means clustering, such that the terminal
+        ones contain polygons_per_bounding polygons on average, or with the surface area heuristic.
 */
 
+/* Builds the hierarchy of a group of polygons with the builder selected in the scene description */
+static const bounding* build_hierarchy(std::vector<const object*>&& content, const bvh_parameters& bvh_params) {
+
+    timer_ms timer;
+    timer.start();
+
+    const bounding* bd = (bvh_params.builder_ == bvh_parameters::builder::SAH) ?
+          create_sah_hierarchy(std::move(content), bvh_params.arity)
+        : create_bounding_hierarchy(std::move(content), bvh_params.polygons_per_bounding);
+
+    timer.stop();
+    if constexpr (DISPLAY_HIERARCHY)
+        display_hierarchy_properties(bd, timer.elapsed());
+
+    return bd;
+}
+
 exit_status parse_obj_file(const std::string& file_name,
     const std::optional<mapping::index_type> default_mapping_index,
     containers& containers, const model_positioning& positioning,
-    const bool bounding_enabled, const unsigned int polygons_per_bounding, const bounding*& output_bd, // Encapsulate
-    const std::optional<real> gamma) {
+    const bvh_parameters& bvh_params, const bounding*& output_bd,
+    const std::optional<real> gamma, const std::optional<std::size_t> number_of_chunks) {
+
+    const bool bounding_enabled = bvh_params.enabled();
 
     printf("Parsing obj file... ");
     fflush(stdout);
@@ -728,67 +903,77 @@ exit_status parse_obj_file(const std::string& file_name,
         object_containers,
         material_wrapper_set,
         _, _, _,
-        orientation_containers
+        orientation_containers,
+        dependencies
     ]
     = containers;
 
-    /* Storage */
-    const unsigned int expected_size = 2 * object_containers.triangle_set.capacity() / 3;
-    auto [ vertex_set, uv_coord_set, normal_set ] = build_sets(expected_size);
-
-    /* Bounding containers
-        content will contain the polygons of a group before being placed in a bounding,
-        which will be added to the children vector
-        At the end, a bounding containing all the ones in bounding is placed in output_bounding */
+    /* Bounding container
+        content will contain the polygons of the object before being placed in a bounding (output_bd) */
     std::vector<const object*> content;
-    std::vector<const bounding*> children;
-
-    polygon_manager poly_manager = {
-        .triangle_set = object_containers.triangle_set,
-        .quad_set     = object_containers.quad_set,
-        .positioning  = positioning,
-        .sets         = {
-            vertex_set, uv_coord_set, normal_set, object_set, content, orientation_containers
-        },
-        .counters = {},
-        .mapping_params = {
-            .current_material_index = 0,
-            .current_mapping_index  = default_mapping_index.value_or(EMPTY_INDEX),
-            .texturing_option       = texturing::Disabled,
-            .normal_option          = normal::Disabled
-        },
-        .min_max = {},
-        .bounding_enabled = bounding_enabled
-    };
 
     try {
 
-        file f(file_name, "rb");
-        const std::vector<unsigned char> buffer = f.extract();
-        f.close();
-
-        std::istringstream stream(reinterpret_cast<const char*>(buffer.data()));
-        std::string arg;
+        const mapped_file f(file_name);
+        const std::vector<std::string_view> chunk_texts = split_in_chunks(text_of(f), number_of_chunks);
 
-        /* Parsing loop */
-        while (stream >> arg) {
+        /* Parallel parsing of the chunks */
+        std::vector<obj_chunk> chunks(chunk_texts.size());
 
-            if (arg == "f") {
-                parse_face_declaration(stream, poly_manager);
+        parallel_for(chunks.size(), [&] (int c) {
+            try {
+                parse_chunk(chunk_texts[c], chunks[c]);
             }
-
-            else if (arg.starts_with("v")) {
-                parse_vertex_declaration(arg, stream, poly_manager);
+            catch (const std::exception& e) {
+                chunks[c].error = e.what();
             }
+        });
+
+        for (const obj_chunk& chunk : chunks)
+            if (chunk.error.has_value())
+                throw std::runtime_error(chunk.error.value());
+
+        /* Storage */
+        auto [ vertex_set, uv_coord_set, normal_set ] = merge_sets(chunks);
+
+        polygon_manager poly_manager = {
+            .triangle_set = object_containers.triangle_set,
+            .quad_set     = object_containers.quad_set,
+            .positioning  = positioning,
+            .sets         = {
+                vertex_set, uv_coord_set, normal_set, object_set, content, orientation_containers
+            },
+            .counters = {
+                .number_of_vertices       = static_cast<unsigned int>(vertex_set.size()   - 1),
+                .number_of_texture_coords = static_cast<unsigned int>(uv_coord_set.size() - 1),
+                .number_of_normals        = static_cast<unsigned int>(normal_set.size()   - 1)
+            },
+            .mapping_params = {
+                .current_material_index = 0,
+                .current_mapping_index  = default_mapping_index.value_or(EMPTY_INDEX),
+                .texturing_option       = texturing::Disabled,
+                .normal_option          = normal::Disabled
+            },
+            .min_max = {},
+            .bounding_enabled = bounding_enabled
+        };
+
+        auto& [ min, max ] = poly_manager.min_max;
+        for (const obj_chunk& chunk : chunks) {
+            min = rt::min(min, chunk.min_max.min);
+            max = rt::max(max, chunk.min_max.max);
+        }
+
+        const auto execute_command = [&] (const obj_command& command) {
 
-            else if (arg == "usemtl") {
+            const std::string argument(command.argument);
+
+            if (command.command_type == obj_command::type::Usemtl) {
 
                 /* Using a new material */
-                std::string m_name;
-                stream >> m_name;
 
                 /* Looking up the material name in the vector of already declared material names */
-                const std::optional<unsigned int> vindex = wrapper<material>::find_element(material_wrapper_set, m_name);
+                const std::optional<unsigned int> vindex = wrapper<material>::find_element(material_wrapper_set, argument);
                 throw_if_nullopt(vindex, "(material reading)");
                 
                 auto& [ current_material_index, current_mapping_index, _, _ ] = poly_manager.mapping_params;
@@ -800,50 +985,55 @@ exit_status parse_obj_file(const std::string& file_name,
                       mt_assoc[current_material_index]
                     : default_mapping_index.value_or(EMPTY_INDEX);
             }
+            else {
 
-            else if (arg == "mtllib") {
-
-                std::string mtl_file_name;
-                stream >> mtl_file_name;
+                dependencies.push_back((path / argument).generic_string());
 
                 const exit_status mtl_parsing_successful =
-                    parse_mtl_file(path, mtl_file_name, material_wrapper_set,
+                    parse_mtl_file(path, argument, material_wrapper_set,
                         containers, mt_assoc, gamma);
                 throw_if_failure(mtl_parsing_successful, "(mtl file loading)");
             }
+        };
 
-            /* Commented line, or ignored command */
-            else if (arg.starts_with("#") || (arg == "s" || arg == "l" || arg == "g" || arg == "o" || arg == "vp")) {
+        /* Sequential addition of the faces, in the order of the file, so that the objects
+           and their orientations are stored in the same order whatever the number of chunks */
 
-                stream.ignore(MAX_LINE_SIZE, '\n');
-            }
+        /* Numbers of v, vt, vn declared in the previous chunks */
+        std::array<unsigned int, 3> declared_before = { 0, 0, 0 };
+        std::vector<int> corners;
 
-            /* New group definition
-                If bounding_enabled is true, the current content vector of polygons
-                is placed in a box that is added to the children vector */
-            else if ((arg == "o" || arg == "g") && not content.empty() && bounding_enabled) {
-
-                // Create a bounding hierarchy containing all the nodes
-                /* Heuristic: each group is a depth 1 node in the global bounding box hierarchy */
-                const bounding* bd = create_bounding_hierarchy(std::move(content), polygons_per_bounding);
-                if constexpr (DISPLAY_HIERARCHY)
-                    display_hierarchy_properties(bd);
-                children.push_back(bd);
-                content.clear();
+        for (const obj_chunk& chunk : chunks) {
+
+            auto next_command = chunk.commands.begin();
+            const auto execute_commands_until = [&] (const unsigned int position) {
+                for (; next_command != chunk.commands.end() && next_command->position <= position; next_command++)
+                    execute_command(*next_command);
+            };
+
+            for (unsigned int i = 0; const face_record& face : chunk.faces) {
+
+                execute_commands_until(i++);
+
+                auto& [ _, _, texturing_option, normal_option ] = poly_manager.mapping_params;
+                texturing_option = face.texturing_option;
+                normal_option    = face.normal_option;
+
+                corners.assign(chunk.indices.begin() + face.first, chunk.indices.begin() + face.first + 3 * face.nb);
+                convert_indices(corners, face, declared_before, poly_manager.sets);
+
+                poly_manager.add_geometry(corners);
             }
+            execute_commands_until(chunk.faces.size());
+
+            declared_before[0] += chunk.vertex_set.size();
+            declared_before[1] += chunk.uv_coord_set.size();
+            declared_before[2] += chunk.normal_set.size();
         }
         
         if (bounding_enabled) [[likely]] {
-            /* Placing the last group into a bounding */
-            const bounding* bd = create_bounding_hierarchy(std::move(content), polygons_per_bounding);
-            if constexpr (DISPLAY_HIERARCHY)
-                display_hierarchy_properties(bd);
-            children.push_back(bd);
-
             /* Computing the final bounding */
-            output_bd = (children.size() == 1) ?
-                  children[0]
-                : create_hierarchy_from_boundings(std::move(children));
+            output_bd = build_hierarchy(std::move(content), bvh_params);
         }
 
         printf("\r%s successfully loaded:\n", file_name.c_str());
@@ -856,4 +1046,4 @@ exit_status parse_obj_file(const std::string& file_name,
         printf("%s\n", e.what());
         return exit_status::Failure;
     }
-}
\ No newline at end of file
+}
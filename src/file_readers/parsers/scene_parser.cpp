@@ -1,6 +1,7 @@
 #include "file_readers/parsers/scene_parser.hpp"
 
 #include "file_readers/parsers/obj_parser.hpp"
+#include "file_readers/parsers/scene_snapshot.hpp"
 
 #include "file_readers/file.hpp"
 #include "auxiliary/utils.hpp"
@@ -219,7 +220,7 @@ static bg_parsing_result parse_background(const file& f) {
             throw std::runtime_error("parsing error in scene constructor (background texture parsing)");
         }           
         
-        printf("\r> %s texture loaded\n", bg_tfile_name_short.c_str());
+        printf("\r> %s texture loaded (%s)\n", bg_tfile_name_short.c_str(), background_texture.memory_report().c_str());
         background_texture_is_set = true;
     }
 
@@ -234,25 +235,43 @@ static bg_parsing_result parse_background(const file& f) {
     };
 }
 
-static unsigned int parse_bvh(const file& f) {
+static bvh_parameters parse_bvh(const file& f) {
     
     /*
         polygons_per_bounding 10 //specifying 0 will deactivate the bounding generation
         or
         bvh: polygons_per_bounding 10
         or
+        bvh: sah
+        or
+        bvh: sah arity 4
+        or
         bvh: disabled
     */
     f.skip_whitespace();
     f.scanf_rewind_if_failure("bvh: ");
-    unsigned int polygons_per_bounding = 0;
-    const exit_status status = f.scanf("polygons_per_bounding %u\n", polygons_per_bounding);
+    bvh_parameters params;
+
+    if (exit_status::Success == f.scanf_rewind_if_failure("sah")) {
+        params.builder_ = bvh_parameters::builder::SAH;
+        unsigned int arity = 2;
+        if (exit_status::Success == f.scanf_rewind_if_failure(" arity %u", arity)) {
+            if (arity != 2 && arity != 4)
+                throw std::runtime_error("parsing error in scene constructor (BVH arity should be 2 or 4)");
+            params.arity = arity;
+        }
+        return params;
+    }
+
+    const exit_status status = f.scanf("polygons_per_bounding %u\n", params.polygons_per_bounding);
     if (status == exit_status::Failure) {
         throw_if_failure(f.scanf("disabled"),
             "parsing error in scene constructor (BVH parameters)");
     }
+    else if (params.polygons_per_bounding != 0)
+        params.builder_ = bvh_parameters::builder::KMeans;
 
-    return polygons_per_bounding;
+    return params;
 }
 
 /* Auxiliary function: returns a material from a description file */
@@ -579,7 +598,8 @@ static void parse_mapping(const file& f, const std::optional<real> inverse_gamma
         composition_wrapper_set,
         texture_set,
         normal_map_set,
-        _
+        _,
+        dependencies
     ]
     = containers;
 
@@ -631,20 +651,24 @@ static void parse_mapping(const file& f, const std::optional<real> inverse_gamma
         if (tfile_name.length() == 0)
             throw std::runtime_error("parsing error in mapping definition " + type_str + ")");
         const std::string tfile_name_short = std::filesystem::path(tfile_name).filename().generic_string();
+        dependencies.push_back(tfile_name);
         
         printf("Parsing %s...", tfile_name.c_str());
         fflush(stdout);
 
         try {
+            std::string report;
             switch (type_) {
                 case Texture: {
-                    texture_set.emplace_back(tfile_name, inverse_gamma);
+                    const texture& t = texture_set.emplace_back(tfile_name, inverse_gamma);
                     comp.has_texture = true;
+                    report = " (" + t.memory_report() + ")";
                     break;
                 }
                 case Normal_map: {
-                    normal_map_set.emplace_back(tfile_name);
+                    const normal_map& nm = normal_map_set.emplace_back(tfile_name);
                     comp.has_normal_map = true;
+                    report = " (" + nm.memory_report() + ")";
                     break;
                 }
                 // ...
@@ -654,8 +678,8 @@ static void parse_mapping(const file& f, const std::optional<real> inverse_gamma
                     throw;
             }
 
-            printf("\r> %s %s loaded                                                     \n",
-                tfile_name_short.c_str(), type_str.c_str());
+            printf("\r> %s %s loaded%s                                                     \n",
+                tfile_name_short.c_str(), type_str.c_str(), report.c_str());
         }
         catch (const std::exception& e) {
             printf("%s %s reading failed\n", tfile_name_short.c_str(), type_str.c_str());
@@ -701,9 +725,9 @@ static triangle::orientation parse_triangle_orientation(const file& f,
         throw std::runtime_error("parsing error in parse_texture_info (triangle UV-coordinates)\n");
 
     return triangle::orientation(index, { uvcoord
-        { u0, 1.0_r - v0 },
-        { u1, 1.0_r - v1 },
-        { u2, 1.0_r - v2 } },
+        { static_cast<real>(u0), static_cast<real>(1.0 - v0) },
+        { static_cast<real>(u1), static_cast<real>(1.0 - v1) },
+        { static_cast<real>(u2), static_cast<real>(1.0 - v2) } },
         tr_v1, tr_v2
     );
 }
@@ -724,10 +748,10 @@ static quad::orientation parse_quad_orientation(const file& f,
     }
 
     return quad::orientation(index, { uvcoord
-        { u0, 1.0_r - v0 },
-        { u1, 1.0_r - v1 },
-        { u2, 1.0_r - v2 },
-        { u3, 1.0_r - v3 } },
+        { static_cast<real>(u0), static_cast<real>(1.0 - v0) },
+        { static_cast<real>(u1), static_cast<real>(1.0 - v1) },
+        { static_cast<real>(u2), static_cast<real>(1.0 - v2) },
+        { static_cast<real>(u3), static_cast<real>(1.0 - v3) } },
         q_v1, q_v2
     );
 }
@@ -841,7 +865,7 @@ static void parse_objects(const file& f, const object_type type, const std::stri
             
             parameters.sphere = {
                 .center = rt::vector(posx, posy, posz),
-                .radius = r
+                .radius = static_cast<real>(r)
             };
             break;
         }
@@ -871,7 +895,7 @@ static void parse_objects(const file& f, const object_type type, const std::stri
                 .center = rt::vector(cx, cy, cz),
                 .x_axis = rt::vector(n1x, n1y, n1z).unit(),
                 .y_axis = rt::vector(n2x, n2y, n2z).unit(),
-                .l      = { lx, ly, lz }
+                .l      = { static_cast<real>(lx), static_cast<real>(ly), static_cast<real>(lz) }
             };
             break;
         }
@@ -886,8 +910,8 @@ static void parse_objects(const file& f, const object_type type, const std::stri
             parameters.cylinder = {
                 .origin    = rt::vector(px, py, pz),
                 .direction = rt::vector(d_x, d_y, d_z).unit(),
-                .radius    = r,
-                .length    = l
+                .radius    = static_cast<real>(r),
+                .length    = static_cast<real>(l)
             };
             break;
         }
@@ -905,7 +929,8 @@ static void parse_objects(const file& f, const object_type type, const std::stri
         composition_wrapper_set,
         texture_set,
         normal_map_set,
-        orientation_containers
+        orientation_containers,
+        _
     ]
     = containers;
 
@@ -1087,7 +1112,7 @@ static parse_load_obj_result parse_load_obj(
 
 /** Scene description parser **/
 
-std::optional<scene> parse_scene_descriptor(const std::string& file_name) {
+std::optional<scene> parse_scene_descriptor(const std::string& file_name, const snapshot_mode snapshot) {
 
     timer_ms timer;
     timer.start();
@@ -1098,11 +1123,67 @@ std::optional<scene> parse_scene_descriptor(const std::string& file_name) {
 
         file f(file_name, "rb");
 
-        const scene::pre_parsing_info pre_parsing_info = pre_parse(f);
         auto [ width, height ] = parse_resolution(f);
         camera cam = parse_camera(f, width, height);
+
+        /* The rest of the description is the part stored in the snapshot:
+           the camera can be modified without invalidating it */
+        const std::size_t description_position = f.position();
         auto [ background, inverse_gamma ] = parse_background(f);
-        unsigned int polygons_per_bounding = parse_bvh(f);
+        const bvh_parameters bvh_params = parse_bvh(f);
+
+        const std::optional<real> gamma = (inverse_gamma.has_value()) ?
+              std::optional(1.0_r / inverse_gamma.value())
+            : std::nullopt;
+
+        const bool snapshot_enabled = snapshot == snapshot_mode::Enabled;
+        const std::string snapshot_name = scene_snapshot::file_name_of(file_name);
+        const uint64_t description_hash = snapshot_enabled ?
+              scene_snapshot::hash_description(file_name, description_position)
+            : 0;
+
+        if (snapshot_enabled) {
+            std::optional<scene_snapshot::content> content = scene_snapshot::load(snapshot_name, description_hash);
+
+            if (content.has_value()) {
+                auto& [
+                    object_set, bounding_set, object_containers,
+                    material_set, comp_set, texture_set, normal_map_set,
+                    orientation_containers
+                ] = content.value();
+
+                scene::containers::mapping mapping_containers(
+                    std::move(material_set),
+                    std::move(comp_set),
+                    std::move(texture_set),
+                    std::move(normal_map_set),
+                    std::move(background)
+                );
+
+                scene_opt.emplace(
+                    std::move(object_set),
+                    std::move(bounding_set),
+                    std::move(object_containers),
+                    std::move(mapping_containers),
+                    std::move(orientation_containers),
+                    std::move(cam),
+                    width, height,
+                    bvh_params,
+                    gamma
+                );
+
+                timer.stop();
+                printf("Scene loading: ");
+                timer.print();
+                return scene_opt;
+            }
+        }
+
+        // The pre-parsing goes through the whole file, and rewinds it to the beginning
+        const std::size_t header_end = f.position();
+        f.rewind();
+        const scene::pre_parsing_info pre_parsing_info = pre_parse(f);
+        f.seek(header_end);
 
         std::vector<const object*> object_set;
         object_set.reserve(pre_parsing_info.max_objects());
@@ -1125,12 +1206,14 @@ std::optional<scene> parse_scene_descriptor(const std::string& file_name) {
 
         std::vector<const bounding*> bounding_set;
 
+        std::vector<std::string> dependencies;
+
         /* Bounding handling */
         /* When bvh is disabled, the objects that are not defined in an obj file are placed in
         the vector other_content. At the end, these objects are placed in a bounding alongside the ones generated during obj files parsing */
         std::vector<const object*> other_content;
         other_content.reserve(pre_parsing_info.total_non_polygon_objects());
-        const bool bounding_enabled = polygons_per_bounding != 0;
+        const bool bounding_enabled = bvh_params.enabled();
 
         containers containers = {
             object_set,
@@ -1140,7 +1223,8 @@ std::optional<scene> parse_scene_descriptor(const std::string& file_name) {
             composition_wrapper_set,
             texture_set,
             normal_map_set,
-            orientation_containers
+            orientation_containers,
+            dependencies
         };
 
         /* Parsing loop */
@@ -1204,12 +1288,13 @@ std::optional<scene> parse_scene_descriptor(const std::string& file_name) {
             if (arg == "load_obj") {
                 
                 const auto& [ ofile_name, m_index, positioning ] = parse_load_obj(f, composition_wrapper_set);
+                dependencies.push_back(ofile_name);
 
                 const bounding* output_bd = nullptr;
                 const exit_status status_obj =
                     parse_obj_file(ofile_name, m_index,
                         containers, positioning,
-                        bounding_enabled, polygons_per_bounding, output_bd,
+                        bvh_params, output_bd,
                         inverse_gamma);
 
                 throw_if_failure(status_obj, ofile_name + " obj file reading failed\n");
@@ -1245,10 +1330,6 @@ std::optional<scene> parse_scene_descriptor(const std::string& file_name) {
             std::move(background)
         );
 
-        const std::optional<real> gamma = (inverse_gamma.has_value()) ?
-              std::optional(1.0_r / inverse_gamma.value())
-            : std::nullopt;
-
         scene_opt.emplace(
             std::move(object_set),
             std::move(bounding_set),
@@ -1257,9 +1338,12 @@ std::optional<scene> parse_scene_descriptor(const std::string& file_name) {
             std::move(orientation_containers),
             std::move(cam),
             width, height,
-            polygons_per_bounding,
+            bvh_params,
             gamma
         );
+
+        if (snapshot_enabled)
+            scene_snapshot::save(snapshot_name, description_hash, dependencies, scene_opt.value());
     }
     catch (const std::exception& e) {
         printf("Error during scene parsing: ");
@@ -0,0 +1,612 @@
+#include "file_readers/parsers/scene_snapshot.hpp"
+
+#include "file_readers/file.hpp"
+#include "file_readers/mapped_file.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+
+static constexpr std::array<char, 8> MAGIC = { 'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0' };
+
+static_assert(std::is_same_v<bounding::box_type, aabb>, "The snapshot only stores aabbs");
+
+/*** Hashing ***/
+
+/* 64-bit multiply-xorshift hash over 8-byte words: not cryptographic, only meant to detect changes */
+static uint64_t hash_bytes(const std::span<const std::byte> bytes) {
+
+    constexpr uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ull;
+
+    uint64_t h = bytes.size() * MULTIPLIER;
+    const auto mix = [&h] (const uint64_t word) {
+        h = (h ^ word) * MULTIPLIER;
+        h ^= h >> 32;
+    };
+
+    const std::size_t number_of_words = bytes.size() / 8;
+    for (std::size_t i = 0; i < number_of_words; i++) {
+        uint64_t word;
+        std::memcpy(&word, bytes.data() + 8 * i, 8);
+        mix(word);
+    }
+
+    const std::size_t remainder = bytes.size() % 8;
+    if (remainder != 0) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes.data() + 8 * number_of_words, remainder);
+        mix(word);
+    }
+
+    return h;
+}
+
+static uint64_t hash_file(const std::string& file_name) {
+    const mapped_file mapped(file_name);
+    return hash_bytes(mapped.content());
+}
+
+static int64_t modification_time(const std::string& file_name) {
+    return static_cast<int64_t>(std::filesystem::last_write_time(file_name).time_since_epoch().count());
+}
+
+std::string scene_snapshot::file_name_of(const std::string& file_name) {
+    return std::filesystem::path(file_name).replace_extension(".rtscene").generic_string();
+}
+
+uint64_t scene_snapshot::hash_description(const std::string& file_name, const std::size_t offset) {
+    const mapped_file mapped(file_name);
+    const std::span<const std::byte> content = mapped.content();
+    return hash_bytes(content.subspan(std::min(offset, content.size())));
+}
+
+/*** Reading and writing ***/
+
+/* Sequential reader of the mapped snapshot, throwing if the end of the file is reached */
+class snapshot_reader {
+
+    private:
+        std::span<const std::byte> data;
+        std::size_t position = 0;
+
+    public:
+        explicit snapshot_reader(const std::span<const std::byte> data)
+            : data(data) {}
+
+        std::span<const std::byte> bytes(const std::size_t size) {
+            if (size > data.size() - position)
+                throw std::runtime_error("truncated file");
+            const std::span<const std::byte> s = data.subspan(position, size);
+            position += size;
+            return s;
+        }
+
+        template<typename T>
+        requires std::is_trivially_copyable_v<T>
+        void read(T& x) {
+            std::memcpy(static_cast<void*>(&x), bytes(sizeof(T)).data(), sizeof(T));
+        }
+
+        template<typename T>
+        T read() {
+            T x;
+            read(x);
+            return x;
+        }
+
+        template<typename T>
+        requires std::is_trivially_copyable_v<T>
+        void read(const std::span<T> s) {
+            if (not s.empty())
+                std::memcpy(static_cast<void*>(s.data()), bytes(s.size_bytes()).data(), s.size_bytes());
+        }
+
+        std::string read_string() {
+            const std::span<const std::byte> s = bytes(read<uint32_t>());
+            return std::string(reinterpret_cast<const char*>(s.data()), s.size());
+        }
+};
+
+template<typename T>
+requires std::is_trivially_copyable_v<T>
+static void write_value(const file& f, const T& x) {
+    throw_if_failure(f.write(std::span<const T>(&x, 1)), "writing error");
+}
+
+template<typename T>
+requires std::is_trivially_copyable_v<T>
+static void write_array(const file& f, const std::span<const T> s) {
+    if (not s.empty())
+        throw_if_failure(f.write(s), "writing error");
+}
+
+static void write_string(const file& f, const std::string& s) {
+    write_value(f, static_cast<uint32_t>(s.size()));
+    write_array(f, std::span<const char>(s));
+}
+
+/* Sets of trivially copyable classes (materials, compositions, orientations), stored as they are in memory */
+template<typename T>
+static void write_trivial_set(const file& f, const std::vector<T>& set) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    write_value(f, static_cast<uint64_t>(set.size()));
+    write_array(f, std::span<const T>(set));
+}
+
+/* The classes without default constructor (orientations) are first constructed
+   with the arbitrary parameters placeholder_args, then overwritten with the stored bytes */
+template<typename T, typename... Args>
+static void read_trivial_set(snapshot_reader& reader, std::vector<T>& set, const Args&... placeholder_args) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const uint64_t count = reader.read<uint64_t>();
+    set.reserve(count);
+    for (uint64_t i = 0; i < count; i++) {
+        T& x = set.emplace_back(placeholder_args...);
+        reader.read(std::span<T>(&x, 1));
+    }
+}
+
+/*** Objects ***/
+
+template<typename T>
+auto scene_snapshot::fields(T& obj) {
+
+    using type = std::remove_const_t<T>;
+
+    if constexpr (std::is_same_v<type, triangle>)
+        return std::tie(obj.position, obj.material_index, obj.orientation_info_index,
+            obj.normal, obj.v1, obj.v2, obj.vn0, obj.dvn1, obj.dvn2, obj.d, obj.det, obj.case_det);
+
+    else if constexpr (std::is_same_v<type, quad>)
+        return std::tie(obj.position, obj.material_index, obj.orientation_info_index,
+            obj.normal, obj.v1, obj.v2, obj.v3, obj.vn0, obj.dvn1, obj.dvn2, obj.dvn3,
+            obj.d, obj.det12, obj.det23, obj.case_det, obj.ratio);
+
+    else if constexpr (std::is_same_v<type, sphere>)
+        return std::tie(obj.position, obj.material_index, obj.orientation_info_index,
+            obj.radius, obj.radius_sq);
+
+    else if constexpr (std::is_same_v<type, plane>)
+        return std::tie(obj.position, obj.material_index, obj.orientation_info_index,
+            obj.normal, obj.d);
+
+    else if constexpr (std::is_same_v<type, box>)
+        return std::tie(obj.position, obj.material_index, obj.orientation_info_index,
+            obj.n1, obj.n2, obj.n3, obj.l1, obj.l2, obj.l3);
+
+    else if constexpr (std::is_same_v<type, cylinder>)
+        return std::tie(obj.position, obj.material_index, obj.orientation_info_index,
+            obj.direction, obj.radius, obj.length);
+}
+
+template<typename Obj>
+void scene_snapshot::write_objects(const file& f, const std::vector<Obj>& set) {
+
+    // The fields of all the objects are packed in one buffer, written at once
+    std::vector<std::byte> buffer;
+    std::size_t position = 0;
+
+    for (const Obj& obj : set) {
+        std::apply([&] (const auto&... x) {
+            buffer.resize(position + (sizeof(x) + ...));
+            ((std::memcpy(buffer.data() + position, &x, sizeof(x)), position += sizeof(x)), ...);
+        }, fields(obj));
+    }
+
+    write_array(f, std::span<const std::byte>(buffer));
+}
+
+/* Objects constructed with arbitrary parameters, then overwritten with the stored fields */
+template<typename Obj>
+static Obj& emplace_placeholder(std::vector<Obj>& set) {
+    if      constexpr (std::is_same_v<Obj, triangle>) return set.emplace_back(rt::ZERO, rt::RIGHT, rt::UP, 0);
+    else if constexpr (std::is_same_v<Obj, quad>)     return set.emplace_back(rt::ZERO, rt::RIGHT, rt::RIGHT + rt::UP, rt::UP, 0);
+    else if constexpr (std::is_same_v<Obj, sphere>)   return set.emplace_back(rt::ZERO, 1.0_r, 0);
+    else if constexpr (std::is_same_v<Obj, plane>)    return set.emplace_back(rt::UP, rt::ZERO, 0);
+    else if constexpr (std::is_same_v<Obj, box>)      return set.emplace_back(rt::ZERO, rt::RIGHT, rt::UP, 1.0_r, 1.0_r, 1.0_r, 0);
+    else if constexpr (std::is_same_v<Obj, cylinder>) return set.emplace_back(rt::ZERO, rt::UP, 1.0_r, 1.0_r, 0);
+}
+
+template<typename Obj>
+void scene_snapshot::read_objects(snapshot_reader& reader, std::vector<Obj>& set, const std::size_t count) {
+
+    // The objects are referenced by pointers: the container must not be reallocated afterwards
+    set.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        Obj& obj = emplace_placeholder(set);
+        std::apply([&] (auto&... x) { (reader.read(x), ...); }, fields(obj));
+    }
+}
+
+/* The objects are referenced by their index in the concatenation of the object containers
+   (triangles, quads, spheres, planes, boxes, cylinders) */
+class object_indexer {
+
+    private:
+        const scene::containers::object& containers;
+
+        template<typename Obj>
+        bool search(const std::vector<Obj>& set, const object* obj, uint32_t& offset) const {
+            const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(obj);
+            const std::uintptr_t begin   = reinterpret_cast<std::uintptr_t>(static_cast<const object*>(set.data()));
+            if (address >= begin && address < begin + set.size() * sizeof(Obj)) {
+                offset += (address - begin) / sizeof(Obj);
+                return true;
+            }
+            offset += set.size();
+            return false;
+        }
+
+        template<typename Obj>
+        static bool select(const std::vector<Obj>& set, uint32_t& index, const object*& obj) {
+            if (index < set.size()) {
+                obj = &set[index];
+                return true;
+            }
+            index -= set.size();
+            return false;
+        }
+
+    public:
+        explicit object_indexer(const scene::containers::object& containers)
+            : containers(containers) {}
+
+        uint32_t index_of(const object* obj) const {
+            const auto& [ triangle_set, quad_set, sphere_set, plane_set, box_set, cylinder_set ] = containers;
+            uint32_t index = 0;
+            const bool found =
+                   search(triangle_set, obj, index) || search(quad_set,  obj, index)
+                || search(sphere_set,   obj, index) || search(plane_set, obj, index)
+                || search(box_set,      obj, index) || search(cylinder_set, obj, index);
+            if (not found)
+                throw std::runtime_error("object outside of the containers");
+            return index;
+        }
+
+        const object* object_at(uint32_t index) const {
+            const auto& [ triangle_set, quad_set, sphere_set, plane_set, box_set, cylinder_set ] = containers;
+            const object* obj = nullptr;
+            const bool found =
+                   select(triangle_set, index, obj) || select(quad_set,  index, obj)
+                || select(sphere_set,   index, obj) || select(plane_set, index, obj)
+                || select(box_set,      index, obj) || select(cylinder_set, index, obj);
+            if (not found)
+                throw std::runtime_error("incorrect object index");
+            return obj;
+        }
+};
+
+/*** Bounding hierarchy ***/
+
+/* The constructor of the aabbs halves the dimensions when the position is the center */
+static std::unique_ptr<bounding::box_type> make_box(const rt::vector& position, const rt::vector& dims) {
+    if constexpr (aabb::type_ == aabb::type::Center)
+        return std::make_unique<aabb>(position, dims * 2.0_r);
+    else
+        return std::make_unique<aabb>(position, dims);
+}
+
+static void write_bounding(const file& f, const bounding* bd, const object_indexer& indexer) {
+
+    const bool terminal = bd->type == bounding::TerminalNode;
+    write_value(f, static_cast<uint8_t>(terminal));
+    write_value(f, static_cast<uint8_t>(bd->b != nullptr));
+    if (bd->b != nullptr) {
+        write_value(f, bd->b->get_stored_position());
+        write_value(f, bd->b->get_dims());
+    }
+
+    if (terminal) {
+        const std::vector<const object*>& content = bd->get_content();
+        std::vector<uint32_t> indices(content.size());
+        std::ranges::transform(content, indices.begin(), [&] (const object* obj) { return indexer.index_of(obj); });
+        write_value(f, static_cast<uint64_t>(indices.size()));
+        write_array(f, std::span<const uint32_t>(indices));
+    }
+    else {
+        const std::span<const bounding * const> children = bd->get_children();
+        write_value(f, static_cast<uint64_t>(children.size()));
+        for (const bounding* child : children)
+            write_bounding(f, child, indexer);
+    }
+}
+
+/* Roots of the hierarchies read so far, which are destroyed if the rest of the file is incorrect:
+   the children of a node are removed from owned once the node is created, so that each bounding is owned once */
+static const bounding* read_bounding(snapshot_reader& reader, const object_indexer& indexer,
+    std::vector<const bounding*>& owned) {
+
+    const bool terminal = reader.read<uint8_t>() != 0;
+    const bool has_box  = reader.read<uint8_t>() != 0;
+
+    std::unique_ptr<bounding::box_type> b = nullptr;
+    if (has_box) {
+        rt::vector position, dims;
+        reader.read(position);
+        reader.read(dims);
+        b = make_box(position, dims);
+    }
+
+    const uint64_t count = reader.read<uint64_t>();
+    const bounding* bd;
+
+    if (terminal) {
+        std::vector<uint32_t> indices(count);
+        reader.read(std::span<uint32_t>(indices));
+        std::vector<const object*> content(count);
+        std::ranges::transform(indices, content.begin(), [&] (const uint32_t index) { return indexer.object_at(index); });
+        bd = new bounding(std::move(content), std::move(b));
+    }
+    else {
+        const std::size_t first_child = owned.size();
+        for (uint64_t i = 0; i < count; i++)
+            read_bounding(reader, indexer, owned);
+        std::vector<const bounding*> children(owned.begin() + first_child, owned.end());
+        bd = new bounding(std::move(children), std::move(b));
+        owned.resize(first_child);
+    }
+
+    owned.push_back(bd);
+    return bd;
+}
+
+/* Destruction of the hierarchies of roots (as in the destructor of the scene) */
+static void delete_hierarchies(const std::span<const bounding* const> roots) {
+    std::vector<const bounding*> stack(roots.begin(), roots.end());
+    while (not stack.empty()) {
+        const bounding* bd = stack.back();
+        stack.pop_back();
+        const std::span<const bounding * const> children = bd->get_children();
+        stack.insert(stack.end(), children.begin(), children.end());
+        delete bd;
+    }
+}
+
+/*** Snapshot ***/
+
+exit_status scene_snapshot::save(const std::string& snapshot_name, const uint64_t description_hash,
+    const std::span<const std::string> dependency_names, const scene& scn) {
+
+    const std::string temporary_name = snapshot_name + ".tmp";
+
+    try {
+
+        std::vector<std::string> names(dependency_names.begin(), dependency_names.end());
+        std::ranges::sort(names);
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+
+        {
+            file f(temporary_name, "wb");
+
+            /* Header */
+            write_array(f, std::span<const char>(MAGIC));
+            write_value(f, VERSION);
+            write_value(f, static_cast<uint32_t>(sizeof(real)));
+            write_value(f, static_cast<uint32_t>(sizeof(rt::color)));
+            const std::size_t total_size_position = f.position();
+            write_value(f, static_cast<uint64_t>(0));
+            write_value(f, description_hash);
+
+            write_value(f, static_cast<uint64_t>(names.size()));
+            for (const std::string& name : names) {
+                write_string(f, name);
+                write_value(f, static_cast<uint64_t>(std::filesystem::file_size(name)));
+                write_value(f, modification_time(name));
+                write_value(f, hash_file(name));
+            }
+
+            const auto& [ triangle_set, quad_set, sphere_set, plane_set, box_set, cylinder_set ] = scn.object_containers;
+            for (const std::size_t size : { triangle_set.size(), quad_set.size(), sphere_set.size(),
+                    plane_set.size(), box_set.size(), cylinder_set.size() })
+                write_value(f, static_cast<uint64_t>(size));
+
+            /* Materials and mappings */
+            const auto& [ material_set, composition_set, texture_set, normal_map_set, _ ] = scn.mapping_containers;
+            write_trivial_set(f, material_set);
+            write_trivial_set(f, composition_set);
+
+            write_value(f, static_cast<uint64_t>(texture_set.size()));
+            for (const texture& t : texture_set) {
+                write_value(f, static_cast<uint8_t>(t.format));
+                write_value(f, static_cast<uint32_t>(t.width));
+                write_value(f, static_cast<uint32_t>(t.height));
+                write_array(f, std::span<const float>(t.component_table));
+                write_array(f, std::span<const uint8_t>(t.texels));
+            }
+
+            write_value(f, static_cast<uint64_t>(normal_map_set.size()));
+            for (const normal_map& nm : normal_map_set) {
+                // The normal maps of the mappings without normal map are empty
+                write_value(f, static_cast<uint32_t>(nm.width));
+                write_value(f, static_cast<uint32_t>(nm.height));
+                write_array(f, std::span<const normal_map::encoded_normal>(nm.data));
+            }
+
+            /* Orientations */
+            const auto& orientations = scn.orientation_containers;
+            write_trivial_set(f, orientations.triangle_orientation_set);
+            write_trivial_set(f, orientations.quad_orientation_set);
+            write_trivial_set(f, orientations.sphere_orientation_set);
+            write_trivial_set(f, orientations.plane_orientation_set);
+            static_assert(TODO_BOX_TEXTURING);
+            static_assert(TODO_CYLINDER_TEXTURING);
+
+            /* Objects */
+            write_objects(f, triangle_set);
+            write_objects(f, quad_set);
+            write_objects(f, sphere_set);
+            write_objects(f, plane_set);
+            write_objects(f, box_set);
+            write_objects(f, cylinder_set);
+
+            const object_indexer indexer(scn.object_containers);
+            std::vector<uint32_t> object_indices(scn.object_set.size());
+            std::ranges::transform(scn.object_set, object_indices.begin(), [&] (const object* obj) { return indexer.index_of(obj); });
+            write_value(f, static_cast<uint64_t>(object_indices.size()));
+            write_array(f, std::span<const uint32_t>(object_indices));
+
+            /* Bounding hierarchy */
+            write_value(f, static_cast<uint64_t>(scn.bounding_set.size()));
+            for (const bounding* bd : scn.bounding_set)
+                write_bounding(f, bd, indexer);
+
+            // The total size detects the files truncated by an interrupted copy
+            const uint64_t total_size = f.position();
+            f.seek(total_size_position);
+            write_value(f, total_size);
+        }
+
+        // Replaces the previous snapshot only once the new one is complete
+        std::filesystem::rename(temporary_name, snapshot_name);
+        printf("> %s snapshot written\n", std::filesystem::path(snapshot_name).filename().generic_string().c_str());
+        return exit_status::Success;
+    }
+    catch (const std::exception& e) {
+        printf("Scene snapshot could not be written: %s\n", e.what());
+    }
+    catch (...) {
+        printf("Scene snapshot could not be written\n");
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(temporary_name, ec);
+    return exit_status::Failure;
+}
+
+std::optional<scene_snapshot::content> scene_snapshot::load(const std::string& snapshot_name, const uint64_t description_hash) {
+
+    if (not std::filesystem::is_regular_file(snapshot_name))
+        return std::nullopt;
+
+    std::vector<const bounding*> owned;
+
+    try {
+
+        const mapped_file mapped(snapshot_name);
+        snapshot_reader reader(mapped.content());
+
+        /* Header */
+        std::array<char, 8> magic;
+        reader.read(std::span<char>(magic));
+        if (magic != MAGIC)
+            throw std::runtime_error("not a scene snapshot");
+
+        if (   reader.read<uint32_t>() != VERSION
+            || reader.read<uint32_t>() != sizeof(real)
+            || reader.read<uint32_t>() != sizeof(rt::color))
+            throw std::runtime_error("written by another version");
+
+        if (reader.read<uint64_t>() != mapped.size())
+            throw std::runtime_error("incorrect file size");
+
+        if (reader.read<uint64_t>() != description_hash)
+            throw std::runtime_error("scene description modified");
+
+        const uint64_t number_of_dependencies = reader.read<uint64_t>();
+        for (uint64_t i = 0; i < number_of_dependencies; i++) {
+            const std::string name = reader.read_string();
+            const uint64_t size    = reader.read<uint64_t>();
+            const int64_t  time    = reader.read<int64_t>();
+            const uint64_t hash    = reader.read<uint64_t>();
+
+            // The hash is only computed when the modification time differs
+            const bool unchanged = std::filesystem::is_regular_file(name)
+                && std::filesystem::file_size(name) == size
+                && (modification_time(name) == time || hash_file(name) == hash);
+            if (not unchanged)
+                throw std::runtime_error(name + " modified");
+        }
+
+        std::array<uint64_t, 6> sizes;
+        reader.read(std::span<uint64_t>(sizes));
+        const auto [ triangles, quads, spheres, planes, boxes, cylinders ] = sizes;
+
+        scene::pre_parsing_info ppi;
+        ppi.triangles = triangles;
+        ppi.quads     = quads;
+        ppi.spheres   = spheres;
+        ppi.planes    = planes;
+        ppi.boxes     = boxes;
+        ppi.cylinders = cylinders;
+
+        std::optional<content> c_opt(std::in_place, ppi);
+        content& c = c_opt.value();
+
+        /* Materials and mappings */
+        read_trivial_set(reader, c.material_set);
+        read_trivial_set(reader, c.composition_set);
+
+        const uint64_t number_of_textures = reader.read<uint64_t>();
+        c.texture_set.reserve(number_of_textures);
+        for (uint64_t i = 0; i < number_of_textures; i++) {
+            // The textures of the mappings without texture are empty
+            texture& t = c.texture_set.emplace_back();
+            t.format = static_cast<texture::texel_format>(reader.read<uint8_t>());
+            if (t.format > texture::texel_format::Half)
+                throw std::runtime_error("unknown texel format");
+            t.width  = reader.read<uint32_t>();
+            t.height = reader.read<uint32_t>();
+            reader.read(std::span<float>(t.component_table));
+            // The texels of all the levels of the mip pyramid are stored
+            t.texels.resize(texture::bytes_per_texel(t.format) * t.compute_levels());
+            reader.read(std::span<uint8_t>(t.texels));
+        }
+
+        const uint64_t number_of_normal_maps = reader.read<uint64_t>();
+        c.normal_map_set.reserve(number_of_normal_maps);
+        for (uint64_t i = 0; i < number_of_normal_maps; i++) {
+            normal_map& nm = c.normal_map_set.emplace_back();
+            nm.width  = reader.read<uint32_t>();
+            nm.height = reader.read<uint32_t>();
+            // The normals of all the levels of the mip pyramid are stored
+            nm.data.resize(nm.compute_levels());
+            reader.read(std::span<normal_map::encoded_normal>(nm.data));
+        }
+
+        /* Orientations */
+        auto& orientations = c.orientation_containers;
+        read_trivial_set(reader, orientations.triangle_orientation_set, 0, std::array<uvcoord, 3> {}, rt::RIGHT, rt::UP);
+        read_trivial_set(reader, orientations.quad_orientation_set,     0, std::array<uvcoord, 4> {}, rt::RIGHT, rt::UP);
+        read_trivial_set(reader, orientations.sphere_orientation_set,   0, rt::FORWARD, rt::RIGHT);
+        read_trivial_set(reader, orientations.plane_orientation_set,    0, rt::UP, rt::RIGHT, 1.0_r);
+
+        /* Objects */
+        auto& [ triangle_set, quad_set, sphere_set, plane_set, box_set, cylinder_set ] = c.object_containers;
+        read_objects(reader, triangle_set, triangles);
+        read_objects(reader, quad_set,     quads);
+        read_objects(reader, sphere_set,   spheres);
+        read_objects(reader, plane_set,    planes);
+        read_objects(reader, box_set,      boxes);
+        read_objects(reader, cylinder_set, cylinders);
+
+        const object_indexer indexer(c.object_containers);
+        const uint64_t number_of_objects = reader.read<uint64_t>();
+        std::vector<uint32_t> object_indices(number_of_objects);
+        reader.read(std::span<uint32_t>(object_indices));
+        c.object_set.resize(number_of_objects);
+        std::ranges::transform(object_indices, c.object_set.begin(), [&] (const uint32_t index) { return indexer.object_at(index); });
+
+        /* Bounding hierarchy */
+        const uint64_t number_of_roots = reader.read<uint64_t>();
+        c.bounding_set.reserve(number_of_roots);
+        for (uint64_t i = 0; i < number_of_roots; i++)
+            c.bounding_set.push_back(read_bounding(reader, indexer, owned));
+
+        printf("> %s snapshot loaded\n", std::filesystem::path(snapshot_name).filename().generic_string().c_str());
+        return c_opt;
+    }
+    catch (const std::exception& e) {
+        printf("Scene snapshot ignored (%s)\n", e.what());
+    }
+    catch (...) {
+        printf("Scene snapshot ignored\n");
+    }
+
+    delete_hierarchies(owned);
+    return std::nullopt;
+}
@@ -0,0 +1,86 @@
+#include "image/image.hpp"
+
+#include "parallel/parallel.hpp"
+
+#include <algorithm>
+
+/* Color of a material index, such that close indices have different colors */
+static rt::color material_color(const uint32_t index) {
+
+    if (index == NO_MATERIAL)
+        return rt::color();
+
+    uint32_t h = index * 0x9e3779b9u;
+    h ^= h >> 16;
+    return rt::color(
+        64 + ( h        & 0xBF),
+        64 + ((h >> 8)  & 0xBF),
+        64 + ((h >> 16) & 0xBF)
+    );
+}
+
+image aov_image(const image& img, const aov_buffers::layer layer, const aov_buffers::output output) {
+
+    const aov_buffers& aovs = img.aovs;
+    const int width  = img.width();
+    const int height = img.height();
+    const real invN = 1.0_r / img.number_of_samples;
+
+    using enum aov_buffers::layer;
+    const bool display = output == aov_buffers::output::Display;
+
+    // The depths are displayed between 0 (background) and 255 (closest point)
+    real max_depth = 0.0_r;
+    if (layer == Depth && display) {
+        for (int j = 0; j < height; j++) {
+            for (int i = 0; i < width; i++)
+                max_depth = std::max(max_depth, aovs.depth[j * width + i] * img.average_factor(j, i, invN));
+        }
+    }
+
+    matrix m(width, height);
+    parallel_for(height, [&] (const int j) {
+
+        const matrix::row row = m[j];
+        for (int i = 0; i < width; i++) {
+
+            const std::size_t index = j * width + i;
+            const real factor = img.average_factor(j, i, invN);
+            rt::color& c = row[i];
+
+            switch (layer) {
+                case Albedo:
+                    c = aovs.albedo.data[index] * factor;
+                    break;
+
+                case Normal:
+                    c = aovs.normal.data[index] * factor;
+                    if (display)
+                        c = (c + rt::color(1.0, 1.0, 1.0)) * 127.5;
+                    break;
+
+                case Depth: {
+                    const real d = aovs.depth[index] * factor;
+                    const real value = (not display) ? d
+                        : (d <= 0.0_r || max_depth <= 0.0_r) ? 0.0_r
+                        : 255.0_r * (1.0_r - 0.9_r * d / max_depth);
+                    c = rt::color(value, value, value);
+                    break;
+                }
+
+                case MaterialIndex: {
+                    const uint32_t material = aovs.material_index[index];
+                    if (display)
+                        c = material_color(material);
+                    else {
+                        const real value = (material == NO_MATERIAL) ? -1.0_r : static_cast<real>(material);
+                        c = rt::color(value, value, value);
+                    }
+                    break;
+                }
+            }
+        }
+    });
+
+    return image(std::move(m), (layer == Albedo) ? img.gamma : std::nullopt);
+}
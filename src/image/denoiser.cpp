@@ -0,0 +1,244 @@
+#include "image/denoiser.hpp"
+
+#include "parallel/parallel.hpp"
+#include "parallel/tiles.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+/* Coefficients of the B3 spline */
+constexpr std::array<real, 5> KERNEL = { 1.0_r / 16.0_r, 1.0_r / 4.0_r, 3.0_r / 8.0_r, 1.0_r / 4.0_r, 1.0_r / 16.0_r };
+
+/* Coefficients of the 3x3 Gaussian filter of the variances */
+constexpr std::array<real, 3> GAUSSIAN_3 = { 0.25_r, 0.5_r, 0.25_r };
+
+/* Added to the albedo (between 0 and 1) before dividing by it, so that black surfaces keep their color */
+constexpr real ALBEDO_EPSILON = 0.01_r;
+
+/* Below this squared norm, an averaged normal is that of the background */
+constexpr real NORMAL_EPSILON = 1e-4_r;
+
+/* Added to the standard deviation of the noise, so that noiseless regions are still filtered a little */
+constexpr real LUMINANCE_EPSILON = 1e-3_r;
+
+/* Color divided by (demodulate) or multiplied by (modulate) the albedo, between ALBEDO_EPSILON and 1 + ALBEDO_EPSILON */
+static inline rt::color demodulate(const rt::color& c, const rt::color& albedo) {
+    constexpr real inv255 = 1.0_r / 255.0_r;
+    return rt::color(
+        c.red   / (albedo.red   * inv255 + ALBEDO_EPSILON),
+        c.green / (albedo.green * inv255 + ALBEDO_EPSILON),
+        c.blue  / (albedo.blue  * inv255 + ALBEDO_EPSILON)
+    );
+}
+
+static inline rt::color modulate(const rt::color& c, const rt::color& albedo) {
+    constexpr real inv255 = 1.0_r / 255.0_r;
+    return rt::color(
+        c.red   * (albedo.red   * inv255 + ALBEDO_EPSILON),
+        c.green * (albedo.green * inv255 + ALBEDO_EPSILON),
+        c.blue  * (albedo.blue  * inv255 + ALBEDO_EPSILON)
+    );
+}
+
+/* Unit normals (zero for the background), from the averaged normals */
+static std::vector<rt::vector> unit_normals(const matrix& normal) {
+
+    std::vector<rt::vector> normals(normal.data.size());
+    for (std::size_t k = 0; k < normals.size(); k++) {
+        const auto [ x, y, z ] = normal.data[k];
+        const rt::vector n(x, y, z);
+        const real nsq = n.normsq();
+        normals[k] = (nsq < NORMAL_EPSILON) ? rt::vector() : n * (1.0_r / std::sqrt(nsq));
+    }
+    return normals;
+}
+
+matrix denoise(const denoiser_input& input, const denoiser_parameters& param) {
+
+    const int width  = input.color.width;
+    const int height = input.color.height;
+    const std::size_t size = input.color.data.size();
+
+    /* Lighting (color divided by the albedo) */
+    matrix current(width, height);
+    for (std::size_t k = 0; k < size; k++) {
+        current.data[k] = (input.albedo != nullptr) ?
+              demodulate(input.color.data[k], input.albedo->data[k])
+            : input.color.data[k];
+    }
+
+    const std::vector<rt::vector> normals = (input.normal != nullptr) ? unit_normals(*input.normal) : std::vector<rt::vector>();
+    const bool use_normals = not normals.empty();
+    const bool use_depth   = input.depth != nullptr;
+
+    const std::vector<tile> tiles = generate_tiles(width, height);
+
+    /* Variance of the luminance of each pixel: when the variances of the averages of the pixels are known, that of the pixel
+       (scaled as the luminance by the demodulation) smoothed by a 3x3 Gaussian filter over the known neighbours, as in SVGF,
+       otherwise the variance of the luminances of the 3x3 neighbourhood of the pixel */
+    const auto is_known = [&] (const std::size_t p) {
+        return input.variance != nullptr && (*input.variance)[p] >= 0.0;
+    };
+    const auto pixel_variance = [&] (const std::size_t p) {
+        const color_real luminance = input.color.data[p].get_luminance();
+        const color_real ratio = (luminance > 0.0) ? current.data[p].get_luminance() / luminance : 1.0;
+        return static_cast<real>((*input.variance)[p] * ratio * ratio);
+    };
+
+    std::vector<real> variance(size);
+    parallel_for_tiles(tiles, [&] (const tile& t, unsigned int) {
+        for (int j = t.y_start; j < t.y_end; j++) {
+            for (int i = t.x_start; i < t.x_end; i++) {
+
+                if (is_known(j * width + i)) {
+                    real sum = 0.0_r, weight_sum = 0.0_r;
+                    for (int y = std::max(0, j - 1); y <= std::min(height - 1, j + 1); y++) {
+                        for (int x = std::max(0, i - 1); x <= std::min(width - 1, i + 1); x++) {
+                            if (not is_known(y * width + x))
+                                continue;
+                            const real weight = GAUSSIAN_3[y - j + 1] * GAUSSIAN_3[x - i + 1];
+                            sum += weight * pixel_variance(y * width + x);
+                            weight_sum += weight;
+                        }
+                    }
+                    variance[j * width + i] = sum / weight_sum;
+                    continue;
+                }
+
+                real sum = 0.0_r, sum_sq = 0.0_r;
+                int n = 0;
+                for (int y = std::max(0, j - 1); y <= std::min(height - 1, j + 1); y++) {
+                    for (int x = std::max(0, i - 1); x <= std::min(width - 1, i + 1); x++) {
+                        const real l = current.data[y * width + x].get_luminance();
+                        sum += l;
+                        sum_sq += l * l;
+                        n++;
+                    }
+                }
+                const real mean = sum / n;
+                variance[j * width + i] = std::max(0.0_r, sum_sq / n - mean * mean);
+            }
+        }
+    });
+
+    matrix next(width, height);
+    std::vector<real> next_variance(size);
+
+    for (int iteration = 0; iteration < param.iterations; iteration++) {
+
+        const int step = 1 << iteration;
+
+        parallel_for_tiles(tiles, [&] (const tile& t, unsigned int) {
+
+            for (int j = t.y_start; j < t.y_end; j++) {
+                for (int i = t.x_start; i < t.x_end; i++) {
+
+                    const std::size_t p = j * width + i;
+                    const rt::color& color_p = current.data[p];
+                    const real luminance_p = color_p.get_luminance();
+                    const real inv_sigma_l = 1.0_r / (param.sigma_luminance * std::sqrt(variance[p]) + LUMINANCE_EPSILON);
+                    const real depth_p = use_depth ? static_cast<real>(input.depth->data[p].red) : 0.0_r;
+
+                    rt::color sum;
+                    real weight_sum = 0.0_r;
+                    real variance_sum = 0.0_r;
+
+                    for (int dy = -2; dy <= 2; dy++) {
+                        const int y = j + dy * step;
+                        if (y < 0 || y >= height)
+                            continue;
+
+                        for (int dx = -2; dx <= 2; dx++) {
+                            const int x = i + dx * step;
+                            if (x < 0 || x >= width)
+                                continue;
+
+                            const std::size_t q = y * width + x;
+                            const rt::color& color_q = current.data[q];
+
+                            real weight = KERNEL[dy + 2] * KERNEL[dx + 2]
+                                * std::exp(-std::abs(luminance_p - color_q.get_luminance()) * inv_sigma_l);
+
+                            if (use_normals) {
+                                const rt::vector& n_p = normals[p];
+                                const rt::vector& n_q = normals[q];
+                                const bool background_p = n_p.normsq() < NORMAL_EPSILON;
+                                const bool background_q = n_q.normsq() < NORMAL_EPSILON;
+                                if (background_p != background_q)
+                                    continue;
+                                if (not background_p)
+                                    weight *= std::pow(std::max(0.0_r, n_p | n_q), param.sigma_normal);
+                            }
+
+                            if (use_depth) {
+                                const real depth_q = static_cast<real>(input.depth->data[q].red);
+                                const real scale = param.sigma_depth * std::max(depth_p, depth_q) * static_cast<real>(step) * std::max(std::abs(dx), std::abs(dy));
+                                if (scale > 0.0_r)
+                                    weight *= std::exp(-std::abs(depth_p - depth_q) / scale);
+                            }
+
+                            sum += color_q * weight;
+                            weight_sum += weight;
+                            variance_sum += weight * weight * variance[q];
+                        }
+                    }
+
+                    // The center pixel always has a positive weight
+                    next.data[p] = sum * (1.0_r / weight_sum);
+                    next_variance[p] = variance_sum / (weight_sum * weight_sum);
+                }
+            }
+        });
+
+        std::swap(current, next);
+        std::swap(variance, next_variance);
+    }
+
+    /* Back to colors */
+    if (input.albedo != nullptr) {
+        for (std::size_t k = 0; k < size; k++)
+            current.data[k] = modulate(current.data[k], input.albedo->data[k]);
+    }
+
+    return current;
+}
+
+image denoise_image(const image& img, const denoiser_parameters& param) {
+
+    const real invN = 1.0_r / img.number_of_samples;
+
+    matrix color(img.width(), img.height());
+    parallel_for(img.height(), [&] (int j) {
+        const matrix::row row = color[j];
+        for (int i = 0; i < img.width(); i++)
+            row[i] = img[j, i] * img.average_factor(j, i, invN);
+    });
+
+    /* Variances of the averages of the pixels (the variance of the samples divided by their number) */
+    std::vector<color_real> variance;
+    if (img.is_adaptive()) {
+        variance.resize(color.data.size());
+        parallel_for(img.height(), [&] (int j) {
+            for (int i = 0; i < img.width(); i++) {
+                const int n = img.get_sample_count(j, i);
+                variance[j * img.width() + i] = (n < 2) ? -1.0 : img.luminance_variance(j, i) / n;
+            }
+        });
+    }
+    const std::vector<color_real>* const variance_ptr = img.is_adaptive() ? &variance : nullptr;
+
+    if (not img.aovs.is_enabled())
+        return image(denoise({ .color = color, .variance = variance_ptr }, param), img.gamma);
+
+    using enum aov_buffers::layer;
+    constexpr aov_buffers::output VALUES = aov_buffers::output::Values;
+    const image albedo = aov_image(img, Albedo, VALUES);
+    const image normal = aov_image(img, Normal, VALUES);
+    const image depth  = aov_image(img, Depth,  VALUES);
+
+    return image(
+        denoise({ .color = color, .albedo = &albedo.data, .normal = &normal.data, .depth = &depth.data, .variance = variance_ptr }, param),
+        img.gamma
+    );
+}
@@ -14,6 +14,7 @@ int main(int argc, char *argv[]) {
     const std::vector<std::string> args(argv + 1, argv + argc);
 
     menu menu;
+    menu.executable_name = argv[0];
     exit_if_failure(menu.parse_arguments(args));
     
     const std::optional<scene> scene_opt = menu.parse_scene_descriptor_file();
@@ -0,0 +1,66 @@
+#include "main_menu/checkpoint_writer.hpp"
+
+checkpoint_writer::checkpoint_writer(const std::string& file_path, const std::optional<compact_parameters>& compact)
+    : file_path(file_path), compact(compact), thread(&checkpoint_writer::thread_loop, this) {}
+
+checkpoint_writer::~checkpoint_writer() noexcept {
+
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        stopping = true;
+    }
+    cond.notify_all();
+    thread.join();
+}
+
+void checkpoint_writer::thread_loop() {
+
+    std::unique_lock<std::mutex> lock(mut);
+    while (true) {
+        cond.wait(lock, [this] { return pending_capture.has_value() || stopping; });
+        if (not pending_capture.has_value())
+            return;
+
+        /* The capture is not modified by the main thread until pending_capture is reset */
+        const raw_data::capture& c = captures[pending_capture.value()];
+        lock.unlock();
+        /* The tiles are encoded on this thread, so that the render keeps all the threads of the pool */
+        const exit_status status = compact.has_value() ?
+              raw_data::export_capture(file_path, c, raw_data::format::Compact, compact.value(),
+                compact_data::execution::Sequential)
+            : raw_data::export_capture(file_path, c);
+        lock.lock();
+
+        last_status = last_status && status;
+        pending_capture.reset();
+        cond.notify_all();
+    }
+}
+
+exit_status checkpoint_writer::submit(const image& image) {
+
+    /* The buffer of next_capture is not being written: the previous write uses the other one */
+    raw_data::capture_data(image, captures[next_capture]);
+
+    std::unique_lock<std::mutex> lock(mut);
+    cond.wait(lock, [this] { return not pending_capture.has_value(); });
+
+    const exit_status status = last_status;
+    last_status = exit_status::Success;
+    pending_capture = next_capture;
+    next_capture ^= 1;
+    lock.unlock();
+
+    cond.notify_all();
+    return status;
+}
+
+exit_status checkpoint_writer::wait() {
+
+    std::unique_lock<std::mutex> lock(mut);
+    cond.wait(lock, [this] { return not pending_capture.has_value(); });
+
+    const exit_status status = last_status;
+    last_status = exit_status::Success;
+    return status;
+}
@@ -11,8 +11,8 @@ using namespace std::filesystem;
 static const std::string OUTPUT_DIR_NAME = "../output";
 static const path output_dir(OUTPUT_DIR_NAME);
 
-file_handler::file_handler()
-    : output_dir_exists(exists(output_dir) && is_directory(output_dir)) {}
+file_handler::file_handler(const std::optional<compact_parameters> compact)
+    : output_dir_exists(exists(output_dir) && is_directory(output_dir)), compact(compact) {}
 
 void file_handler::create_dir() const {
     if (output_dir_exists)
@@ -20,11 +20,19 @@ void file_handler::create_dir() const {
     output_dir_exists = create_directories(output_dir);
 }
 
+std::string file_handler::output_path(const std::string& filename) const {
+    create_dir();
+    return path(output_dir).append(filename).generic_string();
+}
+
+std::string file_handler::display_name(const std::string& filename) const {
+    return output_dir.filename().append(filename).generic_string();
+}
+
 exit_status file_handler::export_file(const type file_type, const std::string& filename, const image& image,
     const bool display_sample_count) const {
 
-    create_dir();
-    const std::string file_path = path(output_dir).append(filename).generic_string();
+    const std::string file_path = output_path(filename);
 
     using enum file_handler::type;
     exit_status status;
@@ -33,14 +41,16 @@ exit_status file_handler::export_file(const type file_type, const std::string& f
             status = bmp::export_data(file_path, image);
             break;
         case Raw:
-            status = raw_data::export_data(file_path, image);
+            status = compact.has_value() ?
+                  raw_data::export_data(file_path, image, raw_data::format::Compact, compact.value())
+                : raw_data::export_data(file_path, image);
             break;
         default: throw;
     }
 
     switch (status) {
         case exit_status::Success:
-            printf("Saved as %s", output_dir.filename().append(filename).generic_string().c_str());
+            printf("Saved as %s", display_name(filename).c_str());
             if (display_sample_count)
                 printf(" (%d samples)       ", image.number_of_samples);
             break;
@@ -52,4 +62,26 @@ exit_status file_handler::export_file(const type file_type, const std::string& f
         default: throw;
     }
     return status;
-}
\ No newline at end of file
+}
+
+exit_status file_handler::export_aovs(const std::string& name, const image& image) const {
+
+    constexpr bool display_sample_count = false;
+    exit_status status = exit_status::Success;
+
+    for (const aov_buffers::layer layer : aov_buffers::layers) {
+
+        const std::string layer_name = name + "_" + aov_buffers::layer_name(layer);
+
+        const ::image values = aov_image(image, layer, aov_buffers::output::Values);
+        const exit_status status_raw = export_file(Raw, raw_filename(layer_name).filename, values, display_sample_count);
+        printf("\n");
+
+        const ::image display = aov_image(image, layer, aov_buffers::output::Display);
+        const exit_status status_bmp = export_file(Bmp, bmp_filename(layer_name).filename, display, display_sample_count);
+        printf("\n");
+
+        status = status && status_raw && status_bmp;
+    }
+    return status;
+}
@@ -2,10 +2,16 @@
 
 #include "tracing/debug.hpp"
 #include "main_menu/file_handler.hpp"
+#include "main_menu/checkpoint_writer.hpp"
+#include "main_menu/shard_coordinator.hpp"
 #include "screen/screen.hpp"
 #include "render/render_loops.hpp"
+#include "render/render_context.hpp"
 #include "auxiliary/timer.hpp"
 #include "tracing/debug.hpp"
+#include "image/denoiser.hpp"
+#include "file_readers/image_files/raw_data.hpp"
+#include "file_readers/parsers/scene_snapshot.hpp"
 
 #include <string>
 #include <span>
@@ -39,7 +45,7 @@ static bool is_float(const std::string& s) {
 
 
 enum class cli_argument {
-    Time, TimeAll, Rays, Multisample, Gamma, Reinhardt, RussianRoulette, Debug, None
+    Time, TimeAll, Rays, Multisample, Gamma, Reinhardt, RussianRoulette, NextEvent, Wavefront, Seed, Sampler, Adaptive, Aov, Denoise, NoSnapshot, Resume, Workers, Shard, Compact, Debug, None
 };
 
 struct arg_pair {
@@ -49,7 +55,7 @@ struct arg_pair {
 
 static cli_argument match(const std::string& input) {
     using enum cli_argument;
-    static const std::array<arg_pair, 8> keywords = {
+    static const std::array<arg_pair, 20> keywords = {
         arg_pair
         { "-time",        Time            },
         { "all",          TimeAll         },
@@ -58,6 +64,18 @@ static cli_argument match(const std::string& input) {
         { "-gamma",       Gamma           },
         { "-reinhardt",   Reinhardt       },
         { "-rr",          RussianRoulette },
+        { "-nee",         NextEvent       },
+        { "-wavefront",   Wavefront       },
+        { "-seed",        Seed            },
+        { "-sampler",     Sampler         },
+        { "-adaptive",    Adaptive        },
+        { "-aov",         Aov             },
+        { "-denoise",     Denoise         },
+        { "-nosnapshot",  NoSnapshot      },
+        { "-resume",      Resume          },
+        { "-workers",     Workers         },
+        { "-shard",       Shard           },
+        { "-compact",     Compact         },
         { "-debug",       Debug           }
     };
     for (const auto& [ keyword, value ] : keywords) {
@@ -67,6 +85,42 @@ static cli_argument match(const std::string& input) {
     return cli_argument::None;
 }
 
+static std::optional<sampler_type> parse_sampler(const std::string& input) {
+    using enum sampler_type;
+    if (input == "independent") return Independent;
+    if (input == "stratified")  return Stratified;
+    if (input == "sobol")       return Sobol;
+    if (input == "bluenoise")   return BlueNoise;
+    return std::nullopt;
+}
+
+static const char* sampler_name(const sampler_type sampler) {
+    using enum sampler_type;
+    switch (sampler) {
+        case Stratified: return "stratified";
+        case Sobol:      return "Owen-scrambled Sobol";
+        case BlueNoise:  return "blue-noise dithered Sobol";
+        default:         return "independent";
+    }
+}
+
+static std::optional<raw_format> parse_raw_format(const std::string& input) {
+    using enum raw_format;
+    if (input == "half")  return Half;
+    if (input == "float") return Single;
+    return std::nullopt;
+}
+
+/* Parameters of the compact raw data files */
+static std::optional<compact_parameters> compact_format(const raw_format format) {
+    using precision = compact_parameters::precision;
+    switch (format) {
+        case raw_format::Half:   return compact_parameters{ .bits = precision::Half   };
+        case raw_format::Single: return compact_parameters{ .bits = precision::Single };
+        default:                 return std::nullopt;
+    }
+}
+
 exit_status menu::parse_aux(const std::span<const std::string> args) {
 
     const unsigned int size = args.size();
@@ -134,6 +188,125 @@ exit_status menu::parse_aux(const std::span<const std::string> args) {
                 break;
             }
 
+            case NextEvent: {
+                runtime_parameters.nee = nee_mode::Enabled;
+                break;
+            }
+
+            case Wavefront: {
+                runtime_parameters.tracing = tracing_mode::Wavefront;
+                break;
+            }
+
+            case Seed: {
+                if (i + 1 >= size || not is_number(args[i + 1])) {
+                    printf("Error, -seed option expects 1 argument\n");
+                    return exit_status::Failure;
+                }
+                const std::string& next = args[++i];
+                runtime_parameters.seed = std::stoull(next);
+                break;
+            }
+
+            case Sampler: {
+                if (i + 1 >= size) {
+                    printf("Error, -sampler option expects 1 argument (independent, stratified, sobol or bluenoise)\n");
+                    return exit_status::Failure;
+                }
+                const std::optional<sampler_type> sampler = parse_sampler(args[++i]);
+                if (not sampler.has_value()) {
+                    printf("Error, unknown sampler %s (expected independent, stratified, sobol or bluenoise)\n", args[i].c_str());
+                    return exit_status::Failure;
+                }
+                runtime_parameters.sampler = sampler.value();
+                break;
+            }
+
+            case Adaptive: {
+                runtime_parameters.adaptive.a_mode = adaptive_parameters::mode::Enabled;
+                if (i + 1 >= size || not is_float(args[i + 1]))
+                    break;
+                const std::string& next = args[++i];
+                const float threshold = std::stof(next);
+                if (threshold <= 0.0f) {
+                    printf("Error, -adaptive threshold should be positive\n");
+                    return exit_status::Failure;
+                }
+                runtime_parameters.adaptive.threshold = threshold;
+                break;
+            }
+
+            case Aov: {
+                runtime_parameters.aov = aov_mode::Enabled;
+                break;
+            }
+
+            case Denoise: {
+                runtime_parameters.denoise = denoise_mode::Enabled;
+                break;
+            }
+
+            case NoSnapshot: {
+                runtime_parameters.snapshot = snapshot_mode::Disabled;
+                break;
+            }
+
+            case Resume: {
+                runtime_parameters.program.p_mode = program_parameters::mode::Offline;
+
+                if (i + 1 >= size) {
+                    printf("Error, -resume option expects 1 argument\n");
+                    return exit_status::Failure;
+                }
+                const std::string& next = args[++i];
+                if (not std::filesystem::is_regular_file(next)) {
+                    printf("Raw data file %s not found\n", next.c_str());
+                    return exit_status::Failure;
+                }
+                runtime_parameters.resume_file = next;
+                break;
+            }
+
+            case Workers: {
+                runtime_parameters.program.p_mode = program_parameters::mode::Offline;
+
+                if (i + 1 >= size || not is_number(args[i + 1]) || std::stoul(args[i + 1]) == 0) {
+                    printf("Error, -workers option expects 1 positive argument\n");
+                    return exit_status::Failure;
+                }
+                const std::string& next = args[++i];
+                runtime_parameters.number_of_workers = std::stoul(next);
+                break;
+            }
+
+            case Shard: {
+                runtime_parameters.program.p_mode = program_parameters::mode::Offline;
+
+                unsigned int index, count;
+                char end;
+                if (i + 1 >= size || std::sscanf(args[i + 1].c_str(), "%u/%u%c", &index, &count, &end) != 2 || index >= count) {
+                    printf("Error, -shard option expects 1 argument index/count (with index < count)\n");
+                    return exit_status::Failure;
+                }
+                i++;
+                runtime_parameters.shard = shard_parameters{ .index = index, .count = count };
+                break;
+            }
+
+            case Compact: {
+                if (i + 1 >= size) {
+                    printf("Error, -compact option expects 1 argument (half or float)\n");
+                    return exit_status::Failure;
+                }
+                const std::optional<raw_format> format = parse_raw_format(args[++i]);
+                if (not format.has_value()) {
+                    printf("Error, unknown precision %s (expected half or float)\n", args[i].c_str());
+                    return exit_status::Failure;
+                }
+                runtime_parameters.raw = format.value();
+                break;
+            }
+
             case Debug: {
                 runtime_parameters.debug = runtime_debugger::option::Enabled;
                 break;
@@ -151,6 +324,7 @@ exit_status menu::parse_aux(const std::span<const std::string> args) {
 
 exit_status menu::parse_arguments(const std::span<const std::string> args) {
     
+    arguments.assign(args.begin(), args.end());
     unsigned int index = 0;
 
     // Scene descriptor
@@ -198,6 +372,72 @@ exit_status menu::parse_arguments(const std::span<const std::string> args) {
     if (runtime_parameters.russian_roulette == russian_roulette_mode::Enabled)
         printf("Russian roulette technique enabled\n");
 
+    if (runtime_parameters.nee == nee_mode::Enabled)
+        printf("Next-event estimation enabled\n");
+
+    if (runtime_parameters.tracing == tracing_mode::Wavefront)
+        printf("Wavefront path tracing enabled\n");
+
+    if (runtime_parameters.sampler != sampler_type::Independent)
+        printf("Sampler: %s\n", sampler_name(runtime_parameters.sampler));
+
+    if (runtime_parameters.adaptive.a_mode == adaptive_parameters::mode::Enabled)
+        printf("Adaptive sampling enabled (threshold: %.3f)\n", runtime_parameters.adaptive.threshold);
+
+    if (runtime_parameters.aov == aov_mode::Enabled)
+        printf("Auxiliary buffers enabled (albedo, normal, depth, material index)\n");
+
+    if (runtime_parameters.denoise == denoise_mode::Enabled)
+        printf("Denoising enabled\n");
+
+    if (runtime_parameters.raw != raw_format::Binary)
+        printf("Compact raw data files (%s precision)\n", (runtime_parameters.raw == raw_format::Half) ? "half" : "single");
+
+    if (runtime_parameters.snapshot == snapshot_mode::Disabled)
+        printf("Scene snapshot disabled\n");
+
+    if (runtime_parameters.resume_file.has_value()) {
+        if (runtime_parameters.program.target_number_of_rays == 0) {
+            printf("Error, -resume option expects the total number of samples (-rays)\n");
+            return exit_status::Failure;
+        }
+        printf("Resuming the render of %s\n", runtime_parameters.resume_file.value().c_str());
+    }
+
+    if (runtime_parameters.number_of_workers != 0 || runtime_parameters.shard.has_value()) {
+        if (runtime_parameters.program.target_number_of_rays == 0) {
+            printf("Error, -workers and -shard options expect the total number of samples (-rays)\n");
+            return exit_status::Failure;
+        }
+        if (runtime_parameters.number_of_workers != 0 && runtime_parameters.shard.has_value()) {
+            printf("Error, -workers and -shard options are incompatible\n");
+            return exit_status::Failure;
+        }
+        if (runtime_parameters.number_of_workers != 0 && runtime_parameters.resume_file.has_value()) {
+            printf("Error, -workers and -resume options are incompatible (each worker can resume its shard with -shard)\n");
+            return exit_status::Failure;
+        }
+    }
+
+    if (runtime_parameters.number_of_workers != 0)
+        printf("Render split across %u worker processes\n", runtime_parameters.number_of_workers);
+
+    if (runtime_parameters.shard.has_value()) {
+        const auto [ first, last ] = shard_coordinator::sample_range(runtime_parameters.shard.value(),
+            runtime_parameters.program.target_number_of_rays);
+        printf("Shard %u/%u: %u samples, from sample index %u\n", runtime_parameters.shard.value().index,
+            runtime_parameters.shard.value().count, last - first, first);
+    }
+
+    // The seed is displayed, so that the render can be reproduced
+    // (a resumed render continues with the seed of the file, unless one is specified)
+    if (runtime_parameters.seed.has_value())
+        printf("Seed: %llu\n", static_cast<unsigned long long int>(runtime_parameters.seed.value()));
+    else if (not runtime_parameters.resume_file.has_value()) {
+        runtime_parameters.seed = default_seed();
+        printf("Seed: %llu\n", static_cast<unsigned long long int>(runtime_parameters.seed.value()));
+    }
+
     return exit_status::Success;
 }
 
@@ -220,51 +460,78 @@ void menu::update_gamma(const std::optional<real> new_gamma) {
     }
 }
 
-static inline void render_simple(image& image, const scene& scene,
+static inline void render_simple(image& image, const render_context& context,
     const runtime_parameters_container& runtime_parameters) {
 
     const unsigned int depth = runtime_parameters.number_of_bounces;
-    const russian_roulette_mode rr = runtime_parameters.russian_roulette;
     const unsigned int ms_samples = runtime_parameters.sampling.multisample_number_of_samples;
 
     using enum sampling_parameters::mode;
     switch (runtime_parameters.sampling.s_mode) {
         case MultiSample:
-            render_loop_parallel_multisample(image, scene, depth, ms_samples);
+            render_loop_parallel_multisample(image, context.scene_, depth, ms_samples);
             break;
         case UniSample:
-            render_loop(image, scene, depth, rr);
+            render_loop(image, context);
             break;
     }
 }
 
-static inline void render(image& image, const scene& scene,
+static inline void render(image& image, const render_context& context,
     const runtime_parameters_container& runtime_parameters) {
-    
-    const unsigned int depth = runtime_parameters.number_of_bounces;
-    const russian_roulette_mode rr = runtime_parameters.russian_roulette;
 
     using enum time_mode;
     switch (runtime_parameters.time) {
         case Simple:
         case Full:
-            render_loop_time(image, scene, depth, rr, runtime_parameters.time);
+            render_loop_time(image, context, runtime_parameters.time);
             break;
 
         case Disabled:
-            render_simple(image, scene, runtime_parameters);
+            render_simple(image, context, runtime_parameters);
             break;
     }
 }
 
-static exit_status run_offline(const runtime_parameters_container& runtime_parameters, image& image,
-    const scene& scene, const file_handler& file_handler) {
+/* Exports the image as bmp and rtdata files, with its auxiliary buffers and its denoised version if enabled */
+static exit_status export_final(const file_handler& file_handler, const std::string& name, const image& image,
+    const runtime_parameters_container& runtime_parameters) {
+
+    exit_status status = file_handler.export_as(bmp(name), raw(name), image);
 
-    const unsigned int target = runtime_parameters.program.target_number_of_rays;
+    if (image.aovs.is_enabled())
+        status = status && file_handler.export_aovs(name, image);
+
+    if (runtime_parameters.denoise == denoise_mode::Enabled) {
+        const ::image denoised = denoise_image(image);
+        status = status && file_handler.export_as(bmp(name + "_denoised"), raw(name + "_denoised"), denoised);
+    }
+
+    return status;
+}
+
+static exit_status run_offline(const runtime_parameters_container& runtime_parameters, image& image,
+    const render_context& context, const file_handler& file_handler) {
+
+    /* A resumed render continues from the samples of the file, up to the same total
+       A shard renders its range of the samples of the render, and reports its progress line by line
+       (see shard_coordinator.hpp) */
+    const std::optional<shard_parameters>& shard = runtime_parameters.shard;
+    const unsigned int total = runtime_parameters.program.target_number_of_rays;
+    const auto [ first, last ] = shard.has_value() ? shard_coordinator::sample_range(shard.value(), total) : std::pair(0u, total);
+    const unsigned int target = last - first;
+    const unsigned int start  = std::min(static_cast<unsigned int>(image.number_of_samples), target);
+
+    const auto print_progress = [&] (const unsigned int samples) {
+        if (shard.has_value())
+            printf("Shard %u/%u: %u / %u\n", shard.value().index, shard.value().count, samples, target);
+        else
+            printf("\r%u / %u", samples, target);
+        fflush(stdout);
+    };
 
     printf("Rendering...\n");
-    printf("0 / %u", target);
-    fflush(stdout);
+    print_progress(start);
 
     timer timer(runtime_parameters.time);
     timer.start();
@@ -272,8 +539,7 @@ static exit_status run_offline(const runtime_parameters_container& runtime_param
     ///////
     constexpr bool ALL_AT_ONCE_EXPERIMENT = false;
     if constexpr (ALL_AT_ONCE_EXPERIMENT) {
-        render_loop_parallel_all_at_once(image, scene, runtime_parameters.number_of_bounces,
-            runtime_parameters.russian_roulette, runtime_parameters.program.target_number_of_rays);
+        render_loop_parallel_all_at_once(image, context, runtime_parameters.program.target_number_of_rays);
         timer.stop();
         printf("\n");
         timer.print();
@@ -281,32 +547,70 @@ static exit_status run_offline(const runtime_parameters_container& runtime_param
     }
     ///////
     
-    for (unsigned int i = 0; i < target; i++) {
+    /* Checkpoints: the image is exported as rtdata every EXPORT_INTERVAL samples, in the background */
+    const std::string checkpoint_name = shard.has_value() ?
+          shard_coordinator::file_name(DEFAULT_OUTPUT_FILE_NAME, shard.value().index)
+        : raw(DEFAULT_OUTPUT_FILE_NAME).filename;
+    checkpoint_writer checkpoints(file_handler.output_path(checkpoint_name), file_handler.raw_compact());
+    
+    for (unsigned int i = start; i < target; i++) {
 
-        render_simple(image, scene, runtime_parameters);
+        render_simple(image, context, runtime_parameters);
 
-        printf("\r%u / %u", i + 1, target);
-        fflush(stdout);
+        print_progress(i + 1);
 
-        /* Exporting as rtdata every EXPORT_INTERVAL samples */
         if ((i + 1) % EXPORT_INTERVAL == 0) {
             timer.interrupt();
 
-            printf(" ");
-            const exit_status status = file_handler.export_as(raw(DEFAULT_OUTPUT_FILE_NAME), image);
-            if (status == exit_status::Failure)
+            if (checkpoints.submit(image) == exit_status::Failure) {
+                printf("\nSave failed\n");
                 return exit_status::Failure;
+            }
+            if (shard.has_value()) {
+                /* The coordinator merges the shard when it reads this line: the file must be written by then */
+                if (checkpoints.wait() == exit_status::Failure) {
+                    printf("\nSave failed\n");
+                    return exit_status::Failure;
+                }
+                printf("Shard %u/%u: saved\n", shard.value().index, shard.value().count);
+            }
+            else
+                printf(" Saving as %s (%d samples)       ", file_handler.display_name(checkpoint_name).c_str(), image.number_of_samples);
+            fflush(stdout);
             
             timer.resume();
         }
     }
 
+    /* The final export replaces the last checkpoint */
+    if (checkpoints.wait() == exit_status::Failure) {
+        printf("\nSave failed\n");
+        return exit_status::Failure;
+    }
+
     timer.stop();
-    printf("\r                                                                              ");
-    printf("\rRender complete: %u / %u\n", target, target);
+    if (not shard.has_value()) {
+        printf("\r                                                                              ");
+        printf("\rRender complete: %u / %u\n", target, target);
+    }
     timer.print();
 
-    return file_handler.export_as(bmp(DEFAULT_OUTPUT_FILE_NAME), raw(DEFAULT_OUTPUT_FILE_NAME), image);
+    if (image.is_adaptive()) {
+        uint64_t total_samples = 0;
+        for (const uint32_t n : image.pixel_samples)
+            total_samples += n;
+        printf("Average number of samples per pixel: %.1f\n",
+            static_cast<double>(total_samples) / static_cast<double>(image.pixel_samples.size()));
+    }
+
+    /* The shards are merged by the coordinator (or the merger) */
+    if (shard.has_value()) {
+        const exit_status status = file_handler.export_as(raw(checkpoint_name), image);
+        printf("\nShard %u/%u: saved\n", shard.value().index, shard.value().count);
+        return status;
+    }
+
+    return export_final(file_handler, DEFAULT_OUTPUT_FILE_NAME, image, runtime_parameters);
 }
 
 // Returns an exit_status if the program has to stop, either because of a failure or because a quit event happened
@@ -328,6 +632,11 @@ static std::optional<exit_status> process_events(const rt::screen& scr, const fi
                 const exit_status status = file_handler.export_as(bmp(DEFAULT_OUTPUT_FILE_NAME), image);
                 if (status == exit_status::Failure)
                     return exit_status::Failure;
+                if (image.aovs.is_enabled()) {
+                    printf("\n");
+                    if (file_handler.export_aovs(DEFAULT_OUTPUT_FILE_NAME, image) == exit_status::Failure)
+                        return exit_status::Failure;
+                }
                 break;
             }
             case R: {
@@ -354,7 +663,9 @@ static std::optional<exit_status> process_events(const rt::screen& scr, const fi
 
 
 static exit_status run_interactive(const runtime_parameters_container& runtime_parameters,
-    image& image, const scene& scene, const file_handler& file_handler) {
+    image& image, const render_context& context, const file_handler& file_handler) {
+
+    const scene& scene = context.scene_;
 
     if (runtime_parameters.debug == runtime_debugger::option::Enabled)
         draw_bounding_boxes(scene, 4);
@@ -362,9 +673,21 @@ static exit_status run_interactive(const runtime_parameters_container& runtime_p
     printf("Initialization complete, computing the first ray...");
     fflush(stdout);
 
-    render(image, scene, runtime_parameters);
+    render(image, context, runtime_parameters);
+
+    /* With denoising, the screen displays a denoised copy of the image, updated after each pass */
+    const bool denoise = runtime_parameters.denoise == denoise_mode::Enabled;
+    ::image preview(denoise ? image.width() : 0, denoise ? image.height() : 0, image.gamma);
+    const auto update_preview = [&] {
+        if (not denoise)
+            return;
+        ::image denoised = denoise_image(image);
+        preview.data = std::move(denoised.data);
+        preview.number_of_samples = 1;
+    };
+    update_preview();
 
-    const rt::screen scr(image, runtime_parameters.tone_mapping.tm_mode);
+    const rt::screen scr(denoise ? preview : image, runtime_parameters.tone_mapping.tm_mode);
     runtime_debugger debug = { runtime_parameters.debug, 0, 0 };
 
     scr.refresh();
@@ -376,7 +699,8 @@ static exit_status run_interactive(const runtime_parameters_container& runtime_p
         printf("\rSamples per pixel: %u", i);
         fflush(stdout);
 
-        render(image, scene, runtime_parameters);
+        render(image, context, runtime_parameters);
+        update_preview();
         scr.refresh();
 
         const std::optional<exit_status> status = process_events(scr, file_handler, image, debug, scene);
@@ -387,21 +711,136 @@ static exit_status run_interactive(const runtime_parameters_container& runtime_p
     printf("\rSamples per pixel: %u", MAX_RAYS);
     printf("                                                   \n");
 
-    return file_handler.export_as(bmp(DEFAULT_OUTPUT_FINAL_FILE_NAME), raw(DEFAULT_OUTPUT_FINAL_FILE_NAME), image);
+    return export_final(file_handler, DEFAULT_OUTPUT_FINAL_FILE_NAME, image, runtime_parameters);
+}
+
+/* Loads the raw data file file_name of a previous render, if it has the resolution of the scene
+   and was rendered from the same scene description (when the file records it) */
+static std::optional<image> load_resumed_image(const std::string& file_name, const scene& scene, const uint64_t scene_hash) {
+
+    std::expected<image, file_reader::error> loaded = raw_data::read_file(file_name);
+    if (not loaded.has_value()) {
+        printf("Error, could not read raw data file %s\n", file_name.c_str());
+        return std::nullopt;
+    }
+
+    image& image = loaded.value();
+    if (image.width() != scene.width || image.height() != scene.height) {
+        printf("Error, the resolution of %s (%dx%d) differs from the resolution of the scene (%dx%d)\n",
+            file_name.c_str(), image.width(), image.height(), scene.width, scene.height);
+        return std::nullopt;
+    }
+
+    if (not image.identity.has_value())
+        printf("Warning: %s does not record its seed and scene description, they cannot be checked\n", file_name.c_str());
+    else if (image.identity.value().scene_hash != scene_hash) {
+        printf("Error, %s was rendered from a different scene description\n", file_name.c_str());
+        return std::nullopt;
+    }
+
+    image.gamma = scene.gamma;
+    printf("Resumed render: %d samples\n", image.number_of_samples);
+    return std::move(image);
+}
+
+/* True if file_name is in the compact format with half-precision floats */
+static bool is_half_precision(const std::string& file_name) {
+    const std::expected<raw_data::header, file_reader::error> header = raw_data::read_file_header(file_name);
+    return header.has_value()
+        && header.value().data_format == raw_data::format::Compact
+        && header.value().compact.bits == compact_parameters::precision::Half;
+}
+
+/* Sharded render: merges the shards of the workers, then denoises the result if enabled
+   (the auxiliary buffers of the workers are not kept, the denoiser is only guided by the colors) */
+static exit_status run_coordinator(const std::string& executable_name, const std::span<const std::string> arguments,
+    const runtime_parameters_container& runtime_parameters, const uint64_t seed) {
+
+    const file_handler file_handler(compact_format(runtime_parameters.raw));
+    const exit_status status = shard_coordinator::run(executable_name, arguments, runtime_parameters.number_of_workers,
+        runtime_parameters.program.target_number_of_rays, seed, file_handler, DEFAULT_OUTPUT_FILE_NAME);
+    if (status == exit_status::Failure || runtime_parameters.denoise == denoise_mode::Disabled)
+        return status;
+
+    const std::expected<image, file_reader::error> merged = raw_data::read_file(file_handler.output_path(raw(DEFAULT_OUTPUT_FILE_NAME).filename));
+    if (not merged.has_value()) {
+        printf("Error, could not read the merged image\n");
+        return exit_status::Failure;
+    }
+    const image denoised = denoise_image(merged.value());
+    return file_handler.export_as(bmp(DEFAULT_OUTPUT_FILE_NAME + "_denoised"), raw(DEFAULT_OUTPUT_FILE_NAME + "_denoised"), denoised);
 }
 
 exit_status menu::run(const scene& scene) const {
 
-    image image(scene.width, scene.height, scene.gamma);
-    const file_handler file_handler;
+    if (runtime_parameters.number_of_workers != 0)
+        return run_coordinator(executable_name, arguments, runtime_parameters, runtime_parameters.seed.value());
+
+    const uint64_t scene_hash = scene_snapshot::hash_description(scene_descriptor_name, 0);
+
+    std::optional<::image> image_opt = runtime_parameters.resume_file.has_value() ?
+          load_resumed_image(runtime_parameters.resume_file.value(), scene, scene_hash)
+        : std::optional<::image>(std::in_place, scene.width, scene.height, scene.gamma);
+    if (not image_opt.has_value())
+        return exit_status::Failure;
+    image& image = image_opt.value();
+
+    /* The samples of a resumed render continue the sequences of its seed (sample indices from its number of samples),
+       or, with another seed, are drawn independently of the previous ones */
+    const std::optional<render_identity>& previous = image.identity;
+    const uint64_t seed = runtime_parameters.seed.value_or(previous.has_value() ? previous.value().seed : default_seed());
+    if (runtime_parameters.resume_file.has_value()) {
+        if (previous.has_value() && previous.value().seed != seed)
+            printf("Warning: the seed of the resumed render (%llu) is replaced by %llu\n",
+                static_cast<unsigned long long int>(previous.value().seed), static_cast<unsigned long long int>(seed));
+        if (not runtime_parameters.seed.has_value())
+            printf("Seed: %llu\n", static_cast<unsigned long long int>(seed));
+    }
+    image.identity = render_identity{ .seed = seed, .scene_hash = scene_hash };
+
+    /* The sums of squared luminances and the auxiliary buffers are not stored in the raw data files,
+       so they are not available for a resumed render (the denoiser is then only guided by the colors) */
+    const bool resumed = image.number_of_samples != 0;
+    if (resumed && (runtime_parameters.adaptive.a_mode == adaptive_parameters::mode::Enabled || runtime_parameters.aov == aov_mode::Enabled))
+        printf("Warning: adaptive sampling and auxiliary buffers are disabled for a resumed render\n");
+
+    if (runtime_parameters.adaptive.a_mode == adaptive_parameters::mode::Enabled && not resumed)
+        image.enable_adaptive_sampling();
+    // The denoiser is guided by the auxiliary buffers (a shard only exports its colors)
+    const bool sharded = runtime_parameters.shard.has_value();
+    if ((runtime_parameters.aov == aov_mode::Enabled || runtime_parameters.denoise == denoise_mode::Enabled) && not (resumed || sharded))
+        image.enable_aovs();
+
+    /* The averages of a half-precision file are rounded to 11 significant bits, and so are the sums of the resumed render:
+       its files are then written in single precision, so that they are not rounded again at each checkpoint */
+    raw_format output_format = runtime_parameters.raw;
+    if (runtime_parameters.resume_file.has_value() && is_half_precision(runtime_parameters.resume_file.value())) {
+        printf("Warning: %s is in half precision, the resumed render starts from its colors rounded to 11 significant bits\n",
+            runtime_parameters.resume_file.value().c_str());
+        if (output_format == raw_format::Half) {
+            output_format = raw_format::Single;
+            printf("The raw data files of the resumed render are written in single precision\n");
+        }
+    }
+    const file_handler file_handler(compact_format(output_format));
+
+    const unsigned int first_sample = sharded ?
+          shard_coordinator::sample_range(runtime_parameters.shard.value(), runtime_parameters.program.target_number_of_rays).first
+        : 0;
+
+    // Created once: the threads of the pool keep their worker and random generator for all the passes
+    const render_context context(scene, runtime_parameters.number_of_bounces, runtime_parameters.russian_roulette,
+        runtime_parameters.nee, seed, runtime_parameters.sampler, runtime_parameters.tracing, runtime_parameters.adaptive,
+        first_sample);
+    context.skip_passes(first_sample + image.number_of_samples);
 
     using enum program_parameters::mode;
     switch (runtime_parameters.program.p_mode) {
         case Offline:
-            return run_offline(runtime_parameters, image, scene, file_handler);
+            return run_offline(runtime_parameters, image, context, file_handler);
         
         case Interactive:
-            return run_interactive(runtime_parameters, image, scene, file_handler);
+            return run_interactive(runtime_parameters, image, context, file_handler);
 
         default: throw;
     }
@@ -0,0 +1,309 @@
+#include "main_menu/shard_coordinator.hpp"
+
+#include "file_readers/image_files/raw_data.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+std::pair<unsigned int, unsigned int> shard_coordinator::sample_range(const shard_parameters& shard, const unsigned int total) {
+    const auto bound = [&] (const unsigned int index) {
+        return static_cast<unsigned int>(static_cast<uint64_t>(total) * index / shard.count);
+    };
+    return { bound(shard.index), bound(shard.index + 1) };
+}
+
+std::string shard_coordinator::file_name(const std::string& output_name, const unsigned int index) {
+    return output_name + "_shard" + std::to_string(index) + ".rtdata";
+}
+
+/* Arguments of the worker rendering the shard index of count: the arguments of the coordinator,
+   without -workers and -seed (and their values) */
+static std::vector<std::string> worker_arguments(const std::span<const std::string> arguments,
+    const unsigned int index, const unsigned int count, const uint64_t seed) {
+
+    std::vector<std::string> worker_args;
+    for (std::size_t i = 0; i < arguments.size(); i++) {
+        if (arguments[i] == "-workers" || arguments[i] == "-seed")
+            i++;
+        else
+            worker_args.push_back(arguments[i]);
+    }
+
+    worker_args.insert(worker_args.end(), {
+        "-seed",  std::to_string(seed),
+        "-shard", std::to_string(index) + "/" + std::to_string(count)
+    });
+    return worker_args;
+}
+
+/* Merges the shards already saved (the others are not counted in the number of samples of the result) */
+static exit_status merge_shards(const file_handler& file_handler, const std::string& output_name, const unsigned int count) {
+
+    std::vector<std::string> shard_paths;
+    for (unsigned int k = 0; k < count; k++) {
+        const std::string path = file_handler.output_path(shard_coordinator::file_name(output_name, k));
+        if (std::filesystem::is_regular_file(path))
+            shard_paths.push_back(path);
+    }
+    if (shard_paths.empty())
+        return exit_status::Success;
+
+    return raw_data::combine_files(file_handler.output_path(output_name + ".bmp"),
+        file_handler.output_path(output_name + ".rtdata"), shard_paths, std::nullopt, std::nullopt);
+}
+
+#ifdef _WIN32
+
+exit_status shard_coordinator::run(const std::string&, std::span<const std::string>, unsigned int, unsigned int,
+    uint64_t, const file_handler&, const std::string&) {
+
+    printf("Error, the worker processes are not supported on this platform (the shards can be rendered separately with -shard)\n");
+    return exit_status::Failure;
+}
+
+#else
+
+#ifdef __linux__
+using cpu_set = cpu_set_t;
+#else
+struct cpu_set {};
+#endif
+
+/* Splits the CPUs available to the process into n disjoint sets of consecutive CPUs
+   (empty if the affinity is not supported, or if there are fewer CPUs than workers) */
+static std::vector<cpu_set> split_cpus([[maybe_unused]] const unsigned int n) {
+
+    std::vector<cpu_set> sets;
+#ifdef __linux__
+    cpu_set_t available;
+    CPU_ZERO(&available);
+    if (sched_getaffinity(0, sizeof(available), &available) != 0)
+        return sets;
+
+    std::vector<int> cpus;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (CPU_ISSET(c, &available))
+            cpus.push_back(c);
+    }
+    if (cpus.size() < n)
+        return sets;
+
+    sets.resize(n);
+    for (unsigned int k = 0; k < n; k++) {
+        CPU_ZERO(&sets[k]);
+        for (std::size_t c = cpus.size() * k / n; c < cpus.size() * (k + 1) / n; c++)
+            CPU_SET(cpus[c], &sets[k]);
+    }
+#endif
+    return sets;
+}
+
+struct worker_process {
+    pid_t pid = -1;
+    int output = -1;                    // Read end of the pipe receiving the standard output of the worker (-1 once closed)
+    std::string line;                   // Line being received
+    std::deque<std::string> last_lines; // Last lines that are not reports, displayed if the worker fails
+    unsigned int samples = 0;
+};
+
+constexpr std::size_t MAX_WORKER_LINES = 20;
+
+/* Launches executable_name with args, its standard output and error redirected to a pipe,
+   and restricted to the CPUs of cpus if it is not null */
+static std::optional<worker_process> launch_worker(const std::string& executable_name,
+    const std::vector<std::string>& args, [[maybe_unused]] const cpu_set* cpus) {
+
+    int fds[2];
+    if (pipe(fds) != 0)
+        return std::nullopt;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    // Prepared before the fork: only async-signal-safe functions can be called in the child
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(executable_name.c_str()));
+    for (const std::string& arg : args)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+#ifdef __linux__
+    const char* const executable_path = "/proc/self/exe";
+#else
+    const char* const executable_path = executable_name.c_str();
+#endif
+
+    const pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return std::nullopt;
+    }
+
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+#ifdef __linux__
+        if (cpus != nullptr)
+            sched_setaffinity(0, sizeof(cpu_set_t), cpus);
+#endif
+        execv(executable_path, argv.data());
+        _exit(127);
+    }
+
+    close(fds[1]);
+    worker_process worker;
+    worker.pid = pid;
+    worker.output = fds[0];
+    return worker;
+}
+
+/* Processes a line received from a worker: updates its number of samples, and returns true if it saved its shard */
+static bool process_line(worker_process& worker, const std::string& line) {
+
+    unsigned int index, count, samples, shard_samples;
+    if (std::sscanf(line.c_str(), "Shard %u/%u: %u / %u", &index, &count, &samples, &shard_samples) == 4) {
+        worker.samples = samples;
+        return false;
+    }
+    if (line.starts_with("Shard ") && line.ends_with(": saved"))
+        return true;
+
+    if (not line.empty()) {
+        worker.last_lines.push_back(line);
+        if (worker.last_lines.size() > MAX_WORKER_LINES)
+            worker.last_lines.pop_front();
+    }
+    return false;
+}
+
+exit_status shard_coordinator::run(const std::string& executable_name, const std::span<const std::string> arguments,
+    const unsigned int number_of_workers, const unsigned int total, const uint64_t seed,
+    const file_handler& file_handler, const std::string& output_name) {
+
+    // The shards of a previous render must not be merged
+    for (unsigned int k = 0; k < number_of_workers; k++) {
+        std::error_code ignored;
+        std::filesystem::remove(file_handler.output_path(file_name(output_name, k)), ignored);
+    }
+
+    const std::vector<cpu_set> cpu_sets = split_cpus(number_of_workers);
+    if (cpu_sets.empty())
+        printf("Warning: the workers are not bound to separate CPUs\n");
+
+    std::vector<worker_process> workers;
+    for (unsigned int k = 0; k < number_of_workers; k++) {
+        std::optional<worker_process> worker = launch_worker(executable_name,
+            worker_arguments(arguments, k, number_of_workers, seed), cpu_sets.empty() ? nullptr : &cpu_sets[k]);
+        if (not worker.has_value()) {
+            printf("Error, could not launch worker %u\n", k);
+            for (const worker_process& w : workers)
+                kill(w.pid, SIGTERM);
+            for (const worker_process& w : workers)
+                waitpid(w.pid, nullptr, 0);
+            return exit_status::Failure;
+        }
+        workers.push_back(std::move(worker.value()));
+    }
+    printf("Rendering with %u workers...\n", number_of_workers);
+
+    const auto print_progress = [&] {
+        unsigned int samples = 0;
+        for (const worker_process& w : workers)
+            samples += w.samples;
+        printf("\r%u / %u", samples, total);
+        fflush(stdout);
+    };
+    print_progress();
+
+    exit_status status = exit_status::Success;
+    std::vector<pollfd> fds;
+    std::vector<unsigned int> fd_workers;
+
+    while (true) {
+
+        fds.clear();
+        fd_workers.clear();
+        for (unsigned int k = 0; k < workers.size(); k++) {
+            if (workers[k].output >= 0) {
+                fds.push_back({ .fd = workers[k].output, .events = POLLIN, .revents = 0 });
+                fd_workers.push_back(k);
+            }
+        }
+        if (fds.empty())
+            break;
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            status = exit_status::Failure;
+            break;
+        }
+
+        bool merge_needed = false;
+        for (std::size_t f = 0; f < fds.size(); f++) {
+            if (fds[f].revents == 0)
+                continue;
+            worker_process& worker = workers[fd_workers[f]];
+
+            char buffer[4096];
+            const ssize_t n = read(worker.output, buffer, sizeof(buffer));
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR)
+                    continue;
+                close(worker.output);
+                worker.output = -1;
+                merge_needed |= process_line(worker, worker.line);
+                worker.line.clear();
+                continue;
+            }
+
+            for (const char c : std::string_view(buffer, n)) {
+                if (c == '\n' || c == '\r') {
+                    merge_needed |= process_line(worker, worker.line);
+                    worker.line.clear();
+                }
+                else
+                    worker.line.push_back(c);
+            }
+        }
+
+        // The shards are merged as they are saved, so that the result can be checked during the render
+        if (merge_needed) {
+            printf("\n");
+            status = status && merge_shards(file_handler, output_name, number_of_workers);
+        }
+        print_progress();
+    }
+
+    for (unsigned int k = 0; k < workers.size(); k++) {
+        int worker_status = 0;
+        while (waitpid(workers[k].pid, &worker_status, 0) < 0 && errno == EINTR) {}
+
+        if (not (WIFEXITED(worker_status) && WEXITSTATUS(worker_status) == EXIT_SUCCESS)) {
+            printf("\nWorker %u failed:\n", k);
+            for (const std::string& line : workers[k].last_lines)
+                printf("    %s\n", line.c_str());
+            status = exit_status::Failure;
+        }
+    }
+
+    printf("\n");
+    return status && merge_shards(file_handler, output_name, number_of_workers);
+}
+
+#endif
@@ -1,57 +1,57 @@
 #include "parallel/parallel.hpp"
+#include "parallel/thread_pool.hpp"
 #include "parameters.hpp"
 
-#include <thread>
-#include <vector>
+#include <algorithm>
+
+/* Number of chunks per thread when no number of threads is requested:
+   small chunks let the threads that finish early steal work from the others */
+constexpr int CHUNKS_PER_THREAD = 8;
 
 [[maybe_unused]]
 static void parallel_for_aux(const int nb_elements,
     const std::function<void (int start, int end)>& functor,
     int wanted_nb_threads = 0) {
-    
-    const int nb_threads_hint = std::thread::hardware_concurrency();
-    if (nb_threads_hint != 0)
-        wanted_nb_threads = std::min(wanted_nb_threads, nb_threads_hint);
-    const int nb_threads =
-        wanted_nb_threads != 0 ?
-              wanted_nb_threads
-            : (nb_threads_hint != 0) ? nb_threads_hint : 8;
-
-    const int batch_size = nb_elements / nb_threads;
-    
-    std::vector<std::thread> pool;
-    pool.reserve(nb_threads);
-
-    for (int i = 0; i < nb_threads; i++) {
-        const int start = i * batch_size;
-        pool.emplace_back(functor, start, start + batch_size);
-    }
-    
-    // Remainder
-    functor(nb_threads * batch_size, nb_elements);
-
-    for (std::thread& thread : pool) {
-        thread.join();
-    }
+
+    if (nb_elements <= 0)
+        return;
+
+    thread_pool& pool = thread_pool::global();
+    const int nb_chunks = std::min(nb_elements,
+        wanted_nb_threads != 0 ? wanted_nb_threads : static_cast<int>(pool.size()) * CHUNKS_PER_THREAD);
+
+    const int chunk_size = nb_elements / nb_chunks;
+    const int remainder  = nb_elements % nb_chunks;
+
+    pool.run(nb_chunks, [&] (int chunk, unsigned int) {
+        // The first chunks take one more element each
+        const int start = chunk * chunk_size + std::min(chunk, remainder);
+        const int end   = start + chunk_size + (chunk < remainder ? 1 : 0);
+        functor(start, end);
+    });
 }
 
 void parallel_for(int nb_elements, const std::function<void (int i)>& functor) {
-
     if constexpr (PARALLELISM == parallelism::Enabled)
         parallel_for_aux(nb_elements, [&functor] (int start, int end) {
-            for (int i = start; i < end; i++) {
-                functor(i);
-            }
+            for (int i = start; i < end; i++) functor(i);
         });
     else
-        for (int i = 0; i < nb_elements; i++)
-            functor(i);
+        for (int i = 0; i < nb_elements; i++) functor(i);
 }
 
 void parallel_for(int nb_elements, const std::function<void (int start, int end)>& functor, int nb_threads) {
-
     if constexpr (PARALLELISM == parallelism::Enabled)
         parallel_for_aux(nb_elements, functor, nb_threads);
     else
         functor(0, nb_elements);
-}
\ No newline at end of file
+}
+
+void parallel_for_tiles(std::span<const tile> tiles, const std::function<void (const tile& t, unsigned int thread_index)>& functor) {
+    if constexpr (PARALLELISM == parallelism::Enabled)
+        thread_pool::global().run(tiles.size(), [&] (int i, unsigned int thread_index) {
+            functor(tiles[i], thread_index);
+        });
+    else
+        for (const tile& t : tiles) functor(t, 0);
+}
@@ -0,0 +1,151 @@
+#include "parallel/thread_pool.hpp"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/* Index of the current thread in its pool (none for threads outside of the pools) */
+static thread_local std::optional<unsigned int> local_thread_index = std::nullopt;
+
+thread_pool::thread_pool(unsigned int nb_threads) {
+
+    if (nb_threads == 0) {
+        const unsigned int nb_threads_hint = std::thread::hardware_concurrency();
+        nb_threads = (nb_threads_hint != 0) ? nb_threads_hint : 8;
+
+#ifdef __linux__
+        // The process may be restricted to some of the CPUs (e.g. a worker of a sharded render)
+        cpu_set_t cpus;
+        if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0 && CPU_COUNT(&cpus) > 0)
+            nb_threads = std::min(nb_threads, static_cast<unsigned int>(CPU_COUNT(&cpus)));
+#endif
+    }
+
+    queues.reserve(nb_threads);
+    for (unsigned int i = 0; i < nb_threads; i++) {
+        queues.emplace_back(std::make_unique<task_queue>());
+    }
+
+    threads.reserve(nb_threads);
+    for (unsigned int i = 0; i < nb_threads; i++) {
+        threads.emplace_back(&thread_pool::thread_loop, this, i);
+    }
+}
+
+thread_pool::~thread_pool() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        stopping = true;
+    }
+    batch_start.notify_all();
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+/* Pops a task from the front of the thread's own queue, or steals one from the back of another queue */
+std::optional<int> thread_pool::pop_task(unsigned int thread_index) {
+
+    {
+        task_queue& own = *queues[thread_index];
+        std::lock_guard<std::mutex> lock(own.mut);
+        if (not own.tasks.empty()) {
+            const int task = own.tasks.front();
+            own.tasks.pop_front();
+            return task;
+        }
+    }
+
+    const unsigned int nb_queues = queues.size();
+    for (unsigned int k = 1; k < nb_queues; k++) {
+        task_queue& victim = *queues[(thread_index + k) % nb_queues];
+        std::lock_guard<std::mutex> lock(victim.mut);
+        if (not victim.tasks.empty()) {
+            const int task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return task;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void thread_pool::thread_loop(unsigned int thread_index) {
+
+    local_thread_index = thread_index;
+    unsigned long int last_batch = 0;
+
+    while (true) {
+
+        const task_function* functor;
+        {
+            std::unique_lock<std::mutex> lock(mut);
+            batch_start.wait(lock, [&] { return stopping || batch_number != last_batch; });
+            if (stopping)
+                return;
+            last_batch = batch_number;
+            functor = current_function;
+        }
+
+        while (const std::optional<int> task = pop_task(thread_index)) {
+            (*functor)(*task, thread_index);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            number_of_idle_threads++;
+        }
+        batch_end.notify_one();
+    }
+}
+
+void thread_pool::run(int nb_tasks, const task_function& functor) {
+
+    if (nb_tasks <= 0)
+        return;
+
+    // Nested call from a thread of a pool: the other threads may be busy with the outer batch
+    if (local_thread_index.has_value()) {
+        for (int task = 0; task < nb_tasks; task++) {
+            functor(task, *local_thread_index);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> submission_lock(submission_mut);
+
+    // Contiguous blocks of tasks are dealt to each thread
+    const unsigned int nb_threads = size();
+    const int block_size = nb_tasks / static_cast<int>(nb_threads);
+    const int remainder  = nb_tasks % static_cast<int>(nb_threads);
+    for (int start = 0, i = 0; i < static_cast<int>(nb_threads); i++) {
+        const int end = start + block_size + (i < remainder ? 1 : 0);
+        task_queue& queue = *queues[i];
+        std::lock_guard<std::mutex> lock(queue.mut);
+        for (int task = start; task < end; task++) {
+            queue.tasks.push_back(task);
+        }
+        start = end;
+    }
+
+    std::unique_lock<std::mutex> lock(mut);
+    current_function = &functor;
+    number_of_idle_threads = 0;
+    batch_number++;
+    batch_start.notify_all();
+
+    // All the threads must be done, so that none of them still holds a reference to the functor
+    batch_end.wait(lock, [&] { return number_of_idle_threads == nb_threads; });
+    current_function = nullptr;
+}
+
+std::optional<unsigned int> thread_pool::current_thread_index() {
+    return local_thread_index;
+}
+
+thread_pool& thread_pool::global() {
+    // Never destroyed, so that exit() can be called from a task without joining the calling thread
+    static thread_pool* const pool = new thread_pool();
+    return *pool;
+}
@@ -0,0 +1,86 @@
+#include "parallel/tiles.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+/* Index of (x, y) along the Morton (Z-order) curve */
+static uint64_t morton_index(uint32_t x, uint32_t y) {
+
+    const auto spread_bits = [] (uint64_t v) {
+        v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+        v = (v | (v << 8))  & 0x00FF00FF00FF00FFull;
+        v = (v | (v << 4))  & 0x0F0F0F0F0F0F0F0Full;
+        v = (v | (v << 2))  & 0x3333333333333333ull;
+        v = (v | (v << 1))  & 0x5555555555555555ull;
+        return v;
+    };
+
+    return spread_bits(x) | (spread_bits(y) << 1);
+}
+
+/* Index of (x, y) along the Hilbert curve filling the n x n square (n power of two) */
+static uint64_t hilbert_index(uint32_t n, uint32_t x, uint32_t y) {
+
+    uint64_t d = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2) {
+        const uint32_t rx = (x & s) > 0 ? 1 : 0;
+        const uint32_t ry = (y & s) > 0 ? 1 : 0;
+        d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+
+        // Rotation of the quadrant
+        if (ry == 0) {
+            if (rx == 1) {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+std::vector<tile> generate_tiles(int width, int height, int tile_size, tile_order order) {
+
+    const int nb_tiles_x = (width  + tile_size - 1) / tile_size;
+    const int nb_tiles_y = (height + tile_size - 1) / tile_size;
+
+    struct indexed_tile {
+        uint64_t index;
+        tile t;
+    };
+    std::vector<indexed_tile> indexed_tiles;
+    indexed_tiles.reserve(nb_tiles_x * nb_tiles_y);
+
+    // Side of the square grid of tiles covered by the Hilbert curve
+    uint32_t n = 1;
+    while (n < static_cast<uint32_t>(std::max(nb_tiles_x, nb_tiles_y))) {
+        n *= 2;
+    }
+
+    for (int ty = 0; ty < nb_tiles_y; ty++) {
+        for (int tx = 0; tx < nb_tiles_x; tx++) {
+
+            const uint64_t index =
+                  (order == tile_order::Morton)  ? morton_index(tx, ty)
+                : (order == tile_order::Hilbert) ? hilbert_index(n, tx, ty)
+                : static_cast<uint64_t>(ty * nb_tiles_x + tx);
+
+            const tile t {
+                .x_start = tx * tile_size,
+                .y_start = ty * tile_size,
+                .x_end   = std::min(width,  (tx + 1) * tile_size),
+                .y_end   = std::min(height, (ty + 1) * tile_size)
+            };
+            indexed_tiles.push_back({ index, t });
+        }
+    }
+
+    std::ranges::sort(indexed_tiles, {}, &indexed_tile::index);
+
+    std::vector<tile> tiles;
+    tiles.reserve(indexed_tiles.size());
+    for (const indexed_tile& it : indexed_tiles) {
+        tiles.push_back(it.t);
+    }
+    return tiles;
+}
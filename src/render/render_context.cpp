@@ -0,0 +1,25 @@
+#include "render/render_context.hpp"
+#include "parallel/thread_pool.hpp"
+
+render_context::render_context(const scene& scene, const unsigned int number_of_bounces,
+    const russian_roulette_mode russian_roulette, const nee_mode nee,
+    const uint64_t seed, const sampler_type sampler, const tracing_mode tracing, const adaptive_parameters adaptive,
+    const unsigned int first_sample)
+
+    : scene_(scene), tiles(generate_tiles(scene.width, scene.height)),
+      rg0(seed, ANTI_ALIASING), seed(seed), tracing(tracing), adaptive(adaptive), first_sample(first_sample) {
+
+    // All the threads share the seed: their generators are reseeded by the render loops for each pixel (or tile),
+    // from the seed and the pixel coordinates, so that the threads never draw the same sequences
+    const unsigned int nb_threads = thread_pool::global().size();
+    states.reserve(nb_threads);
+    for (unsigned int i = 0; i < nb_threads; i++) {
+        states.emplace_back(std::make_unique<const thread_state>(scene, seed, sampler,
+            number_of_bounces, russian_roulette, nee));
+    }
+}
+
+void render_context::skip_passes(const unsigned int number_of_passes) const {
+    for (unsigned int i = 0; i < number_of_passes; i++)
+        std::ignore = camera::generate_shift(rg0);
+}
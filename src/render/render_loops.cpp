@@ -1,11 +1,14 @@
 #include "render/render_loops.hpp"
+#include "render/render_context.hpp"
 #include "tracing/tracing.hpp"
 #include "parallel/parallel.hpp"
+#include "parallel/thread_pool.hpp"
 #include "auxiliary/timer.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <iostream>
-#include <thread>
+#include <vector>
 
 /* ********** Render loops ********** */
 
@@ -67,52 +70,132 @@ static void print_render_time(uint64_t elapsed, bool time_all) {
     printf("\n");
 }
 
+/* One sample pass on a tile */
+static void render_tile(image& image, const scene& scene, const tile& t,
+    const randomgen& rg, const worker& worker_, const camera::aa_shift& shift, const unsigned int first_sample) {
+
+    // The pixels of a tile always have the same number of samples
+    const int sample_index = first_sample + image.get_sample_count(t.y_start, t.x_start);
+    const bool aovs_enabled = image.aovs.is_enabled();
+
+    for (int j = t.y_start; j < t.y_end; j++) {
+        for (int i = t.x_start; i < t.x_end; i++) {
+
+            rg.reseed(i, j, sample_index);
+            const ray init_ray = scene.cam.gen_ray(i, j, rg, sample_index, shift);
+            aov_sample first_hit;
+            const rt::color new_color = worker_.pathtrace(init_ray, aovs_enabled ? &first_hit : nullptr);
+            image.add_sample(j, i, new_color, first_hit);
+        }
+    }
+}
+
+/* Wavefront version of the pass on a tile: the camera rays of the whole tile are traced together */
+static void render_tile_wavefront(image& image, const scene& scene, const tile& t,
+    const randomgen& rg, const worker& worker_, const camera::aa_shift& shift, const unsigned int first_sample) {
+
+    thread_local std::vector<ray> init_rays;
+    thread_local std::vector<randomgen::state> init_states;
+    thread_local std::vector<rt::color> colors;
+    thread_local std::vector<aov_sample> first_hits;
+
+    const int sample_index = first_sample + image.get_sample_count(t.y_start, t.x_start);
+
+    init_rays.clear();
+    init_states.clear();
+    for (int j = t.y_start; j < t.y_end; j++) {
+        for (int i = t.x_start; i < t.x_end; i++) {
+            rg.reseed(i, j, sample_index);
+            init_rays.push_back(scene.cam.gen_ray(i, j, rg, sample_index, shift));
+            // The bounces of the path continue the sequence of its pixel, as in render_tile
+            init_states.push_back(rg.save_state());
+        }
+    }
+    colors.resize(init_rays.size());
+    const bool aovs_enabled = image.aovs.is_enabled();
+    first_hits.resize(aovs_enabled ? init_rays.size() : 0);
+
+    worker_.pathtrace_wavefront(init_rays, init_states, colors, first_hits);
+
+    std::size_t k = 0;
+    for (int j = t.y_start; j < t.y_end; j++) {
+        for (int i = t.x_start; i < t.x_end; i++) {
+            if (aovs_enabled)
+                image.add_sample(j, i, colors[k], first_hits[k]);
+            else
+                image.add_sample(j, i, colors[k]);
+            k++;
+        }
+    }
+}
+
+/* Number of samples per pixel before the convergence of a tile is estimated */
+constexpr int ADAPTIVE_MIN_SAMPLES = 16;
+
+/* Adaptive sampling: a tile is converged when the relative error of each of its pixels is below threshold */
+static bool is_converged(const image& image, const tile& t, const real threshold) {
+
+    if (image.get_sample_count(t.y_start, t.x_start) < ADAPTIVE_MIN_SAMPLES)
+        return false;
+
+    for (int j = t.y_start; j < t.y_end; j++) {
+        for (int i = t.x_start; i < t.x_end; i++) {
+            if (image.relative_error(j, i) >= threshold)
+                return false;
+        }
+    }
+    return true;
+}
+
 /* Main render loop
-   If time_mode == Full, all lines produce a time measurement and output the estimated total time.
+   The image is cut into tiles, processed by the threads of the pool with work-stealing.
+   If time_mode == Full, the estimated total time is output regularly (every 5% of the tiles).
    If time_mode == Simple, only the total time is output at the end.
  */
 template<time_mode time_mode>
-void render_loop_parallel(image& image, const scene& scene, const unsigned int number_of_bounces, const russian_roulette_mode russian_roulette) {
+void render_loop_parallel(image& image, const render_context& context) {
 
     constexpr bool time_enabled = time_mode != time_mode::Disabled;
     constexpr bool time_all = time_mode == time_mode::Full;
-    const float x = 100.0f / static_cast<float>(scene.height);
+
+    const scene& scene = context.scene_;
+    const int nb_tiles = context.tiles.size();
+    const int print_step = std::max(1, nb_tiles / 20);
+    const float x = 100.0f / static_cast<float>(nb_tiles);
 
     std::atomic_int cpt = 0;
     timer_ms timer;
     if constexpr (time_enabled) {
         timer.start();
     }
+    const uint64_t start_time = timer_ms::get_time();
 
     // Anti-aliasing bias
-    static const randomgen rg0;
-    const camera::aa_shift shift = camera::generate_shift(rg0);
-    
-    parallel_for(scene.height, [&, number_of_bounces] (int j_start, int j_end) {
+    const camera::aa_shift shift = camera::generate_shift(context.rg0);
 
-        const randomgen rg;
-        const worker worker_(scene, rg, number_of_bounces, russian_roulette);
+    const bool adaptive = context.adaptive.a_mode == adaptive_parameters::mode::Enabled && image.is_adaptive();
+    const real threshold = static_cast<real>(context.adaptive.threshold);
 
-        for (int j = j_start; j < j_end; j++) {
+    parallel_for_tiles(context.tiles, [&] (const tile& t, unsigned int thread_index) {
 
-            const matrix::row row = image.data[j];
-            for (int i = 0; rt::color& color : row) {
+        const randomgen& rg = context.get_randomgen(thread_index);
+        const worker& worker_ = context.get_worker(thread_index);
 
-                const ray init_ray = scene.cam.gen_ray(i, j, rg, image.number_of_samples, shift);
-                const rt::color new_color = worker_.pathtrace(init_ray);
-                color += new_color;
-                i++;
-            }
+        if (not (adaptive && is_converged(image, t, threshold))) {
+            if (context.tracing == tracing_mode::Wavefront)
+                render_tile_wavefront(image, scene, t, rg, worker_, shift, context.first_sample);
+            else
+                render_tile(image, scene, t, rg, worker_, shift, context.first_sample);
         }
 
         if constexpr (time_all) {
-            timer.step();
-            cpt += 1;
-            const uint64_t elapsed = timer.elapsed();
-            const float progress = cpt * x;
-            print_estimated_time(elapsed, progress);
+            const int done = ++cpt;
+            if (done % print_step == 0) {
+                const uint64_t elapsed = timer_ms::get_time() - start_time;
+                const float progress = done * x;
+                print_estimated_time(elapsed, progress);
+            }
         }
-
     });
 
     if constexpr (time_enabled) {
@@ -124,19 +207,18 @@ void render_loop_parallel(image& image, const scene& scene, const unsigned int n
     image.increase_sample_count();
 }
 
-void render_loop(image& image, const scene& scene, const unsigned int number_of_bounces, const russian_roulette_mode russian_roulette) {
-    render_loop_parallel<time_mode::Disabled>(image, scene, number_of_bounces, russian_roulette);
+void render_loop(image& image, const render_context& context) {
+    render_loop_parallel<time_mode::Disabled>(image, context);
 }
 
-void render_loop_time(image& image, const scene& scene, const unsigned int number_of_bounces,
-    const russian_roulette_mode russian_roulette, const time_mode time_mode) {
+void render_loop_time(image& image, const render_context& context, const time_mode time_mode) {
 
     switch (time_mode) {
         case time_mode::Simple:
-            render_loop_parallel<time_mode::Simple>(image, scene, number_of_bounces, russian_roulette);
+            render_loop_parallel<time_mode::Simple>(image, context);
             break;
         case time_mode::Full:
-            render_loop_parallel<time_mode::Full>(image, scene, number_of_bounces, russian_roulette);
+            render_loop_parallel<time_mode::Full>(image, context);
             break;
         default:
             break;
@@ -155,39 +237,45 @@ void render_loop_parallel_multisample(image&, const scene&, const unsigned int,
 /// Experiment
 
 
-void render_loop_parallel_all_at_once(image& image, const scene& scene, const unsigned int number_of_bounces,
-    const russian_roulette_mode russian_roulette, const int target) {
+void render_loop_parallel_all_at_once(image& image, const render_context& context, const int target) {
+
+    const scene& scene = context.scene_;
+    const camera::aa_shift shift = camera::generate_shift(context.rg0);
 
-    static const randomgen rg0;
-    const camera::aa_shift shift = camera::generate_shift(rg0);
+    // Time spent by each thread of the pool
+    std::vector<uint64_t> thread_times(thread_pool::global().size(), 0);
 
-    parallel_for(scene.height, [&, number_of_bounces, russian_roulette, target] (int j_start, int j_end) {
+    parallel_for_tiles(context.tiles, [&, target] (const tile& t, unsigned int thread_index) {
 
         timer_ms timer;
         timer.start();
-        
-        const randomgen rg;
-        const worker worker_(scene, rg, number_of_bounces, russian_roulette);
 
-        for (int j = j_start; j < j_end; j++) {
+        const randomgen& rg = context.get_randomgen(thread_index);
+        const worker& worker_ = context.get_worker(thread_index);
+
+        for (int j = t.y_start; j < t.y_end; j++) {
             const matrix::row row = image.data[image.height() - 1 - j];
 
-            for (int i = 0; rt::color& color : row) {
+            for (int i = t.x_start; i < t.x_end; i++) {
 
                 for (int k = 0; k < target; k++) {
-                    ray r = scene.cam.gen_ray(i, j, rg, image.number_of_samples + k, shift);
+                    const int sample_index = context.first_sample + image.number_of_samples + k;
+                    rg.reseed(i, j, sample_index);
+                    ray r = scene.cam.gen_ray(i, j, rg, sample_index, shift);
                     const rt::color new_col = worker_.pathtrace(r);
-                    color += new_col;
+                    row[i] += new_col;
                 }
-                i++;
             }
         }
-    
+
         timer.stop();
-        std::cout << "Thread " << std::this_thread::get_id() << ": ";
-        timer.print();
+        thread_times[thread_index] += timer.elapsed();
     });
 
+    for (unsigned int i = 0; i < thread_times.size(); i++) {
+        printf("Thread %u: Time: %lums\n", i, static_cast<unsigned long int>(thread_times[i]));
+    }
+
     image.increase_sample_count(target);
 }
 
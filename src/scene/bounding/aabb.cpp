@@ -4,9 +4,9 @@
 
 #include "auxiliary/utils.hpp"
 
-real aabb::measure_distance(const ray& r) const {
+real aabb::measure_distance(const rt::vector& position, const rt::vector& dims, const ray& r) {
 
-    const auto& [ u, dir, inv_dir ] = r;
+    const auto& [ u, dir, inv_dir, _ ] = r;
 
     const rt::vector v = u - position;
 
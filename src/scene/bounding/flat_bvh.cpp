@@ -0,0 +1,112 @@
+#include "scene/bounding/flat_bvh.hpp"
+
+static constexpr unsigned int DEFAULT_STACK_SIZE = 200;
+
+flat_bvh::node flat_bvh::make_node(const bounding* bd) {
+
+    node n {
+        .position = rt::ZERO,
+        .dims     = rt::ZERO,
+        .first    = 0,
+        .count    = 0,
+        .type     = bd->type,
+        .has_box  = bd->b != nullptr
+    };
+
+    if (n.has_box) {
+        static_assert(std::is_same_v<bounding::box_type, aabb>, "Only aabb boxes can be flattened");
+        n.position = bd->b->get_stored_position();
+        n.dims     = bd->b->get_dims();
+    }
+    return n;
+}
+
+/* Fills the node with its range of children or primitives, then stores its children contiguously
+   and their subtrees after them (depth-first) */
+void flat_bvh::add_subtree(const uint32_t node_index, const bounding* const bd) {
+
+    if (bd->type == bounding::TerminalNode) {
+        const std::vector<const object*>& content = bd->get_content();
+        nodes[node_index].first = primitives.size();
+        nodes[node_index].count = content.size();
+        primitives.insert(primitives.end(), content.begin(), content.end());
+        return;
+    }
+
+    const std::span<const bounding * const> children = bd->get_children();
+    const uint32_t first = nodes.size();
+    nodes[node_index].first = first;
+    nodes[node_index].count = children.size();
+
+    for (const bounding* const child : children) {
+        nodes.push_back(make_node(child));
+    }
+    for (uint32_t i = 0; i < children.size(); i++) {
+        add_subtree(first + i, children[i]);
+    }
+}
+
+flat_bvh::flat_bvh(const std::span<const bounding * const> bounding_set)
+    : number_of_roots(bounding_set.size()) {
+
+    nodes.reserve(bounding::cpt);
+
+    // The first-level boundings are placed first
+    for (const bounding* const bd : bounding_set) {
+        nodes.push_back(make_node(bd));
+    }
+    for (uint32_t i = 0; i < number_of_roots; i++) {
+        add_subtree(i, bounding_set[i]);
+    }
+
+    nodes.shrink_to_fit();
+    primitives.shrink_to_fit();
+}
+
+void flat_bvh::find_closest(const ray& r, real& distance_to_closest, const object*& closest_object) const {
+
+    real d_closest       = distance_to_closest;
+    const object* cl_obj = closest_object;
+
+    static thread_local custom_stack<uint32_t> node_stack(DEFAULT_STACK_SIZE);
+    node_stack.set_empty();
+
+    // The first root is processed first
+    for (uint32_t i = number_of_roots; i > 0; i--) {
+        node_stack.push(i - 1);
+    }
+
+    while (not node_stack.empty()) {
+
+        uint32_t index = node_stack.pop();
+
+        /* The last child of an internal node is processed right away instead of being pushed and popped */
+        while (true) {
+
+            const node& n = nodes[index];
+
+            if (n.has_box && aabb::measure_distance(n.position, n.dims, r) >= d_closest)
+                break;
+
+            if (n.type == bounding::TerminalNode) {
+                for (const object* const obj : std::span(primitives).subspan(n.first, n.count)) {
+                    const real d = obj->measure_distance(r);
+                    if (d < d_closest) {
+                        d_closest = d;
+                        cl_obj = obj;
+                    }
+                }
+                break;
+            }
+
+            const uint32_t last = n.first + n.count - 1;
+            for (uint32_t child = n.first; child < last; child++) {
+                node_stack.push(child);
+            }
+            index = last;
+        }
+    }
+
+    distance_to_closest = d_closest;
+    closest_object      = cl_obj;
+}
@@ -0,0 +1,419 @@
+#include "scene/bounding/wide_bvh.hpp"
+
+#include "auxiliary/simd.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+static constexpr unsigned int DEFAULT_STACK_SIZE = 200;
+
+/* Coordinates (and inverse directions) are clamped to +/- this value, so that the lane tests
+   only handle finite values: a product with a zero never produces a NaN */
+static constexpr float LANE_INFINITY = 1e30f;
+
+/* Relative margin applied to the float boxes and to the entry and exit distances,
+   which covers the rounding of the ray and of the boxes to single precision.
+   The boxes are also enlarged, for each ray, by this margin relative to the magnitude of its origin,
+   since the rounding of the origin shifts the slab distances by an amount that does not depend on the size of the box */
+static constexpr float LANE_MARGIN = 0x1p-18f;
+
+/* Bounds of the rounding errors of the float triangle tests (see intersect_triangles),
+   relative to the products of the magnitudes of the operands
+   Determinants below DETERMINANT_TOLERANCE (relative to |d| |e1| |e2|) are considered grazing,
+   and BARYCENTRIC_TOLERANCE is a minimum tolerance of the barycentric coordinates */
+static constexpr float DETERMINANT_ERROR     = 0x1p-20f;
+static constexpr float NUMERATOR_ERROR       = 0x1p-18f;
+static constexpr float DETERMINANT_TOLERANCE = 0x1p-12f;
+static constexpr float BARYCENTRIC_TOLERANCE = 0x1p-10f;
+
+static inline float to_lane(const real x) {
+    return static_cast<float>(std::clamp(x, static_cast<real>(-LANE_INFINITY), static_cast<real>(LANE_INFINITY)));
+}
+
+/* Ray converted to the lane format */
+struct lane_ray {
+    float ox, oy, oz;
+    float dx, dy, dz;
+    float ix, iy, iz;
+    /* Magnitudes of the origin (largest coordinate) and of the direction (sum of the coordinates) */
+    float o_norm, d_norm;
+    /* Origin shifted by the margin of the boxes: the entry distances are computed from o + margin
+       and the exit distances from o - margin, which enlarges the boxes by the margin on every side */
+    float ox_entry, oy_entry, oz_entry;
+    float ox_exit,  oy_exit,  oz_exit;
+
+    explicit lane_ray(const ray& r)
+        : ox(to_lane(r.origin.x)),    oy(to_lane(r.origin.y)),    oz(to_lane(r.origin.z)),
+          dx(to_lane(r.direction.x)), dy(to_lane(r.direction.y)), dz(to_lane(r.direction.z)),
+          ix(to_lane(r.inv_dir.x)),   iy(to_lane(r.inv_dir.y)),   iz(to_lane(r.inv_dir.z)),
+          o_norm(std::max({ std::abs(ox), std::abs(oy), std::abs(oz) })),
+          d_norm(std::abs(dx) + std::abs(dy) + std::abs(dz)) {
+
+        const float margin = LANE_MARGIN * o_norm;
+        ox_entry = ox + margin; oy_entry = oy + margin; oz_entry = oz + margin;
+        ox_exit  = ox - margin; oy_exit  = oy - margin; oz_exit  = oz - margin;
+    }
+};
+
+/* Box tests of the width children of a node: places the entry distances of the children in t_near
+   and returns a bit mask of the children hit before t_max */
+template<unsigned int width>
+static inline unsigned int intersect_lanes(const typename wide_bvh<width>::node& n, const lane_ray& lr,
+    const float t_max, std::array<float, width>& t_near) {
+
+    using lanes = float_lanes<width>;
+
+    const lanes ix = lanes::broadcast(lr.ix), iy = lanes::broadcast(lr.iy), iz = lanes::broadcast(lr.iz);
+
+    /* (min - o - margin) / d and (max - o + margin) / d: whatever the sign of d,
+       the slab is enlarged by the margin of the origin on both sides */
+    const lanes t0x = (lanes::load(n.min_x.data()) - lanes::broadcast(lr.ox_entry)) * ix;
+    const lanes t1x = (lanes::load(n.max_x.data()) - lanes::broadcast(lr.ox_exit))  * ix;
+    const lanes t0y = (lanes::load(n.min_y.data()) - lanes::broadcast(lr.oy_entry)) * iy;
+    const lanes t1y = (lanes::load(n.max_y.data()) - lanes::broadcast(lr.oy_exit))  * iy;
+    const lanes t0z = (lanes::load(n.min_z.data()) - lanes::broadcast(lr.oz_entry)) * iz;
+    const lanes t1z = (lanes::load(n.max_z.data()) - lanes::broadcast(lr.oz_exit))  * iz;
+
+    const lanes t_in  = max(max(min(t0x, t1x), min(t0y, t1y)), max(min(t0z, t1z), lanes::broadcast(0.0f)));
+    const lanes t_out = min(min(max(t0x, t1x), max(t0y, t1y)), min(max(t0z, t1z), lanes::broadcast(t_max)));
+
+    const lanes near = t_in  * lanes::broadcast(1.0f - LANE_MARGIN);
+    const lanes far  = t_out * lanes::broadcast(1.0f + LANE_MARGIN);
+    near.store(t_near.data());
+    return le_mask(near, far);
+}
+
+/* Moller-Trumbore test of the width triangles of a block: returns a bit mask of the triangles
+   that may be hit before t_max, which are then tested exactly.
+
+   The tolerances bound the rounding errors of the float computation, so that the triangles hit by the exact test
+   are always candidates. With S = |o| + |p0| (largest coordinates) and |d|, |e1|, |e2| the sums of the coordinates,
+   the errors of det, s.p, d.q and e2.q are at most DETERMINANT_ERROR |d| |e1| |e2|, NUMERATOR_ERROR S |d| |e2|,
+   NUMERATOR_ERROR S |d| |e1| and NUMERATOR_ERROR S |e1| |e2|. Rays whose determinant is below DETERMINANT_TOLERANCE |d| |e1| |e2|
+   (at least twice its error) are always candidates, and for the others, the error of u (0 <= u <= 1 for a hit)
+   is at most (error(s.p) + error(det)) / |det|, and the error of t at most 2 (error(e2.q) + |t| error(det)) / |det|.
+   The errors grow with the distance of the triangle and of the ray origin to the origin of the scene,
+   relative to the size of the triangle. */
+template<unsigned int width>
+static inline unsigned int intersect_triangles(const typename wide_bvh<width>::triangle_block& b, const lane_ray& lr,
+    const float t_max) {
+
+    using lanes = float_lanes<width>;
+
+    const lanes dx = lanes::broadcast(lr.dx), dy = lanes::broadcast(lr.dy), dz = lanes::broadcast(lr.dz);
+    const lanes e1x = lanes::load(b.e1x.data()), e1y = lanes::load(b.e1y.data()), e1z = lanes::load(b.e1z.data());
+    const lanes e2x = lanes::load(b.e2x.data()), e2y = lanes::load(b.e2y.data()), e2z = lanes::load(b.e2z.data());
+
+    // p = d x e2
+    const lanes px = dy * e2z - dz * e2y;
+    const lanes py = dz * e2x - dx * e2z;
+    const lanes pz = dx * e2y - dy * e2x;
+    const lanes det = e1x * px + e1y * py + e1z * pz;
+
+    const lanes d_norm  = lanes::broadcast(lr.d_norm);
+    const lanes e1_norm = lanes::load(b.e1_norm.data());
+    const lanes e2_norm = lanes::load(b.e2_norm.data());
+    const lanes d_e1 = d_norm * e1_norm;
+    const lanes d_e2 = d_norm * e2_norm;
+    const lanes d_e1_e2 = d_e1 * e2_norm;
+
+    const unsigned int grazing = le_mask(abs(det), d_e1_e2 * lanes::broadcast(DETERMINANT_TOLERANCE));
+
+    const lanes inv_det = lanes::broadcast(1.0f) / det;
+
+    // s = o - p0, q = s x e1
+    const lanes sx = lanes::broadcast(lr.ox) - lanes::load(b.p0x.data());
+    const lanes sy = lanes::broadcast(lr.oy) - lanes::load(b.p0y.data());
+    const lanes sz = lanes::broadcast(lr.oz) - lanes::load(b.p0z.data());
+    const lanes qx = sy * e1z - sz * e1y;
+    const lanes qy = sz * e1x - sx * e1z;
+    const lanes qz = sx * e1y - sy * e1x;
+
+    const lanes u = (sx * px + sy * py + sz * pz) * inv_det;
+    const lanes v = (dx * qx + dy * qy + dz * qz) * inv_det;
+    const lanes t = (e2x * qx + e2y * qy + e2z * qz) * inv_det;
+
+    // Error bounds
+    const lanes abs_inv_det = abs(inv_det);
+    const lanes s_norm    = (lanes::broadcast(lr.o_norm) + lanes::load(b.p0_norm.data())) * lanes::broadcast(NUMERATOR_ERROR);
+    const lanes det_error = d_e1_e2 * lanes::broadcast(DETERMINANT_ERROR);
+    const lanes u_error = (s_norm * d_e2 + det_error) * abs_inv_det + lanes::broadcast(BARYCENTRIC_TOLERANCE);
+    const lanes v_error = (s_norm * d_e1 + det_error) * abs_inv_det + lanes::broadcast(BARYCENTRIC_TOLERANCE);
+    const lanes t_error = (s_norm * e1_norm * e2_norm + abs(t) * det_error) * (abs_inv_det + abs_inv_det);
+
+    const unsigned int inside =
+          le_mask(lanes::broadcast(0.0f) - u_error, u)
+        & le_mask(lanes::broadcast(0.0f) - v_error, v)
+        & le_mask(u + v, lanes::broadcast(1.0f) + u_error + v_error)
+        & le_mask(lanes::broadcast(0.0f) - t_error, t)
+        & le_mask(t, lanes::broadcast(t_max * (1.0f + LANE_MARGIN)) + t_error);
+
+    return (inside | grazing) & b.valid_mask;
+}
+
+/* Box of a lane: boxless boundings (containers of first-level objects) get an infinite box */
+static min_max_coord lane_box(const std::span<const bounding * const> items) {
+    rt::vector min = min_max_coord::min_empty;
+    rt::vector max = min_max_coord::max_empty;
+    for (const bounding* const bd : items) {
+        if (bd->b == nullptr)
+            return build_min_max_coord(
+                rt::vector(-infinity, -infinity, -infinity),
+                rt::vector( infinity,  infinity,  infinity));
+        bd->get_min_max_coord().update(min, max);
+    }
+    return build_min_max_coord(min, max);
+}
+
+static real surface_area(const bounding* const bd) {
+    const auto [ min_x, max_x, min_y, max_y, min_z, max_z ] = bd->get_min_max_coord();
+    const real dx = max_x - min_x;
+    const real dy = max_y - min_y;
+    const real dz = max_z - min_z;
+    return dx * dy + dy * dz + dz * dx;
+}
+
+/* Rounds outwards, with a margin relative to the magnitude of the coordinates */
+static inline float lower_bound(const real x, const real scale) {
+    return to_lane(x - scale * LANE_MARGIN);
+}
+
+static inline float upper_bound(const real x, const real scale) {
+    return to_lane(x + scale * LANE_MARGIN);
+}
+
+/* Packs the triangles of the content into blocks, and stores the other objects as primitives */
+template<unsigned int width>
+uint32_t wide_bvh<width>::add_leaf(const std::vector<const object*>& content) {
+
+    leaf l {
+        .first_block          = static_cast<uint32_t>(blocks.size()),
+        .number_of_blocks     = 0,
+        .first_primitive      = static_cast<uint32_t>(primitives.size()),
+        .number_of_primitives = 0
+    };
+
+    unsigned int lane = width;
+    for (const object* const obj : content) {
+
+        const triangle* const tr = dynamic_cast<const triangle*>(obj);
+        if (tr == nullptr) {
+            primitives.push_back(obj);
+            l.number_of_primitives++;
+            continue;
+        }
+
+        if (lane == width) {
+            triangle_block& b = blocks.emplace_back();
+            b.p0x.fill(0.0f); b.p0y.fill(0.0f); b.p0z.fill(0.0f);
+            b.e1x.fill(0.0f); b.e1y.fill(0.0f); b.e1z.fill(0.0f);
+            b.e2x.fill(0.0f); b.e2y.fill(0.0f); b.e2z.fill(0.0f);
+            b.p0_norm.fill(0.0f); b.e1_norm.fill(0.0f); b.e2_norm.fill(0.0f);
+            b.triangles.fill(nullptr);
+            b.valid_mask = 0;
+            l.number_of_blocks++;
+            lane = 0;
+        }
+
+        triangle_block& b = blocks.back();
+        const rt::vector& p0 = tr->get_position();
+        const auto [ e1, e2 ] = tr->get_v1_v2();
+
+        b.p0x[lane] = to_lane(p0.x); b.p0y[lane] = to_lane(p0.y); b.p0z[lane] = to_lane(p0.z);
+        b.e1x[lane] = to_lane(e1.x); b.e1y[lane] = to_lane(e1.y); b.e1z[lane] = to_lane(e1.z);
+        b.e2x[lane] = to_lane(e2.x); b.e2y[lane] = to_lane(e2.y); b.e2z[lane] = to_lane(e2.z);
+        b.p0_norm[lane] = std::max({ std::abs(b.p0x[lane]), std::abs(b.p0y[lane]), std::abs(b.p0z[lane]) });
+        b.e1_norm[lane] = std::abs(b.e1x[lane]) + std::abs(b.e1y[lane]) + std::abs(b.e1z[lane]);
+        b.e2_norm[lane] = std::abs(b.e2x[lane]) + std::abs(b.e2y[lane]) + std::abs(b.e2z[lane]);
+        b.triangles[lane] = tr;
+        b.valid_mask |= 1u << lane;
+        lane++;
+    }
+
+    leaves.push_back(l);
+    return leaves.size() - 1;
+}
+
+template<unsigned int width>
+uint32_t wide_bvh<width>::add_node(const std::span<const bounding * const> items) {
+
+    /* Collapse: the internal item of largest surface is replaced with its children,
+       as long as they fit in the node */
+    std::vector<const bounding*> lanes(items.begin(), items.end());
+    while (lanes.size() < width) {
+        auto largest = lanes.end();
+        real largest_area = -1.0_r;
+        for (auto it = lanes.begin(); it != lanes.end(); it++) {
+            const bounding* const bd = *it;
+            if (bd->type == bounding::node_type::InternalNode && bd->b != nullptr
+                && lanes.size() - 1 + bd->get_children().size() <= width
+                && surface_area(bd) > largest_area) {
+                largest = it;
+                largest_area = surface_area(bd);
+            }
+        }
+        if (largest == lanes.end())
+            break;
+
+        const std::span<const bounding * const> children = (*largest)->get_children();
+        *largest = children[0];
+        lanes.insert(lanes.end(), children.begin() + 1, children.end());
+    }
+
+    /* If there are too many items, they are dealt into width groups of neighbouring items */
+    const std::size_t nb_items  = lanes.size();
+    const std::size_t nb_lanes  = std::min<std::size_t>(nb_items, width);
+
+    const uint32_t index = nodes.size();
+    nodes.emplace_back();
+    {
+        node& n = nodes[index];
+        n.min_x.fill(LANE_INFINITY);  n.min_y.fill(LANE_INFINITY);  n.min_z.fill(LANE_INFINITY);
+        n.max_x.fill(-LANE_INFINITY); n.max_y.fill(-LANE_INFINITY); n.max_z.fill(-LANE_INFINITY);
+        n.child.fill(EMPTY_LANE);
+        n.count.fill(0);
+    }
+
+    for (std::size_t lane = 0, start = 0; lane < nb_lanes; lane++) {
+
+        const std::size_t end = start + nb_items / nb_lanes + (lane < nb_items % nb_lanes ? 1 : 0);
+        const std::span<const bounding * const> group = std::span(lanes).subspan(start, end - start);
+        start = end;
+
+        uint32_t child = EMPTY_LANE;
+        uint32_t count = 0;
+
+        if (group.size() == 1 && group[0]->type == bounding::node_type::TerminalNode) {
+            const std::vector<const object*>& content = group[0]->get_content();
+            if (not content.empty()) {
+                child = add_leaf(content);
+                count = content.size();
+            }
+        }
+        else if (group.size() == 1) {
+            if (not group[0]->get_children().empty())
+                child = add_node(group[0]->get_children());
+        }
+        else
+            child = add_node(group);
+
+        if (child == EMPTY_LANE)
+            continue;
+
+        // The recursive calls may have moved the nodes
+        node& n = nodes[index];
+        const auto [ min_x, max_x, min_y, max_y, min_z, max_z ] = lane_box(group);
+        const real scale = std::max({ std::abs(min_x), std::abs(max_x), std::abs(min_y),
+            std::abs(max_y), std::abs(min_z), std::abs(max_z) });
+
+        n.min_x[lane] = lower_bound(min_x, scale);
+        n.min_y[lane] = lower_bound(min_y, scale);
+        n.min_z[lane] = lower_bound(min_z, scale);
+        n.max_x[lane] = upper_bound(max_x, scale);
+        n.max_y[lane] = upper_bound(max_y, scale);
+        n.max_z[lane] = upper_bound(max_z, scale);
+        n.child[lane] = child;
+        n.count[lane] = count;
+    }
+
+    return index;
+}
+
+template<unsigned int width>
+wide_bvh<width>::wide_bvh(const std::span<const bounding * const> bounding_set) {
+
+    if (bounding_set.empty())
+        return;
+
+    nodes.reserve(bounding::cpt / (width / 2));
+    add_node(bounding_set);
+
+    nodes.shrink_to_fit();
+    leaves.shrink_to_fit();
+    blocks.shrink_to_fit();
+    primitives.shrink_to_fit();
+}
+
+template<unsigned int width>
+void wide_bvh<width>::find_closest(const ray& r, real& distance_to_closest, const object*& closest_object) const {
+
+    if (nodes.empty())
+        return;
+
+    real d_closest       = distance_to_closest;
+    const object* cl_obj = closest_object;
+
+    const lane_ray lr(r);
+
+    static thread_local custom_stack<uint32_t> node_stack(DEFAULT_STACK_SIZE);
+    node_stack.set_empty();
+    node_stack.push(0);
+
+    std::array<float, width> t_near;
+    std::array<std::pair<float, uint32_t>, width> internal_hits;
+
+    while (not node_stack.empty()) {
+
+        const node& n = nodes[node_stack.pop()];
+        unsigned int mask = intersect_lanes<width>(n, lr, to_lane(d_closest), t_near);
+
+        /* The terminal children are searched right away, the internal ones are sorted */
+        unsigned int nb_internal_hits = 0;
+        while (mask != 0) {
+            const unsigned int lane = std::countr_zero(mask);
+            mask &= mask - 1;
+
+            if (n.child[lane] == EMPTY_LANE)
+                continue;
+
+            if (n.count[lane] == 0) {
+                internal_hits[nb_internal_hits++] = { t_near[lane], n.child[lane] };
+                continue;
+            }
+
+            const leaf& l = leaves[n.child[lane]];
+
+            for (const triangle_block& b : std::span(blocks).subspan(l.first_block, l.number_of_blocks)) {
+                unsigned int candidates = intersect_triangles<width>(b, lr, to_lane(d_closest));
+                while (candidates != 0) {
+                    const triangle* const tr = b.triangles[std::countr_zero(candidates)];
+                    candidates &= candidates - 1;
+                    // Non-virtual call: the type is known
+                    const real d = tr->triangle::measure_distance(r);
+                    if (d < d_closest) {
+                        d_closest = d;
+                        cl_obj = tr;
+                    }
+                }
+            }
+
+            for (const object* const obj : std::span(primitives).subspan(l.first_primitive, l.number_of_primitives)) {
+                const real d = obj->measure_distance(r);
+                if (d < d_closest) {
+                    d_closest = d;
+                    cl_obj = obj;
+                }
+            }
+        }
+
+        /* Pushed from far to near, so that the nearest child is popped first (insertion sort: at most width children) */
+        for (unsigned int i = 1; i < nb_internal_hits; i++) {
+            const std::pair<float, uint32_t> h = internal_hits[i];
+            unsigned int j = i;
+            for (; j > 0 && internal_hits[j - 1].first < h.first; j--)
+                internal_hits[j] = internal_hits[j - 1];
+            internal_hits[j] = h;
+        }
+        for (unsigned int i = 0; i < nb_internal_hits; i++) {
+            if (static_cast<real>(internal_hits[i].first) < d_closest)
+                node_stack.push(internal_hits[i].second);
+        }
+    }
+
+    distance_to_closest = d_closest;
+    closest_object      = cl_obj;
+}
+
+template class wide_bvh<4>;
+template class wide_bvh<8>;
@@ -0,0 +1,61 @@
+#include "scene/light_sources/emissive_lights.hpp"
+
+#include "scene/objects/triangle.hpp"
+#include "scene/objects/quad.hpp"
+#include "scene/objects/sphere.hpp"
+
+#include <algorithm>
+
+bool emissive_lights::is_samplable(const object* obj) {
+    return dynamic_cast<const triangle*>(obj) != nullptr
+        || dynamic_cast<const quad*>    (obj) != nullptr
+        || dynamic_cast<const sphere*>  (obj) != nullptr;
+}
+
+emissive_lights::emissive_lights(const std::span<const object* const> object_set,
+    const std::span<const material> material_set) {
+
+    std::vector<real> powers;
+
+    for (const object* obj : object_set) {
+
+        const unsigned int index = obj->get_material_index();
+        if (index >= material_set.size())
+            continue;
+
+        const material& m = material_set[index];
+        if (not is_light_source(m) || not is_samplable(obj))
+            continue;
+
+        const real p = power(obj, m);
+        if (p <= 0.0_r)
+            continue;
+
+        total_power += p;
+        lights.push_back(obj);
+        powers.push_back(p);
+        cumulative_power.push_back(total_power);
+    }
+
+    pdf_areas.reserve(lights.size());
+    for (std::size_t i = 0; i < lights.size(); i++)
+        pdf_areas.emplace(lights[i], powers[i] / (total_power * lights[i]->area()));
+}
+
+emissive_lights::light_sample emissive_lights::sample(const randomgen& rg) const {
+
+    const real x = rg.random_real(total_power);
+    const std::size_t i = std::min(
+        static_cast<std::size_t>(std::upper_bound(cumulative_power.begin(), cumulative_power.end(), x) - cumulative_power.begin()),
+        lights.size() - 1
+    );
+
+    const object* const light = lights[i];
+    const real p = cumulative_power[i] - (i == 0 ? 0.0_r : cumulative_power[i - 1]);
+
+    return {
+        .light    = light,
+        .point    = light->sample(rg),
+        .pdf_area = p / (total_power * light->area())
+    };
+}
@@ -2,6 +2,7 @@
 
 #include "auxiliary/custom_stack.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <span>
 
@@ -9,28 +10,34 @@
 
 using Float = alias_table::Float;
 
-std::vector<Float> alias_table::compute_low_res_table(const matrix& matrix) {
+/* Pixel of column x and row y of a light map */
+static inline const rt::color& pixel(const matrix& map, const int x, const int y) {
+    return map[y, x];
+}
 
-    const int width  = std::min(LOWRES_DEFAULT_WIDTH,  static_cast<unsigned int>(matrix.width));
-    const int height = std::min(LOWRES_DEFAULT_HEIGHT, static_cast<unsigned int>(matrix.height));
-    
-    const Float ratio_x = static_cast<Float>(matrix.width)  / LOWRES_DEFAULT_WIDTH;
-    const Float ratio_y = static_cast<Float>(matrix.height) / LOWRES_DEFAULT_HEIGHT;
+static inline rt::color pixel(const texture& map, const int x, const int y) {
+    return map.get_texel(x, y);
+}
+
+template<typename Map>
+static std::vector<Float> low_res_table(const Map& map, const unsigned int map_width, const unsigned int map_height,
+    const unsigned int width, const unsigned int height) {
+
+    const Float ratio_x = static_cast<Float>(map_width)  / width;
+    const Float ratio_y = static_cast<Float>(map_height) / height;
     const Float r = PI / height;
 
     const int table_size = height * width;
     std::vector<Float> table(table_size);
 
-    Float phi = 0.0f;
-    for (int ly = 0; ly < height; ly++) {
+    // Sine of the polar angle at the center of each row (the area of the pixels on the sphere)
+    for (unsigned int ly = 0; ly < height; ly++) {
 
-        const Float sinphi = sin(phi);
+        const Float sinphi = sin((ly + 0.5f) * r);
         const int l = ly * width;
 
-        for (int i = l; i < l + width; i++)
+        for (unsigned int i = l; i < l + width; i++)
             table[i] = sinphi;
-
-        phi += r;
     }
 
     for (int i = 0; i < table_size; i++) {
@@ -38,32 +45,49 @@ std::vector<Float> alias_table::compute_low_res_table(const matrix& matrix) {
         const int lx = i % width;
         const int ly = i / width;
 
-        // Sampling the high res matrix and averaging the pixels
+        // Sampling the high res map and averaging the pixels
         const int init_x  =  lx      * ratio_x;
-        const int bound_x = (lx + 1) * ratio_x;
+        const int bound_x = std::max(init_x + 1, std::min(static_cast<int>((lx + 1) * ratio_x), static_cast<int>(map_width)));
         const int init_y  =  ly      * ratio_y;
-        const int bound_y = (ly + 1) * ratio_y;
+        const int bound_y = std::max(init_y + 1, std::min(static_cast<int>((ly + 1) * ratio_y), static_cast<int>(map_height)));
 
         rt::color sum;
         for (int y = init_y; y < bound_y; y++) {
             for (int x = init_x; x < bound_x; x++)
-                sum += matrix[y, x];
+                sum += pixel(map, x, y);
         }
         sum /= (bound_x - init_x) * (bound_y - init_y);
         table[i] *= static_cast<Float>(sum.get_average());
     }
 
-    // Normalize the table
-    Float weight_sum = 0.0;
+    // Normalize the table (uniform for a black map)
+    double weight_sum = 0.0;
     for (const Float x : table)
         weight_sum += x;
 
+    if (weight_sum <= 0.0) {
+        std::fill(table.begin(), table.end(), 1.0f / table_size);
+        return table;
+    }
+
     for (Float& p : table)
-        p /= weight_sum;
+        p = static_cast<Float>(p / weight_sum);
 
     return table;
 }
 
+std::vector<Float> alias_table::compute_low_res_table(const matrix& matrix,
+    const unsigned int width, const unsigned int height) {
+
+    return low_res_table(matrix, matrix.width, matrix.height, width, height);
+}
+
+std::vector<Float> alias_table::compute_low_res_table(const texture& texture,
+    const unsigned int width, const unsigned int height) {
+
+    return low_res_table(texture, texture.get_width(), texture.get_height(), width, height);
+}
+
 alias_table::alias_table(const std::vector<Float>& prob_table,
     const unsigned int map_width,
     const unsigned int map_height,
@@ -71,10 +95,11 @@ alias_table::alias_table(const std::vector<Float>& prob_table,
     const unsigned int pt_height)
     
     :
+        probabilities(prob_table),
         map_width(map_width),
         map_height(map_height),
         pt_width(pt_width),
-        //pt_height(pt_height),
+        pt_height(pt_height),
         ratio_x(static_cast<Float>(map_width)  / pt_width),
         ratio_y(static_cast<Float>(map_height) / pt_height) {
 
@@ -166,4 +191,40 @@ light_map_sample alias_table::sample_light_map(const random_ratio_gen<Float>& rg
     const unsigned int x = min_x + rg.random(max_x - min_x);
     const unsigned int y = min_y + rg.random(max_y - min_y);
     return { x, y };
-}
\ No newline at end of file
+}
+
+
+/* Infinite area light */
+
+infinite_area_light::uv_sample infinite_area_light::sample(const randomgen& rg) const {
+
+    const unsigned int s = table.sample_table(static_cast<Float>(rg.random_ratio()));
+    const auto [ du, dv ] = rg.random_ratios<2>();
+
+    const real u = (static_cast<real>(s % table.pt_width) + du) / table.pt_width;
+    const real v = (static_cast<real>(s / table.pt_width) + dv) / table.pt_height;
+
+    const real sinphi = std::sin(v * PI);
+    return {
+        .u   = u,
+        .v   = v,
+        .pdf = (sinphi > 0.0_r) ?
+              static_cast<real>(table.probabilities[s]) * static_cast<real>(table.probabilities.size()) / (2.0_r * PI * PI * sinphi)
+            : 0.0_r
+    };
+}
+
+/* The pixel (u, v) is chosen with probability p(pixel) * width * height per unit of texture area,
+   and the texture area du dv covers a solid angle of 2 pi^2 sin(phi) du dv */
+real infinite_area_light::pdf(const real u, const real v) const {
+
+    const real sinphi = std::sin(v * PI);
+    if (sinphi <= 0.0_r)
+        return 0.0_r;
+
+    const unsigned int x = std::min(static_cast<unsigned int>(std::max(u, 0.0_r) * table.pt_width),  table.pt_width  - 1);
+    const unsigned int y = std::min(static_cast<unsigned int>(std::max(v, 0.0_r) * table.pt_height), table.pt_height - 1);
+
+    return static_cast<real>(table.probabilities[y * table.pt_width + x]) * static_cast<real>(table.probabilities.size())
+        / (2.0_r * PI * PI * sinphi);
+}
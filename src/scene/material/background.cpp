@@ -5,7 +5,7 @@
 #include <cmath>
 
 /* Returns the color of the pixel dir is pointing at, when a texture is set */
-const rt::color& background_container::get_texture_color(const rt::vector& dir) const {
+rt::color background_container::get_texture_color(const rt::vector& dir) const {
     
     const rt::vector dir_rotated = rotation_matrix * dir;
     const auto& [ theta, phi ] = trig::get_angles(dir_rotated);
@@ -15,4 +15,29 @@ const rt::color& background_container::get_texture_color(const rt::vector& dir)
     const real v = phi / PI;
 
     return bg_texture.get_color(u, v);
-}
\ No newline at end of file
+}
+
+/* Inverse of the mapping of get_texture_color */
+rt::vector background_container::get_direction(const real u, const real v) const {
+
+    const real theta = (2.0_r * PI) * u;
+    const real phi   = PI * v;
+    const real sin_phi = std::sin(phi);
+
+    const rt::vector dir_rotated(-std::sin(theta) * sin_phi, std::cos(phi), std::cos(theta) * sin_phi);
+    return inverse_rotation_matrix * dir_rotated;
+}
+
+background_container::direction_sample background_container::sample_direction(const randomgen& rg) const {
+
+    const auto [ u, v, pdf_dir ] = light->sample(rg);
+    return { get_direction(u, v), pdf_dir };
+}
+
+real background_container::pdf(const rt::vector& dir) const {
+
+    const rt::vector dir_rotated = rotation_matrix * dir;
+    const auto& [ theta, phi ] = trig::get_angles(dir_rotated);
+
+    return light->pdf(theta / (2.0_r * PI), phi / PI);
+}
@@ -1,29 +1,76 @@
 #include "scene/material/normal_map.hpp"
 
 #include "file_readers/image_files/normal_map_reader.hpp"
+#include "parallel/parallel.hpp"
 
+#include <cstdio>
 #include <stdexcept>
 
-normal_map::normal_map(const unsigned int w, const unsigned int h, vector_matrix&& data)
-    : data(std::move(data)),
-      width(w - 1), height(h - 1),
-      width_real(width),
-      height_real(height) {}
+std::size_t normal_map::compute_levels() {
 
+    levels.clear();
+    std::size_t offset = 0;
+    unsigned int w = width, h = height;
+    while (true) {
+        levels.push_back({
+            .offset = offset, .width = w, .height = h,
+            .max_x = static_cast<real>(w) - 1.0_r, .max_y = static_cast<real>(h) - 1.0_r
+        });
+        offset += static_cast<std::size_t>(w) * h;
+        if (w <= 1 && h <= 1)
+            return offset;
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+}
+
+void normal_map::build_mipmaps() {
+
+    for (std::size_t l = 1; l < levels.size(); l++) {
+        const level& previous = levels[l - 1];
+        const level& current  = levels[l];
+
+        parallel_for(current.height, [&] (int j) {
+
+            const unsigned int y0 = std::min(2 * j,     static_cast<int>(previous.height) - 1);
+            const unsigned int y1 = std::min(2 * j + 1, static_cast<int>(previous.height) - 1);
+            for (unsigned int i = 0; i < current.width; i++) {
+                const unsigned int x0 = std::min(2 * i,     previous.width - 1);
+                const unsigned int x1 = std::min(2 * i + 1, previous.width - 1);
+                const rt::vector first = get_normal(previous, x0, y0);
+                const rt::vector sum = first + get_normal(previous, x1, y0)
+                    + get_normal(previous, x0, y1) + get_normal(previous, x1, y1);
+                // The normals of opposite directions average to zero: the first one is kept
+                data[current.offset + static_cast<std::size_t>(j) * current.width + i] =
+                    encode((sum.normsq() > 0.0_r) ? sum.unit() : first);
+            }
+        });
+    }
+}
+
+normal_map::normal_map(normals&& n)
+    : data(std::move(n.data)), width(n.width), height(n.height) {
+
+    data.resize(compute_levels());
+    build_mipmaps();
+}
 
 /* Constructor from a .bmp file */
 normal_map::normal_map(const std::string& file_name) {
 
-    std::optional<vector_matrix> vm_opt = read_normal_map(file_name);
-    if (not vm_opt.has_value())
+    std::optional<normals> normals_opt = read_normal_map(file_name);
+    if (not normals_opt.has_value())
         throw std::runtime_error("Error in normal map definition: could not read image file\n");
 
-    data = std::move(vm_opt.value());
-    width  = data.size()    - 1;
-    height = data[0].size() - 1;
-    width_real  = static_cast<real>(width);
-    height_real = static_cast<real>(height);
+    *this = normal_map(std::move(normals_opt.value()));
 }
 
+std::string normal_map::memory_report() const {
 
+    constexpr double MB = 1024.0 * 1024.0;
 
+    char report[128];
+    std::snprintf(report, sizeof(report), "%ux%u octahedral, %.1f MB instead of %.1f MB",
+        width, height, memory_size() / MB, static_cast<double>(width) * height * sizeof(rt::vector) / MB);
+    return report;
+}
@@ -2,9 +2,132 @@
 
 #include "file_readers/image_files/bmp_reader.hpp"
 #include "file_readers/image_files/hdr_reader.hpp"
+#include "parallel/parallel.hpp"
+#include "auxiliary/half.hpp"
 
+#include <cmath>
+#include <cstdio>
 #include <filesystem>
 
+/* Components of the color c in half-precision floats (the negative components are replaced by 0) */
+static std::array<uint16_t, 3> color_to_half(const rt::color& c) {
+    return {
+        float_to_half(static_cast<float>(std::max(c.red,   0.0))),
+        float_to_half(static_cast<float>(std::max(c.green, 0.0))),
+        float_to_half(static_cast<float>(std::max(c.blue,  0.0)))
+    };
+}
+
+/* Encodes the color c (non-negative components) in the RGBE format in rgbe,
+   such that the decoded components are mantissa * 2^(exponent - 128) (as in hdr::read_file) */
+static void color_to_rgbe(const rt::color& c, uint8_t* rgbe) {
+
+    const double max = std::max({ c.red, c.green, c.blue });
+    if (not (max >= 0x1p-120)) {
+        // Below the smallest exponent
+        std::fill(rgbe, rgbe + 4, 0);
+        return;
+    }
+
+    int exponent;
+    std::frexp(max, &exponent); // max = fraction * 2^exponent, fraction in [0.5, 1)
+    const int biased_exponent = std::min(exponent + 120, 255);
+    const double scale = std::ldexp(1.0, 128 - biased_exponent);
+
+    for (const double component : { c.red, c.green, c.blue })
+        *(rgbe++) = static_cast<uint8_t>(std::min(component * scale, 255.0));
+    *rgbe = static_cast<uint8_t>(biased_exponent);
+}
+
+std::size_t texture::compute_levels() {
+
+    levels.clear();
+    std::size_t offset = 0;
+    unsigned int w = width, h = height;
+    while (true) {
+        levels.push_back({
+            .offset = offset, .width = w, .height = h,
+            .max_x = static_cast<real>(w) - 1.0_r, .max_y = static_cast<real>(h) - 1.0_r
+        });
+        offset += static_cast<std::size_t>(w) * h;
+        if (w <= 1 && h <= 1)
+            return offset;
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+}
+
+void texture::encode(const rt::color& c, uint8_t* t) const {
+
+    switch (format) {
+        case texel_format::RGB8:
+            /* Inverse of the table (increasing): closest entry */
+            for (const double component : { c.red, c.green, c.blue }) {
+                const auto it = std::lower_bound(component_table.begin(), component_table.end(), component);
+                std::size_t index = std::distance(component_table.begin(), it);
+                if (index == component_table.size()
+                    || (index > 0 && component - component_table[index - 1] < component_table[index] - component))
+                    index--;
+                *(t++) = static_cast<uint8_t>(index);
+            }
+            return;
+
+        case texel_format::RGBE:
+            color_to_rgbe(c, t);
+            return;
+
+        case texel_format::Half: {
+            const std::array<uint16_t, 3> h = color_to_half(c);
+            std::memcpy(t, h.data(), sizeof(h));
+            return;
+        }
+
+        default: throw;
+    }
+}
+
+void texture::build_mipmaps() {
+
+    const std::size_t bytes = bytes_per_texel(format);
+
+    for (std::size_t l = 1; l < levels.size(); l++) {
+        const level& previous = levels[l - 1];
+        const level& current  = levels[l];
+
+        parallel_for(current.height, [&] (int j) {
+
+            const unsigned int y0 = std::min(2 * j,     static_cast<int>(previous.height) - 1);
+            const unsigned int y1 = std::min(2 * j + 1, static_cast<int>(previous.height) - 1);
+            for (unsigned int i = 0; i < current.width; i++) {
+                const unsigned int x0 = std::min(2 * i,     previous.width - 1);
+                const unsigned int x1 = std::min(2 * i + 1, previous.width - 1);
+                const rt::color average =
+                    (get_texel(x0, y0, l - 1) + get_texel(x1, y0, l - 1)
+                   + get_texel(x0, y1, l - 1) + get_texel(x1, y1, l - 1)) * 0.25;
+                encode(average, texels.data() + bytes * (current.offset + static_cast<std::size_t>(j) * current.width + i));
+            }
+        });
+    }
+}
+
+texture::texture(const matrix& matrix)
+    : format(texel_format::Half), width(matrix.width), height(matrix.height) {
+
+    texels.resize(bytes_per_texel(format) * compute_levels());
+
+    parallel_for(height, [&] (int j) {
+
+        uint8_t* t = texels.data() + bytes_per_texel(format) * width * j;
+        for (const rt::color& c : matrix[j]) {
+            const std::array<uint16_t, 3> h = color_to_half(c);
+            std::memcpy(t, h.data(), sizeof(h));
+            t += sizeof(h);
+        }
+    });
+
+    build_mipmaps();
+}
+
 /* Constructor from a .bmp or .hdr file */
 texture::texture(const std::string& file_name, std::optional<real> gamma) {
 
@@ -13,20 +136,63 @@ texture::texture(const std::string& file_name, std::optional<real> gamma) {
     const bool is_right_format = is_bmp || extension == ".hdr";
     if (not is_right_format)
         throw std::runtime_error("Error in texture definition: wrong file format\n");
-    
-    std::expected<matrix, file_reader::error> mat_opt = (is_bmp) ?
-          bmp::read_file(file_name)
-        : hdr::read_file(file_name);
-    if (not mat_opt.has_value())
-        throw std::runtime_error("Error in texture definition: could not read image file\n");
 
-    data = std::move(mat_opt.value());
-    if (gamma.has_value())
-        data.apply_gamma(gamma.value());
+    if (is_bmp) {
+        std::expected<bmp::pixels, file_reader::error> pixels_opt = bmp::read_pixels(file_name);
+        if (not pixels_opt.has_value())
+            throw std::runtime_error("Error in texture definition: could not read image file\n");
+
+        format = texel_format::RGB8;
+        width  = pixels_opt.value().width;
+        height = pixels_opt.value().height;
+        texels = std::move(pixels_opt.value().data);
+        texels.resize(bytes_per_texel(format) * compute_levels());
+
+        /* The gamma correction only depends on the value of the component */
+        for (unsigned int i = 0; i < component_table.size(); i++) {
+            rt::color c(i, i, i);
+            if (gamma.has_value())
+                c.apply_gamma(gamma.value());
+            component_table[i] = c.red;
+        }
+    }
+    else {
+        std::expected<hdr::pixels, file_reader::error> pixels_opt = hdr::read_pixels(file_name);
+        if (not pixels_opt.has_value())
+            throw std::runtime_error("Error in texture definition: could not read image file\n");
+
+        format = texel_format::RGBE;
+        width  = pixels_opt.value().width;
+        height = pixels_opt.value().height;
+        texels = std::move(pixels_opt.value().data);
+        texels.resize(bytes_per_texel(format) * compute_levels());
+
+        for (int e = 0; e < static_cast<int>(component_table.size()); e++)
+            component_table[e] = std::ldexp(1.0f, e - 128);
 
-    width  = data.width  - 1;
-    height = data.height - 1;
-    width_real  = static_cast<real>(width);
-    height_real = static_cast<real>(height);
+        /* The gamma correction is applied to the decoded colors, which are encoded again */
+        if (gamma.has_value()) {
+            parallel_for(height, [&] (int j) {
+                for (unsigned int i = 0; i < width; i++) {
+                    rt::color c = get_texel(i, j);
+                    c.apply_gamma(gamma.value());
+                    color_to_rgbe(c, texels.data() + bytes_per_texel(format) * (width * j + i));
+                }
+            });
+        }
+    }
+
+    build_mipmaps();
 }
 
+std::string texture::memory_report() const {
+
+    constexpr char const* format_names[] = { "RGB8", "RGBE", "half" };
+    constexpr double MB = 1024.0 * 1024.0;
+
+    char report[128];
+    std::snprintf(report, sizeof(report), "%ux%u %s, %.1f MB instead of %.1f MB",
+        width, height, format_names[static_cast<int>(format)],
+        memory_size() / MB, static_cast<double>(width) * height * sizeof(rt::color) / MB);
+    return report;
+}
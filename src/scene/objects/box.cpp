@@ -132,7 +132,7 @@ min_max_coord box::get_min_max_coord() const {
    The box is assumed to be standard (axes are n1 = (1, 0, 0), n2 = (0, 1, 0), n3 = (0, 0, 1)) */
 bool box::is_hit_by(const ray& r) const {
     
-    const auto& [ u, dir, inv_dir ] = r;
+    const auto& [ u, dir, inv_dir, _ ] = r;
     const rt::vector abs_inv_dir = rt::abs(inv_dir);
 
     // See measure_distance
@@ -162,7 +162,7 @@ bool box::is_hit_by(const ray& r) const {
    The box is assumed to be an AABB */
 real box::is_hit_with_distance(const ray& r) const {
     
-    const auto& [ u, dir, inv_dir ] = r;
+    const auto& [ u, dir, inv_dir, _ ] = r;
 
     // See measure_distance
 
@@ -224,6 +224,11 @@ rt::vector box::sample_visible(const randomgen&, const rt::vector&) const {
     throw std::runtime_error("Sampling is unavailable for boxes");
 }
 
+real box::area() const {
+    const rt::vector l = get_l();
+    return 8.0_r * (l.x * l.y + l.y * l.z + l.z * l.x);
+}
+
 void box::print() const {
     printf("Box: ");
     printf("center: ");
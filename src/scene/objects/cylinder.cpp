@@ -242,6 +242,10 @@ rt::vector cylinder::sample_visible(const randomgen&, const rt::vector&) const {
     throw std::runtime_error("Sampling is unavailable for cylinders");
 }
 
+real cylinder::area() const {
+    return 2.0_r * PI * radius * (length + radius);
+}
+
 void cylinder::print() const {
     printf("Cylinder: ");
     printf("position: ");
@@ -105,6 +105,10 @@ rt::vector plane::sample_visible(const randomgen&, const rt::vector&) const {
     throw std::runtime_error("Sampling is unavailable for planes");
 }
 
+real plane::area() const {
+    return infinity;
+}
+
 void plane::print() const {
     printf("Plane: ");
     printf("normal: ");
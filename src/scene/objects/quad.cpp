@@ -264,6 +264,10 @@ rt::vector quad::sample_visible(const randomgen& rg, const rt::vector& /*pt*/) c
     return sample(rg);
 }
 
+real quad::area() const {
+    return 0.5_r * ((v1 ^ v2).norm() + (v2 ^ v3).norm());
+}
+
 void quad::print() const {
     printf("Quad: ");
     printf("p0 = ");
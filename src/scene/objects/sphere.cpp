@@ -112,6 +112,10 @@ rt::vector sphere::sample_visible(const randomgen& rg, const rt::vector& pt) con
     return direction::random<Pi_over_2>(rg, (pt - position).unit());
 }
 
+real sphere::area() const {
+    return 4.0_r * PI * radius_sq;
+}
+
 void sphere::print() const {
     printf("Sphere: ");
     printf("center: "); position.print();
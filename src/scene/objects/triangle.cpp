@@ -99,7 +99,7 @@ inline rt::vector triangle::get_barycenter() const {
 real triangle::measure_distance(const ray& r) const {
     // See Math-details.md
 
-    const auto& [ u, dir, _ ] = r;
+    const auto& [ u, dir, _, _ ] = r;
 
     const real pdt  = (normal | dir);
     const real upln = (normal | u) + d;
@@ -242,6 +242,10 @@ inline rt::vector triangle::sample_visible(const randomgen& rg, const rt::vector
     return sample(rg);
 }
 
+real triangle::area() const {
+    return 0.5_r * (v1 ^ v2).norm();
+}
+
 void triangle::print() const {
     printf("Triangle: ");
     printf("p0 = ");
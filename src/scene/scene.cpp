@@ -15,17 +15,19 @@ scene::scene(
     scene::containers::orientation&& orientation_containers,
     camera&& cam,
     const int width, const int height,
-    const unsigned int polygons_per_bounding,
+    const bvh_parameters& bvh_params,
     const std::optional<real> gamma) :
     
     object_set              (std::move(object_set)),
     bounding_set            (std::move(bounding_set)),
+    flat_hierarchy          (this->bounding_set),
     object_containers       (std::move(object_containers)),
     mapping_containers      (std::move(mapping_containers)),
     orientation_containers  (std::move(orientation_containers)),
+    lights                  (this->object_set, this->mapping_containers.material_set),
     cam                     (std::move(cam)),
     width(width), height(height),
-    polygons_per_bounding(polygons_per_bounding),
+    bvh_params(bvh_params),
     gamma(gamma) {}
 
 
@@ -152,40 +154,16 @@ std::optional<hit> scene::find_closest_object(const ray& r) const {
 
 /* Tree-search through the bounding boxes */
 std::optional<hit> scene::find_closest_object_bounding(const ray& r) const {
-    /* For all the bounding boxes in bounding::set, we do the following:
-       If the bounding box is terminal, look for the object of minimum distance.
-       If it is internal, if the ray intersects the box, add its children to the bounding stack.
-       Then apply the same algorithm to the bounding stack, until it is empty.
+    /* The search goes through the flattened hierarchy:
+       if a node is terminal, look for the object of minimum distance in its range of primitives,
+       if it is internal and the ray intersects its box, its children are searched.
        Finally, compute the hit associated with the object of minimum distance.
      */
 
     real distance_to_closest  = infinity;
     const object* closest_obj = nullptr;
-    
-    static thread_local custom_stack<const bounding*> bounding_stack(DEFAULT_STACK_SIZE);
-    bounding_stack.set_empty();
-
-    /* Pass through the set of first-level bounding boxes */
-    for (const bounding* const bd : bounding_set) {
-        bd->check_box(r, bounding_stack, distance_to_closest, closest_obj);
-    }
-
-    /* In order to avoid pushing and then immediately popping an element from bounding_stack,
-       we store the last element of bd->children in next_bounding.
-       The boolean bd_stored indicates whether we should pop an element, or if one is currently
-       stored.
-     */
-    const bounding* next_bounding = nullptr;
-    bool bd_stored = false;
-
-    /* Apply the same to the bounding box stack */
-    while (bd_stored || (not bounding_stack.empty())) {
 
-        const bounding* bd = bd_stored ? next_bounding : bounding_stack.pop();
-        
-        bd->check_box_next(r, bounding_stack, distance_to_closest, closest_obj,
-            bd_stored, next_bounding);
-    }
+    flat_hierarchy.find_closest(r, distance_to_closest, closest_obj);
 
     /* Finally, return the hit corresponding to the closest object intersected by the ray */
     return (closest_obj != nullptr) ?
@@ -193,7 +171,7 @@ std::optional<hit> scene::find_closest_object_bounding(const ray& r) const {
         : std::nullopt;
 }
 
-const rt::color& scene::sample_color(const hit& h, const material& m) const {
+rt::color scene::sample_color(const hit& h, const material& m) const {
 
     const auto& [ _, comp_set, texture_set, _, _ ] = mapping_containers;
 
@@ -215,7 +193,52 @@ const rt::color& scene::sample_color(const hit& h, const material& m) const {
     return texture_set[mi->index].get_color(u, v);
 }
 
-map_sample scene::sample_maps(const hit& h, const material& m) const {
+/* Largest elongation of the footprint of a ray on a surface seen at a grazing angle */
+static constexpr real MAX_FOOTPRINT_ELONGATION = 8.0_r;
+
+/* Differences of the UV-coordinates between the hit point and the ends of the axes of the footprint of the ray
+   (the minor axis, and the major axis in the direction of the ray, elongated by the grazing angle),
+   computed on the tangent plane of the surface */
+static std::pair<uvcoord, uvcoord> footprint_uv_differences(const hit& h, const ray& r,
+    const uvcoord& uv, const auto& compute_uv) {
+
+    const rt::vector& p = h.get_point();
+    const rt::vector& n = h.get_normal();
+    const real width = r.footprint.width_at((p - r.origin).norm());
+
+    const real cos_theta = r.direction | n;
+    const rt::vector along = fma(n, -cos_theta, r.direction);
+    const real sin_theta = along.norm();
+
+    /* Orthonormal basis of the tangent plane, its first vector in the direction of the ray */
+    const rt::vector major = (sin_theta > 1e-3_r) ?
+          along / sin_theta
+        : (n ^ (std::abs(n.x) < 0.9_r ? rt::vector(1.0_r, 0.0_r, 0.0_r) : rt::vector(0.0_r, 1.0_r, 0.0_r))).unit();
+    const rt::vector minor = n ^ major;
+    const real elongation = std::min(1.0_r / std::max(std::abs(cos_theta), 1e-6_r), MAX_FOOTPRINT_ELONGATION);
+
+    const auto difference = [&] (const rt::vector& offset) {
+        const auto [ u, v ] = compute_uv(fma(offset, width, p));
+        return uvcoord { u - uv.u, v - uv.v };
+    };
+    return { difference(major * elongation), difference(minor) };
+}
+
+/* Level of detail (log2 of the size of the footprint, in texels) of a map of dimensions width x height,
+   for a footprint spanning the UV-differences d1 and d2 */
+static inline real level_of_detail(const std::pair<uvcoord, uvcoord>& differences,
+    const unsigned int width, const unsigned int height) {
+
+    const auto& [ d1, d2 ] = differences;
+    const real w = static_cast<real>(width);
+    const real h = static_cast<real>(height);
+    const real size_sq = std::max(
+        (d1.u * w) * (d1.u * w) + (d1.v * h) * (d1.v * h),
+        (d2.u * w) * (d2.u * w) + (d2.v * h) * (d2.v * h));
+    return (size_sq > 1.0_r) ? 0.5_r * std::log2(size_sq) : 0.0_r;
+}
+
+map_sample scene::sample_maps(const hit& h, const material& m, const ray& r) const {
 
     const auto& [ material_set, comp_set, texture_set, normal_map_set, _ ] = mapping_containers;
 
@@ -233,13 +256,27 @@ map_sample scene::sample_maps(const hit& h, const material& m) const {
     
     const auto [ u, v ] = dispatch::compute_uv(obj, type, h.get_point(), mi);
 
+    /* Footprint of the ray in UV-coordinates (the UV-coordinates of planes and spheres wrap around) */
+    std::pair<uvcoord, uvcoord> differences = {};
+    if (r.footprint.spread > 0.0_r && (comp.has_texture || comp.has_normal_map)) {
+        const bool wraps = (type == Plane || type == Sphere);
+        differences = footprint_uv_differences(h, r, { u, v }, [&] (const rt::vector& p) {
+            const auto [ pu, pv ] = dispatch::compute_uv(obj, type, p, mi);
+            return wraps ?
+                  uvcoord { u + std::remainder(pu - u, 1.0_r), v + std::remainder(pv - v, 1.0_r) }
+                : uvcoord { pu, pv };
+        });
+    }
+
     const rt::color& t_col = comp.has_texture ?
-          texture_set[index].get_color(u, v)
+          texture_set[index].get_color(u, v,
+            level_of_detail(differences, texture_set[index].get_width(), texture_set[index].get_height()))
         : m.get_color();
     
     // Tangent-space normal
     const rt::vector& n_vec = comp.has_normal_map ?
-          normal_map_set[index].get_tangent_space_normal(u, v)
+          normal_map_set[index].get_tangent_space_normal(u, v,
+            level_of_detail(differences, normal_map_set[index].get_width(), normal_map_set[index].get_height()))
         : h.get_normal();
     
     // const real smoothness = (comp.has_roughness_map) ?
@@ -158,9 +158,9 @@ namespace rt {
 		const unsigned int bytes_per_pixel = texture.bytes_per_pixel();
 		const unsigned int padding = texture_pitch % bytes_per_pixel;
 		
-		for (int index = 0; const matrix::const_row row : img.data) {
-            for (const color& pixel_col : row) {
-				color avg = pixel_col * invN;
+		for (int index = 0, j = 0; const matrix::const_row row : img.data) {
+            for (int i = 0; const color& pixel_col : row) {
+				color avg = pixel_col * img.average_factor(j, i++, invN);
 				avg.cap();
 				const auto [ r, g, b ] = avg.to_uint8();
 				texture_pixels[index] 	  = r;
@@ -169,6 +169,7 @@ namespace rt {
 				index += bytes_per_pixel;
             }
 			index += padding;
+			j++;
         }
 	}
 
@@ -177,7 +178,6 @@ namespace rt {
 
 		const real invN = 1.0_r / static_cast<real>(number_of_rays);
 		constexpr real inv255 = 1.0_r / 255.0_r;
-		const real inv = inv255 * invN;
 
 		const texture::lock lock = texture.get_lock();
 		const auto [ texture_pixels, texture_pitch ] = lock.info;
@@ -185,10 +185,10 @@ namespace rt {
 		const unsigned int bytes_per_pixel = texture.bytes_per_pixel();
 		const unsigned int padding = texture_pitch % bytes_per_pixel;
 		
-		for (int index = 0; const matrix::const_row row : img.data) {
-            for (const color& pixel_col : row) {
+		for (int index = 0, j = 0; const matrix::const_row row : img.data) {
+            for (int i = 0; const color& pixel_col : row) {
 
-				color corrected = pixel_col * inv;
+				color corrected = pixel_col * (inv255 * img.average_factor(j, i++, invN));
 				corrected ^= img.gamma.value();
 				corrected *= 255.0_r;
 				corrected.cap();
@@ -199,6 +199,7 @@ namespace rt {
 				index += bytes_per_pixel;
             }
 			index += padding;
+			j++;
         }
 	}
 
@@ -209,13 +210,14 @@ namespace rt {
 
 		// Computation of the maximum luminance
 		real max_luminance = 0.0_r;
-		for (const matrix::const_row row : img.data) {
-			for (const rt::color& col : row) {
+		for (int j = 0; const matrix::const_row row : img.data) {
+			for (int i = 0; const rt::color& col : row) {
 				const auto [ r, g, b ] = col;
-				const real luminance = (0.2126_r * r + 0.7152_r * g + 0.0722_r * b) * invN;
+				const real luminance = (0.2126_r * r + 0.7152_r * g + 0.0722_r * b) * img.average_factor(j, i++, invN);
 				if (luminance > max_luminance)
 					max_luminance = luminance;
 			}
+			j++;
 		}
 		const real lwhitecorr = 1.0_r / (max_luminance * max_luminance);
 
@@ -227,12 +229,12 @@ namespace rt {
         
 		//unsigned int index = 0;
 		constexpr real inv255 = 1.0_r / 255.0_r;
-		const real inv = inv255 * invN;
 
-		for (int index = 0; const matrix::row row : img.data) {
-            for (const color& col : row) {
+		for (int index = 0, j = 0; const matrix::const_row row : img.data) {
+            for (int i = 0; const color& col : row) {
 
 				const auto [ lr, lg, lb ] = col;
+				const real inv = inv255 * img.average_factor(j, i++, invN);
 				
 				const real lin = (0.2126_r * lr + 0.7152_r * lg + 0.0722_r * lb) * inv;
 				// const real lin = (lr + lg + lb) * inv * 0.333;
@@ -250,6 +252,7 @@ namespace rt {
 				index += bytes_per_pixel;
             }
 			index += padding;
+			j++;
         }
 	}
 }
@@ -0,0 +1,321 @@
+#include "file_readers/image_files/compact_data.hpp"
+#include "file_readers/image_files/raw_data.hpp"
+#include "test_images.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+///// Testing the round trip of the compact format of the raw data files
+
+/* Power of two, so that the averages (sums / number of samples) are exact */
+static constexpr unsigned int NUMBER_OF_SAMPLES = 4;
+
+static constexpr unsigned int WIDTH  = 45;
+static constexpr unsigned int HEIGHT = 19;
+static constexpr unsigned int TEST_TILE_SIZE = 8; // The image is not a whole number of tiles
+
+/* Tile (1, 0) is all zero and tile (2, 0) is very bright, tile (3, 1) is very dark,
+   the others are smooth gradients with some noise (the averages are all single-precision floats) */
+static std::vector<rt::color> make_sums() {
+    std::vector<rt::color> sums(WIDTH * HEIGHT);
+    for (unsigned int j = 0; j < HEIGHT; j++) {
+        for (unsigned int i = 0; i < WIDTH; i++) {
+            const unsigned int tx = i / TEST_TILE_SIZE;
+            const unsigned int ty = j / TEST_TILE_SIZE;
+            const unsigned int h = pixel_hash(i, j);
+            const float noise = static_cast<float>((h >> 20) % 64) / 64.0f;
+            float r = 10.0f * i + noise, g = 5.0f * j + 0.5f, b = 0.25f * (i + j);
+            if (ty == 0 && tx == 1)
+                r = g = b = 0.0f;
+            else if (ty == 0 && tx == 2) {
+                r *= 0x1p100f;
+                g *= 0x1p90f;
+                b = 3.0e38f;
+            }
+            else if (ty == 1 && tx == 3) {
+                r *= 0x1p-100f;
+                g *= 0x1p-60f;
+                b = 0.0f;
+            }
+            sums[j * WIDTH + i] = rt::color(r, g, b) * static_cast<real>(NUMBER_OF_SAMPLES);
+        }
+    }
+    return sums;
+}
+
+/* Decodes all the tiles of data */
+static std::vector<color_real> decode(const std::vector<std::byte>& data, const compact_parameters& parameters) {
+    const compact_data::decoder decoder(data, WIDTH, HEIGHT, parameters);
+    std::vector<color_real> colors(3 * WIDTH * HEIGHT);
+    for (unsigned int ty = 0; ty < decoder.tiles_y; ty++) {
+        for (unsigned int tx = 0; tx < decoder.tiles_x; tx++) {
+            const auto [ x, y, _, _ ] = decoder.tile_rectangle(tx, ty);
+            decoder.decode_tile(tx, ty, colors.data() + 3 * (static_cast<std::size_t>(y) * WIDTH + x), WIDTH);
+        }
+    }
+    return colors;
+}
+
+/* Largest component of the averages of the tile of the pixel (i, j) */
+static double tile_max(const std::vector<rt::color>& sums, const unsigned int i, const unsigned int j) {
+    double max = 0.0;
+    for (unsigned int y = j / TEST_TILE_SIZE * TEST_TILE_SIZE; y < std::min(HEIGHT, (j / TEST_TILE_SIZE + 1) * TEST_TILE_SIZE); y++) {
+        for (unsigned int x = i / TEST_TILE_SIZE * TEST_TILE_SIZE; x < std::min(WIDTH, (i / TEST_TILE_SIZE + 1) * TEST_TILE_SIZE); x++) {
+            const rt::color& c = sums[y * WIDTH + x];
+            max = std::max({ max, std::abs(c.red), std::abs(c.green), std::abs(c.blue) });
+        }
+    }
+    return max / NUMBER_OF_SAMPLES;
+}
+
+/* Single precision: exact
+   Half precision: 11 significant bits relative to the value, or to the brightest value of the tile for the smallest ones
+   (the values are divided by the power of two of the tile, the subnormal half-precision floats being below 2^-14) */
+static bool check_values(const std::vector<rt::color>& sums, const std::vector<color_real>& colors, const compact_parameters& parameters) {
+    for (unsigned int j = 0; j < HEIGHT; j++) {
+        for (unsigned int i = 0; i < WIDTH; i++) {
+            const rt::color& c = sums[j * WIDTH + i];
+            const double expected[3] = { c.red / NUMBER_OF_SAMPLES, c.green / NUMBER_OF_SAMPLES, c.blue / NUMBER_OF_SAMPLES };
+            const double bound_tile = 0x1p-24 * tile_max(sums, i, j);
+            for (unsigned int p = 0; p < 3; p++) {
+                const double value = colors[3 * (j * WIDTH + i) + p];
+                const bool correct = (parameters.bits == compact_parameters::precision::Single) ?
+                      value == expected[p]
+                    : std::abs(value - expected[p]) <= 0x1p-11 * std::abs(expected[p]) + bound_tile;
+                if (not correct) {
+                    printf("Pixel (%u, %u), component %u: %g instead of %g\n", i, j, p, value, expected[p]);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/* Offset of the tile t, read from the index at the start of the data */
+static uint64_t offset(const std::vector<std::byte>& data, const std::size_t t) {
+    uint64_t value;
+    std::memcpy(&value, data.data() + t * sizeof(uint64_t), sizeof(uint64_t));
+    return value;
+}
+
+static bool check_structure(const std::vector<std::byte>& data, const compact_parameters& parameters) {
+
+    const unsigned int tiles_x = (WIDTH + TEST_TILE_SIZE - 1) / TEST_TILE_SIZE;
+    const std::size_t nb_tiles = tiles_x * ((HEIGHT + TEST_TILE_SIZE - 1) / TEST_TILE_SIZE);
+    const std::size_t index_size = (nb_tiles + 1) * sizeof(uint64_t);
+
+    /* Offsets: from 0 to the size of the tiles, non-decreasing */
+    if (offset(data, 0) != 0 || offset(data, nb_tiles) != data.size() - index_size) {
+        printf("Incorrect offsets index\n");
+        return false;
+    }
+    for (std::size_t t = 0; t < nb_tiles; t++)
+        if (offset(data, t + 1) < offset(data, t))
+            return false;
+
+    /* Exponents: 0 for the all-zero tile, such that the brightest value is in [0.5, 1) for the others */
+    const auto exponent = [&] (const std::size_t t) {
+        int16_t e;
+        std::memcpy(&e, data.data() + index_size + offset(data, t), sizeof(int16_t));
+        return e;
+    };
+    const std::vector<rt::color> sums = make_sums();
+    int bright_exponent;
+    std::frexp(tile_max(sums, 2 * TEST_TILE_SIZE, 0), &bright_exponent);
+    if (exponent(1) != 0 || exponent(2) != bright_exponent) {
+        printf("Incorrect tile exponents: %d %d (expected 0 %d)\n", exponent(1), exponent(2), bright_exponent);
+        return false;
+    }
+
+    /* With compression, the zero words of the all-zero tile are runs of 128 bytes */
+    const std::size_t n = TEST_TILE_SIZE * TEST_TILE_SIZE;
+    const std::size_t words_size = 3 * n * static_cast<unsigned int>(parameters.bits) / 8;
+    const std::size_t zero_tile_size = offset(data, 2) - offset(data, 1);
+    const std::size_t expected_size = sizeof(int16_t) + (parameters.compression ? 2 * ((words_size + 127) / 128) : words_size);
+    if (zero_tile_size != expected_size) {
+        printf("Incorrect size of the all-zero tile: %zu (expected %zu)\n", zero_tile_size, expected_size);
+        return false;
+    }
+    return true;
+}
+
+/* Corrupted data is detected by the decoder */
+template<typename F>
+static bool throws_data_error(F f) {
+    try {
+        f();
+    }
+    catch (file_reader::error e) {
+        return e == file_reader::error::DataError;
+    }
+    return false;
+}
+
+static bool check_corruption(const std::vector<std::byte>& data, const compact_parameters& parameters) {
+
+    const std::size_t nb_tiles = ((WIDTH + TEST_TILE_SIZE - 1) / TEST_TILE_SIZE) * ((HEIGHT + TEST_TILE_SIZE - 1) / TEST_TILE_SIZE);
+
+    std::vector<std::byte> truncated(data.begin(), data.end() - 1);
+    std::vector<std::byte> decreasing = data;
+    const uint64_t large = offset(data, nb_tiles) + 1;
+    std::memcpy(decreasing.data() + sizeof(uint64_t), &large, sizeof(uint64_t));
+
+    bool detected = throws_data_error([&] { compact_data::decoder(truncated, WIDTH, HEIGHT, parameters); })
+        && throws_data_error([&] { compact_data::decoder(decreasing, WIDTH, HEIGHT, parameters); })
+        && throws_data_error([&] { compact_data::decoder(std::span(data).first(16), WIDTH, HEIGHT, parameters); });
+
+    /* Compressed tile whose last run is cut: its words are not all decoded */
+    if (parameters.compression) {
+        std::vector<std::byte> cut = data;
+        const std::size_t index_size = (nb_tiles + 1) * sizeof(uint64_t);
+        const uint64_t end_of_tile_0 = offset(data, 1) - 1;
+        cut.erase(cut.begin() + index_size + end_of_tile_0);
+        for (std::size_t t = 1; t <= nb_tiles; t++) {
+            const uint64_t o = offset(data, t) - 1;
+            std::memcpy(cut.data() + t * sizeof(uint64_t), &o, sizeof(uint64_t));
+        }
+        std::vector<color_real> colors(3 * WIDTH * HEIGHT);
+        detected = detected && throws_data_error([&] {
+            compact_data::decoder(cut, WIDTH, HEIGHT, parameters).decode_tile(0, 0, colors.data(), WIDTH);
+        });
+    }
+
+    if (not detected)
+        printf("Corrupted data not detected\n");
+    return detected;
+}
+
+/* Raw data file: header fields, and values multiplied by the number of samples when the file is read */
+static bool check_file(const std::vector<rt::color>& sums, const compact_parameters& parameters) {
+
+    image img(WIDTH, HEIGHT, 1.0_r / 2.2_r);
+    img.number_of_samples = NUMBER_OF_SAMPLES;
+    img.identity = render_identity{ .seed = 1234567890123ull, .scene_hash = 0xfedcba9876543210ull };
+    for (unsigned int j = 0; j < HEIGHT; j++) {
+        unsigned int i = 0;
+        for (rt::color& c : img.data[j])
+            c = sums[j * WIDTH + i++];
+    }
+
+    const std::string file_name = (std::filesystem::temp_directory_path() / "test_compact_data.rtdata").string();
+    if (raw_data::export_data(file_name, img, raw_data::format::Compact, parameters) == exit_status::Failure)
+        return false;
+
+    const std::expected<raw_data::header, file_reader::error> header = raw_data::read_file_header(file_name);
+    const std::expected<image, file_reader::error> read = raw_data::read_file(file_name);
+    std::filesystem::remove(file_name);
+    if (not header.has_value() || not read.has_value())
+        return false;
+
+    const raw_data::header& h = header.value();
+    const bool correct_header = h.width == WIDTH && h.height == HEIGHT && h.number_of_samples == NUMBER_OF_SAMPLES
+        && h.data_format == raw_data::format::Compact
+        && h.compact.bits == parameters.bits && h.compact.tile_size == parameters.tile_size
+        && h.compact.compression == parameters.compression
+        && h.identity.has_value() && h.identity.value().seed == 1234567890123ull
+        && h.identity.value().scene_hash == 0xfedcba9876543210ull
+        && h.gamma.has_value() && std::abs(h.gamma.value() - 1.0_r / 2.2_r) < 1.0e-5_r;
+    if (not correct_header) {
+        printf("Incorrect header\n");
+        return false;
+    }
+
+    std::vector<color_real> colors(3 * WIDTH * HEIGHT);
+    for (unsigned int j = 0; j < HEIGHT; j++) {
+        for (unsigned int i = 0; i < WIDTH; i++) {
+            const rt::color& c = read.value().data[j, i];
+            colors[3 * (j * WIDTH + i)]     = c.red   / NUMBER_OF_SAMPLES;
+            colors[3 * (j * WIDTH + i) + 1] = c.green / NUMBER_OF_SAMPLES;
+            colors[3 * (j * WIDTH + i) + 2] = c.blue  / NUMBER_OF_SAMPLES;
+        }
+    }
+    return read.value().number_of_samples == static_cast<int>(NUMBER_OF_SAMPLES) && check_values(sums, colors, parameters);
+}
+
+/* Averages beyond 2^1000 are clamped to it: the tile of a single row of 4 pixels has values up to 2^1020,
+   and is encoded as if its largest value was 2^1000 */
+static bool check_clamping(const compact_parameters::precision bits) {
+
+    constexpr unsigned int width = 4, height = 1;
+    constexpr double LIMIT = 0x1p1000;
+    const std::vector<rt::color> averages = {
+        rt::color(0x1p1010,  1.0,       0.0),
+        rt::color(-0x1p1020, 0.5,       2.0),
+        rt::color(0x1p999,  -0x1p1005,  3.0),
+        rt::color(0.25,      0x1p-3,    LIMIT)
+    };
+    std::vector<rt::color> sums;
+    for (const rt::color& c : averages)
+        sums.push_back(c * static_cast<real>(NUMBER_OF_SAMPLES));
+
+    const compact_parameters parameters = { .bits = bits, .tile_size = 4 };
+    const std::vector<std::byte> data = compact_data::encode(sums, NUMBER_OF_SAMPLES, width, height, parameters);
+
+    int16_t exponent;
+    std::memcpy(&exponent, data.data() + 2 * sizeof(uint64_t), sizeof(int16_t));
+
+    const compact_data::decoder decoder(data, width, height, parameters);
+    std::vector<color_real> colors(3 * width * height);
+    decoder.decode_tile(0, 0, colors.data(), width);
+
+    bool correct = exponent == 1001;
+    for (std::size_t k = 0; k < colors.size(); k++) {
+        const rt::color& c = averages[k / 3];
+        const double expected = std::clamp((k % 3 == 0) ? c.red : ((k % 3 == 1) ? c.green : c.blue), -LIMIT, LIMIT);
+        correct = correct && std::abs(colors[k] - expected) <= 0x1p-11 * std::abs(expected) + 0x1p-24 * LIMIT;
+    }
+
+    printf("%s precision, values beyond 2^1000: %s\n",
+        (bits == compact_parameters::precision::Half) ? "Half" : "Single", correct ? "OK" : "error");
+    return correct;
+}
+
+int main(int, char**) {
+
+    const std::vector<rt::color> sums = make_sums();
+
+    using precision = compact_parameters::precision;
+    bool success = true;
+
+    for (const precision bits : { precision::Half, precision::Single }) {
+
+        std::vector<color_real> uncompressed_colors;
+
+        for (const bool compression : { false, true }) {
+
+            const compact_parameters parameters = {
+                .bits = bits, .tile_size = TEST_TILE_SIZE, .compression = compression
+            };
+
+            const std::vector<std::byte> data = compact_data::encode(sums, NUMBER_OF_SAMPLES, WIDTH, HEIGHT, parameters);
+            const std::vector<color_real> colors = decode(data, parameters);
+
+            /* The compression is lossless */
+            if (not compression)
+                uncompressed_colors = colors;
+            const bool lossless = colors == uncompressed_colors;
+            if (not lossless)
+                printf("The compression changes the values\n");
+
+            const bool correct = check_values(sums, colors, parameters) && check_structure(data, parameters)
+                && check_corruption(data, parameters) && lossless && check_file(sums, parameters);
+
+            printf("%s precision, compression %d: %zu bytes, %s\n",
+                (bits == precision::Half) ? "Half" : "Single", compression, data.size(), correct ? "OK" : "error");
+            success = success && correct;
+        }
+
+        success = check_clamping(bits) && success;
+    }
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+/* Helpers shared by the tests of the raw data files */
+
+/* Pseudo-random hash of the pixel (i, j) of the test image number k,
+   from which the tests draw the noise and the special pixels (all-zero, very bright) of their images */
+constexpr unsigned int pixel_hash(const unsigned int i, const unsigned int j, const unsigned int k = 0) {
+    return (i * 7919u + j * 104729u + k * 1299709u) * 2654435761u;
+}
@@ -0,0 +1,244 @@
+#include "file_readers/parsers/obj_parser.hpp"
+#include "file_readers/parsers/scene_parser.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+///// Testing that the result of the obj parser does not depend on the number of chunks
+
+static constexpr int NB_RINGS       = 60;
+static constexpr int RING_SIZE      = 6;
+static constexpr int NB_MATERIALS   = 3;
+
+/* Tube made of rings of RING_SIZE vertices, each ring with its own v, vt and vn lines,
+   so that the faces between two rings refer to vertices declared in the previous chunks
+   The face formats, the index signs and the materials change from ring to ring,
+   and each ring is closed by a polygon with 5 or 6 sides */
+static void write_fixture(const std::string& file_name) {
+
+    FILE* file = fopen(file_name.c_str(), "w");
+    fprintf(file, "# Fixture of test_obj_chunks\no tube\n\n");
+
+    for (int r = 0; r < NB_RINGS; r++) {
+
+        for (int k = 0; k < RING_SIZE; k++) {
+            const double angle = 2.0 * 3.14159265358979 * k / RING_SIZE;
+            /* Small bumps, so that some quads are not planar and are split */
+            const double z = 0.5 * r + 0.05 * std::sin(1.7 * k * r);
+            fprintf(file, "v %.6f %.6f %.6f\n", std::cos(angle), std::sin(angle), z);
+            fprintf(file, "vt %.4f %.4f\n", static_cast<double>(k) / RING_SIZE, static_cast<double>(r) / NB_RINGS);
+            fprintf(file, "vn %.5f %.5f %.5f\n", std::cos(angle), std::sin(angle), 0.1 * std::cos(r + k));
+        }
+
+        if (r == 0)
+            continue;
+
+        /* Global (1-based) index of the vertex k of the ring r, or its negative index from the end of the ring r */
+        const bool negative = (r % 5 != 0);
+        const auto index = [&] (const int ring, const int k) {
+            return negative ? (ring - r - 1) * RING_SIZE + (k % RING_SIZE)
+                            : ring * RING_SIZE + (k % RING_SIZE) + 1;
+        };
+        const auto corner = [&] (const int ring, const int k) {
+            const int i = index(ring, k);
+            switch (r % 4) {
+                case 0:  fprintf(file, " %d/%d/%d", i, i, i); break;
+                case 1:  fprintf(file, " %d//%d", i, i);      break;
+                case 2:  fprintf(file, " %d/%d", i, i);       break;
+                default: fprintf(file, " %d", i);
+            }
+        };
+
+        fprintf(file, "usemtl mat_%d\ns %s\n", r % NB_MATERIALS, (r % 2 == 0) ? "off" : "1");
+
+        for (int k = 0; k < RING_SIZE; k++) {
+            /* Changes of material in the middle of the faces of a ring */
+            if (k == RING_SIZE / 2)
+                fprintf(file, "g ring_%d\nusemtl mat_%d\n", r, (r + 1) % NB_MATERIALS);
+
+            fprintf(file, "f");
+            if ((r + k) % 3 == 0) {
+                /* Quad split into two triangles by the file */
+                corner(r - 1, k); corner(r - 1, k + 1); corner(r, k + 1);
+                fprintf(file, "\nf");
+                corner(r - 1, k); corner(r, k + 1); corner(r, k);
+            }
+            else {
+                corner(r - 1, k); corner(r - 1, k + 1); corner(r, k + 1); corner(r, k);
+            }
+            fprintf(file, "\n");
+        }
+
+        /* Cap: hexagon, or pentagon and triangle */
+        fprintf(file, "f");
+        if (r % 2 == 0) {
+            for (int k = RING_SIZE - 1; k >= 0; k--)
+                corner(r, k);
+        }
+        else {
+            for (int k = RING_SIZE - 1; k >= 1; k--)
+                corner(r, k);
+            fprintf(file, "\nf");
+            corner(r, 1); corner(r, 0); corner(r, RING_SIZE - 1);
+        }
+        fprintf(file, "\n\n");
+    }
+
+    fclose(file);
+}
+
+/* Storage of the result of a parsing (the materials are shared, so that their indices are the same) */
+struct parsed_obj {
+    std::vector<const object*> object_set;
+    std::vector<const object*> other_content;
+    std::vector<wrapper<composition>> composition_wrapper_set;
+    std::vector<texture>    texture_set;
+    std::vector<normal_map> normal_map_set;
+    std::vector<std::string> dependencies;
+
+    scene::containers::object object_containers;
+    scene::containers::orientation orientation_containers;
+
+    parsed_obj(const scene::pre_parsing_info& pre_parsing_info)
+        : object_containers(pre_parsing_info), orientation_containers(pre_parsing_info) {}
+
+    bool parse(const std::string& file_name, std::vector<wrapper<material>>& material_wrapper_set,
+        const std::optional<std::size_t> number_of_chunks) {
+
+        containers containers = {
+            object_set,
+            other_content,
+            object_containers,
+            material_wrapper_set,
+            composition_wrapper_set,
+            texture_set,
+            normal_map_set,
+            orientation_containers,
+            dependencies
+        };
+
+        /* Default mapping, so that the textured faces get an orientation */
+        const bounding* output_bd = nullptr;
+        return parse_obj_file(
+            file_name, 0, containers,
+            model_positioning(rt::vector(1, 2, 3), 2.0_r),
+            bvh_parameters {}, output_bd, 1.0_r, number_of_chunks
+        ) == exit_status::Success;
+    }
+};
+
+static bool same_uv(const uvcoord& a, const uvcoord& b) {
+    return a.u == b.u && a.v == b.v;
+}
+
+/* Normal at a point inside the polygon (interpolated if it has vertex normals) */
+template<typename T>
+static std::optional<rt::vector> normal_inside(const T& polygon) {
+    const auto& [ v1, v2 ] = polygon.get_v1_v2();
+    const rt::vector n = (v1 ^ v2).unit();
+    const rt::vector p = polygon.get_position() + 0.3_r * (v1 + v2);
+    const ray r(p + n, -1.0_r * n);
+    const real t = polygon.measure_distance(r);
+    if (not std::isfinite(t))
+        return std::nullopt;
+    return polygon.compute_intersection(r, t).get_normal();
+}
+
+template<typename T>
+static bool same_polygon(const T& a, const T& b) {
+    const auto& [ a1, a2 ] = a.get_v1_v2();
+    const auto& [ b1, b2 ] = b.get_v1_v2();
+    return a.get_position() == b.get_position() && a1 == b1 && a2 == b2
+        && a.get_material_index() == b.get_material_index()
+        && a.get_orientation_info_index() == b.get_orientation_info_index()
+        && normal_inside(a) == normal_inside(b);
+}
+
+template<typename O>
+static bool same_orientation(const O& a, const O& b) {
+    for (std::size_t i = 0; i < std::size(a.uv); i++)
+        if (not same_uv(a.uv[i], b.uv[i]))
+            return false;
+    return a.index == b.index && a.tangent == b.tangent && a.bitangent == b.bitangent;
+}
+
+/* Position of an object of object_set in the triangle set (positive) or in the quad set (negative) */
+static long object_position(const parsed_obj& p, const object* obj) {
+    const auto& [ triangle_set, quad_set, _, _, _, _ ] = p.object_containers;
+    const auto* t = static_cast<const void*>(obj);
+    if (not triangle_set.empty() && t >= triangle_set.data() && t < triangle_set.data() + triangle_set.size())
+        return static_cast<const triangle*>(obj) - triangle_set.data();
+    return -1 - (static_cast<const quad*>(obj) - quad_set.data());
+}
+
+template<typename T, typename Eq>
+static bool same_sets(const std::vector<T>& a, const std::vector<T>& b, Eq eq) {
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); i++)
+        if (not eq(a[i], b[i]))
+            return false;
+    return true;
+}
+
+static bool same_result(const parsed_obj& a, const parsed_obj& b) {
+    const auto& [ a_triangles, a_quads, _, _, _, _ ] = a.object_containers;
+    const auto& [ b_triangles, b_quads, _, _, _, _ ] = b.object_containers;
+    const auto& [ a_triangle_orientations, a_quad_orientations, _, _, _, _ ] = a.orientation_containers;
+    const auto& [ b_triangle_orientations, b_quad_orientations, _, _, _, _ ] = b.orientation_containers;
+
+    return same_sets(a_triangles, b_triangles, same_polygon<triangle>)
+        && same_sets(a_quads, b_quads, same_polygon<quad>)
+        && same_sets(a_triangle_orientations, b_triangle_orientations, same_orientation<triangle::orientation>)
+        && same_sets(a_quad_orientations, b_quad_orientations, same_orientation<quad::orientation>)
+        && same_sets(a.object_set, b.object_set, [&] (const object* x, const object* y) {
+            return object_position(a, x) == object_position(b, y);
+        });
+}
+
+int main(int, char**) {
+
+    const std::string file_name = (std::filesystem::temp_directory_path() / "test_obj_chunks.obj").string();
+    write_fixture(file_name);
+    const std::size_t file_size = std::filesystem::file_size(file_name);
+
+    scene::pre_parsing_info pre_parsing_info;
+    const auto& [ _, obj_triangles, obj_quads ] = pre_parse_obj(file_name);
+    pre_parsing_info.triangles += obj_triangles;
+    pre_parsing_info.quads     += obj_quads;
+    pre_parsing_info.objects   += obj_triangles + obj_quads;
+
+    std::vector<wrapper<material>> material_wrapper_set;
+    for (int m = 0; m < NB_MATERIALS; m++)
+        material_wrapper_set.emplace_back(material(), "mat_" + std::to_string(m));
+
+    parsed_obj reference(pre_parsing_info);
+    if (not reference.parse(file_name, material_wrapper_set, 1)) {
+        printf("Parsing error (1 chunk)\n");
+        return EXIT_FAILURE;
+    }
+    printf("1 chunk: %zu triangles, %zu quads, %zu + %zu orientations\n",
+        reference.object_containers.triangle_set.size(), reference.object_containers.quad_set.size(),
+        reference.orientation_containers.triangle_orientation_set.size(),
+        reference.orientation_containers.quad_orientation_set.size());
+
+    bool success = true;
+
+    /* Down to chunks of a few bytes: most chunks contain a single line */
+    for (const std::size_t nb_chunks : { std::size_t(2), std::size_t(3), std::size_t(7), std::size_t(64),
+        std::size_t(1000), file_size / 8, file_size }) {
+
+        parsed_obj p(pre_parsing_info);
+        const bool same = p.parse(file_name, material_wrapper_set, nb_chunks) && same_result(reference, p);
+        printf("%zu chunks: %s\n", nb_chunks, same ? "OK" : "different result");
+        success = success && same;
+    }
+
+    std::filesystem::remove(file_name);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
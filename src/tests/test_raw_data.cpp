@@ -0,0 +1,228 @@
+#include "file_readers/image_files/raw_data.hpp"
+#include "file_readers/mapped_file.hpp"
+#include "test_images.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <expected>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+///// Testing that the merge of raw data files in memory and through mappings give the same result,
+///// and that the pixels of an adaptive render are exported as if they all had number_of_rays samples
+
+struct source_file {
+    raw_data::format format;
+    compact_parameters compact;
+    int number_of_samples;
+};
+
+/* Seed and scene recorded by the shards of a render */
+constexpr render_identity SHARD_IDENTITY = { .seed = 12345, .scene_hash = 0x0123456789abcdefull };
+
+/* Sums of the image number k: multiples of 1/4, written exactly in the text format */
+static image make_image(const unsigned int width, const unsigned int height, const int k, const int number_of_samples) {
+    image img(width, height);
+    img.number_of_samples = number_of_samples;
+    img.identity = SHARD_IDENTITY;
+    for (unsigned int j = 0; j < height; j++) {
+        unsigned int i = 0;
+        for (rt::color& c : img.data[j]) {
+            const unsigned int h = pixel_hash(i, j, k);
+            /* All-zero pixels, and very bright ones */
+            const real scale = (h % 17 == 0) ? 0.0_r : ((h % 13 == 0) ? 4096.0_r : 1.0_r);
+            c = rt::color((h >> 8) % 1021, (h >> 12) % 1019, (h >> 16) % 1013) * (0.25_r * scale * number_of_samples);
+            i++;
+        }
+    }
+    return img;
+}
+
+static bool same_images(const image& a, const image& b) {
+    if (a.width() != b.width() || a.height() != b.height() || a.number_of_samples != b.number_of_samples
+        || a.identity != b.identity)
+        return false;
+    for (int j = 0; j < a.height(); j++)
+        for (int i = 0; i < a.width(); i++)
+            if (not (a.data[j, i] == b.data[j, i]))
+                return false;
+    return true;
+}
+
+static bool same_files(const std::string& a, const std::string& b) {
+    const mapped_file fa(a);
+    const mapped_file fb(b);
+    return std::ranges::equal(fa.content(), fb.content());
+}
+
+/* Merges the sources with the mappings (with several memory budgets, so that the images are split in several bands),
+   and in memory (the first source being replaced by a copy in the text format) */
+static bool test_merge(const std::filesystem::path& dir, const unsigned int width, const unsigned int height,
+    const std::vector<source_file>& sources, const std::vector<real>& weights) {
+
+    std::vector<std::string> names;
+    for (std::size_t k = 0; k < sources.size(); k++) {
+        const image img = make_image(width, height, static_cast<int>(k), sources[k].number_of_samples);
+        names.push_back("source_" + std::to_string(k) + ".rtdata");
+        if (raw_data::export_data((dir / names.back()).string(), img, sources[k].format, sources[k].compact) == exit_status::Failure)
+            return false;
+        if (k == 0 && raw_data::export_data((dir / "source_text.rtdata").string(), img, raw_data::format::Text) == exit_status::Failure)
+            return false;
+    }
+
+    std::vector<std::string> text_names = names;
+    text_names[0] = "source_text.rtdata";
+    const std::string reference_bmp = (dir / "in_memory.bmp").string();
+    const std::string reference_raw = (dir / "in_memory.rtdata").string();
+    if (raw_data::combine_files(reference_bmp, reference_raw, text_names, dir.string(), std::nullopt, weights) == exit_status::Failure)
+        return false;
+    const std::expected<image, file_reader::error> reference = raw_data::read_file(reference_raw);
+
+    bool success = reference.has_value() && reference->identity == SHARD_IDENTITY;
+
+    /* Budget 1: bands of a single block of rows, whose boundaries are not aligned on the pages */
+    for (const std::size_t memory_budget : { std::size_t(1), std::size_t(100000), raw_data::DEFAULT_MERGE_MEMORY }) {
+
+        const std::string bmp_name = (dir / "mapped.bmp").string();
+        const std::string raw_name = (dir / "mapped.rtdata").string();
+        const exit_status status = raw_data::combine_files(bmp_name, raw_name, names, dir.string(), std::nullopt,
+            weights, memory_budget);
+        const std::expected<image, file_reader::error> merged = raw_data::read_file(raw_name);
+
+        const bool same = status == exit_status::Success && merged.has_value() && success
+            && same_images(reference.value(), merged.value()) && same_files(reference_bmp, bmp_name);
+        printf("%ux%u, %zu files%s, memory %zu: %s\n", width, height, sources.size(), weights.empty() ? "" : " (weighted)",
+            memory_budget, same ? "OK" : "different result");
+        success = success && same;
+    }
+    return success;
+}
+
+/* Adaptive render: the pixel (i, j) has 1 + (i + 3 * j) % number_of_samples samples of the same color (none for some pixels),
+   so each pixel of the files must be that color multiplied by number_of_samples, whatever its own number of samples
+   Merged with a uniform render of the same color, each pixel of the adaptive file counts for number_of_samples samples
+   (and the merged file does not record a seed, the two renders having different ones) */
+static bool test_adaptive(const std::filesystem::path& dir) {
+
+    constexpr unsigned int width = 45, height = 29;
+    constexpr int number_of_samples = 8;
+    constexpr int uniform_samples = 3;
+
+    const auto color_of = [] (const int i, const int j) {
+        return rt::color(i + 0.25_r, j * 2, (i * j) % 7);
+    };
+    const auto has_samples = [] (const int i, const int j) {
+        return (i + j) % 11 != 0;
+    };
+
+    image adaptive(width, height);
+    adaptive.identity = render_identity{ .seed = 1, .scene_hash = SHARD_IDENTITY.scene_hash };
+    adaptive.enable_adaptive_sampling();
+    for (int pass = 0; pass < number_of_samples; pass++) {
+        for (int j = 0; j < static_cast<int>(height); j++)
+            for (int i = 0; i < static_cast<int>(width); i++)
+                if (has_samples(i, j) && pass <= (i + 3 * j) % number_of_samples)
+                    adaptive.add_sample(j, i, color_of(i, j));
+        adaptive.increase_sample_count();
+    }
+
+    image uniform(width, height);
+    uniform.number_of_samples = uniform_samples;
+    uniform.identity = render_identity{ .seed = 2, .scene_hash = SHARD_IDENTITY.scene_hash };
+    for (int j = 0; j < static_cast<int>(height); j++)
+        for (int i = 0; i < static_cast<int>(width); i++)
+            uniform.data[j, i] = color_of(i, j) * uniform_samples;
+    if (raw_data::export_data((dir / "uniform.rtdata").string(), uniform) == exit_status::Failure)
+        return false;
+
+    /* Values read, expected sums of the pixels with samples, and the sums of the pixels without */
+    const auto check = [&] (const std::expected<image, file_reader::error>& img, const int expected_samples,
+        const real pixel_samples, const real empty_samples) {
+        if (not img.has_value() || img->number_of_samples != expected_samples)
+            return false;
+        for (int j = 0; j < static_cast<int>(height); j++) {
+            for (int i = 0; i < static_cast<int>(width); i++) {
+                const rt::color expected = color_of(i, j) * (has_samples(i, j) ? pixel_samples : empty_samples);
+                const rt::color& c = img->data[j, i];
+                // The text format has 6 decimals, and the compact one single-precision floats
+                const real tolerance = 1e-5_r * (1.0_r + static_cast<real>(expected.get_average()));
+                if (std::abs(c.red - expected.red) > tolerance || std::abs(c.green - expected.green) > tolerance
+                    || std::abs(c.blue - expected.blue) > tolerance)
+                    return false;
+            }
+        }
+        return true;
+    };
+
+    using enum raw_data::format;
+    const compact_parameters single = { .bits = compact_parameters::precision::Single };
+
+    bool success = true;
+    for (const raw_data::format format : { Text, Binary, Compact }) {
+
+        const std::string name = "adaptive_" + std::to_string(static_cast<unsigned int>(format)) + ".rtdata";
+        const bool exported = raw_data::export_data((dir / name).string(), adaptive, format, single) == exit_status::Success;
+        const bool normalized = exported
+            && check(raw_data::read_file((dir / name).string()), number_of_samples, number_of_samples, 0.0_r);
+
+        const std::vector<std::string> names = { name, "uniform.rtdata" };
+        const std::string raw_name = (dir / "adaptive_merged.rtdata").string();
+        const bool merged = exported
+            && raw_data::combine_files((dir / "adaptive_merged.bmp").string(), raw_name, names, dir.string(), std::nullopt)
+                == exit_status::Success;
+        const std::expected<image, file_reader::error> merged_image = raw_data::read_file(raw_name);
+        const bool merged_correctly = merged && merged_image.has_value() && not merged_image->identity.has_value()
+            && check(merged_image, number_of_samples + uniform_samples, number_of_samples + uniform_samples, uniform_samples);
+
+        printf("Adaptive render, format %u: export %s, merge %s\n", static_cast<unsigned int>(format),
+            normalized ? "OK" : "different result", merged_correctly ? "OK" : "different result");
+        success = success && normalized && merged_correctly;
+    }
+    return success;
+}
+
+int main(int, char**) {
+
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "test_raw_data";
+    std::filesystem::create_directories(dir);
+
+    using enum raw_data::format;
+    using precision = compact_parameters::precision;
+
+    const compact_parameters single_16 = { .bits = precision::Single, .tile_size = 16 };
+    const compact_parameters half_32   = { .bits = precision::Half,   .tile_size = 32 };
+    const compact_parameters single_24 = { .bits = precision::Single, .tile_size = 24, .compression = false };
+
+    const std::vector<source_file> mixed = {
+        { Binary,  {},        10 },
+        { Compact, single_16, 3 },
+        { Compact, half_32,   7 }
+    };
+    const std::vector<source_file> binary = {
+        { Binary, {}, 4 },
+        { Binary, {}, 1 },
+        { Binary, {}, 9 }
+    };
+    const std::vector<source_file> compact = {
+        { Binary,  {},        2 },
+        { Compact, single_24, 5 },
+        { Compact, half_32,   6 },
+        { Compact, single_16, 1 }
+    };
+
+    /* Heights that are not multiples of the heights of the tiles or of the blocks of rows,
+       and rows whose sizes are not multiples of the size of the pages */
+    bool success = true;
+    success = test_merge(dir, 300, 101, mixed, { 1.0_r, 2.5_r, 0.25_r }) && success;
+    success = test_merge(dir, 300, 101, mixed, {}) && success;
+    success = test_merge(dir, 1000, 67, binary, { 0.5_r, 1.0_r, 3.0_r }) && success;
+    success = test_merge(dir, 171, 250, compact, { 1.0_r, 0.0_r, 2.0_r, 0.75_r }) && success;
+    success = test_adaptive(dir) && success;
+
+    std::filesystem::remove_all(dir);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
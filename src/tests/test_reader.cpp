@@ -166,6 +166,7 @@ static void test_obj() {
     std::vector<wrapper<composition>> composition_wrapper_set;
     std::vector<texture>    texture_set;
     std::vector<normal_map> normal_map_set;
+    std::vector<std::string> dependencies;
 
     scene::containers::object object_containers(pre_parsing_info);
     scene::containers::orientation orientation_containers(pre_parsing_info);
@@ -179,7 +180,8 @@ static void test_obj() {
         composition_wrapper_set,
         texture_set,
         normal_map_set,
-        orientation_containers
+        orientation_containers,
+        dependencies
     };
 
     uint64_t total_time = 0;
@@ -193,7 +195,7 @@ static void test_obj() {
         [[maybe_unused]] const exit_status status = parse_obj_file(
             filename_obj, std::nullopt, containers,
             model_positioning(rt::vector(1, 1, 1), 2.0_r),
-            false, 0, output_bd, 1.0_r
+            bvh_parameters {}, output_bd, 1.0_r
         );
         assert(status == exit_status::Success);
 
@@ -0,0 +1,186 @@
+#include "file_readers/parsers/scene_parser.hpp"
+#include "auxiliary/randomgen.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+///// Testing that the SAH and the k-means clustering hierarchies give the same closest objects as the linear search
+
+static constexpr int GRID_SIZE   = 30;
+static constexpr int NB_SOUP     = 3000;
+static constexpr int NB_RAYS     = 20000;
+
+/* Bumpy grid (shared edges), and a soup of triangles and quads of all sizes, in two obj files */
+static void write_objs(const std::string& grid_name, const std::string& soup_name) {
+
+    FILE* file = fopen(grid_name.c_str(), "w");
+    for (int j = 0; j <= GRID_SIZE; j++)
+        for (int i = 0; i <= GRID_SIZE; i++)
+            fprintf(file, "v %.6f %.6f %.6f\n", 0.1 * i, 0.05 * std::sin(0.7 * i + 1.3 * j), -0.1 * j);
+    for (int j = 0; j < GRID_SIZE; j++) {
+        for (int i = 0; i < GRID_SIZE; i++) {
+            const int v = j * (GRID_SIZE + 1) + i + 1;
+            fprintf(file, "f %d %d %d\nf %d %d %d\n", v, v + 1, v + GRID_SIZE + 2, v, v + GRID_SIZE + 2, v + GRID_SIZE + 1);
+        }
+    }
+    fclose(file);
+
+    xoshiro256plus engine(42);
+    const auto random = [&engine] (const double a, const double b) {
+        return a + (b - a) * to_ratio<double>(engine());
+    };
+
+    file = fopen(soup_name.c_str(), "w");
+    for (int k = 0; k < NB_SOUP; k++) {
+        const double x = random(-1, 4), y = random(0.1, 2), z = random(-4, 1);
+        const double size = (k % 4 == 0) ? random(0.5, 1.5) : random(0.01, 0.2);
+        fprintf(file, "v %.6f %.6f %.6f\nv %.6f %.6f %.6f\nv %.6f %.6f %.6f\nv %.6f %.6f %.6f\n",
+            x, y, z,
+            x + size * random(-1, 1), y + size * random(-1, 1), z + size * random(-1, 1),
+            x + size * random(-1, 1), y + size * random(-1, 1), z + size * random(-1, 1),
+            x + size, y, z + size);
+        // Quads, and triangles made of the first three vertices
+        if (k % 2 == 0)
+            fprintf(file, "f -4 -3 -2\n");
+        else
+            fprintf(file, "f -4 -1 -3 -2\n");
+    }
+    fclose(file);
+}
+
+static void write_scene(const std::string& file_name, const std::string& bvh_line,
+    const std::string& grid_name, const std::string& soup_name) {
+
+    FILE* file = fopen(file_name.c_str(), "w");
+    fprintf(file,
+        "resolution width:64 height:48\n"
+        "camera position:(2, 1, 3) direction:(0, 0, -1) rightdir:auto fov_width:1 distance:1\n"
+        "background_color 0 0 0\n"
+        "%s\n\n"
+        "sphere center:(0, 1, -1) radius:0.5 material:diffuse\n"
+        "sphere center:(3, 0.5, -3) radius:0.3 material:diffuse\n"
+        "quad (-1, 2, -5) (-1, 0, -5) (5, 0, -5) (5, 2, -5) material:diffuse\n"
+        "box center:(1, 0.6, -2) x_axis:(1, 0, -0.4) y_axis:(0, 1, 0) 0.6 1.2 0.6 material:diffuse\n"
+        "load_obj %s\n\n"
+        "load_obj %s\n",
+        bvh_line.c_str(), grid_name.c_str(), soup_name.c_str());
+    fclose(file);
+}
+
+/* Index of an object of the scene in the concatenation of its containers,
+   the same for all the scenes parsed from the same objects */
+template<typename Obj>
+static bool search(const std::vector<Obj>& set, const object* obj, long& index) {
+    const auto* address = static_cast<const void*>(obj);
+    if (not set.empty() && address >= set.data() && address < set.data() + set.size()) {
+        index += static_cast<const Obj*>(obj) - set.data();
+        return true;
+    }
+    index += set.size();
+    return false;
+}
+
+static long object_index(const scene& scn, const object* obj) {
+    const auto& [ triangle_set, quad_set, sphere_set, plane_set, box_set, cylinder_set ] = scn.object_containers;
+    long index = 0;
+    const bool found =
+           search(triangle_set, obj, index) || search(quad_set,  obj, index)
+        || search(sphere_set,   obj, index) || search(plane_set, obj, index)
+        || search(box_set,      obj, index) || search(cylinder_set, obj, index);
+    return found ? index : -1;
+}
+
+template<typename Obj>
+static bool select(const std::vector<Obj>& set, long& index, const object*& obj) {
+    if (index < static_cast<long>(set.size())) {
+        obj = &set[index];
+        return true;
+    }
+    index -= set.size();
+    return false;
+}
+
+static const object* object_at(const scene& scn, long index) {
+    const auto& [ triangle_set, quad_set, sphere_set, plane_set, box_set, cylinder_set ] = scn.object_containers;
+    const object* obj = nullptr;
+    if (index >= 0)
+           select(triangle_set, index, obj) || select(quad_set,  index, obj)
+        || select(sphere_set,   index, obj) || select(plane_set, index, obj)
+        || select(box_set,      index, obj) || select(cylinder_set, index, obj);
+    return obj;
+}
+
+/* Same object hit at the same point, or, in case of a tie (shared edges), another object hit at the same distance */
+static bool same_hit(const scene& reference, const std::optional<hit>& expected, const scene& scn, const std::optional<hit>& h, const ray& r) {
+    if (expected.has_value() != h.has_value())
+        return false;
+    if (not h.has_value())
+        return true;
+    const long index = object_index(scn, h->get_object());
+    if (index == object_index(reference, expected->get_object()))
+        return h->get_point() == expected->get_point();
+    const object* obj = object_at(reference, index);
+    return obj != nullptr && obj->measure_distance(r) == expected->get_object()->measure_distance(r);
+}
+
+int main(int, char**) {
+
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "test_sah";
+    std::filesystem::create_directories(dir);
+    const std::string grid_name = (dir / "grid.obj").string();
+    const std::string soup_name = (dir / "soup.obj").string();
+    write_objs(grid_name, soup_name);
+
+    const auto parse = [&] (const std::string& bvh_line) {
+        const std::string scene_name = (dir / "scene.txt").string();
+        write_scene(scene_name, bvh_line, grid_name, soup_name);
+        return parse_scene_descriptor(scene_name, snapshot_mode::Disabled);
+    };
+
+    const std::optional<scene> reference = parse("bvh: disabled");
+    if (not reference.has_value()) {
+        printf("Parsing error\n");
+        return EXIT_FAILURE;
+    }
+
+    xoshiro256plus engine(7);
+    const auto random = [&engine] (const real a, const real b) {
+        return a + (b - a) * to_ratio<real>(engine());
+    };
+    std::vector<ray> rays;
+    for (int k = 0; k < NB_RAYS; k++) {
+        const rt::vector origin(random(-3, 6), random(-1, 5), random(-7, 3));
+        const rt::vector target(random(-1, 4), random(-0.5_r, 2), random(-4, 1));
+        rays.emplace_back(origin, (target - origin).unit());
+    }
+
+    std::vector<std::optional<hit>> expected;
+    expected.reserve(rays.size());
+    for (const ray& r : rays)
+        expected.push_back(reference->find_closest(r, bvh_option::Disabled));
+
+    bool success = true;
+
+    for (const std::string bvh_line : { "bvh: sah", "bvh: sah arity 4", "bvh: polygons_per_bounding 5", "bvh: polygons_per_bounding 20" }) {
+
+        const std::optional<scene> scn = parse(bvh_line);
+        bool same = scn.has_value();
+        unsigned int hits = 0;
+        for (std::size_t k = 0; same && k < rays.size(); k++) {
+            const std::optional<hit> h = scn->find_closest(rays[k], bvh_option::Enabled);
+            same = same_hit(reference.value(), expected[k], scn.value(), h, rays[k]);
+            hits += h.has_value() ? 1 : 0;
+        }
+        printf("%s: %u hits, %s\n", bvh_line.c_str(), hits, same ? "OK" : "different result");
+        success = success && same;
+    }
+
+    std::filesystem::remove_all(dir);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,126 @@
+#include "file_readers/parsers/scene_parser.hpp"
+#include "file_readers/parsers/scene_snapshot.hpp"
+#include "file_readers/mapped_file.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+///// Testing that incomplete scene snapshots are rejected, and that the boundings already read are destroyed
+
+static constexpr int GRID_SIZE = 40;
+
+/* Position in the header of the snapshot of the total size of the file, and of the hash of the description
+   (after the magic number, the version, sizeof(real) and sizeof(rt::color)) */
+static constexpr std::size_t TOTAL_SIZE_POSITION = 8 + 3 * sizeof(uint32_t);
+static constexpr std::size_t HASH_POSITION       = TOTAL_SIZE_POSITION + sizeof(uint64_t);
+
+/* Bumpy grid of GRID_SIZE x GRID_SIZE squares, each split into two triangles */
+static void write_obj(const std::string& file_name) {
+    FILE* file = fopen(file_name.c_str(), "w");
+    for (int j = 0; j <= GRID_SIZE; j++)
+        for (int i = 0; i <= GRID_SIZE; i++)
+            fprintf(file, "v %.6f %.6f %.6f\n", 0.1 * i, 0.05 * std::sin(0.7 * i + 1.3 * j), -0.1 * j);
+    for (int j = 0; j < GRID_SIZE; j++) {
+        for (int i = 0; i < GRID_SIZE; i++) {
+            const int v = j * (GRID_SIZE + 1) + i + 1;
+            fprintf(file, "f %d %d %d\nf %d %d %d\n", v, v + 1, v + GRID_SIZE + 2, v, v + GRID_SIZE + 2, v + GRID_SIZE + 1);
+        }
+    }
+    fclose(file);
+}
+
+static void write_scene(const std::string& file_name, const std::string& obj_name) {
+    FILE* file = fopen(file_name.c_str(), "w");
+    fprintf(file,
+        "resolution width:64 height:48\n"
+        "camera position:(2, 1, 3) direction:(0, 0, -1) rightdir:auto fov_width:1 distance:1\n"
+        "background_color 0 0 0\n"
+        "bvh: sah\n\n"
+        "sphere center:(0, 1, -1) radius:0.5 material:diffuse\n"
+        "quad (-1, 2, -5) (-1, 0, -5) (5, 0, -5) (5, 2, -5) material:diffuse\n"
+        "load_obj %s\n", obj_name.c_str());
+    fclose(file);
+}
+
+static std::vector<std::byte> read_bytes(const std::string& file_name) {
+    const mapped_file mapped(file_name);
+    return std::vector<std::byte>(mapped.content().begin(), mapped.content().end());
+}
+
+static void write_bytes(const std::string& file_name, const std::vector<std::byte>& bytes) {
+    FILE* file = fopen(file_name.c_str(), "wb");
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+int main(int, char**) {
+
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "test_snapshot";
+    std::filesystem::create_directories(dir);
+    const std::string obj_name      = (dir / "grid.obj").string();
+    const std::string scene_name    = (dir / "scene.txt").string();
+    const std::string snapshot_name = scene_snapshot::file_name_of(scene_name);
+
+    write_obj(obj_name);
+    write_scene(scene_name, obj_name);
+    std::filesystem::remove(snapshot_name);
+
+    /* The first parsing writes the snapshot */
+    std::size_t number_of_roots;
+    {
+        const std::optional<scene> scn = parse_scene_descriptor(scene_name);
+        if (not scn.has_value() || not std::filesystem::is_regular_file(snapshot_name)) {
+            printf("Snapshot not written\n");
+            return EXIT_FAILURE;
+        }
+        number_of_roots = scn->bounding_set.size();
+    }
+
+    const std::vector<std::byte> bytes = read_bytes(snapshot_name);
+    uint64_t description_hash;
+    std::memcpy(&description_hash, bytes.data() + HASH_POSITION, sizeof(uint64_t));
+
+    bool success = true;
+
+    /* The second parsing loads the snapshot, without replacing it */
+    {
+        const auto write_time = std::filesystem::last_write_time(snapshot_name);
+        const std::optional<scene> scn = parse_scene_descriptor(scene_name);
+        const bool loaded = scn.has_value() && scn->bounding_set.size() == number_of_roots
+            && std::filesystem::last_write_time(snapshot_name) == write_time;
+        printf("Complete snapshot: %s\n", loaded ? "OK" : "not loaded");
+        success = success && loaded;
+    }
+
+    /* The bounding hierarchy is at the end of the file: the files cut by a few bytes end in the middle of it
+       The total size in the header is updated, so that the truncation is only detected while reading the hierarchy */
+    for (const std::size_t cut : { std::size_t(1), std::size_t(9), std::size_t(100), std::size_t(1000) }) {
+        std::vector<std::byte> truncated(bytes.begin(), bytes.end() - cut);
+        const uint64_t total_size = truncated.size();
+        std::memcpy(truncated.data() + TOTAL_SIZE_POSITION, &total_size, sizeof(uint64_t));
+        write_bytes(snapshot_name, truncated);
+
+        const bool rejected = not scene_snapshot::load(snapshot_name, description_hash).has_value();
+        printf("Snapshot cut by %zu bytes: %s\n", cut, rejected ? "OK" : "loaded");
+        success = success && rejected;
+    }
+
+    /* The scene is parsed again, and the snapshot replaced */
+    {
+        const std::optional<scene> scn = parse_scene_descriptor(scene_name);
+        const bool parsed = scn.has_value() && scn->bounding_set.size() == number_of_roots
+            && std::filesystem::file_size(snapshot_name) == bytes.size();
+        printf("Parsing after an incomplete snapshot: %s\n", parsed ? "OK" : "different result");
+        success = success && parsed;
+    }
+
+    std::filesystem::remove_all(dir);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
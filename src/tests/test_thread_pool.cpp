@@ -0,0 +1,56 @@
+#include "parallel/parallel.hpp"
+#include "parallel/thread_pool.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+///// Testing the work-stealing pool and the tile orders
+int main(int, char**) {
+
+    constexpr int width  = 1000;
+    constexpr int height = 563;
+
+    for (const tile_order order : { tile_order::Rows, tile_order::Morton, tile_order::Hilbert }) {
+
+        const std::vector<tile> tiles = generate_tiles(width, height, 16, order);
+
+        // Every pixel must be covered by exactly one tile
+        std::vector<std::atomic_int> coverage(width * height);
+        parallel_for_tiles(tiles, [&] (const tile& t, unsigned int) {
+            for (int j = t.y_start; j < t.y_end; j++)
+                for (int i = t.x_start; i < t.x_end; i++)
+                    coverage[j * width + i]++;
+        });
+
+        for (const std::atomic_int& c : coverage) {
+            if (c != 1) {
+                printf("Tile coverage error (order %d)\n", static_cast<int>(order));
+                return EXIT_FAILURE;
+            }
+        }
+        printf("%zu tiles, order %d: OK\n", tiles.size(), static_cast<int>(order));
+    }
+
+    // Unbalanced workload: the cost of the elements grows with their index
+    std::atomic_long sum = 0;
+    parallel_for(2000, [&] (int i) {
+        long local = 0;
+        for (int k = 0; k < i * 1000; k++) local += k % 7;
+        sum += (local >= 0) ? 1 : 0;
+    });
+    printf("Sum: %ld (expected 2000), %u threads\n", sum.load(), thread_pool::global().size());
+
+    // Explicit pool, with repeated batches and nested calls
+    thread_pool pool(4);
+    std::atomic_int count = 0;
+    for (int batch = 0; batch < 100; batch++) {
+        pool.run(37, [&] (int, unsigned int) {
+            pool.run(3, [&] (int, unsigned int) { count++; });
+        });
+    }
+    printf("Count: %d (expected 11100)\n", count.load());
+
+    return (sum == 2000 && count == 11100) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
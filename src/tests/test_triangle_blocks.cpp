@@ -0,0 +1,146 @@
+#include "scene/bounding/wide_bvh.hpp"
+#include "accelerating_structures/sah.hpp"
+#include "auxiliary/randomgen.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+///// Testing that the packed triangle blocks of the wide hierarchy give the same closest hit as triangle::measure_distance
+
+static constexpr int GRID_SIZE      = 30;
+static constexpr int NB_SOUP        = 2000;
+static constexpr int NB_RANDOM_RAYS = 20000;
+
+/* Bumpy grid (shared edges and vertices), and a soup of triangles of all sizes, including slivers,
+   shifted far from the origin so that the float coordinates are rounded */
+static std::vector<triangle> make_triangles(const rt::vector& shift, xoshiro256plus& engine) {
+
+    const auto random = [&engine] (const real a, const real b) {
+        return a + (b - a) * to_ratio<real>(engine());
+    };
+
+    std::vector<triangle> triangles;
+    triangles.reserve(2 * GRID_SIZE * GRID_SIZE + NB_SOUP);
+
+    const auto vertex = [&] (const int i, const int j) {
+        return shift + rt::vector(0.1_r * i, 0.05_r * std::sin(0.7_r * i + 1.3_r * j), -0.1_r * j);
+    };
+    for (int j = 0; j < GRID_SIZE; j++) {
+        for (int i = 0; i < GRID_SIZE; i++) {
+            triangles.emplace_back(vertex(i, j), vertex(i + 1, j), vertex(i + 1, j + 1), 0);
+            triangles.emplace_back(vertex(i, j), vertex(i + 1, j + 1), vertex(i, j + 1), 0);
+        }
+    }
+
+    for (int k = 0; k < NB_SOUP; k++) {
+        const rt::vector p0 = shift + rt::vector(random(-1, 4), random(-2, 2), random(-4, 1));
+        const real size = (k % 3 == 0) ? random(0.001_r, 0.01_r) : random(0.05_r, 0.5_r);
+        const rt::vector e1 = size * rt::vector(random(-1, 1), random(-1, 1), random(-1, 1));
+        // Slivers: second edge almost parallel to the first one
+        const rt::vector e2 = (k % 7 == 0) ?
+              e1 * 0.5_r + rt::vector(1e-5_r, 0, 0)
+            : size * rt::vector(random(-1, 1), random(-1, 1), random(-1, 1));
+        triangles.emplace_back(p0, p0 + e1, p0 + e2, 0);
+    }
+
+    return triangles;
+}
+
+/* Closest triangle, testing them all */
+static real brute_force(const std::vector<triangle>& triangles, const ray& r) {
+    real distance = infinity;
+    for (const triangle& t : triangles)
+        distance = std::min(distance, t.measure_distance(r));
+    return distance;
+}
+
+template<unsigned int width>
+static bool test_rays(const wide_bvh<width>& bvh, const std::vector<triangle>& triangles,
+    const std::vector<ray>& rays, const char* name) {
+
+    unsigned int hits = 0;
+    for (const ray& r : rays) {
+
+        real distance = infinity;
+        const object* closest = nullptr;
+        bvh.find_closest(r, distance, closest);
+
+        const real expected = brute_force(triangles, r);
+        // In case of a tie (shared edges), any of the closest triangles is correct
+        const bool correct = (distance == expected)
+            && (closest == nullptr || closest->measure_distance(r) == distance);
+        if (not correct) {
+            printf("%s, width %u: distance %.17g instead of %.17g\n", name, width, static_cast<double>(distance), static_cast<double>(expected));
+            return false;
+        }
+        if (closest != nullptr)
+            hits++;
+    }
+    printf("%s, width %u: %zu rays, %u hits: OK\n", name, width, rays.size(), hits);
+    return true;
+}
+
+static void delete_hierarchy(const bounding* root) {
+    std::vector<const bounding*> stack = { root };
+    while (not stack.empty()) {
+        const bounding* bd = stack.back();
+        stack.pop_back();
+        const std::span<const bounding * const> children = bd->get_children();
+        stack.insert(stack.end(), children.begin(), children.end());
+        delete bd;
+    }
+}
+
+static bool test_scene(const rt::vector& shift, const char* name) {
+
+    xoshiro256plus engine(1234);
+    const auto random = [&engine] (const real a, const real b) {
+        return a + (b - a) * to_ratio<real>(engine());
+    };
+
+    const std::vector<triangle> triangles = make_triangles(shift, engine);
+
+    std::vector<ray> rays;
+    /* Rays towards random points of the scene */
+    for (int k = 0; k < NB_RANDOM_RAYS; k++) {
+        const rt::vector origin = shift + rt::vector(random(-3, 6), random(-4, 4), random(-6, 3));
+        const rt::vector target = shift + rt::vector(random(-1, 4), random(-2, 2), random(-4, 1));
+        rays.emplace_back(origin, (target - origin).unit());
+    }
+    /* Rays towards the vertices and the middles of the edges of the grid, and axis-aligned rays */
+    for (int j = 0; j < GRID_SIZE; j++) {
+        for (int i = 0; i < GRID_SIZE; i++) {
+            const rt::vector vertex = shift + rt::vector(0.1_r * i, 0.05_r * std::sin(0.7_r * i + 1.3_r * j), -0.1_r * j);
+            const rt::vector origin = shift + rt::vector(1.5_r, 3, -1.5_r);
+            rays.emplace_back(origin, (vertex - origin).unit());
+            rays.emplace_back(origin, (vertex + rt::vector(0.05_r, 0, 0) - origin).unit());
+            rays.emplace_back(vertex + rt::vector(0.01_r, 1, -0.02_r), rt::vector(0, -1, 0));
+        }
+    }
+
+    std::vector<const object*> content;
+    for (const triangle& t : triangles)
+        content.push_back(&t);
+
+    const bounding* root = create_sah_hierarchy(std::move(content), 2);
+    const std::span<const bounding * const> roots(&root, 1);
+
+    const bool success = test_rays(wide_bvh<4>(roots), triangles, rays, name)
+                      && test_rays(wide_bvh<8>(roots), triangles, rays, name);
+
+    delete_hierarchy(root);
+    return success;
+}
+
+int main(int, char**) {
+
+    bool success = true;
+    success = test_scene(rt::vector(0, 0, 0), "Origin") && success;
+    success = test_scene(rt::vector(1000, -500, 2000), "Far from the origin") && success;
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
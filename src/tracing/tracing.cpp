@@ -66,20 +66,34 @@ using enum direction::angle;
     );
 }
 
-/* Determining the pixel of the background texture to display */
-[[nodiscard]] inline rt::color worker::background_case(const rt::vector& direction, const accumulators& acc) const {
-
-    const rt::color& color = scene_.mapping_containers.background.get_color(direction);
-    return acc.combine(color);
-}
-
 void worker::process_bounce(const bounce_parameters& param, path_parameters& out, bool double_bounce) const {
     
     const auto& [ h, m, normal, color, smoothness ] = param;
-    auto& [ r, acc, refr_index ] = out;
+    auto& [ r, acc, refr_index, refr_stack, diffuse_pdf ] = out;
 
     direction::bounce_vectors bounce_v(r.direction, normal);
 
+    /* Footprint of the next ray: the footprint of the incoming ray on the surface, with the same spread
+       (the curvature of the surface and the roughness of the material are ignored) */
+    const ray_footprint footprint = {
+        .width  = r.footprint.width_at((h.get_point() - r.origin).norm()),
+        .spread = r.footprint.spread
+    };
+
+    /* Diffuse bounces (cosine-weighted directions around the normal): the light sources are sampled explicitly,
+       and the probability density of the bounce is kept to weight the light that the bounce may reach */
+    diffuse_pdf = 0.0_r;
+    const auto diffuse_bounce = [&] (const ray& next) {
+        if (nee == nee_mode::Disabled)
+            return;
+        const rt::vector oriented_normal = (h.get_ray_orientation() == Inward) ? normal : (-1.0_r) * normal;
+        if (not scene_.lights.empty())
+            acc.emitted_colors = acc.combine(direct_lighting(h, oriented_normal));
+        if (scene_.mapping_containers.background.is_importance_sampled())
+            acc.emitted_colors = acc.combine(environment_lighting(h, oriented_normal));
+        diffuse_pdf = std::max(0.0_r, next.direction | oriented_normal) / PI;
+    };
+
     if (m.is_opaque()) {
         /* Diffuse or specular reflection */
 
@@ -103,6 +117,9 @@ void worker::process_bounce(const bounce_parameters& param, path_parameters& out
             otherwise the reflection has the original color (like a tomato) */
             if (!is_specular_bounce || m.does_reflect_color())
                 acc.update_color_mat(color);
+
+            if (!is_specular_bounce)
+                diffuse_bounce(r);
         }
         else {
 
@@ -110,6 +127,7 @@ void worker::process_bounce(const bounce_parameters& param, path_parameters& out
 
             r = diffuse_case(h, normal);
             acc.update_color_mat(color);
+            diffuse_bounce(r);
         }
     }
     else {
@@ -167,15 +185,130 @@ void worker::process_bounce(const bounce_parameters& param, path_parameters& out
         }
     }
 
+    r.footprint = footprint;
+
     if (m.is_emissive())
         acc.update_emitted_col(m);
 }
 
-[[nodiscard]] inline rt::color worker::full_intensity_case(const accumulators& acc,
+/* Multiple importance sampling: power heuristic (beta = 2) */
+static inline real power_heuristic(const real pdf, const real other_pdf) {
+    const real pdf_sq = pdf * pdf;
+    return pdf_sq / (pdf_sq + other_pdf * other_pdf);
+}
+
+/* Determining the pixel of the background texture to display */
+[[nodiscard]] rt::color worker::background_case(const path_parameters& path) const {
+
+    const background_container& background = scene_.mapping_containers.background;
+    const rt::color& color = background.get_color(path.r.direction);
+
+    /* If the background could also have been sampled from the previous bounce,
+       its contribution is weighted against that of the background sampling */
+    if (path.diffuse_pdf > 0.0_r && background.is_importance_sampled()) {
+        const real weight = power_heuristic(path.diffuse_pdf, background.pdf(path.r.direction));
+        return path.acc.combine(color * weight);
+    }
+
+    return path.acc.combine(color);
+}
+
+[[nodiscard]] aov_sample worker::first_hit_values(const ray& r, const hit& h, const map_sample& maps) const {
+    return {
+        .albedo         = maps.texture_color,
+        .normal         = maps.normal_vector,
+        .depth          = (h.get_point() - r.origin).norm(),
+        .material_index = h.get_object()->get_material_index()
+    };
+}
+
+[[nodiscard]] aov_sample worker::first_hit_values(const ray& r) const {
+    return {
+        .albedo         = scene_.mapping_containers.background.get_color(r.direction),
+        .normal         = rt::vector(),
+        .depth          = 0.0_r,
+        .material_index = NO_MATERIAL
+    };
+}
+
+[[nodiscard]] rt::color worker::full_intensity_case(const path_parameters& path,
     const hit& h, const material& m) const {
     
     const rt::color& color = scene_.sample_color(h, m);
-    return acc.combine(color * m.get_emission_intensity());
+
+    /* If the light source could also have been sampled from the previous bounce,
+       its contribution is weighted against that of the light sampling */
+    real weight = 1.0_r;
+    if (path.diffuse_pdf > 0.0_r) {
+        const real pdf_area = scene_.lights.pdf_area(h.get_object());
+        const real cos_light = std::abs(path.r.direction | h.get_normal());
+        if (pdf_area > 0.0_r && cos_light > 0.0_r) {
+            const real pdf_light = pdf_area * (h.get_point() - path.r.origin).normsq() / cos_light;
+            weight = power_heuristic(path.diffuse_pdf, pdf_light);
+        }
+    }
+
+    return path.acc.combine(color * (m.get_emission_intensity() * weight));
+}
+
+/* Relative distance under which the point reached by the shadow ray is the sampled point */
+constexpr real LIGHT_POINT_TOLERANCE = 1e-3_r;
+
+[[nodiscard]] rt::color worker::direct_lighting(const hit& h, const rt::vector& oriented_normal) const {
+
+    const auto [ light, point, pdf_area ] = scene_.lights.sample(rg);
+
+    const rt::vector origin = h.biased_point(Outward);
+    const rt::vector to_light = point - origin;
+    const real dist_sq = to_light.normsq();
+    if (dist_sq <= 0.0_r)
+        return rt::BLACK;
+    const real dist = std::sqrt(dist_sq);
+    const rt::vector dir = to_light / dist;
+
+    const real cos_surface = dir | oriented_normal;
+    if (cos_surface <= 0.0_r)
+        return rt::BLACK;
+
+    /* Shadow ray: the first point hit must be the sampled point */
+    const std::optional<hit> opt_h = scene_.find_closest(ray(origin, dir), bvh);
+    if (not opt_h.has_value() || opt_h->get_object() != light
+        || (opt_h->get_point() - point).normsq() > (LIGHT_POINT_TOLERANCE * LIGHT_POINT_TOLERANCE) * dist_sq)
+        return rt::BLACK;
+
+    const hit& h_light = opt_h.value();
+    const real cos_light = std::abs(dir | h_light.get_normal());
+    if (cos_light <= 0.0_r)
+        return rt::BLACK;
+
+    /* Densities with respect to the solid angle: light sampling, and diffuse bounce (cos / pi) */
+    const real pdf_light = pdf_area * dist_sq / cos_light;
+    const real pdf_diffuse = cos_surface / PI;
+
+    const material& m = scene_.mapping_containers.material_set[light->get_material_index()];
+    const rt::color& color = scene_.sample_color(h_light, m);
+
+    /* The diffuse reflectance is color / pi, the color of the surface is applied by the accumulator */
+    return color * (m.get_emission_intensity() * power_heuristic(pdf_light, pdf_diffuse) * pdf_diffuse / pdf_light);
+}
+
+[[nodiscard]] rt::color worker::environment_lighting(const hit& h, const rt::vector& oriented_normal) const {
+
+    const background_container& background = scene_.mapping_containers.background;
+    const auto [ dir, pdf_env ] = background.sample_direction(rg);
+    if (pdf_env <= 0.0_r)
+        return rt::BLACK;
+
+    const real cos_surface = dir | oriented_normal;
+    if (cos_surface <= 0.0_r)
+        return rt::BLACK;
+
+    /* Shadow ray: the background is reached if no object is hit */
+    if (scene_.find_closest(ray(h.biased_point(Outward), dir), bvh).has_value())
+        return rt::BLACK;
+
+    const real pdf_diffuse = cos_surface / PI;
+    return background.get_color(dir) * (power_heuristic(pdf_env, pdf_diffuse) * pdf_diffuse / pdf_env);
 }
 
 /* Path tracing function */
@@ -188,24 +321,29 @@ void worker::process_bounce(const bounce_parameters& param, path_parameters& out
    in iterative form, we have an accumulator color_materials of the product of the a(k), k = n...,
    and an accumulator (emitted_colors) of the (product of a(j), j = n..k) * b(k). */
 
-rt::color worker::pathtrace(const ray& init_ray) const {
+rt::color worker::pathtrace(const ray& init_ray, aov_sample* const first_hit) const {
     
     refr_stack.set_empty();
 
     path_parameters path_param = {
         .r = init_ray,
         .acc = {},
-        .refr_index = init_refr_index
+        .refr_index = init_refr_index,
+        .refr_stack = refr_stack
     };
-    auto& [ r, acc, refr_index ] = path_param;
+    auto& [ r, acc, refr_index, _, _ ] = path_param;
 
     for (unsigned int i = 0; i < bounce; i++) {
 
         const std::optional<hit> opt_h = scene_.find_closest(r, bvh);
+        const bool record_first_hit = (i == 0 && first_hit != nullptr);
 
         /* No object hit: background color or background texture */
-        if (not opt_h.has_value()) 
-            return background_case(r.direction, acc);
+        if (not opt_h.has_value()) {
+            if (record_first_hit)
+                *first_hit = first_hit_values(r);
+            return background_case(path_param);
+        }
         
         
         /* Object hit */
@@ -215,8 +353,11 @@ rt::color worker::pathtrace(const ray& init_ray) const {
         const material&     m   = scene_.mapping_containers.material_set[obj->get_material_index()];
 
         /* Full-intensity light source reached */
-        if (m.is_emissive() && m.get_emission_intensity() >= 1.0_r)
-            return full_intensity_case(acc, h, m);
+        if (m.is_emissive() && m.get_emission_intensity() >= 1.0_r) {
+            if (record_first_hit)
+                *first_hit = first_hit_values(r, h, scene_.sample_maps(h, m, r));
+            return full_intensity_case(path_param, h, m);
+        }
 
         
         /* The ray can either be transmitted (and refracted) through the surface,
@@ -225,7 +366,10 @@ rt::color worker::pathtrace(const ray& init_ray) const {
         */
 
         // map_sample contains the local information: texture color and normal (and soon: smoothness and displacement)
-        const auto& [ color, normal ] = scene_.sample_maps(h, m);
+        const map_sample maps = scene_.sample_maps(h, m, r);
+        if (record_first_hit)
+            *first_hit = first_hit_values(r, h, maps);
+        const auto& [ color, normal ] = maps;
         
         const bounce_parameters param = { h, m, normal, color, m.get_smoothness() }; // or ms.smoothness
         
@@ -0,0 +1,157 @@
+#include "tracing/tracing.hpp"
+
+/* ******************************************************************** */
+/* ********************** Wavefront path tracing ********************** */
+
+/*  The paths of a batch of rays (the pixels of a tile) are traced together, one bounce at a time:
+    all the active rays are intersected in one loop, the hits are grouped by kind (miss, full-intensity emitter,
+    diffuse, specular, refractive) and each group is shaded in its own loop,
+    then the surviving paths are compacted for the next bounce.
+    The state of the generator of each path is saved after each of its bounces and restored before the next one,
+    so that each path has the same random decisions as in pathtrace, only the order of the computations changes. */
+
+void worker::wavefront_buffers::reserve(const std::size_t size) {
+
+    if (size <= capacity)
+        return;
+
+    paths.reserve(size);
+    states.reserve(size);
+    hits.resize(size);
+    groups.resize(size);
+    active.reserve(size);
+    sorted.resize(size);
+    survivors.reserve(size);
+    stacks = std::make_unique<refraction_stack[]>(size);
+    capacity = size;
+}
+
+worker::wavefront_group worker::classify(const std::optional<hit>& opt_h) const {
+
+    using enum wavefront_group;
+
+    if (not opt_h.has_value())
+        return Miss;
+
+    const material& m = scene_.mapping_containers.material_set[opt_h->get_object()->get_material_index()];
+
+    if (m.is_emissive() && m.get_emission_intensity() >= 1.0_r)
+        return Emitter;
+    if (not m.is_opaque())
+        return Refractive;
+    return m.is_specular() ? Specular : Diffuse;
+}
+
+void worker::pathtrace_wavefront(const std::span<const ray> init_rays, const std::span<const randomgen::state> init_states,
+    const std::span<rt::color> output, const std::span<aov_sample> first_hits) const {
+
+    wavefront_buffers& wf = wavefront;
+    const std::size_t size = init_rays.size();
+    wf.reserve(size);
+
+    wf.paths.clear();
+    wf.states.assign(init_states.begin(), init_states.end());
+    wf.active.clear();
+    for (std::size_t k = 0; k < size; k++) {
+        wf.stacks[k].set_empty();
+        wf.paths.push_back({
+            .r = init_rays[k],
+            .acc = {},
+            .refr_index = init_refr_index,
+            .refr_stack = wf.stacks[k]
+        });
+        wf.active.push_back(k);
+    }
+
+    for (unsigned int i = 0; i < bounce && not wf.active.empty(); i++) {
+
+        /* Intersection of all the active rays */
+        for (const uint32_t k : wf.active) {
+            std::optional<hit> opt_h = scene_.find_closest(wf.paths[k].r, bvh);
+            wf.hits[k].reset();
+            if (opt_h.has_value())
+                wf.hits[k].emplace(std::move(opt_h.value()));
+        }
+
+        const bool record_first_hits = (i == 0 && not first_hits.empty());
+
+        /* Grouping by kind of hit (counting sort) */
+        std::array<std::size_t, NUMBER_OF_WAVEFRONT_GROUPS + 1> offsets {};
+        for (const uint32_t k : wf.active) {
+            wf.groups[k] = classify(wf.hits[k]);
+            offsets[static_cast<std::size_t>(wf.groups[k]) + 1]++;
+        }
+        for (std::size_t g = 1; g <= NUMBER_OF_WAVEFRONT_GROUPS; g++) {
+            offsets[g] += offsets[g - 1];
+        }
+        const std::array<std::size_t, NUMBER_OF_WAVEFRONT_GROUPS + 1> starts = offsets;
+        for (const uint32_t k : wf.active) {
+            wf.sorted[offsets[static_cast<std::size_t>(wf.groups[k])]++] = k;
+        }
+
+        const auto group_range = [&] (const wavefront_group g) {
+            const std::size_t index = static_cast<std::size_t>(g);
+            return std::span(wf.sorted).subspan(starts[index], starts[index + 1] - starts[index]);
+        };
+
+        using enum wavefront_group;
+
+        /* No object hit: background color or background texture */
+        for (const uint32_t k : group_range(Miss)) {
+            if (record_first_hits)
+                first_hits[k] = first_hit_values(wf.paths[k].r);
+            rg.restore_state(wf.states[k]);
+            output[k] = background_case(wf.paths[k]);
+        }
+
+        /* Full-intensity light source reached */
+        for (const uint32_t k : group_range(Emitter)) {
+            const hit& h = wf.hits[k].value();
+            const material& m = scene_.mapping_containers.material_set[h.get_object()->get_material_index()];
+            if (record_first_hits)
+                first_hits[k] = first_hit_values(wf.paths[k].r, h, scene_.sample_maps(h, m, wf.paths[k].r));
+            rg.restore_state(wf.states[k]);
+            output[k] = full_intensity_case(wf.paths[k], h, m);
+        }
+
+        /* Bounces, group by group; the surviving paths are compacted for the next bounce */
+        wf.survivors.clear();
+        for (const wavefront_group g : { Diffuse, Specular, Refractive }) {
+            for (const uint32_t k : group_range(g)) {
+
+                const hit&      h = wf.hits[k].value();
+                const material& m = scene_.mapping_containers.material_set[h.get_object()->get_material_index()];
+                path_parameters& path = wf.paths[k];
+                rg.restore_state(wf.states[k]);
+
+                const map_sample maps = scene_.sample_maps(h, m, path.r);
+                if (record_first_hits)
+                    first_hits[k] = first_hit_values(path.r, h, maps);
+                const auto& [ color, normal ] = maps;
+                const bounce_parameters param = { h, m, normal, color, m.get_smoothness() };
+                process_bounce(param, path, false);
+
+                if (russian_roulette == russian_roulette_mode::Enabled) {
+                    const real avg = path.acc.color_materials.get_average_ratio();
+                    if (avg < 1.0_r) {
+                        if (rg.random_ratio() <= 1.0_r - avg) {
+                            output[k] = path.acc.emitted_colors;
+                            continue;
+                        }
+                        path.acc.color_materials /= avg;
+                    }
+                }
+
+                wf.states[k] = rg.save_state();
+                wf.survivors.push_back(k);
+            }
+        }
+
+        std::swap(wf.active, wf.survivors);
+    }
+
+    /* Maximum number of bounces reached: the final color is black */
+    for (const uint32_t k : wf.active) {
+        output[k] = wf.paths[k].acc.emitted_colors;
+    }
+}